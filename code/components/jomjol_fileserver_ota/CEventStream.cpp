@@ -0,0 +1,138 @@
+#include "CEventStream.h"
+
+#include <algorithm>
+
+
+CEventStream::CEventStream(int _maxSubscribers)
+{
+    maxSubscribers = _maxSubscribers;
+    lastId = 0;
+}
+
+
+std::string CEventStream::Format(const char *_event, uint32_t _id, const std::string &_data)
+{
+    std::string frame;
+    frame.reserve(_data.length() + 48);
+
+    frame.append("event: ").append(_event).append("\nid: ").append(std::to_string(_id)).append("\n");
+
+    // A line break would end the field, so every line gets its own data field (joined again by the browser)
+    size_t start = 0;
+    while (true) {
+        size_t end = _data.find('\n', start);
+        size_t length = ((end == std::string::npos) ? _data.length() : end) - start;
+
+        if ((length > 0) && (_data[start + length - 1] == '\r')) {
+            length--;
+        }
+
+        frame.append("data: ").append(_data, start, length).append("\n");
+
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+
+    frame.append("\n");
+    return frame;
+}
+
+
+std::string CEventStream::FormatHead(int _retryMs)
+{
+    return "HTTP/1.1 200 OK\r\n"
+           "Content-Type: text/event-stream\r\n"
+           "Cache-Control: no-cache\r\n"
+           "Connection: keep-alive\r\n"
+           "Access-Control-Allow-Origin: *\r\n"
+           "\r\n"
+           "retry: " + std::to_string(_retryMs) + "\n\n";
+}
+
+
+CEventStream::Frame CEventStream::Publish(const char *_event, const std::string &_data)
+{
+    Latest *entry = NULL;
+
+    for (int i = 0; i < latest.size(); ++i) {
+        if (latest[i].event == _event) {
+            entry = &latest[i];
+            break;
+        }
+    }
+
+    if (entry == NULL) {
+        latest.push_back(Latest());
+        entry = &latest.back();
+        entry->event = _event;
+    }
+    else if (entry->data == _data) {
+        return NULL;
+    }
+
+    entry->data = _data;
+    entry->frame = std::make_shared<const std::string>(Format(_event, ++lastId, _data));
+
+    return entry->frame;
+}
+
+
+std::vector<CEventStream::Frame> CEventStream::getLatest()
+{
+    std::vector<Frame> frames;
+
+    for (int i = 0; i < latest.size(); ++i) {
+        frames.push_back(latest[i].frame);
+    }
+
+    return frames;
+}
+
+
+bool CEventStream::Subscribe(int _fd)
+{
+    std::vector<int>::iterator it = std::find(subscribers.begin(), subscribers.end(), _fd);
+
+    if (it != subscribers.end()) {
+        subscribedIds[it - subscribers.begin()] = lastId;
+        return true;
+    }
+
+    if (subscribers.size() >= maxSubscribers) {
+        return false;
+    }
+
+    subscribers.push_back(_fd);
+    subscribedIds.push_back(lastId);
+    return true;
+}
+
+
+bool CEventStream::Unsubscribe(int _fd)
+{
+    std::vector<int>::iterator it = std::find(subscribers.begin(), subscribers.end(), _fd);
+
+    if (it == subscribers.end()) {
+        return false;
+    }
+
+    subscribedIds.erase(subscribedIds.begin() + (it - subscribers.begin()));
+    subscribers.erase(it);
+    return true;
+}
+
+
+std::vector<int> CEventStream::getSubscribers(uint32_t _id)
+{
+    std::vector<int> fds;
+
+    for (int i = 0; i < subscribers.size(); ++i) {
+        if (subscribedIds[i] < _id) {
+            fds.push_back(subscribers[i]);
+        }
+    }
+
+    return fds;
+}
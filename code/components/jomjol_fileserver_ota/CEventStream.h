@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef CEVENTSTREAM_H
+#define CEVENTSTREAM_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+
+/**
+ * Server-Sent Events (text/event-stream) to a limited number of subscribed sockets
+ * Each event gets formatted once into a frame which is shared by all subscribers (and by the sender
+ * while the frame is on its way). The last frame of each event name is kept, so a new subscriber
+ * gets the current state right away instead of polling for it. The last id at subscribing is kept per subscriber,
+ * frames up to it are part of the latest ones and must not be sent again.
+ * The class only uses the C/C++ standard library, the caller is responsible for locking.
+ */
+class CEventStream
+{
+public:
+    typedef std::shared_ptr<const std::string> Frame;
+
+protected:
+    struct Latest {
+        std::string event;
+        std::string data;
+        Frame frame;
+    };
+
+    std::vector<int> subscribers;
+    std::vector<uint32_t> subscribedIds;    // lastId at Subscribe(), same index as subscribers
+    int maxSubscribers;
+    std::vector<Latest> latest;
+    uint32_t lastId;
+
+public:
+    CEventStream(int _maxSubscribers);
+
+    /* "event: <name>\nid: <id>\ndata: <line>\n...\n", one data field per line of _data */
+    static std::string Format(const char *_event, uint32_t _id, const std::string &_data);
+
+    /* Status line and headers of the stream response, followed by the reconnection delay of the browser */
+    static std::string FormatHead(int _retryMs);
+
+    /**
+     * Formats the event and keeps it as the latest one of its name
+     * @return the frame to be sent to all subscribers, NULL if _data is the same as the latest one of this event
+     */
+    Frame Publish(const char *_event, const std::string &_data);
+
+    /* Latest frame of each event name, in the order the names were published first */
+    std::vector<Frame> getLatest();
+
+    /**
+     * To be called together with getLatest() (same lock), the later frames get sent by getSubscribers(_id)
+     * @return false if all places are taken, true also if _fd is already subscribed
+     */
+    bool Subscribe(int _fd);
+
+    /* False if _fd was not subscribed */
+    bool Unsubscribe(int _fd);
+
+    const std::vector<int> &getSubscribers() { return subscribers; };
+
+    /* Subscribers which did not get the frame with id _id by getLatest(), i.e. subscribed before it got published */
+    std::vector<int> getSubscribers(uint32_t _id);
+    uint32_t getLastId() { return lastId; };
+};
+
+#endif //CEVENTSTREAM_H
@@ -0,0 +1,74 @@
+#include "CGzip.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "miniz.h"
+
+
+static mz_bool gzip_put(const void *_buffer, int _length, void *_user)
+{
+    ((std::string *)_user)->append((const char *)_buffer, _length);
+    return MZ_TRUE;
+}
+
+
+static void gzip_put_le32(std::string *_out, uint32_t _value)
+{
+    for (int i = 0; i < 4; ++i) {
+        *_out += (char)((_value >> (8 * i)) & 0xFF);
+    }
+}
+
+
+size_t CGzip::GetWorkspaceSize()
+{
+    return sizeof(tdefl_compressor);
+}
+
+
+bool CGzip::Compress(const void *_data, size_t _length, std::string *_out, void *(*_alloc)(size_t), void (*_free)(void *))
+{
+    void *(*allocFunction)(size_t) = (_alloc != NULL) ? _alloc : malloc;
+    void (*freeFunction)(void *) = (_free != NULL) ? _free : free;
+
+    _out->clear();
+
+    void *workspace = allocFunction(GetWorkspaceSize());
+    if (workspace == NULL) {
+        return false;
+    }
+
+    bool ok = Compress(_data, _length, _out, workspace);
+    freeFunction(workspace);
+    return ok;
+}
+
+
+bool CGzip::Compress(const void *_data, size_t _length, std::string *_out, void *_workspace)
+{
+    // ID1, ID2, CM (deflate), FLG, MTIME (none), XFL, OS (unknown)
+    static const char header[10] = { 0x1f, (char)0x8b, 8, 0, 0, 0, 0, 0, 0, (char)0xff };
+    tdefl_compressor *compressor = (tdefl_compressor *)_workspace;
+
+    _out->clear();
+
+    if (compressor == NULL) {
+        return false;
+    }
+
+    _out->reserve(sizeof(header) + _length / 2 + 8);
+    _out->assign(header, sizeof(header));
+
+    bool ok = (tdefl_init(compressor, gzip_put, _out, TDEFL_DEFAULT_MAX_PROBES) == TDEFL_STATUS_OKAY) &&
+              (tdefl_compress_buffer(compressor, _data, _length, TDEFL_FINISH) == TDEFL_STATUS_DONE);
+
+    if (!ok) {
+        _out->clear();
+        return false;
+    }
+
+    gzip_put_le32(_out, (uint32_t)mz_crc32(MZ_CRC32_INIT, (const unsigned char *)_data, _length));
+    gzip_put_le32(_out, (uint32_t)_length);     // ISIZE, modulo 2^32
+    return true;
+}
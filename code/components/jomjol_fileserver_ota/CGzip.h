@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef CGZIP_H
+#define CGZIP_H
+
+#include <string>
+#include <stddef.h>
+
+
+/**
+ * gzip compression of a request body (RFC 1952, one member, deflate of miniz)
+ * The compressor needs about 312 kB. Callers which compress repeatedly should allocate this workspace once
+ * and pass it each time, so the PSRAM does not get fragmented by a large allocation per request.
+ * The class only uses the C/C++ standard library and the deflater of miniz.
+ */
+class CGzip
+{
+public:
+    static size_t GetWorkspaceSize();
+
+    /**
+     * @param _workspace GetWorkspaceSize() bytes for the compressor, it can be reused for the next call
+     * @return false if the compressor fails, _out is empty then
+     */
+    static bool Compress(const void *_data, size_t _length, std::string *_out, void *_workspace);
+
+    /**
+     * @param _alloc/_free memory for the compressor (e.g. PSRAM), NULL for malloc()/free()
+     * @return false if the compressor can not be allocated or fails, _out is empty then
+     */
+    static bool Compress(const void *_data, size_t _length, std::string *_out,
+                         void *(*_alloc)(size_t) = NULL, void (*_free)(void *) = NULL);
+};
+
+#endif //CGZIP_H
@@ -0,0 +1,150 @@
+#include "CHttpRange.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+
+/* Decimal number without sign, false if there is none */
+static bool parse_position(const char **_text, size_t *_value)
+{
+    const char *start = *_text;
+    char *end;
+
+    if (!isdigit((unsigned char)*start)) {
+        return false;
+    }
+
+    unsigned long long value = strtoull(start, &end, 10);
+    *_value = (value > (size_t)-1) ? (size_t)-1 : (size_t)value;
+    *_text = end;
+    return true;
+}
+
+
+CHttpRange::Result CHttpRange::Parse(const char *_range, const char *_ifRange, size_t _size, std::string _etag, std::string _lastModified,
+                                     size_t *_start, size_t *_length)
+{
+    *_start = 0;
+    *_length = _size;
+
+    if ((_range == NULL) || (strncasecmp(_range, "bytes=", 6) != 0)) {
+        return RANGE_NONE;  // No range or unknown unit
+    }
+
+    // The range only applies to the same version of the file
+    if ((_ifRange != NULL) && (*_ifRange != '\0') && (_etag != _ifRange) && (_lastModified != _ifRange)) {
+        return RANGE_NONE;
+    }
+
+    const char *spec = _range + 6;
+    while (*spec == ' ') {
+        spec++;
+    }
+
+    if (strchr(spec, ',') != NULL) {
+        return RANGE_NONE;  // Several ranges
+    }
+
+    size_t first, last;
+    bool hasLast;
+
+    if (*spec == '-') {
+        // Suffix: last n bytes
+        spec++;
+        size_t suffix;
+        if (!parse_position(&spec, &suffix) || (*spec != '\0')) {
+            return RANGE_NONE;
+        }
+
+        if ((suffix == 0) || (_size == 0)) {
+            return RANGE_NOT_SATISFIABLE;
+        }
+
+        first = (suffix < _size) ? _size - suffix : 0;
+        last = _size - 1;
+    }
+    else {
+        if (!parse_position(&spec, &first) || (*spec++ != '-')) {
+            return RANGE_NONE;
+        }
+
+        hasLast = parse_position(&spec, &last);
+        if ((*spec != '\0') || (hasLast && (last < first))) {
+            return RANGE_NONE;  // Invalid, gets ignored
+        }
+
+        if (first >= _size) {
+            return RANGE_NOT_SATISFIABLE;
+        }
+
+        if (!hasLast || (last >= _size)) {
+            last = _size - 1;
+        }
+    }
+
+    *_start = first;
+    *_length = last - first + 1;
+    return RANGE_PARTIAL;
+}
+
+
+std::string CHttpRange::GetETag(size_t _size, time_t _modified)
+{
+    char etag[40];
+
+    snprintf(etag, sizeof(etag), "\"%lx-%lx\"", (unsigned long)_size, (unsigned long)_modified);
+    return std::string(etag);
+}
+
+
+std::string CHttpRange::FormatHttpDate(time_t _time)
+{
+    char date[40];
+    struct tm timeinfo;
+
+    gmtime_r(&_time, &timeinfo);
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &timeinfo);   // Needs the "C" locale (as on the ESP)
+    return std::string(date);
+}
+
+
+std::string CHttpRange::FormatHead(Result _result, const char *_contentType, size_t _start, size_t _length, size_t _size,
+                                   std::string _etag, std::string _lastModified, std::string _extraHeaders)
+{
+    char line[100];
+    std::string head;
+
+    if (_result == RANGE_PARTIAL) {
+        head = "HTTP/1.1 206 Partial Content\r\n";
+        snprintf(line, sizeof(line), "Content-Range: bytes %lu-%lu/%lu\r\n",
+                 (unsigned long)_start, (unsigned long)(_start + _length - 1), (unsigned long)_size);
+        head += line;
+    }
+    else if (_result == RANGE_NOT_SATISFIABLE) {
+        head = "HTTP/1.1 416 Range Not Satisfiable\r\n";
+        snprintf(line, sizeof(line), "Content-Range: bytes */%lu\r\n", (unsigned long)_size);
+        head += line;
+        _length = 0;
+    }
+    else {
+        head = "HTTP/1.1 200 OK\r\n";
+    }
+
+    head += "Content-Type: " + std::string(_contentType) + "\r\n";
+    snprintf(line, sizeof(line), "Content-Length: %lu\r\n", (unsigned long)_length);
+    head += line;
+    head += "Accept-Ranges: bytes\r\n";
+
+    if (!_etag.empty()) {
+        head += "ETag: " + _etag + "\r\n";
+    }
+
+    if (!_lastModified.empty()) {
+        head += "Last-Modified: " + _lastModified + "\r\n";
+    }
+
+    return head + _extraHeaders + "\r\n";
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef CHTTPRANGE_H
+#define CHTTPRANGE_H
+
+#include <string>
+#include <stddef.h>
+#include <time.h>
+
+
+/**
+ * HTTP range requests of files (RFC 7233): Range, If-Range and the response head with Content-Length
+ * Only a single byte range is supported, a request with several ranges gets the whole file (allowed by
+ * the RFC). The validators are an ETag from size and modification time and the Last-Modified date.
+ * The class only uses the C/C++ standard library.
+ */
+class CHttpRange
+{
+public:
+    enum Result {
+        RANGE_NONE = 0,             // 200, whole file
+        RANGE_PARTIAL,              // 206, _start/_length
+        RANGE_NOT_SATISFIABLE,      // 416
+    };
+
+    /**
+     * Evaluate the request headers (NULL or empty if not present)
+     * @param _size file size
+     * @param _start, _length part to be sent (whole file for RANGE_NONE)
+     */
+    static Result Parse(const char *_range, const char *_ifRange, size_t _size, std::string _etag, std::string _lastModified,
+                        size_t *_start, size_t *_length);
+
+    static std::string GetETag(size_t _size, time_t _modified);
+
+    /* IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT" */
+    static std::string FormatHttpDate(time_t _time);
+
+    /**
+     * Status line and headers of the response, ends with the empty line
+     * @param _extraHeaders complete header lines ("Name: value\r\n"), may be empty
+     */
+    static std::string FormatHead(Result _result, const char *_contentType, size_t _start, size_t _length, size_t _size,
+                                  std::string _etag, std::string _lastModified, std::string _extraHeaders);
+};
+
+#endif //CHTTPRANGE_H
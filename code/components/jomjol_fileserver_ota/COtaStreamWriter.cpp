@@ -0,0 +1,136 @@
+#include "COtaStreamWriter.h"
+
+#include <stdio.h>
+#include <ctype.h>
+
+
+COtaStreamWriter::COtaStreamWriter(Partition *_partition, size_t _maxSize)
+{
+    partition = _partition;
+    maxSize = _maxSize;
+    expectedSize = 0;
+    written = 0;
+    started = false;
+    failed = false;
+}
+
+
+bool COtaStreamWriter::fail(std::string _error)
+{
+    if (started) {
+        partition->End(false);
+        started = false;
+    }
+
+    if (!failed) {
+        failed = true;
+        error = _error;
+    }
+
+    return false;
+}
+
+
+bool COtaStreamWriter::Begin(size_t _expectedSize, std::string _expectedMD5)
+{
+    expectedSize = _expectedSize;
+    expectedMD5 = "";
+    written = 0;
+    md5 = "";
+    failed = false;
+    error = "";
+    md5Init(&md5Context);
+
+    for (size_t i = 0; i < _expectedMD5.length(); ++i) {
+        expectedMD5 += (char)tolower((unsigned char)_expectedMD5[i]);
+    }
+
+    if (!expectedMD5.empty() && ((expectedMD5.length() != 32) || (expectedMD5.find_first_not_of("0123456789abcdef") != std::string::npos))) {
+        return fail("Invalid MD5 " + _expectedMD5);
+    }
+
+    if (expectedSize > maxSize) {
+        return fail("Image too large (" + std::to_string(expectedSize) + " bytes, partition " + std::to_string(maxSize) + " bytes)");
+    }
+
+    return true;
+}
+
+
+bool COtaStreamWriter::Write(const uint8_t *_data, size_t _length)
+{
+    if (failed) {
+        return false;
+    }
+
+    if (_length == 0) {
+        return true;
+    }
+
+    if (written == 0) {
+        // Nothing gets written if it is no firmware (e.g. a ZIP file)
+        if (_data[0] != IMAGE_MAGIC) {
+            return fail("Not a firmware image");
+        }
+
+        if (!partition->Begin()) {
+            return fail("Failed to start the OTA partition");
+        }
+        started = true;
+    }
+
+    if (written + _length > maxSize) {
+        return fail("Image larger than the partition (" + std::to_string(maxSize) + " bytes)");
+    }
+
+    md5Update(&md5Context, (uint8_t *)_data, _length);
+
+    if (!partition->Write(_data, _length)) {
+        return fail("Failed to write to the OTA partition");
+    }
+
+    written += _length;
+    return true;
+}
+
+
+bool COtaStreamWriter::Finish()
+{
+    if (failed) {
+        return false;
+    }
+
+    if (written == 0) {
+        return fail("No data received");
+    }
+
+    if ((expectedSize > 0) && (written != expectedSize)) {
+        return fail("Received " + std::to_string(written) + " of " + std::to_string(expectedSize) + " bytes");
+    }
+
+    char hex[3];
+    md5Finalize(&md5Context);
+    for (int i = 0; i < 16; ++i) {
+        snprintf(hex, sizeof(hex), "%02x", md5Context.digest[i]);
+        md5 += hex;
+    }
+
+    if (!expectedMD5.empty() && (md5 != expectedMD5)) {
+        return fail("MD5 mismatch (received " + md5 + ", expected " + expectedMD5 + ")");
+    }
+
+    started = false;
+    if (!partition->End(true)) {
+        failed = true;
+        error = "Image validation failed";
+        return false;
+    }
+
+    return true;
+}
+
+
+void COtaStreamWriter::Abort(std::string _error)
+{
+    fail(_error);
+}
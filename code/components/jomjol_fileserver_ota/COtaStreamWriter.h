@@ -0,0 +1,73 @@
+#pragma once
+
+#ifndef COTASTREAMWRITER_H
+#define COTASTREAMWRITER_H
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "md5.h"
+
+
+/**
+ * Firmware image written to the OTA partition while it gets received (no copy on the SD card)
+ * The first byte has to be the magic byte of an ESP image, otherwise nothing gets written. The size is
+ * checked against the partition and the announced length, the MD5 of all bytes against the expected one
+ * (e.g. computed by the web browser). The image only gets finished (validated by the partition writer)
+ * if all checks pass, otherwise it gets aborted.
+ * The partition writer is an interface, so it can be replaced by a file for tests.
+ * The class only uses the C/C++ standard library and md5.h.
+ */
+class COtaStreamWriter
+{
+public:
+    class Partition
+    {
+    public:
+        virtual ~Partition() {};
+        virtual bool Begin() = 0;
+        virtual bool Write(const uint8_t *_data, size_t _length) = 0;
+
+        /* _ok: finish and validate the image, otherwise abort it */
+        virtual bool End(bool _ok) = 0;
+    };
+
+protected:
+    Partition *partition;
+    size_t maxSize;
+    size_t expectedSize;        // 0: not known
+    size_t written;
+    std::string expectedMD5;    // Lower case hex, empty: not checked
+    std::string md5;
+    MD5Context md5Context;
+    bool started;
+    bool failed;
+    std::string error;
+
+    bool fail(std::string _error);
+
+public:
+    static const uint8_t IMAGE_MAGIC = 0xE9;   // ESP_IMAGE_HEADER_MAGIC
+
+    COtaStreamWriter(Partition *_partition, size_t _maxSize);
+
+    /**
+     * @param _expectedSize announced length (e.g. Content-Length), 0 if not known
+     * @param _expectedMD5 hex MD5 of the image, empty if not known
+     */
+    bool Begin(size_t _expectedSize, std::string _expectedMD5);
+    bool Write(const uint8_t *_data, size_t _length);
+
+    /* All data received: check size and MD5, then finish the image. False if it got aborted. */
+    bool Finish();
+
+    /* Abort, e.g. the connection got lost */
+    void Abort(std::string _error);
+
+    std::string getMD5() { return md5; };
+    std::string getError() { return error; };
+    size_t getWritten() { return written; };
+};
+
+#endif //COTASTREAMWRITER_H
@@ -0,0 +1,207 @@
+#include "CStaticFileIndex.h"
+#include "CHttpRange.h"
+
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+
+static bool ends_with_gz(const std::string &_name)
+{
+    return (_name.length() > 3) && (_name.compare(_name.length() - 3, 3, ".gz") == 0);
+}
+
+
+CStaticFileIndex::CStaticFileIndex()
+{
+    built = false;
+}
+
+
+void CStaticFileIndex::set(std::string _relative, bool _present, size_t _size, time_t _modified)
+{
+    bool gz = ends_with_gz(_relative);
+    std::string name = gz ? _relative.substr(0, _relative.length() - 3) : _relative;
+    Entry &entry = entries[name];       // New entries are value-initialized (not present)
+    Version &version = gz ? entry.gz : entry.plain;
+
+    version.present = _present;
+    version.size = _size;
+    version.modified = _modified;
+
+    if (gz) {
+        // A .gz file can also be requested by its own name
+        Entry &own = entries[_relative];
+        own.plain = version;
+    }
+
+    if (!entry.plain.present && !entry.gz.present) {
+        entries.erase(name);
+    }
+
+    if (gz && !_present) {
+        entries.erase(_relative);
+    }
+}
+
+
+void CStaticFileIndex::scan(std::string _folder, std::string _relative)
+{
+    DIR *dir = opendir(_folder.c_str());
+    if (dir == NULL) {
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) {
+            continue;
+        }
+
+        std::string path = _folder + "/" + entry->d_name;
+        std::string relative = _relative + "/" + entry->d_name;
+
+        if (entry->d_type == DT_DIR) {
+            scan(path, relative);
+            continue;
+        }
+
+        struct stat fileStat;
+        if (stat(path.c_str(), &fileStat) == 0) {
+            set(relative, true, fileStat.st_size, fileStat.st_mtime);
+        }
+    }
+    closedir(dir);
+}
+
+
+int CStaticFileIndex::Build(std::string _root)
+{
+    root = _root;
+    entries.clear();
+    scan(root, "");
+    built = true;
+
+    int files = 0;
+    for (std::map<std::string, Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (it->second.plain.present && !ends_with_gz(it->first)) {
+            files++;
+        }
+        if (it->second.gz.present) {
+            files++;
+        }
+    }
+
+    return files;
+}
+
+
+bool CStaticFileIndex::getRelative(std::string _path, std::string *_relative)
+{
+    if (!built || (_path.length() <= root.length() + 1) || (_path.compare(0, root.length(), root) != 0) || (_path[root.length()] != '/')) {
+        return false;
+    }
+
+    *_relative = _path.substr(root.length());
+    return true;
+}
+
+
+void CStaticFileIndex::Update(std::string _path)
+{
+    std::string relative;
+    if (!getRelative(_path, &relative)) {
+        return;
+    }
+
+    struct stat fileStat;
+    if ((stat(_path.c_str(), &fileStat) == 0) && !S_ISDIR(fileStat.st_mode)) {
+        set(relative, true, fileStat.st_size, fileStat.st_mtime);
+    }
+    else {
+        set(relative, false, 0, 0);
+    }
+}
+
+
+bool CStaticFileIndex::Covers(std::string _path)
+{
+    std::string relative;
+    return getRelative(_path, &relative);
+}
+
+
+bool CStaticFileIndex::Lookup(std::string _path, File *_file)
+{
+    std::string relative;
+    if (!getRelative(_path, &relative)) {
+        return false;
+    }
+
+    std::map<std::string, Entry>::iterator it = entries.find(relative);
+    if (it == entries.end()) {
+        return false;
+    }
+
+    const Version &version = it->second.gz.present ? it->second.gz : it->second.plain;
+
+    _file->gzip = it->second.gz.present;
+    _file->fileName = _file->gzip ? _path + ".gz" : _path;
+    _file->size = version.size;
+    _file->modified = version.modified;
+    _file->etag = CHttpRange::GetETag(version.size, version.modified);
+    return true;
+}
+
+
+bool CStaticFileIndex::IsNotModified(const char *_ifNoneMatch, const char *_ifModifiedSince, std::string _etag, std::string _lastModified)
+{
+    if ((_ifNoneMatch != NULL) && (*_ifNoneMatch != '\0')) {
+        // List of ETags or "*", weak comparison (a "W/" prefix gets ignored)
+        std::string list = _ifNoneMatch;
+        size_t pos = 0;
+
+        while (pos < list.length()) {
+            size_t end = list.find(',', pos);
+            if (end == std::string::npos) {
+                end = list.length();
+            }
+
+            std::string tag = list.substr(pos, end - pos);
+            size_t first = tag.find_first_not_of(" \t");
+            size_t last = tag.find_last_not_of(" \t");
+            tag = (first == std::string::npos) ? "" : tag.substr(first, last - first + 1);
+
+            if (tag.compare(0, 2, "W/") == 0) {
+                tag = tag.substr(2);
+            }
+
+            if ((tag == "*") || (!_etag.empty() && (tag == _etag))) {
+                return true;
+            }
+
+            pos = end + 1;
+        }
+
+        return false;
+    }
+
+    // Exact match only, the date of the file is the only one the client can have got from us
+    return (_ifModifiedSince != NULL) && !_lastModified.empty() && (_lastModified == _ifModifiedSince);
+}
+
+
+std::string CStaticFileIndex::FormatNotModified(std::string _etag, std::string _lastModified, std::string _extraHeaders)
+{
+    std::string head = "HTTP/1.1 304 Not Modified\r\n";
+
+    if (!_etag.empty()) {
+        head += "ETag: " + _etag + "\r\n";
+    }
+
+    if (!_lastModified.empty()) {
+        head += "Last-Modified: " + _lastModified + "\r\n";
+    }
+
+    return head + _extraHeaders + "\r\n";
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#ifndef CSTATICFILEINDEX_H
+#define CSTATICFILEINDEX_H
+
+#include <string>
+#include <map>
+#include <stddef.h>
+#include <time.h>
+
+
+/**
+ * In-memory index of the static web files (e.g. /sdcard/html)
+ * For each requested name it knows whether a precompressed .gz sibling exists and size, modification
+ * time and ETag of the file which gets sent. A request can then be answered with 304 Not Modified
+ * without touching the SD card, and the .gz lookup needs no stat() per request.
+ * The index gets built once by a scan of the folder and updated per file when files get written or deleted.
+ * The class only uses the C/C++ standard library and POSIX file functions, the caller is responsible for locking.
+ */
+class CStaticFileIndex
+{
+public:
+    struct File {
+        std::string fileName;       // File to be sent, with ".gz" if precompressed
+        bool gzip;
+        size_t size;
+        time_t modified;
+        std::string etag;           // See CHttpRange::GetETag()
+    };
+
+protected:
+    struct Version {
+        bool present;
+        size_t size;
+        time_t modified;
+    };
+
+    struct Entry {
+        Version plain;
+        Version gz;                 // <name>.gz
+    };
+
+    std::string root;
+    std::map<std::string, Entry> entries;   // Relative to the root, without ".gz"
+    bool built;
+
+    void scan(std::string _folder, std::string _relative);
+    void set(std::string _relative, bool _present, size_t _size, time_t _modified);
+    bool getRelative(std::string _path, std::string *_relative);
+
+public:
+    CStaticFileIndex();
+
+    /* Scan _root with its sub folders, replaces the previous index. Returns the number of files. */
+    int Build(std::string _root);
+
+    /* A file got written or deleted, paths outside of the root get ignored */
+    void Update(std::string _path);
+
+    /* True if _path is inside the indexed folder (a missing entry is then most likely a 404) */
+    bool Covers(std::string _path);
+
+    /* File to be sent for the requested _path, the .gz version if available */
+    bool Lookup(std::string _path, File *_file);
+
+    /**
+     * Conditional request: true if the client already has this version
+     * @param _ifNoneMatch, _ifModifiedSince request headers (NULL or empty if not present), If-None-Match takes precedence
+     */
+    static bool IsNotModified(const char *_ifNoneMatch, const char *_ifModifiedSince, std::string _etag, std::string _lastModified);
+
+    /* Response head of a 304 (no body), _extraHeaders are complete header lines */
+    static std::string FormatNotModified(std::string _etag, std::string _lastModified, std::string _extraHeaders);
+
+    size_t getSize() { return entries.size(); };
+    bool isBuilt() { return built; };
+};
+
+#endif //CSTATICFILEINDEX_H
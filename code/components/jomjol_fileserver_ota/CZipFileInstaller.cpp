@@ -0,0 +1,267 @@
+#include "CZipFileInstaller.h"
+
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <ctype.h>
+#include <algorithm>
+
+
+#define INSTALLER_NEW_SUFFIX    ".new"
+#define INSTALLER_OLD_SUFFIX    ".old"
+#define INSTALLER_REPLACED      'R'     // Manifest: existing file kept as .old
+#define INSTALLER_CREATED       'N'     // Manifest: new file
+
+
+static bool file_exists(std::string _path)
+{
+    struct stat fileStat;
+    return stat(_path.c_str(), &fileStat) == 0;
+}
+
+
+static std::string to_upper(std::string _text)
+{
+    for (size_t i = 0; i < _text.length(); ++i) {
+        _text[i] = toupper((unsigned char)_text[i]);
+    }
+    return _text;
+}
+
+
+CZipFileInstaller::CZipFileInstaller(std::string _manifestFile, MapFunction _mapName)
+{
+    manifestFile = _manifestFile;
+    mapName = _mapName;
+    entrySink = NULL;
+    file = NULL;
+    bytes = 0;
+}
+
+
+CZipFileInstaller::~CZipFileInstaller()
+{
+    if (file != NULL) {
+        fclose(file);
+        remove((target + INSTALLER_NEW_SUFFIX).c_str());
+    }
+}
+
+
+void CZipFileInstaller::SetEntrySink(std::string _name, CZipStream::Sink *_sink)
+{
+    entrySinks[to_upper(_name)] = _sink;
+}
+
+
+void CZipFileInstaller::MakeParentDirs(std::string _path)
+{
+    for (size_t pos = _path.find('/', 1); pos != std::string::npos; pos = _path.find('/', pos + 1)) {
+        mkdir(_path.substr(0, pos).c_str(), 0775);     // Fails for existing folders
+    }
+}
+
+
+/* Append a line to the manifest before the step is done, so a rollback always knows about it */
+bool CZipFileInstaller::note(char _action, std::string _path)
+{
+    FILE *manifest = fopen(manifestFile.c_str(), "a");
+    if (manifest == NULL) {
+        return false;
+    }
+
+    bool ok = fprintf(manifest, "%c %s\n", _action, _path.c_str()) > 0;
+    ok = (fclose(manifest) == 0) && ok;
+    return ok;
+}
+
+
+bool CZipFileInstaller::IsSafeName(std::string _name)
+{
+    return !_name.empty() && (_name[0] != '/') && (_name[0] != '\\') && (_name.find("..") == std::string::npos);
+}
+
+
+bool CZipFileInstaller::Begin(std::string _name, uint32_t _size)
+{
+    if (!IsSafeName(_name)) {
+        return false;
+    }
+
+    std::map<std::string, CZipStream::Sink *>::iterator it = entrySinks.find(to_upper(_name));
+    entrySink = (it != entrySinks.end()) ? it->second : NULL;
+
+    if (entrySink != NULL) {
+        return entrySink->Begin(_name, _size);
+    }
+
+    target = mapName(_name);
+    if (target.empty()) {
+        return false;
+    }
+
+    MakeParentDirs(target);
+    file = fopen((target + INSTALLER_NEW_SUFFIX).c_str(), "wb");   // NULL: Write() fails
+    return true;
+}
+
+
+bool CZipFileInstaller::Write(const uint8_t *_data, size_t _length)
+{
+    if (entrySink != NULL) {
+        return entrySink->Write(_data, _length);
+    }
+
+    if ((file == NULL) || (fwrite(_data, 1, _length, file) != _length)) {
+        return false;
+    }
+
+    bytes += _length;
+    return true;
+}
+
+
+bool CZipFileInstaller::End(bool _ok)
+{
+    if (entrySink != NULL) {
+        CZipStream::Sink *sink = entrySink;
+        entrySink = NULL;
+        return sink->End(_ok);
+    }
+
+    std::string newFile = target + INSTALLER_NEW_SUFFIX;
+    std::string oldFile = target + INSTALLER_OLD_SUFFIX;
+
+    bool ok = (file != NULL) && (fclose(file) == 0) && _ok;
+    file = NULL;
+
+    if (!ok) {
+        remove(newFile.c_str());
+        return false;
+    }
+
+    if (std::find(installed.begin(), installed.end(), target) != installed.end()) {
+        // Same target again (e.g. config-initial and config), the first backup stays
+        ok = (remove(target.c_str()) == 0);
+    }
+    else if (file_exists(target)) {
+        remove(oldFile.c_str());
+        ok = note(INSTALLER_REPLACED, target) && (rename(target.c_str(), oldFile.c_str()) == 0);
+    }
+    else {
+        ok = note(INSTALLER_CREATED, target);
+    }
+
+    ok = ok && (rename(newFile.c_str(), target.c_str()) == 0);
+
+    if (!ok) {
+        remove(newFile.c_str());
+        return false;
+    }
+
+    installed.push_back(target);
+    return true;
+}
+
+
+void CZipFileInstaller::Commit()
+{
+    FILE *manifest = fopen(manifestFile.c_str(), "r");
+    char line[300];
+
+    if (manifest != NULL) {
+        while (fgets(line, sizeof(line), manifest) != NULL) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if ((line[0] == INSTALLER_REPLACED) && (line[1] == ' ')) {
+                remove((std::string(line + 2) + INSTALLER_OLD_SUFFIX).c_str());
+            }
+        }
+        fclose(manifest);
+    }
+
+    remove(manifestFile.c_str());
+}
+
+
+int CZipFileInstaller::RemoveOthers(std::string _folder)
+{
+    DIR *dir = opendir(_folder.c_str());
+    int deleted = 0;
+
+    if (dir == NULL) {
+        return 0;
+    }
+
+    struct dirent *entry;
+    std::vector<std::string> folders;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) {
+            continue;
+        }
+
+        std::string path = _folder + "/" + entry->d_name;
+
+        if (entry->d_type == DT_DIR) {
+            folders.push_back(path);
+        }
+        else if ((std::find(installed.begin(), installed.end(), path) == installed.end()) && (remove(path.c_str()) == 0)) {
+            deleted++;
+        }
+    }
+    closedir(dir);
+
+    for (size_t i = 0; i < folders.size(); ++i) {
+        deleted += RemoveOthers(folders[i]);
+        rmdir(folders[i].c_str());  // Only if empty
+    }
+
+    return deleted;
+}
+
+
+int CZipFileInstaller::Rollback(std::string _manifestFile)
+{
+    FILE *manifest = fopen(_manifestFile.c_str(), "r");
+    if (manifest == NULL) {
+        return -1;
+    }
+
+    std::vector<std::string> lines;
+    char line[300];
+
+    while (fgets(line, sizeof(line), manifest) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if ((strlen(line) > 2) && (line[1] == ' ')) {
+            lines.push_back(line);
+        }
+    }
+    fclose(manifest);
+
+    int restored = 0;
+
+    // Newest first
+    for (int i = (int)lines.size() - 1; i >= 0; --i) {
+        std::string path = lines[i].substr(2);
+        std::string oldFile = path + INSTALLER_OLD_SUFFIX;
+
+        remove((path + INSTALLER_NEW_SUFFIX).c_str());
+
+        if (lines[i][0] == INSTALLER_CREATED) {
+            if (remove(path.c_str()) == 0) {
+                restored++;
+            }
+        }
+        else if ((lines[i][0] == INSTALLER_REPLACED) && file_exists(oldFile)) {
+            // Without the .old file the update stopped before the file got replaced
+            remove(path.c_str());
+            if (rename(oldFile.c_str(), path.c_str()) == 0) {
+                restored++;
+            }
+        }
+    }
+
+    remove(_manifestFile.c_str());
+    return restored;
+}
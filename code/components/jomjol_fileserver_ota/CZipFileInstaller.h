@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef CZIPFILEINSTALLER_H
+#define CZIPFILEINSTALLER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <stdio.h>
+
+#include "CZipStream.h"
+
+
+/**
+ * Sink of CZipStream which writes the entries to their final location
+ * Each file gets written next to its target (".new") and then renamed, so a file is never half written.
+ * A file which gets replaced is kept as ".old" until Commit(). Every step is noted in a manifest file
+ * first, Rollback() (e.g. after a failed update or on the next boot) restores the previous state.
+ * Single entries can be passed to another sink instead (e.g. the firmware into the OTA partition).
+ * The class only uses the C/C++ standard library and POSIX file functions.
+ */
+class CZipFileInstaller : public CZipStream::Sink
+{
+public:
+    /* Target path of an entry, empty to skip it */
+    typedef std::function<std::string(std::string _name)> MapFunction;
+
+protected:
+    std::string manifestFile;
+    MapFunction mapName;
+    std::map<std::string, CZipStream::Sink *> entrySinks;  // Upper case name
+    CZipStream::Sink *entrySink;    // Current entry goes to this sink
+    FILE *file;
+    std::string target;
+    std::vector<std::string> installed;
+    size_t bytes;
+
+    bool note(char _action, std::string _path);
+
+public:
+    CZipFileInstaller(std::string _manifestFile, MapFunction _mapName);
+    ~CZipFileInstaller();
+
+    /* Entry _name (not case sensitive) goes to _sink, it is not noted in the manifest */
+    void SetEntrySink(std::string _name, CZipStream::Sink *_sink);
+
+    bool Begin(std::string _name, uint32_t _size);
+    bool Write(const uint8_t *_data, size_t _length);
+    bool End(bool _ok);
+
+    /* Keep the new files: delete the replaced ones and the manifest */
+    void Commit();
+
+    /**
+     * Delete the files below _folder which are not part of this installation (the folder gets replaced)
+     * Only after Commit(), before it the .old files of a possible rollback would get deleted as well.
+     * @return number of deleted files
+     */
+    int RemoveOthers(std::string _folder);
+
+    /**
+     * Undo the installation noted in _manifestFile, nothing to do if there is none
+     * @return number of restored or deleted files, -1 if there was no manifest
+     */
+    static int Rollback(std::string _manifestFile);
+
+    /* False for entry names which could leave the target folder (absolute or with ".."), such entries get skipped */
+    static bool IsSafeName(std::string _name);
+
+    /* Create the folders of a path */
+    static void MakeParentDirs(std::string _path);
+
+    std::vector<std::string> *getInstalled() { return &installed; };
+    size_t getBytes() { return bytes; };
+};
+
+#endif //CZIPFILEINSTALLER_H
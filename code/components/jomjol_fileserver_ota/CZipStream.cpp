@@ -0,0 +1,319 @@
+#include "CZipStream.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "miniz.h"
+
+
+#define ZIP_LOCAL_HEADER_SIGNATURE      0x04034b50
+#define ZIP_CENTRAL_HEADER_SIGNATURE    0x02014b50
+#define ZIP_END_SIGNATURE               0x06054b50
+#define ZIP_DESCRIPTOR_SIGNATURE        0x08074b50
+#define ZIP_LOCAL_HEADER_SIZE           30
+
+#define ZIP_FLAG_ENCRYPTED              0x0001
+#define ZIP_FLAG_DESCRIPTOR             0x0008
+
+#define ZIP_METHOD_STORED               0
+#define ZIP_METHOD_DEFLATED             8
+
+
+static uint16_t read16(const uint8_t *_data)
+{
+    return _data[0] | (_data[1] << 8);
+}
+
+
+static uint32_t read32(const uint8_t *_data)
+{
+    return _data[0] | (_data[1] << 8) | (_data[2] << 16) | ((uint32_t)_data[3] << 24);
+}
+
+
+CZipStream::CZipStream(Sink *_sink, void *(*_alloc)(size_t), void (*_free)(void *))
+{
+    sink = _sink;
+    state = STATE_HEADER;
+    entries = 0;
+    inEntry = false;
+    moreOutput = false;
+    allocFunction = (_alloc != NULL) ? _alloc : malloc;
+    freeFunction = (_free != NULL) ? _free : free;
+
+    inflator = (tinfl_decompressor *)allocFunction(sizeof(tinfl_decompressor));
+    dictionary = (uint8_t *)allocFunction(TINFL_LZ_DICT_SIZE);
+
+    if ((inflator == NULL) || (dictionary == NULL)) {
+        fail("Not enough memory for the inflater");
+    }
+}
+
+
+CZipStream::~CZipStream()
+{
+    if (inflator != NULL) {
+        freeFunction(inflator);
+    }
+
+    if (dictionary != NULL) {
+        freeFunction(dictionary);
+    }
+}
+
+
+void CZipStream::fail(std::string _error)
+{
+    if (inEntry && !skip) {
+        sink->End(false);
+    }
+
+    inEntry = false;
+    error = _error;
+    state = STATE_ERROR;
+}
+
+
+/* Append input to the pending bytes until there are _needed, true if complete */
+bool CZipStream::collect(const uint8_t **_data, size_t *_length, size_t _needed)
+{
+    size_t take = std::min(_needed - pending.size(), *_length);
+
+    pending.insert(pending.end(), *_data, *_data + take);
+    *_data += take;
+    *_length -= take;
+
+    return pending.size() == _needed;
+}
+
+
+bool CZipStream::startEntry()
+{
+    const uint8_t *header = pending.data();
+
+    flags = read16(header + 6);
+    method = read16(header + 8);
+    crcExpected = read32(header + 14);
+    compressedSize = read32(header + 18);
+    size = read32(header + 22);
+    name = std::string((const char *)header + ZIP_LOCAL_HEADER_SIZE, read16(header + 26));
+
+    if (flags & ZIP_FLAG_ENCRYPTED) {
+        fail("Encrypted entry " + name);
+        return false;
+    }
+
+    if ((method != ZIP_METHOD_STORED) && (method != ZIP_METHOD_DEFLATED)) {
+        fail("Unsupported compression of " + name);
+        return false;
+    }
+
+    if ((compressedSize == 0xFFFFFFFF) || (size == 0xFFFFFFFF)) {
+        fail("ZIP64 entry " + name);
+        return false;
+    }
+
+    if ((method == ZIP_METHOD_STORED) && (flags & ZIP_FLAG_DESCRIPTOR)) {
+        fail("Stored entry with unknown size " + name);    // The end can not be found
+        return false;
+    }
+
+    bool folder = !name.empty() && (name[name.length() - 1] == '/');
+
+    crc = (uint32_t)mz_crc32(MZ_CRC32_INIT, NULL, 0);
+    written = 0;
+    consumed = 0;
+    dictionaryOffset = 0;
+    moreOutput = false;
+    tinfl_init(inflator);
+
+    skip = folder || !sink->Begin(name, (flags & ZIP_FLAG_DESCRIPTOR) ? 0 : size);
+    inEntry = true;
+    return true;
+}
+
+
+bool CZipStream::output(const uint8_t *_data, size_t _length)
+{
+    if (_length == 0) {
+        return true;
+    }
+
+    crc = (uint32_t)mz_crc32(crc, _data, _length);
+    written += _length;
+
+    if (!skip && !sink->Write(_data, _length)) {
+        fail("Failed to write " + name);
+        return false;
+    }
+
+    return true;
+}
+
+
+void CZipStream::inflateData(const uint8_t **_data, size_t *_length)
+{
+    size_t inLength = *_length;
+    mz_uint32 inflateFlags = TINFL_FLAG_HAS_MORE_INPUT;
+
+    if (!(flags & ZIP_FLAG_DESCRIPTOR)) {
+        inLength = std::min(inLength, (size_t)(compressedSize - consumed));
+        if (inLength == compressedSize - consumed) {
+            inflateFlags = 0;   // All of the entry
+        }
+    }
+
+    size_t outLength = TINFL_LZ_DICT_SIZE - dictionaryOffset;
+    tinfl_status status = tinfl_decompress(inflator, *_data, &inLength, dictionary, dictionary + dictionaryOffset, &outLength, inflateFlags);
+
+    *_data += inLength;
+    *_length -= inLength;
+    consumed += inLength;
+
+    if (!output(dictionary + dictionaryOffset, outLength)) {
+        return;
+    }
+    dictionaryOffset = (dictionaryOffset + outLength) & (TINFL_LZ_DICT_SIZE - 1);
+
+    moreOutput = (status == TINFL_STATUS_HAS_MORE_OUTPUT);
+
+    if (status < TINFL_STATUS_DONE) {
+        fail("Corrupt data in " + name);
+    }
+    else if (status == TINFL_STATUS_DONE) {
+        finishData();
+    }
+}
+
+
+void CZipStream::finishData()
+{
+    if (flags & ZIP_FLAG_DESCRIPTOR) {
+        pending.clear();
+        state = STATE_DESCRIPTOR;
+        return;
+    }
+
+    if (consumed != compressedSize) {
+        fail("Size mismatch of " + name);
+        return;
+    }
+
+    endEntry();
+}
+
+
+void CZipStream::endEntry()
+{
+    bool ok = (crc == crcExpected) && (written == size);
+
+    inEntry = false;
+    entries++;
+
+    if (!skip && !sink->End(ok) && ok) {
+        fail("Failed to write " + name);
+        return;
+    }
+
+    if (!ok) {
+        fail("CRC error in " + name);
+        return;
+    }
+
+    pending.clear();
+    state = STATE_HEADER;
+}
+
+
+CZipStream::Status CZipStream::Feed(const uint8_t *_data, size_t _length)
+{
+    while (((_length > 0) || moreOutput) && (state != STATE_DONE) && (state != STATE_ERROR)) {
+        switch (state) {
+            case STATE_HEADER:
+                if ((pending.size() < 4) && !collect(&_data, &_length, 4)) {
+                    break;
+                }
+
+                if ((read32(pending.data()) == ZIP_CENTRAL_HEADER_SIGNATURE) || (read32(pending.data()) == ZIP_END_SIGNATURE)) {
+                    state = STATE_DONE;     // The rest is not needed
+                }
+                else if (read32(pending.data()) != ZIP_LOCAL_HEADER_SIGNATURE) {
+                    fail((entries == 0) ? "Not a ZIP file" : "Invalid local header");
+                }
+                else if (collect(&_data, &_length, ZIP_LOCAL_HEADER_SIZE)) {
+                    nameLength = read16(pending.data() + 26) + read16(pending.data() + 28);
+                    state = STATE_NAME;
+                }
+                break;
+
+            case STATE_NAME:
+                if (!collect(&_data, &_length, ZIP_LOCAL_HEADER_SIZE + nameLength) || !startEntry()) {
+                    break;
+                }
+
+                state = STATE_DATA;
+                if ((method == ZIP_METHOD_STORED) && (compressedSize == 0)) {
+                    finishData();
+                }
+                break;
+
+            case STATE_DATA:
+                if (method == ZIP_METHOD_DEFLATED) {
+                    inflateData(&_data, &_length);
+                }
+                else {
+                    size_t take = std::min(_length, (size_t)(compressedSize - consumed));
+                    if (output(_data, take)) {
+                        _data += take;
+                        _length -= take;
+                        consumed += take;
+
+                        if (consumed == compressedSize) {
+                            finishData();
+                        }
+                    }
+                }
+                break;
+
+            case STATE_DESCRIPTOR:
+                if ((pending.size() < 4) && !collect(&_data, &_length, 4)) {
+                    break;
+                }
+
+                // The signature is optional: CRC, compressed size, size
+                if (collect(&_data, &_length, (read32(pending.data()) == ZIP_DESCRIPTOR_SIGNATURE) ? 16 : 12)) {
+                    const uint8_t *descriptor = pending.data() + pending.size() - 12;
+                    crcExpected = read32(descriptor);
+                    size = read32(descriptor + 8);
+
+                    if (read32(descriptor + 4) != consumed) {
+                        fail("Size mismatch of " + name);
+                    }
+                    else {
+                        endEntry();
+                    }
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (state == STATE_DONE) {
+        return STATUS_DONE;
+    }
+
+    return (state == STATE_ERROR) ? STATUS_ERROR : STATUS_MORE;
+}
+
+
+CZipStream::Status CZipStream::Finish()
+{
+    if ((state != STATE_DONE) && (state != STATE_ERROR)) {
+        fail("Incomplete ZIP file");
+    }
+
+    return (state == STATE_DONE) ? STATUS_DONE : STATUS_ERROR;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#ifndef CZIPSTREAM_H
+#define CZIPSTREAM_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+struct tinfl_decompressor_tag;
+
+
+/**
+ * Extraction of a ZIP file while it gets read (or received), without the central directory
+ * The data is fed in pieces of any size. The local headers get parsed, stored and deflated entries
+ * are passed to a sink as they get inflated (32 kB dictionary, no buffer of the entry size needed).
+ * Entries with a data descriptor (streamed ZIP files) are supported, CRC and size get checked.
+ * Encrypted and ZIP64 entries are not supported. The stream ends with the central directory.
+ * The class only uses the C/C++ standard library and the inflater of miniz.
+ */
+class CZipStream
+{
+public:
+    class Sink
+    {
+    public:
+        virtual ~Sink() {};
+
+        /* New entry (not for folders), _size is 0 if not known yet (data descriptor). Return false to skip it. */
+        virtual bool Begin(std::string _name, uint32_t _size) = 0;
+        virtual bool Write(const uint8_t *_data, size_t _length) = 0;
+
+        /* Entry complete, _ok is false after a CRC or write error or if the stream broke off */
+        virtual bool End(bool _ok) = 0;
+    };
+
+    enum Status {
+        STATUS_MORE = 0,            // Waiting for more data
+        STATUS_DONE,                // Central directory reached, all entries extracted
+        STATUS_ERROR,
+    };
+
+protected:
+    enum State {
+        STATE_HEADER = 0,
+        STATE_NAME,
+        STATE_DATA,
+        STATE_DESCRIPTOR,
+        STATE_DONE,
+        STATE_ERROR,
+    };
+
+    Sink *sink;
+    State state;
+    std::vector<uint8_t> pending;   // Header bytes collected so far
+    std::string error;
+    int entries;
+
+    // Current entry
+    std::string name;
+    uint16_t flags;
+    uint16_t method;
+    uint32_t crcExpected;
+    uint32_t compressedSize;
+    uint32_t size;
+    size_t nameLength;              // Name and extra field
+    bool skip;
+    bool inEntry;
+    uint32_t crc;
+    uint32_t written;
+    uint32_t consumed;
+
+    tinfl_decompressor_tag *inflator;
+    uint8_t *dictionary;
+    size_t dictionaryOffset;
+    bool moreOutput;                // The inflater has more output for the input it already got
+
+    void *(*allocFunction)(size_t);
+    void (*freeFunction)(void *);
+
+    bool collect(const uint8_t **_data, size_t *_length, size_t _needed);
+    bool startEntry();
+    void inflateData(const uint8_t **_data, size_t *_length);
+    bool output(const uint8_t *_data, size_t _length);
+    void finishData();
+    void endEntry();
+    void fail(std::string _error);
+
+public:
+    /* _alloc/_free: memory for the inflater (about 43 kB, e.g. PSRAM), NULL for malloc()/free() */
+    CZipStream(Sink *_sink, void *(*_alloc)(size_t) = NULL, void (*_free)(void *) = NULL);
+    ~CZipStream();
+
+    Status Feed(const uint8_t *_data, size_t _length);
+
+    /* End of the input, an error if the central directory was not reached */
+    Status Finish();
+
+    std::string getError() { return error; };
+    int getEntries() { return entries; };
+};
+
+#endif //CZIPSTREAM_H
@@ -0,0 +1,221 @@
+#include "server_events.h"
+
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+
+#include "ClassLogFile.h"
+#include "CEventStream.h"
+#include "basic_auth.h"
+#include "../../include/defines.h"
+
+static const char *TAG = "EVENTS";
+
+static CEventStream stream(SERVER_EVENTS_MAX_SUBSCRIBERS);
+static SemaphoreHandle_t eventsMutex = NULL;
+static httpd_handle_t eventsServer = NULL;
+typedef struct pending_frame {
+    CEventStream::Frame frame;
+    uint32_t id;
+    std::vector<int> fds;           // Filled by the webserver task: the subscribers which still need the frame
+} pending_frame_t;
+
+static std::vector<pending_frame_t> pendingFrames;          // Published, not yet sent by the webserver task
+static bool sendQueued = false;
+
+
+void server_events_init(void)
+{
+    if (eventsMutex != NULL) {
+        return;
+    }
+
+    eventsMutex = xSemaphoreCreateMutex();
+    if (eventsMutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create mutex, events disabled");
+    }
+}
+
+
+/* False before server_events_init() */
+static bool events_lock(void)
+{
+    if (eventsMutex == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(eventsMutex, portMAX_DELAY);
+    return true;
+}
+
+
+/* Webserver task only */
+static bool events_send(httpd_handle_t _server, int _fd, const std::string &_data)
+{
+    size_t sent = 0;
+
+    while (sent < _data.length()) {
+        int result = httpd_socket_send(_server, _fd, _data.data() + sent, _data.length() - sent, 0);
+        if (result <= 0) {
+            return false;
+        }
+        sent += result;
+    }
+
+    return true;
+}
+
+
+/* Runs in the webserver task (httpd_queue_work), so the sockets are not used by two tasks at once */
+static void events_send_work(void *_arg)
+{
+    std::vector<pending_frame_t> frames;
+    std::vector<int> gone;
+
+    if (!events_lock()) {
+        return;
+    }
+    frames.swap(pendingFrames);
+    for (int i = 0; i < frames.size(); ++i) {
+        // A subscriber which came after the publish already got the frame (or a newer one) with the latest frames
+        frames[i].fds = stream.getSubscribers(frames[i].id);
+    }
+    sendQueued = false;
+    xSemaphoreGive(eventsMutex);
+
+    for (int i = 0; i < frames.size(); ++i) {
+        for (int j = 0; j < frames[i].fds.size(); ++j) {
+            int fd = frames[i].fds[j];
+
+            if ((std::find(gone.begin(), gone.end(), fd) == gone.end()) && !events_send(eventsServer, fd, *frames[i].frame)) {
+                ESP_LOGD(TAG, "Subscriber %d gone", fd);
+                gone.push_back(fd);
+
+                if (events_lock()) {
+                    stream.Unsubscribe(fd);
+                    xSemaphoreGive(eventsMutex);
+                }
+                httpd_sess_trigger_close(eventsServer, fd);
+            }
+        }
+    }
+}
+
+
+void server_events_publish(const char *_event, const std::string &_data)
+{
+    if (!events_lock()) {
+        return;
+    }
+
+    CEventStream::Frame frame = stream.Publish(_event, _data);
+
+    // Without subscribers it is only kept for the next one
+    if ((frame != NULL) && (eventsServer != NULL) && !stream.getSubscribers().empty()) {
+        pending_frame_t pending;
+        pending.frame = frame;
+        pending.id = stream.getLastId();
+        pendingFrames.push_back(pending);
+
+        if (!sendQueued) {
+            sendQueued = (httpd_queue_work(eventsServer, events_send_work, NULL) == ESP_OK);
+
+            if (!sendQueued) {
+                ESP_LOGW(TAG, "Failed to queue event %s", _event);
+                pendingFrames.clear();
+            }
+        }
+    }
+
+    xSemaphoreGive(eventsMutex);
+}
+
+
+void server_events_close_fn(httpd_handle_t _server, int _sockfd)
+{
+    if (events_lock()) {
+        if (stream.Unsubscribe(_sockfd)) {
+            ESP_LOGD(TAG, "Subscriber %d closed", _sockfd);
+        }
+        xSemaphoreGive(eventsMutex);
+    }
+
+    close(_sockfd);
+}
+
+
+int server_events_get_subscribers(void)
+{
+    int count = 0;
+
+    if (events_lock()) {
+        count = stream.getSubscribers().size();
+        xSemaphoreGive(eventsMutex);
+    }
+
+    return count;
+}
+
+
+/**
+ * The response head gets written directly to the socket and the handler returns without finishing the response,
+ * the socket stays open and gets the events of server_events_publish(). The browser (EventSource) reconnects
+ * by itself after the connection got closed, e.g. by the least recently used purge of the webserver.
+ */
+static esp_err_t handler_events(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    std::vector<CEventStream::Frame> frames;
+
+    if (!events_lock()) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Event stream not available");
+        return ESP_FAIL;
+    }
+    bool subscribed = stream.Subscribe(fd);
+    frames = stream.getLatest();
+    xSemaphoreGive(eventsMutex);
+
+    if (!subscribed) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "60");
+        httpd_resp_sendstr(req, "Too many event subscribers, poll /json instead");
+        return ESP_OK;
+    }
+
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "New subscriber " + std::to_string(fd));
+
+    bool ok = events_send(req->handle, fd, CEventStream::FormatHead(SERVER_EVENTS_RETRY));
+
+    for (int i = 0; ok && (i < frames.size()); ++i) {
+        ok = events_send(req->handle, fd, *frames[i]);
+    }
+
+    if (!ok) {
+        if (events_lock()) {
+            stream.Unsubscribe(fd);
+            xSemaphoreGive(eventsMutex);
+        }
+        return ESP_FAIL;        // Closes the socket
+    }
+
+    return ESP_OK;
+}
+
+
+void register_server_events_uri(httpd_handle_t server)
+{
+    ESP_LOGI(TAG, "Registering URI handlers");
+
+    eventsServer = server;
+
+    httpd_uri_t uri = { };
+    uri.uri = "/events";
+    uri.method = HTTP_GET;
+    uri.handler = APPLY_BASIC_AUTH_FILTER(handler_events);
+    uri.user_ctx = NULL;
+    httpd_register_uri_handler(server, &uri);
+}
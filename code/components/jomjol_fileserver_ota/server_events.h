@@ -0,0 +1,30 @@
+#pragma once
+
+#ifndef SERVEREVENTS_H
+#define SERVEREVENTS_H
+
+#include <esp_http_server.h>
+#include <string>
+
+
+/**
+ * /events: Server-Sent Events instead of polling /json, /value and /statusflow (see CEventStream)
+ * Events: "status" (text of /statusflow) on each change of the flow status, "reading" (document of /json)
+ * when a round has finished. A new subscriber gets the latest event of each kind right away.
+ * The stream keeps one of the webserver sockets open, the number of subscribers is limited
+ * by SERVER_EVENTS_MAX_SUBSCRIBERS.
+ */
+void register_server_events_uri(httpd_handle_t server);
+
+/* Creates the lock, once at startup before the flow publishes its first status */
+void server_events_init(void);
+
+/* Can be called from any task, the frame gets formatted once and sent to all subscribers by the webserver task */
+void server_events_publish(const char *_event, const std::string &_data);
+
+/* close_fn of the webserver (httpd_config_t), removes the subscriber and closes the socket */
+void server_events_close_fn(httpd_handle_t _server, int _sockfd);
+
+int server_events_get_subscribers(void);
+
+#endif //SERVEREVENTS_H
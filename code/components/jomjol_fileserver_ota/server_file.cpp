@@ -29,9 +29,12 @@ extern "C" {
 #include "esp_vfs.h"
 #include <esp_spiffs.h>
 #include "esp_http_server.h"
+#include "esp_heap_caps.h"
 
 #include "../../include/defines.h"
 #include "ClassLogFile.h"
+#include "CDataLogQuery.h"
+#include "CImagePack.h"
 
 #include "MainFlowControl.h"
 
@@ -43,7 +46,8 @@ extern "C" {
 #include "server_GPIO.h"
 
 #include "Helper.h"
-#include "miniz.h"
+#include "CZipStream.h"
+#include "CZipFileInstaller.h"
 #include "basic_auth.h"
 
 static const char *TAG = "OTA FILE";
@@ -59,6 +63,9 @@ struct file_server_data {
 #include <iostream>
 #include <sys/types.h>
 #include <dirent.h>
+#include <vector>
+#include <algorithm>
+#include <limits.h>
 
 using namespace std;
 
@@ -66,6 +73,7 @@ string SUFFIX_ZW = "_tmp";
 
 static esp_err_t send_logfile(httpd_req_t *req, bool send_full_file);
 static esp_err_t send_datafile(httpd_req_t *req, bool send_full_file);
+static esp_err_t send_datafile_binary(httpd_req_t *req, bool send_full_file);
 
 esp_err_t get_numbers_file_handler(httpd_req_t *req)
 {
@@ -113,7 +121,7 @@ esp_err_t get_data_file_handler(httpd_req_t *req)
 
         ESP_LOGD(TAG, " Extension: %s", _fileext.c_str());
 
-        if (_fileext == "csv")
+        if ((_fileext == "csv") || (_fileext == "bin"))
         {
             _filename = _filename + "\t";
             httpd_resp_sendstr_chunk(req, _filename.c_str());
@@ -341,6 +349,11 @@ static esp_err_t datafileact_get_last_part_handler(httpd_req_t *req) {
 static esp_err_t send_datafile(httpd_req_t *req, bool send_full_file)
 {
     LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "data_get_last_part_handler");
+
+    if (LogFile.GetDataLogBinary()) {
+        return send_datafile_binary(req, send_full_file);
+    }
+
     FILE *fd = NULL;
     //struct stat file_stat;
     ESP_LOGD(TAG, "uri: %s", req->uri);
@@ -418,6 +431,500 @@ static esp_err_t send_datafile(httpd_req_t *req, bool send_full_file)
     return ESP_OK;
 }
 
+/* Sends the records of an opened binary data log from _start until the first one after _to as CSV lines
+ * or JSON objects. The lines are collected in the scratch buffer and sent as chunks. */
+static bool send_data_records(httpd_req_t *req, CDataLog *_log, uint32_t _start, time_t _to, bool _json, size_t *_used, bool *_first)
+{
+    char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
+    CDataLog::Record record;
+
+    for (uint32_t i = _start; i < _log->getRecordCount(); ++i) {
+        if (!_log->Read(i, &record)) {
+            continue; // Damaged record (e.g. power loss while writing)
+        }
+
+        if ((time_t)record.timestamp > _to) {
+            break;
+        }
+
+        if (SERVER_FILER_SCRATCH_BUFSIZE - *_used < DATA_EXPORT_MAX_LINE) {
+            if (httpd_resp_send_chunk(req, chunk, *_used) != ESP_OK) {
+                return false;
+            }
+            *_used = 0;
+        }
+
+        if (_json) {
+            size_t separator = *_first ? 0 : 1;
+            int len = CDataLog::FormatJSON(&record, _log->getName(record.number), PREVALUE_TIME_FORMAT_OUTPUT,
+                                           chunk + *_used + separator, SERVER_FILER_SCRATCH_BUFSIZE - *_used - separator);
+
+            if (len == 0) {
+                continue; // Does not fit into a line, skipped instead of sending invalid JSON
+            }
+
+            if (separator > 0) {
+                chunk[*_used] = ',';
+            }
+            *_used += separator + len;
+        }
+        else {
+            *_used += CDataLog::FormatCSV(&record, _log->getName(record.number), PREVALUE_TIME_FORMAT_OUTPUT,
+                                         chunk + *_used, SERVER_FILER_SCRATCH_BUFSIZE - *_used - 1);
+            chunk[(*_used)++] = '\n';
+        }
+
+        *_first = false;
+    }
+
+    return true;
+}
+
+
+/* Current day of the binary data log in the format of the CSV data log */
+static esp_err_t send_datafile_binary(httpd_req_t *req, bool send_full_file)
+{
+    CDataLog log;
+    std::string currentfilename = LogFile.GetCurrentFileNameData();
+
+    if (!log.Open(currentfilename)) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to read file: " + currentfilename + "!");
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, get404());
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_type(req, "text/plain");
+
+    uint32_t start = 0;
+
+    if (!send_full_file && (log.getRecordCount() > DATA_EXPORT_LAST_PART_RECORDS)) {
+        start = log.getRecordCount() - DATA_EXPORT_LAST_PART_RECORDS;
+    }
+
+    size_t used = 0;
+    bool first = true;
+
+    if (!send_data_records(req, &log, start, (time_t)LONG_MAX, false, &used, &first) ||
+        ((used > 0) && (httpd_resp_send_chunk(req, ((struct file_server_data *)req->user_ctx)->scratch, used) != ESP_OK))) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "File sending failed!");
+        httpd_resp_sendstr_chunk(req, NULL);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+
+/* Unix time or local time as YYYY-MM-DD[THH:MM[:SS]], a date only is the start or end (_end) of the day */
+static bool parse_data_export_time(const char *_value, bool _end, time_t *_time)
+{
+    char *end;
+    unsigned long seconds = strtoul(_value, &end, 10);
+
+    if ((*_value != '\0') && (*end == '\0')) {
+        *_time = seconds;
+        return true;
+    }
+
+    struct tm tm = {};
+    int count = sscanf(_value, PREVALUE_TIME_FORMAT_INPUT, &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+
+    if (count < 3) {
+        return false;
+    }
+
+    if ((count == 3) && _end) {
+        tm.tm_hour = 23;
+        tm.tm_min = 59;
+        tm.tm_sec = 59;
+    }
+
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    *_time = mktime(&tm);
+
+    return true;
+}
+
+
+/* Parameters from and to of a data request (default: today), sends the error response if one is invalid */
+static bool parse_data_range(httpd_req_t *req, const char *_query, time_t *_from, time_t *_to)
+{
+    char value[30];
+    time_t now;
+    time(&now);
+
+    struct tm *timeinfo = localtime(&now);
+    timeinfo->tm_hour = 0;
+    timeinfo->tm_min = 0;
+    timeinfo->tm_sec = 0;
+    *_from = mktime(timeinfo);
+    *_to = now;
+
+    if ((httpd_query_key_value(_query, "from", value, sizeof(value)) == ESP_OK) && !parse_data_export_time(value, false, _from)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid parameter from");
+        return false;
+    }
+
+    if ((httpd_query_key_value(_query, "to", value, sizeof(value)) == ESP_OK) && !parse_data_export_time(value, true, _to)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid parameter to");
+        return false;
+    }
+
+    return true;
+}
+
+
+/* Data files (extension _extension, both formats if empty) of the days from _from to _to, sorted by date */
+static std::vector<std::string> get_data_files(time_t _from, time_t _to, std::string _extension)
+{
+    // One file per day, the names sort by date
+    std::string firstFile = LogFile.GetDataFileName(_from);
+    std::string lastFile = LogFile.GetDataFileName(_to);
+    std::string dataDir = firstFile.substr(0, firstFile.find_last_of('/'));
+    size_t dateLength = firstFile.length() - 4; // Without extension
+    std::vector<std::string> files;
+
+    if (_from > _to) {
+        return files;
+    }
+
+    DIR *dir = opendir(dataDir.c_str());
+    if (!dir) {
+        return files;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        std::string file = dataDir + "/" + entry->d_name;
+
+        if ((file.length() != firstFile.length()) ||
+            (file.compare(0, dateLength, firstFile, 0, dateLength) < 0) || (file.compare(0, dateLength, lastFile, 0, dateLength) > 0)) {
+            continue;
+        }
+
+        std::string extension = file.substr(dateLength);
+
+        if ((extension == _extension) || (_extension.empty() && ((extension == ".csv") || (extension == ".bin")))) {
+            files.push_back(file);
+        }
+    }
+    closedir(dir);
+
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+
+/**
+ * Records of the binary data log in a time range
+ * Parameters: from, to (see parse_data_export_time(), default: today), format=csv|json
+ * Only the day files of the range are opened, the start is found with the time index.
+ */
+static esp_err_t data_export_handler(httpd_req_t *req)
+{
+    char query[100] = "";
+    char value[30];
+    time_t from, to;
+    bool json = false;
+
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    if (!LogFile.GetDataLogBinary()) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Data log is not in binary format (parameter DataLogFormat)");
+        return ESP_FAIL;
+    }
+
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+
+    if (!parse_data_range(req, query, &from, &to)) {
+        return ESP_FAIL;
+    }
+
+    if (httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+        json = (toUpper(std::string(value)) == "JSON");
+    }
+
+    httpd_resp_set_type(req, json ? "application/json" : "text/plain");
+
+    char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
+    size_t used = 0;
+    bool first = true;
+    bool ok = true;
+    CDataLog log;
+
+    if (json) {
+        chunk[used++] = '[';
+    }
+
+    std::vector<std::string> files = get_data_files(from, to, ".bin");
+
+    for (int i = 0; ok && (i < files.size()); ++i) {
+        if (log.Open(files[i])) {
+            ok = send_data_records(req, &log, log.FindFirst(from), to, json, &used, &first);
+            log.Close();
+        }
+    }
+
+    if (json && ok) {
+        chunk[used++] = ']';
+    }
+
+    if (!ok || ((used > 0) && (httpd_resp_send_chunk(req, chunk, used) != ESP_OK))) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Data export failed!");
+        httpd_resp_sendstr_chunk(req, NULL);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+
+/* Adds a completed bucket of a data query to the scratch buffer, sends the buffer if it is full */
+static bool send_data_bucket(httpd_req_t *req, CDataLogQuery::Bucket *_bucket, bool _json, size_t *_used, bool *_first)
+{
+    char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
+
+    if (SERVER_FILER_SCRATCH_BUFSIZE - *_used < DATA_EXPORT_MAX_LINE) {
+        if (httpd_resp_send_chunk(req, chunk, *_used) != ESP_OK) {
+            return false;
+        }
+        *_used = 0;
+    }
+
+    if (_json && !*_first) {
+        chunk[(*_used)++] = ',';
+    }
+
+    *_used += CDataLogQuery::FormatBucket(_bucket, _json, PREVALUE_TIME_FORMAT_OUTPUT, chunk + *_used, SERVER_FILER_SCRATCH_BUFSIZE - *_used - 1);
+
+    if (!_json) {
+        chunk[(*_used)++] = '\n';
+    }
+
+    *_first = false;
+    return true;
+}
+
+
+/**
+ * Values of one number in a time range, aggregated on the fly into buckets (min/max/avg/last)
+ * Parameters: from, to (see parse_data_export_time(), default: today), number (default: first number),
+ * downsample (bucket length in seconds, 0: every value) or points (number of buckets over the range), format=json|csv
+ * Reads the binary day files with the time index and the CSV day files line by line. Only one bucket and
+ * one chunk are held in memory.
+ */
+static esp_err_t data_query_handler(httpd_req_t *req)
+{
+    char query[200] = "";
+    char value[40];
+    time_t from, to;
+    uint32_t interval = 0;
+    bool json = true;
+    std::string number = flowctrl.getNumbersName();
+
+    number = number.substr(0, number.find('\t'));
+
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+
+    if (!parse_data_range(req, query, &from, &to)) {
+        return ESP_FAIL;
+    }
+
+    if (httpd_query_key_value(query, "number", value, sizeof(value)) == ESP_OK) {
+        number = std::string(value);
+    }
+
+    if (httpd_query_key_value(query, "downsample", value, sizeof(value)) == ESP_OK) {
+        std::string downsample = std::string(value);
+        if (!isStringNumeric(downsample) || (std::stol(downsample) < 0)) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid parameter downsample");
+            return ESP_FAIL;
+        }
+        interval = std::stol(downsample);
+    }
+
+    if (httpd_query_key_value(query, "points", value, sizeof(value)) == ESP_OK) {
+        std::string points = std::string(value);
+        if (!isStringNumeric(points) || (std::stol(points) <= 0)) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid parameter points");
+            return ESP_FAIL;
+        }
+        interval = (to - from) / std::stol(points) + 1;
+    }
+
+    if (httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+        json = (toUpper(std::string(value)) != "CSV");
+    }
+
+    httpd_resp_set_type(req, json ? "application/json" : "text/plain");
+
+    char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
+    size_t used = 0;
+    bool first = true;
+    bool ok = true;
+    CDataLogQuery aggregator;
+    CDataLogQuery::Bucket bucket;
+
+    aggregator.Init(from, to, interval);
+
+    if (json) {
+        used = snprintf(chunk, SERVER_FILER_SCRATCH_BUFSIZE, "{\"number\":\"%s\",\"from\":%lld,\"to\":%lld,\"downsample\":%lu,\"buckets\":[",
+                        CDataLog::EscapeJSON(number).c_str(), (long long)from, (long long)to, (unsigned long)interval);
+    }
+
+    std::vector<std::string> files = get_data_files(from, to, "");
+
+    for (int i = 0; ok && (i < files.size()); ++i) {
+        if (files[i].compare(files[i].length() - 4, 4, ".bin") == 0) {
+            CDataLog log;
+
+            if (!log.Open(files[i]) || (log.getNumber(number) < 0)) {
+                continue;
+            }
+
+            int numberIndex = log.getNumber(number);
+            CDataLog::Record record;
+
+            for (uint32_t r = log.FindFirst(from); ok && (r < log.getRecordCount()); ++r) {
+                if (!log.Read(r, &record) || (record.number != numberIndex) || !(record.flags & CDataLog::FLAG_VALUE)) {
+                    continue;
+                }
+
+                if ((time_t)record.timestamp > to) {
+                    break;
+                }
+
+                if (aggregator.Add(record.timestamp, record.value, &bucket)) {
+                    ok = send_data_bucket(req, &bucket, json, &used, &first);
+                }
+            }
+        }
+        else {
+            FILE *file = fopen(files[i].c_str(), "r");
+            char line[DATA_EXPORT_MAX_LINE];
+            uint32_t timestamp;
+            double lineValue;
+
+            if (file == NULL) {
+                continue;
+            }
+
+            while (ok && (fgets(line, sizeof(line), file) != NULL)) {
+                if (!CDataLogQuery::ParseCSVLine(line, number, &timestamp, &lineValue)) {
+                    continue;
+                }
+
+                if ((time_t)timestamp > to) {
+                    break;
+                }
+
+                if (aggregator.Add(timestamp, lineValue, &bucket)) {
+                    ok = send_data_bucket(req, &bucket, json, &used, &first);
+                }
+            }
+            fclose(file);
+        }
+    }
+
+    if (ok && aggregator.Finish(&bucket)) {
+        ok = send_data_bucket(req, &bucket, json, &used, &first);
+    }
+
+    if (ok && json) {
+        used += snprintf(chunk + used, SERVER_FILER_SCRATCH_BUFSIZE - used, "],\"values\":%lu}", (unsigned long)aggregator.getValueCount());
+    }
+
+    if (!ok || ((used > 0) && (httpd_resp_send_chunk(req, chunk, used) != ESP_OK))) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Data query failed!");
+        httpd_resp_sendstr_chunk(req, NULL);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+
+/**
+ * Image from an image log container (ROIImagesFormat = container, see CImagePack)
+ * Parameter file: path of the image as it would be in the legacy layout, e.g.
+ * /log/digit/20240101/10/3.5_dig1_20240101-101500.jpg (the result prefix is optional)
+ * Parameter folder: hour folder, e.g. /log/digit/20240101/10, sends the index of its container
+ */
+static esp_err_t log_image_handler(httpd_req_t *req)
+{
+    char query[300] = "";
+    char value[200];
+    std::string file, folder;
+
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+
+    if (httpd_query_key_value(query, "file", value, sizeof(value)) == ESP_OK) {
+        file = UrlDecode(std::string(value));
+        size_t slash = file.find_last_of('/');
+        folder = (slash != std::string::npos) ? file.substr(0, slash) : "";
+        file = file.substr(slash + 1);
+    }
+    else if (httpd_query_key_value(query, "folder", value, sizeof(value)) == ESP_OK) {
+        folder = UrlDecode(std::string(value));
+    }
+
+    if ((folder.length() < 2) || (folder[0] != '/') || (folder.find("..") != std::string::npos)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid or missing parameter file/folder");
+        return ESP_FAIL;
+    }
+
+    std::string packFile = "/sdcard" + folder + "/" + IMAGE_PACK_FILE;
+    CImagePack::Entry entry;
+    FILE *fd;
+
+    if (file.empty()) {
+        entry.offset = 0;
+        entry.length = UINT32_MAX;
+        fd = fopen(CImagePack::GetIndexFileName(packFile).c_str(), "r");
+        httpd_resp_set_type(req, "text/plain");
+    }
+    else {
+        fd = CImagePack::Find(packFile, file, &entry) ? fopen(packFile.c_str(), "r") : NULL;
+        httpd_resp_set_type(req, "image/jpeg");
+    }
+
+    if ((fd == NULL) || (fseek(fd, entry.offset, SEEK_SET) != 0)) {
+        if (fd != NULL) {
+            fclose(fd);
+        }
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Image not found");
+        return ESP_FAIL;
+    }
+
+    char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
+    uint32_t remaining = entry.length;
+    size_t chunksize;
+
+    do {
+        chunksize = fread(chunk, 1, std::min((uint32_t)SERVER_FILER_SCRATCH_BUFSIZE, remaining), fd);
+        remaining -= chunksize;
+
+        if (httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK) {
+            fclose(fd);
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Image sending failed!");
+            httpd_resp_sendstr_chunk(req, NULL);
+            return ESP_FAIL;
+        }
+    } while (chunksize != 0);
+
+    fclose(fd);
+    return ESP_OK;
+}
+
+
 static esp_err_t send_logfile(httpd_req_t *req, bool send_full_file)
 {
     LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "log_get_last_part_handler");
@@ -433,6 +940,7 @@ static esp_err_t send_logfile(httpd_req_t *req, bool send_full_file)
 
     // Since the log file is still could open for writing, we need to close it first
     LogFile.CloseLogFileAppendHandle();
+    LogFile.Flush(); // Also write the buffered lines
 
     fd = fopen(currentfilename.c_str(), "r");
     if (!fd) {
@@ -568,39 +1076,16 @@ static esp_err_t download_get_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-
     ESP_LOGD(TAG, "Sending file: %s (%ld bytes)...", filename, file_stat.st_size);
-    set_content_type_from_file(req, filename);
 
-    /* Retrieve the pointer to scratch buffer for temporary storage */
-    char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
-    size_t chunksize;
-    do {
-        /* Read file in chunks into the scratch buffer */
-        chunksize = fread(chunk, 1, SERVER_FILER_SCRATCH_BUFSIZE, fd);
-
-        /* Send buffer contents as HTTP chunk. If empty this functions as a
-         * last-chunk message, signaling end-of-response, to the HTTP client.
-         * See RFC 2616, section 3.6.1 for details on Chunked Transfer Encoding. */
-        if (httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK) {
-            fclose(fd);
-            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "File sending failed!");
-            /* Abort sending file */
-            httpd_resp_sendstr_chunk(req, NULL);
-            /* Respond with 500 Internal Server Error */
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file!");
-            return ESP_FAIL;
-        }
-
-        /* Keep looping till the whole file is sent */
-    } while (chunksize != 0);
+    /* Supports Range requests (e.g. resuming the download of a large log or image) */
+    esp_err_t res = send_file_content(req, fd, get_content_type_from_file(filename), "Access-Control-Allow-Origin: *\r\n");
 
-    /* Close file after sending complete */
-    fclose(fd);
-    ESP_LOGD(TAG, "File successfully sent");
+    if (res == ESP_OK) {
+        ESP_LOGD(TAG, "File successfully sent");
+    }
 
-    return ESP_OK;
+    return res;
 }
 
 /* Handler to upload a file onto the server */
@@ -711,6 +1196,7 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
 
     /* Close file upon upload completion */
     fclose(fd);
+    static_file_index_update(filepath);
     LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "File saved: " + string(filename));
     ESP_LOGI(TAG, "File reception completed");
 
@@ -876,6 +1362,7 @@ static esp_err_t delete_post_handler(httpd_req_t *req)
 
         /* Delete file */
         unlink(filepath);
+        static_file_index_update(filepath);
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "File deleted: " + string(filename));
         ESP_LOGI(TAG, "File deletion completed");
 
@@ -941,229 +1428,132 @@ void delete_all_in_directory(std::string _directory)
                 LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Deleting file: " + filename);
                 /* Delete file */
                 unlink(filename.c_str());    
+                static_file_index_update(filename);
             }
         };
     }
     closedir(dir);
 }
 
-std::string unzip_new(std::string _in_zip_file, std::string _html_tmp, std::string _html_final, std::string _target_bin, std::string _main, bool _initial_setup)
+static void *unzip_malloc(size_t _size)
 {
-    int i, sort_iter;
-    mz_bool status;
-    size_t uncomp_size;
-    mz_zip_archive zip_archive;
-    void* p;
-    char archive_filename[64];
-    std::string zw, ret = "";
-    std::string directory = "";
-
-    ESP_LOGD(TAG, "miniz.c version: %s", MZ_VERSION);
-    ESP_LOGD(TAG, "Zipfile: %s", _in_zip_file.c_str());
-
-    // Now try to open the archive.
-    memset(&zip_archive, 0, sizeof(zip_archive));
-    status = mz_zip_reader_init_file(&zip_archive, _in_zip_file.c_str(), 0);
-    if (!status)
-    {
-        ESP_LOGD(TAG, "mz_zip_reader_init_file() failed!");
-        return ret;
-    }
+    return heap_caps_malloc(_size, MALLOC_CAP_SPIRAM);
+}
 
-    // Get and print information about each file in the archive.
-    int numberoffiles = (int)mz_zip_reader_get_num_files(&zip_archive);
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Files to be extracted: " + to_string(numberoffiles));
 
-    sort_iter = 0;
-    {
-        memset(&zip_archive, 0, sizeof(zip_archive));
-        status = mz_zip_reader_init_file(&zip_archive, _in_zip_file.c_str(), sort_iter ? MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY : 0);
-        if (!status)
-        {
-            ESP_LOGD(TAG, "mz_zip_reader_init_file() failed!");
-            return ret;
-        }
+static void unzip_free(void *_ptr)
+{
+    heap_caps_free(_ptr);
+}
 
-        for (i = 0; i < numberoffiles; i++)
-        {
-            mz_zip_archive_file_stat file_stat;
-            mz_zip_reader_file_stat(&zip_archive, i, &file_stat);
-            sprintf(archive_filename, file_stat.m_filename);
-            
-            if (!file_stat.m_is_directory) {
-            // Try to extract all the files to the heap.
-            p = mz_zip_reader_extract_file_to_heap(&zip_archive, archive_filename, &uncomp_size, 0);
-                if (!p)
-                {
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "mz_zip_reader_extract_file_to_heap() failed on file " + string(archive_filename));
-                    mz_zip_reader_end(&zip_archive);
-                    return ret;
-                }
-            
-                // Save to File.
-                zw = std::string(archive_filename);
-                ESP_LOGD(TAG, "Rohfilename: %s", zw.c_str());
-
-                if (toUpper(zw) == "FIRMWARE.BIN")
-                {
-                    zw = _target_bin + zw;
-                    ret = zw;
-                }
-                else
-                {
-                    std::string _dir = getDirectory(zw);
-                    if ((_dir == "config-initial") && !_initial_setup)
-                    {
-                        continue;
-                    }
-                    else
-                    {
-                        _dir = "config";
-                        std::string _s1 = "config-initial";
-                        FindReplace(zw, _s1, _dir);
-                    }
-
-                    if (_dir.length() > 0)
-                    {
-                        zw = _main + zw;
-                    }
-                    else
-                    {
-                        zw = _html_tmp + zw;
-                    }
 
-                }
+/* Read the ZIP file piece by piece, the entries get inflated straight into the sink */
+static bool unzip_stream(std::string _in_zip_file, CZipStream::Sink *_sink)
+{
+    FILE *fd = fopen(_in_zip_file.c_str(), "rb");
+    if (!fd) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to open " + _in_zip_file);
+        return false;
+    }
 
-                // files in the html folder shall be redirected to the temporary html folder
-                if (zw.find(_html_final) == 0) {
-                    FindReplace(zw, _html_final, _html_tmp);
-                }
-            
-                string filename_zw = zw + SUFFIX_ZW;
+    uint8_t *buffer = (uint8_t *)malloc(SERVER_FILER_SCRATCH_BUFSIZE);
+    if (buffer == NULL) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Not enough memory to extract " + _in_zip_file);
+        fclose(fd);
+        return false;
+    }
+
+    CZipStream zip(_sink, unzip_malloc, unzip_free);
+    CZipStream::Status status = CZipStream::STATUS_MORE;
+    size_t length;
+
+    while ((status == CZipStream::STATUS_MORE) && ((length = fread(buffer, 1, SERVER_FILER_SCRATCH_BUFSIZE, fd)) > 0)) {
+        status = zip.Feed(buffer, length);
+    }
 
-                ESP_LOGI(TAG, "File to extract: %s, Temp. Filename: %s", zw.c_str(), filename_zw.c_str());
+    free(buffer);
+    fclose(fd);
 
-                std::string folder = filename_zw.substr(0, filename_zw.find_last_of('/'));
-                MakeDir(folder);
+    if (status == CZipStream::STATUS_MORE) {
+        status = zip.Finish();
+    }
 
-                // extrahieren in zwischendatei
-                DeleteFile(filename_zw);
+    if (status != CZipStream::STATUS_DONE) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to extract " + _in_zip_file + ": " + zip.getError());
+        return false;
+    }
 
-                FILE* fpTargetFile = fopen(filename_zw.c_str(), "wb");
-                uint writtenbytes = fwrite(p, 1, (uint)uncomp_size, fpTargetFile);
-                fclose(fpTargetFile);
-                
-                bool isokay = true;
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Extracted " + to_string(zip.getEntries()) + " entries of " + _in_zip_file);
+    return true;
+}
 
-                if (writtenbytes == (uint)uncomp_size)
-                {
-                    isokay = true;
-                }
-                else
-                {
-                    isokay = false;
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in writting extracted file (function fwrite) extracted file \"" +
-                            string(archive_filename) + "\", size " + to_string(uncomp_size));
-                }
 
-                DeleteFile(zw);
-                if (!isokay)
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in fwrite \"" + string(archive_filename) + "\", size " + to_string(uncomp_size));
-                isokay = isokay && RenameFile(filename_zw, zw);
-                if (!isokay)
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in Rename \"" + filename_zw + "\" to \"" + zw);
-
-                if (isokay)
-                    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Successfully extracted file \"" + string(archive_filename) + "\", size " + to_string(uncomp_size));
-                else
-                {
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in extracting file \"" + string(archive_filename) + "\", size " + to_string(uncomp_size));
-                    ret = "ERROR";
-                }
-                mz_free(p);
-            }
+bool unzip_update(std::string _in_zip_file, std::string _main, bool _initial_setup, CZipStream::Sink *_firmware,
+                  std::function<bool(void)> _activate)
+{
+    CZipFileInstaller installer(UPDATE_MANIFEST_FILE, [&](std::string _name) {
+        if ((getDirectory(_name) == "config-initial") && !_initial_setup) {
+            return std::string("");
         }
 
-        // Close the archive, freeing any resources it was using
-        mz_zip_reader_end(&zip_archive);
-    }
+        std::string _from = "config-initial";
+        std::string _to = "config";
+        FindReplace(_name, _from, _to);
+        return _main + _name;
+    });
+    installer.SetEntrySink("firmware.bin", _firmware);
 
-    ESP_LOGD(TAG, "Success.");
-    return ret;
-}
+    if (!unzip_stream(_in_zip_file, &installer)) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Restored " + to_string(CZipFileInstaller::Rollback(UPDATE_MANIFEST_FILE)) + " files");
+        return false;
+    }
 
-void unzip(std::string _in_zip_file, std::string _target_directory){
-    int i, sort_iter;
-    mz_bool status;
-    size_t uncomp_size;
-    mz_zip_archive zip_archive;
-    void* p;
-    char archive_filename[64];
-    std::string zw;
-//    static const char* s_Test_archive_filename = "testhtml.zip";
-
-    ESP_LOGD(TAG, "miniz.c version: %s", MZ_VERSION);
-    ESP_LOGD(TAG, "Zipfile: %s", _in_zip_file.c_str());
-    ESP_LOGD(TAG, "Target Dir: %s", _target_directory.c_str());
-
-    // Now try to open the archive.
-    memset(&zip_archive, 0, sizeof(zip_archive));
-    status = mz_zip_reader_init_file(&zip_archive, _in_zip_file.c_str(), 0);
-    if (!status)
-    {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "mz_zip_reader_init_file() failed!");
-        return;
+    // Web interface and config must match the firmware: keep them only if the firmware could be activated
+    if (!_activate()) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Restored " + to_string(CZipFileInstaller::Rollback(UPDATE_MANIFEST_FILE)) + " files");
+        return false;
     }
 
-    // Get and print information about each file in the archive.
-    int numberoffiles = (int)mz_zip_reader_get_num_files(&zip_archive);
-    for (sort_iter = 0; sort_iter < 2; sort_iter++)
-    {
-        memset(&zip_archive, 0, sizeof(zip_archive));
-        status = mz_zip_reader_init_file(&zip_archive, _in_zip_file.c_str(), sort_iter ? MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY : 0);
-        if (!status)
-        {
-            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "mz_zip_reader_init_file() failed!");
-            return;
+    installer.Commit();
+
+    // The html folder gets replaced as a whole: remove the files of the previous version (after the commit, a
+    // rollback needs the .old files)
+    std::string html = _main + "html";
+    std::vector<std::string> *installed = installer.getInstalled();
+
+    for (size_t i = 0; i < installed->size(); ++i) {
+        if ((*installed)[i].compare(0, html.length() + 1, html + "/") == 0) {
+            LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Removed " + to_string(installer.RemoveOthers(html)) + " files of the previous web interface");
+            break;
         }
+    }
 
-        for (i = 0; i < numberoffiles; i++)
-        {
-            mz_zip_archive_file_stat file_stat;
-            mz_zip_reader_file_stat(&zip_archive, i, &file_stat);
-            sprintf(archive_filename, file_stat.m_filename);
- 
-            // Try to extract all the files to the heap.
-            p = mz_zip_reader_extract_file_to_heap(&zip_archive, archive_filename, &uncomp_size, 0);
-            if (!p)
-            {
-                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "mz_zip_reader_extract_file_to_heap() failed!");
-                mz_zip_reader_end(&zip_archive);
-                return;
-            }
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Installed " + to_string(installed->size()) + " files (" + to_string(installer.getBytes()) + " bytes)");
+    return true;
+}
 
-            // Save to File.
-            zw = std::string(archive_filename);
-            zw = _target_directory + zw;
-            ESP_LOGD(TAG, "File to extract: %s", zw.c_str());
-            FILE* fpTargetFile = fopen(zw.c_str(), "wb");
-            fwrite(p, 1, (uint)uncomp_size, fpTargetFile);
-            fclose(fpTargetFile);
 
-            ESP_LOGD(TAG, "Successfully extracted file \"%s\", size %u", archive_filename, (uint)uncomp_size);
-            //            ESP_LOGD(TAG, "File data: \"%s\"", (const char*)p);
+bool unzip(std::string _in_zip_file, std::string _target_directory, bool _replace)
+{
+    CZipFileInstaller installer(UPDATE_MANIFEST_FILE, [&](std::string _name) {
+        return _target_directory + _name;
+    });
 
-            // We're done.
-            mz_free(p);
-        }
+    if (!unzip_stream(_in_zip_file, &installer)) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Restored " + to_string(CZipFileInstaller::Rollback(UPDATE_MANIFEST_FILE)) + " files");
+        return false;
+    }
+
+    installer.Commit();
 
-        // Close the archive, freeing any resources it was using
-        mz_zip_reader_end(&zip_archive);
+    if (_replace) {
+        installer.RemoveOthers(_target_directory.substr(0, _target_directory.find_last_not_of('/') + 1));
     }
 
-    ESP_LOGD(TAG, "Success.");
+    return true;
 }
 
+
 void register_server_file_uri(httpd_handle_t server, const char *base_path)
 {
     static struct file_server_data *server_data = NULL;
@@ -1219,6 +1609,30 @@ void register_server_file_uri(httpd_handle_t server, const char *base_path)
     };
     httpd_register_uri_handler(server, &file_datafile_last_part_handle);
 
+    httpd_uri_t file_data_export = {
+        .uri       = "/data_export",
+        .method    = HTTP_GET,
+        .handler = APPLY_BASIC_AUTH_FILTER(data_export_handler),
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &file_data_export);
+
+    httpd_uri_t file_data_query = {
+        .uri       = "/data_query",
+        .method    = HTTP_GET,
+        .handler = APPLY_BASIC_AUTH_FILTER(data_query_handler),
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &file_data_query);
+
+    httpd_uri_t file_log_image = {
+        .uri       = "/log_image",
+        .method    = HTTP_GET,
+        .handler = APPLY_BASIC_AUTH_FILTER(log_image_handler),
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &file_log_image);
+
     httpd_uri_t file_logfileact = {
         .uri       = "/logfileact",  // Match all URIs of type /path/to/file
         .method    = HTTP_GET,
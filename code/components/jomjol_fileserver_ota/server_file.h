@@ -5,11 +5,25 @@
 
 #include <esp_http_server.h>
 #include <string>
+#include <functional>
+
+#include "CZipStream.h"
 
 void register_server_file_uri(httpd_handle_t server, const char *base_path);
 
-void unzip(std::string _in_zip_file, std::string _target_directory);
-std::string unzip_new(std::string _in_zip_file, std::string _html_tmp, std::string _html_final, std::string _target_bin, std::string _main = "/sdcard/", bool _initial_setup = false);
+/**
+ * Extract a ZIP file without temporary copies (see CZipStream, CZipFileInstaller), each file gets replaced
+ * with a rename and all are restored if the extraction fails. _replace: remove the other files of the folder.
+ */
+bool unzip(std::string _in_zip_file, std::string _target_directory, bool _replace = false);
+
+/**
+ * Extract an update ZIP to _main (html, config, ...), firmware.bin goes to _firmware (e.g. the OTA partition)
+ * _activate gets called after the extraction, before the files are committed (e.g. switch to the new firmware).
+ * If it fails, the previous files get restored and false is returned.
+ */
+bool unzip_update(std::string _in_zip_file, std::string _main, bool _initial_setup, CZipStream::Sink *_firmware,
+                  std::function<bool(void)> _activate);
 
 
 void delete_all_in_directory(std::string _directory);
@@ -5,6 +5,7 @@
 #include <sys/param.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
+#include <algorithm>
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,6 +19,14 @@ extern "C" {
 #include "esp_log.h"
 #include "Helper.h"
 #include "esp_http_server.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "CHttpRange.h"
+#include "CStaticFileIndex.h"
 #include "../../include/defines.h"
 
 static const char *TAG = "SERVER HELP";
@@ -32,33 +41,104 @@ bool endsWith(std::string const &str, std::string const &suffix)
     return str.compare(str.length() - suffix.length(), suffix.length(), suffix) == 0;
 }
 
+
+/* Sends _length bytes, httpd_send() may send less at once */
+static bool send_raw(httpd_req_t *req, const char *_data, size_t _length)
+{
+    while (_length > 0) {
+        int sent = httpd_send(req, _data, _length);
+        if (sent <= 0) {
+            return false;
+        }
+        _data += sent;
+        _length -= sent;
+    }
+
+    return true;
+}
+
+
+static CStaticFileIndex staticFileIndex;
+static SemaphoreHandle_t staticFileIndexMutex = NULL;
+
+
+void static_file_index_build(void)
+{
+    if (staticFileIndexMutex == NULL) {
+        staticFileIndexMutex = xSemaphoreCreateMutex();
+        if (staticFileIndexMutex == NULL) {
+            ESP_LOGE(TAG, "Failed to create mutex, static files get served without the index");
+            return;
+        }
+    }
+
+    int64_t start = esp_timer_get_time();
+
+    xSemaphoreTake(staticFileIndexMutex, portMAX_DELAY);
+    int files = staticFileIndex.Build(STATIC_FILE_INDEX_ROOT);
+    xSemaphoreGive(staticFileIndexMutex);
+
+    ESP_LOGI(TAG, "Indexed %d files of %s in %d ms", files, STATIC_FILE_INDEX_ROOT, (int)((esp_timer_get_time() - start) / 1000));
+}
+
+
+void static_file_index_update(std::string _path)
+{
+    if (staticFileIndexMutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(staticFileIndexMutex, portMAX_DELAY);
+    if (staticFileIndex.Covers(_path)) {
+        staticFileIndex.Update(_path);
+    }
+    xSemaphoreGive(staticFileIndexMutex);
+}
+
+
+static bool static_file_index_lookup(std::string _path, CStaticFileIndex::File *_file)
+{
+    if (staticFileIndexMutex == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(staticFileIndexMutex, portMAX_DELAY);
+    bool found = staticFileIndex.Lookup(_path, _file);
+    xSemaphoreGive(staticFileIndexMutex);
+
+    return found;
+}
+
+
 esp_err_t send_file(httpd_req_t *req, std::string filename)
 {
     std::string _filename_old = filename;
     struct stat file_stat;
     bool _gz_file_exists = false;
+    CStaticFileIndex::File indexed;
+    bool _indexed = static_file_index_lookup(filename, &indexed);
 
     ESP_LOGD(TAG, "old filename: %s", filename.c_str());
-    std::string _filename_temp = std::string(filename) + ".gz";
-
-    // Checks whether the file is available as .gz
-    if (stat(_filename_temp.c_str(), &file_stat) == 0) {
-        filename = _filename_temp;
 
-        ESP_LOGD(TAG, "new filename: %s", filename.c_str());
-        _gz_file_exists = true;
+    if (_indexed) {
+        // .gz availability known from the index, no stat() needed
+        filename = indexed.fileName;
+        _gz_file_exists = indexed.gzip;
     }
+    else {
+        std::string _filename_temp = std::string(filename) + ".gz";
 
-    FILE *fd = fopen(filename.c_str(), "r");
-    if (!fd)  {
-        ESP_LOGE(TAG, "Failed to read file: %s", filename.c_str());
-		
-        /* Respond with 404 Error */
-        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, get404());
-        return ESP_FAIL;
+        // Checks whether the file is available as .gz
+        if (stat(_filename_temp.c_str(), &file_stat) == 0) {
+            filename = _filename_temp;
+
+            ESP_LOGD(TAG, "new filename: %s", filename.c_str());
+            _gz_file_exists = true;
+        }
     }
 
-    ESP_LOGD(TAG, "Sending file: %s ...", filename.c_str());
+    const char *content_type = get_content_type_from_file(filename.c_str());
+    std::string extra_headers = "";
 
     /* For all files with the following file extention tell the webbrowser to cache them for 12h */
     if (endsWith(filename, ".html") ||
@@ -75,55 +155,220 @@ esp_err_t send_file(httpd_req_t *req, std::string filename)
         // endsWith(filename, ".zip") ||
         endsWith(filename, ".gz"))	{
         if (filename == "/sdcard/html/setup.html") {
-            httpd_resp_set_hdr(req, "Clear-Site-Data", "\"*\"");
-            set_content_type_from_file(req, filename.c_str());
+            extra_headers = "Clear-Site-Data: \"*\"\r\n";
         }
         else if (_gz_file_exists) {
-            httpd_resp_set_hdr(req, "Cache-Control", "max-age=43200");
-            httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
-            set_content_type_from_file(req, _filename_old.c_str());
+            extra_headers = "Cache-Control: max-age=43200\r\nContent-Encoding: gzip\r\n";
+            content_type = get_content_type_from_file(_filename_old.c_str());
         }
         else {
-            httpd_resp_set_hdr(req, "Cache-Control", "max-age=43200");
-            set_content_type_from_file(req, filename.c_str());
+            extra_headers = "Cache-Control: max-age=43200\r\n";
         }
     }
-    else {
-        set_content_type_from_file(req, filename.c_str());
-    }
-
-    /* Retrieve the pointer to scratch buffer for temporary storage */
-    char *chunk = scratch;
-    size_t chunksize;
-	
-    do  {
-        /* Read file in chunks into the scratch buffer */
-        chunksize = fread(chunk, 1, SERVER_HELPER_SCRATCH_BUFSIZE, fd);
-
-        /* Send the buffer contents as HTTP response chunk */
-        if (httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK)  {
-            fclose(fd);
-            ESP_LOGE(TAG, "File sending failed!");
-			
-            /* Abort sending file */
-            httpd_resp_sendstr_chunk(req, NULL);
-			
-            /* Respond with 500 Internal Server Error */
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file");
-			
-            return ESP_FAIL;
+
+    /* Revalidation after the cache time: answer from the index without touching the SD card */
+    if (_indexed && (filename != "/sdcard/html/setup.html")) {
+        char ifNoneMatch[128] = "";
+        char ifModifiedSince[40] = "";
+        std::string lastModified = CHttpRange::FormatHttpDate(indexed.modified);
+
+        httpd_req_get_hdr_value_str(req, "If-None-Match", ifNoneMatch, sizeof(ifNoneMatch));
+        httpd_req_get_hdr_value_str(req, "If-Modified-Since", ifModifiedSince, sizeof(ifModifiedSince));
+
+        if (CStaticFileIndex::IsNotModified(ifNoneMatch, ifModifiedSince, indexed.etag, lastModified)) {
+            ESP_LOGD(TAG, "Not modified: %s", filename.c_str());
+            std::string head = CStaticFileIndex::FormatNotModified(indexed.etag, lastModified, extra_headers);
+            return send_raw(req, head.c_str(), head.length()) ? ESP_OK : ESP_FAIL;
         }
+    }
+
+    FILE *fd = fopen(filename.c_str(), "r");
+    if (!fd)  {
+        ESP_LOGE(TAG, "Failed to read file: %s", filename.c_str());
+		
+        /* Respond with 404 Error */
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, get404());
+        return ESP_FAIL;
+    }
+
+    if (!_indexed) {
+        static_file_index_update(filename);  // E.g. copied to the folder without the file server
+    }
+
+    ESP_LOGD(TAG, "Sending file: %s ...", filename.c_str());
 
-        /* Keep looping till the whole file is sent */
-    } while (chunksize != 0);
+    return send_file_content(req, fd, content_type, extra_headers);
+}
+
+
+/*******************************************************************
+ * Double buffered file sending
+ * A reader task reads the next block of the file while the httpd task
+ * sends the previous one, so SD card and WLAN work in parallel.
+ *******************************************************************/
+struct FileReadBlock {
+    int buffer;
+    size_t length;      // 0: end of the transfer (or read error)
+};
+
+static uint8_t *readBuffers[2] = {NULL, NULL};
+static QueueHandle_t freeBuffers = NULL;
+static QueueHandle_t filledBuffers = NULL;
+static SemaphoreHandle_t readerMutex = NULL;   // One transfer at a time
+static TaskHandle_t readerTaskHandle = NULL;
+static FILE *readFile = NULL;
+static size_t readRemaining = 0;
+static volatile bool readAbort = false;
+
+
+static void task_file_reader(void *pvParameter)
+{
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (true) {
+            FileReadBlock block;
+            xQueueReceive(freeBuffers, &block.buffer, portMAX_DELAY);
+
+            block.length = (readAbort || (readRemaining == 0)) ? 0 :
+                           fread(readBuffers[block.buffer], 1, std::min((size_t)SERVER_FILE_SEND_BUFSIZE, readRemaining), readFile);
+            readRemaining -= block.length;
+            xQueueSend(filledBuffers, &block, portMAX_DELAY);
+
+            if (block.length == 0) {
+                break;
+            }
+        }
+    }
+}
+
+
+static bool start_file_reader(void)
+{
+    if (readerTaskHandle != NULL) {
+        return true;
+    }
+
+    readBuffers[0] = (uint8_t *)heap_caps_malloc(SERVER_FILE_SEND_BUFSIZE, MALLOC_CAP_SPIRAM);
+    readBuffers[1] = (uint8_t *)heap_caps_malloc(SERVER_FILE_SEND_BUFSIZE, MALLOC_CAP_SPIRAM);
+    freeBuffers = xQueueCreate(2, sizeof(int));
+    filledBuffers = xQueueCreate(2, sizeof(FileReadBlock));
+    readerMutex = xSemaphoreCreateMutex();
+
+    if ((readBuffers[0] == NULL) || (readBuffers[1] == NULL) || (freeBuffers == NULL) || (filledBuffers == NULL) || (readerMutex == NULL) ||
+        (xTaskCreate(&task_file_reader, "file_reader", 3 * 1024, NULL, tskIDLE_PRIORITY + 5, &readerTaskHandle) != pdPASS)) {
+        ESP_LOGE(TAG, "Failed to start the file reader, files get sent with a single buffer");
+        heap_caps_free(readBuffers[0]);
+        heap_caps_free(readBuffers[1]);
+        readBuffers[0] = readBuffers[1] = NULL;
+        readerTaskHandle = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+
+/* Sends _length bytes from the current position of the file, false on a read or send error */
+static bool send_file_data(httpd_req_t *req, FILE *fd, size_t _length)
+{
+    if (!start_file_reader() || (xSemaphoreTake(readerMutex, 0) != pdTRUE)) {
+        // Single buffer (reader in use by another transfer)
+        while (_length > 0) {
+            size_t chunksize = fread(scratch, 1, std::min((size_t)SERVER_HELPER_SCRATCH_BUFSIZE, _length), fd);
+            if ((chunksize == 0) || !send_raw(req, scratch, chunksize)) {
+                return false;
+            }
+            _length -= chunksize;
+        }
+        return true;
+    }
+
+    int buffer;
+    xQueueReset(freeBuffers);
+    xQueueReset(filledBuffers);
+    buffer = 0;
+    xQueueSend(freeBuffers, &buffer, 0);
+    buffer = 1;
+    xQueueSend(freeBuffers, &buffer, 0);
+
+    readFile = fd;
+    readRemaining = _length;
+    readAbort = false;
+    xTaskNotifyGive(readerTaskHandle);
+
+    bool ok = true;
+    FileReadBlock block;
+
+    while (true) {
+        xQueueReceive(filledBuffers, &block, portMAX_DELAY);
+        if (block.length == 0) {
+            break;
+        }
+
+        if (ok && !send_raw(req, (const char *)readBuffers[block.buffer], block.length)) {
+            ok = false;
+            readAbort = true;   // Reader stops at its next block
+        }
+        else if (ok) {
+            _length -= block.length;
+        }
+
+        xQueueSend(freeBuffers, &block.buffer, portMAX_DELAY);
+    }
+
+    readFile = NULL;
+    xSemaphoreGive(readerMutex);
+
+    return ok && (_length == 0);
+}
+
+
+esp_err_t send_file_content(httpd_req_t *req, FILE *fd, const char *_contentType, std::string _extraHeaders)
+{
+    struct stat file_stat;
+
+    if (fstat(fileno(fd), &file_stat) != 0) {
+        fclose(fd);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read file");
+        return ESP_FAIL;
+    }
+
+    size_t size = file_stat.st_size;
+    std::string etag = CHttpRange::GetETag(size, file_stat.st_mtime);
+    std::string lastModified = CHttpRange::FormatHttpDate(file_stat.st_mtime);
+    char range[64] = "";
+    char ifRange[64] = "";
+    size_t start, length;
+
+    httpd_req_get_hdr_value_str(req, "Range", range, sizeof(range));
+    httpd_req_get_hdr_value_str(req, "If-Range", ifRange, sizeof(ifRange));
+
+    CHttpRange::Result result = CHttpRange::Parse(range, ifRange, size, etag, lastModified, &start, &length);
+    std::string head = CHttpRange::FormatHead(result, _contentType, start, length, size, etag, lastModified, _extraHeaders);
+
+    if (result == CHttpRange::RANGE_PARTIAL) {
+        ESP_LOGD(TAG, "Range %s: %d bytes from %d", range, (int)length, (int)start);
+    }
+
+    bool ok = send_raw(req, head.c_str(), head.length());
+
+    if (ok && (result != CHttpRange::RANGE_NOT_SATISFIABLE) && (length > 0)) {
+        ok = (fseek(fd, start, SEEK_SET) == 0) && send_file_data(req, fd, length);
+    }
 
-    /* Close file after sending complete */
     fclose(fd);
-    ESP_LOGD(TAG, "File sending complete");
-	
-    return ESP_OK;    
+
+    if (!ok) {
+        // Content-Length is already sent, the connection gets closed
+        ESP_LOGE(TAG, "File sending failed!");
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
 }
 
+
 /* Copies the full path into destination buffer and returns
  * pointer to path (skipping the preceding base path) */
 const char* get_path_from_uri(char *dest, const char *base_path, const char *uri, size_t destsize)
@@ -155,48 +400,55 @@ const char* get_path_from_uri(char *dest, const char *base_path, const char *uri
 
 /* Set HTTP response content type according to file extension */
 esp_err_t set_content_type_from_file(httpd_req_t *req, const char *filename)
+{
+    return httpd_resp_set_type(req, get_content_type_from_file(filename));
+}
+
+
+/* HTTP content type according to file extension */
+const char *get_content_type_from_file(const char *filename)
 {
     if (IS_FILE_EXT(filename, ".pdf")) {
-        return httpd_resp_set_type(req, "application/x-pdf");
+        return "application/x-pdf";
     }
     else if (IS_FILE_EXT(filename, ".htm")) {
-        return httpd_resp_set_type(req, "text/html");
+        return "text/html";
     }
     else if (IS_FILE_EXT(filename, ".html")) {
-        return httpd_resp_set_type(req, "text/html");
+        return "text/html";
     }
     else if (IS_FILE_EXT(filename, ".jpeg")) {
-        return httpd_resp_set_type(req, "image/jpeg");
+        return "image/jpeg";
     }
     else if (IS_FILE_EXT(filename, ".jpg")) {
-        return httpd_resp_set_type(req, "image/jpeg");
+        return "image/jpeg";
     }
     else if (IS_FILE_EXT(filename, ".gif")) {
-        return httpd_resp_set_type(req, "image/gif");
+        return "image/gif";
     }
     else if (IS_FILE_EXT(filename, ".png")) {
-        return httpd_resp_set_type(req, "image/png");
+        return "image/png";
     }
     else if (IS_FILE_EXT(filename, ".ico")) {
-        return httpd_resp_set_type(req, "image/x-icon");
+        return "image/x-icon";
     }
     else if (IS_FILE_EXT(filename, ".js")) {
-        return httpd_resp_set_type(req, "application/javascript");
+        return "application/javascript";
     }
     else if (IS_FILE_EXT(filename, ".css")) {
-        return httpd_resp_set_type(req, "text/css");
+        return "text/css";
     }
     else if (IS_FILE_EXT(filename, ".xml")) {
-        return httpd_resp_set_type(req, "text/xml");
+        return "text/xml";
     }
     else if (IS_FILE_EXT(filename, ".zip")) {
-        return httpd_resp_set_type(req, "application/x-zip");
+        return "application/x-zip";
     }
     else if (IS_FILE_EXT(filename, ".gz")) {
-        return httpd_resp_set_type(req, "application/x-gzip");
+        return "application/x-gzip";
     }
 
     /* This is a limited set only */
     /* For any other type always set as plain text */
-    return httpd_resp_set_type(req, "text/plain");
+    return "text/plain";
 }
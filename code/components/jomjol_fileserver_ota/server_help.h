@@ -4,6 +4,7 @@
 #define SERVERHELP_H
 
 #include <string>
+#include <stdio.h>
 //#include <sys/param.h>
 #include "esp_http_server.h"
 
@@ -12,6 +13,14 @@ const char* get_path_from_uri(char *dest, const char *base_path, const char *uri
 
 esp_err_t send_file(httpd_req_t *req, std::string filename);
 
+/* In-memory index of the web files (see CStaticFileIndex): build at startup, update when a file got written or deleted */
+void static_file_index_build(void);
+void static_file_index_update(std::string _path);
+
+/* Send an opened file with Content-Length, only a part of it for a Range request (see CHttpRange). Closes the file. */
+esp_err_t send_file_content(httpd_req_t *req, FILE *fd, const char *_contentType, std::string _extraHeaders = "");
+
 esp_err_t set_content_type_from_file(httpd_req_t *req, const char *filename);
+const char *get_content_type_from_file(const char *filename);
 
 #endif //SERVERHELP_H
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "server_ota.h"
 
 #include <string>
+#include <algorithm>
 #include "string.h"
 
 /* TODO Rethink the usage of the int watchdog. It is no longer to be used, see
@@ -30,11 +31,15 @@ https://docs.espressif.com/projects/esp-idf/en/latest/esp32/migration-guides/rel
 
 #include "MainFlowControl.h"
 #include "server_file.h"
+#include "server_help.h"
+#include "CZipFileInstaller.h"
+#include "COtaStreamWriter.h"
 #include "server_GPIO.h"
 #ifdef ENABLE_MQTT
     #include "interface_mqtt.h"
 #endif //ENABLE_MQTT
 #include "ClassControllCamera.h"
+#include "image_log_writer.h"
 #include "connect_wlan.h"
 
 
@@ -52,6 +57,10 @@ static const char *TAG = "OTA";
 
 esp_err_t handler_reboot(httpd_req_t *req);
 static bool ota_update_task(std::string fn);
+static bool ota_stream_begin(void);
+static bool ota_stream_write(const uint8_t *_data, size_t _length);
+static bool ota_stream_end(bool _ok);
+static bool ota_stream_activate(void);
 
 std::string _file_name_update;
 bool initial_setup = false;
@@ -68,6 +77,37 @@ static void infinite_loop(void)
 }
 
 
+/* firmware.bin of an update ZIP gets written to the OTA partition while it gets inflated */
+class OtaZipSink : public CZipStream::Sink
+{
+protected:
+    bool started;
+    bool complete;
+
+public:
+    OtaZipSink() { started = false; complete = false; };
+
+    bool Begin(std::string _name, uint32_t _size)
+    {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Writing " + _name + " to the OTA partition");
+        started = ota_stream_begin();
+        complete = false;
+        return true;    // If not started, the write fails and the update gets rolled back
+    }
+
+    bool Write(const uint8_t *_data, size_t _length) { return started && ota_stream_write(_data, _length); };
+
+    bool End(bool _ok)
+    {
+        complete = started && ota_stream_end(_ok);
+        started = false;
+        return complete;
+    }
+
+    bool isComplete() { return complete; };
+};
+
+
 void task_do_Update_ZIP(void *pvParameter)
 {
     StatusLED(AP_OR_OTA, 1, true);  // Signaling an OTA update
@@ -78,34 +118,27 @@ void task_do_Update_ZIP(void *pvParameter)
 
     if (filetype == "ZIP")
     {
-        std::string in, outHtml, outHtmlTmp, outHtmlOld, outbin, zw, retfirmware;
-
-        outHtml = "/sdcard/html";
-        outHtmlTmp = "/sdcard/html_tmp";
-        outHtmlOld = "/sdcard/html_old";
-        outbin = "/sdcard/firmware";
+        /* Remove the tmp and old html folder of an update by a previous firmware in case they still exist */
+        removeFolder("/sdcard/html_tmp", TAG);
+        removeFolder("/sdcard/html_old", TAG);
 
-        /* Remove the old and tmp html folder in case they still exist */
-        removeFolder(outHtmlTmp.c_str(), TAG);
-        removeFolder(outHtmlOld.c_str(), TAG);
-
-        /* Extract the ZIP file. The content of the html folder gets extracted to the temporar folder html-temp. */
+        /* Extract the ZIP file. Each file gets written in place, firmware.bin goes straight into the OTA partition. */
         LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Extracting ZIP file " + _file_name_update + "...");
-        retfirmware = unzip_new(_file_name_update, outHtmlTmp+"/", outHtml+"/", outbin+"/", "/sdcard/", initial_setup);
-    	LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Files unzipped.");
-
-        /* ZIP file got extracted, replace the old html folder with the new one */
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Renaming folder " + outHtml + " to " + outHtmlOld + "...");
-        RenameFolder(outHtml, outHtmlOld);
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Renaming folder " + outHtmlTmp + " to " + outHtml + "...");
-        RenameFolder(outHtmlTmp, outHtml);
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Deleting folder " + outHtmlOld + "...");
-        removeFolder(outHtmlOld.c_str(), TAG);
-
-        if (retfirmware.length() > 0)
-        {
+        OtaZipSink firmware;
+        bool ok = unzip_update(_file_name_update, "/sdcard/", initial_setup, &firmware, [&]() {
+            if (!firmware.isComplete()) {
+                return true;    // Only files, the firmware stays
+            }
+
             LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Found firmware.bin");
-            ota_update_task(retfirmware);
+            return ota_stream_activate();
+        });
+
+        if (!ok) {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Update failed, the previous files got restored");
+        }
+        else {
+            LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Files unzipped.");
         }
 
         LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Trigger reboot due to firmware update");
@@ -127,6 +160,12 @@ void task_do_Update_ZIP(void *pvParameter)
 void CheckUpdate()
 {
  	FILE *pfile;
+
+    int restored = CZipFileInstaller::Rollback(UPDATE_MANIFEST_FILE);
+    if (restored >= 0) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Previous update got interrupted, restored " + to_string(restored) + " files");
+    }
+
     if ((pfile = fopen("/sdcard/update.txt", "r")) == NULL)
     {
 		LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "No pending update");
@@ -157,13 +196,22 @@ void CheckUpdate()
 }
 
 
-static bool ota_update_task(std::string fn)
-{
-    esp_err_t err;
-    /* update handle : set by esp_ota_begin(), must be freed via esp_ota_end() */
-    esp_ota_handle_t update_handle = 0 ;
-    const esp_partition_t *update_partition = NULL;
+/*******************************************************************
+ * Streaming OTA write: the image gets written to the next OTA partition
+ * piece by piece, e.g. from a file or from a ZIP entry while it gets inflated.
+ *******************************************************************/
+#define OTA_HEADER_CHECK_SIZE (sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t))
 
+static esp_ota_handle_t otaHandle = 0;
+static const esp_partition_t *otaPartition = NULL;
+static uint8_t otaHeader[OTA_HEADER_CHECK_SIZE];     // Collected until the version can be checked
+static size_t otaHeaderLength = 0;
+static bool otaStarted = false;                     // esp_ota_begin() done
+static int otaLength = 0;
+
+
+static bool ota_stream_begin(void)
+{
     ESP_LOGI(TAG, "Starting OTA update");
 
     const esp_partition_t *configured = esp_ota_get_boot_partition();
@@ -177,103 +225,123 @@ static bool ota_update_task(std::string fn)
     ESP_LOGI(TAG, "Running partition type %d subtype %d (offset 0x%08x)",
              running->type, running->subtype, (unsigned int)running->address);
 
+    otaPartition = esp_ota_get_next_update_partition(NULL);
+    if (otaPartition == NULL) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "No OTA partition to write to");
+        return false;
+    }
 
-    update_partition = esp_ota_get_next_update_partition(NULL);
     ESP_LOGI(TAG, "Writing to partition subtype %d at offset 0x%x",
-             update_partition->subtype, (unsigned int)update_partition->address);
-//    assert(update_partition != NULL);
+             otaPartition->subtype, (unsigned int)otaPartition->address);
+
+    otaHandle = 0;
+    otaHeaderLength = 0;
+    otaStarted = false;
+    otaLength = 0;
+    return true;
+}
 
-    int binary_file_length = 0;
 
-    // deal with all receive packet 
-    bool image_header_was_checked = false;
+/* Check the version of the new firmware, then start writing with the collected header */
+static bool ota_stream_check_header(void)
+{
+    esp_err_t err;
+    esp_app_desc_t new_app_info;
 
-    int data_read;     
+    // check current version with downloading
+    memcpy(&new_app_info, &otaHeader[sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t)], sizeof(esp_app_desc_t));
+    ESP_LOGI(TAG, "New firmware version: %s", new_app_info.version);
 
-    FILE* f = fopen(fn.c_str(), "rb");     // previously only "r
+    esp_app_desc_t running_app_info;
+    if (esp_ota_get_partition_description(esp_ota_get_running_partition(), &running_app_info) == ESP_OK) {
+        ESP_LOGI(TAG, "Running firmware version: %s", running_app_info.version);
+    }
 
-    if (f == NULL) { // File does not exist
+    const esp_partition_t* last_invalid_app = esp_ota_get_last_invalid_partition();
+    esp_app_desc_t invalid_app_info;
+    if (esp_ota_get_partition_description(last_invalid_app, &invalid_app_info) == ESP_OK) {
+        ESP_LOGI(TAG, "Last invalid firmware version: %s", invalid_app_info.version);
+    }
+
+    // check current version with last invalid partition
+    if (last_invalid_app != NULL) {
+        if (memcmp(invalid_app_info.version, new_app_info.version, sizeof(new_app_info.version)) == 0) {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "New version is the same as invalid version");
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Previously, there was an attempt to launch the firmware with " + 
+                    string(invalid_app_info.version) + " version, but it failed");
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "The firmware has been rolled back to the previous version");
+            infinite_loop();
+        }
+    }
+
+    err = esp_ota_begin(otaPartition, OTA_SIZE_UNKNOWN, &otaHandle);
+    if (err != ESP_OK) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "esp_ota_begin failed (" + string(esp_err_to_name(err)) + ")");
         return false;
     }
+    ESP_LOGI(TAG, "esp_ota_begin succeeded");
+    otaStarted = true;
+
+    err = esp_ota_write(otaHandle, otaHeader, otaHeaderLength);
+    return err == ESP_OK;
+}
 
-    data_read = fread(ota_write_data, 1, SERVER_OTA_SCRATCH_BUFSIZE, f);
 
-    while (data_read > 0) {
-        if (data_read < 0) {
-            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Error: SSL data read error");
+static bool ota_stream_write(const uint8_t *_data, size_t _length)
+{
+    otaLength += _length;
+
+    if (!otaStarted) {
+        size_t take = std::min(_length, OTA_HEADER_CHECK_SIZE - otaHeaderLength);
+        memcpy(otaHeader + otaHeaderLength, _data, take);
+        otaHeaderLength += take;
+        _data += take;
+        _length -= take;
+
+        if (otaHeaderLength < OTA_HEADER_CHECK_SIZE) {
+            return true;
+        }
+
+        if (!ota_stream_check_header()) {
             return false;
-        } else if (data_read > 0) {
-            if (image_header_was_checked == false) {
-                esp_app_desc_t new_app_info;
-                if (data_read > sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t)) {
-                    // check current version with downloading
-                    memcpy(&new_app_info, &ota_write_data[sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t)], sizeof(esp_app_desc_t));
-                    ESP_LOGI(TAG, "New firmware version: %s", new_app_info.version);
-
-                    esp_app_desc_t running_app_info;
-                    if (esp_ota_get_partition_description(running, &running_app_info) == ESP_OK) {
-                        ESP_LOGI(TAG, "Running firmware version: %s", running_app_info.version);
-                    }
+        }
+    }
 
-                    const esp_partition_t* last_invalid_app = esp_ota_get_last_invalid_partition();
-                    esp_app_desc_t invalid_app_info;
-                    if (esp_ota_get_partition_description(last_invalid_app, &invalid_app_info) == ESP_OK) {
-                        ESP_LOGI(TAG, "Last invalid firmware version: %s", invalid_app_info.version);
-                    }
+    if (_length == 0) {
+        return true;
+    }
 
-                    // check current version with last invalid partition
-                    if (last_invalid_app != NULL) {
-                        if (memcmp(invalid_app_info.version, new_app_info.version, sizeof(new_app_info.version)) == 0) {
-                            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "New version is the same as invalid version");
-                            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Previously, there was an attempt to launch the firmware with " + 
-                                    string(invalid_app_info.version) + " version, but it failed");
-                            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "The firmware has been rolled back to the previous version");
-                            infinite_loop();
-                        }
-                    }
+    esp_err_t err = esp_ota_write(otaHandle, (const void *)_data, _length);
+    if (err != ESP_OK) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "esp_ota_write failed (" + string(esp_err_to_name(err)) + ")!");
+        return false;
+    }
 
-/*
-                    if (memcmp(new_app_info.version, running_app_info.version, sizeof(new_app_info.version)) == 0) {
-                        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Current running version is the same as a new. We will not continue the update");
-                        infinite_loop();
-                    }
-*/
-                    image_header_was_checked = true;
+    ESP_LOGD(TAG, "Written image length %d", otaLength);
+    return true;
+}
 
-                    err = esp_ota_begin(update_partition, OTA_SIZE_UNKNOWN, &update_handle);
-                    if (err != ESP_OK) {
-                        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "esp_ota_begin failed (" + string(esp_err_to_name(err)) + ")");
-                        return false;
-                    }
-                    ESP_LOGI(TAG, "esp_ota_begin succeeded");
-                } else {
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "received package is not fit len");
-                    return false;
-                }
-            }            
-            err = esp_ota_write( update_handle, (const void *)ota_write_data, data_read);
-            if (err != ESP_OK) {
-                return false;
-            }
-            binary_file_length += data_read;
-            ESP_LOGD(TAG, "Written image length %d", binary_file_length);
-        } else if (data_read == 0) {
-           //
-           // * As esp_http_client_read never returns negative error code, we rely on
-           // * `errno` to check for underlying transport connectivity closure if any
-           //
-            if (errno == ECONNRESET || errno == ENOTCONN) {
-                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Connection closed, errno = " + to_string(errno));
-                break;
-            }
+
+/* Finish (validate) the image, _ok false: abort it */
+static bool ota_stream_end(bool _ok)
+{
+    if (!otaStarted) {
+        if (_ok) {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "received package is not fit len");
         }
-        data_read = fread(ota_write_data, 1, SERVER_OTA_SCRATCH_BUFSIZE, f);
+        return false;
     }
-    fclose(f);  
 
-    ESP_LOGI(TAG, "Total Write binary data length: %d", binary_file_length);
+    otaStarted = false;
 
-    err = esp_ota_end(update_handle);
+    if (!_ok) {
+        esp_ota_abort(otaHandle);
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Total Write binary data length: %d", otaLength);
+
+    esp_err_t err = esp_ota_end(otaHandle);
     if (err != ESP_OK) {
         if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
             LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Image validation failed, image is corrupted");
@@ -282,15 +350,116 @@ static bool ota_update_task(std::string fn)
         return false;
     }
 
-    err = esp_ota_set_boot_partition(update_partition);
+    return true;
+}
+
+
+/* Boot the new image after the next restart */
+static bool ota_stream_activate(void)
+{
+    esp_err_t err = esp_ota_set_boot_partition(otaPartition);
     if (err != ESP_OK) {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "esp_ota_set_boot_partition failed (" + string(esp_err_to_name(err)) + ")!");
+        return false;
+    }
+
+    return true;
+}
+
+
+/* The OTA partition for COtaStreamWriter */
+class OtaPartitionWriter : public COtaStreamWriter::Partition
+{
+public:
+    bool Begin() { return ota_stream_begin(); };
+    bool Write(const uint8_t *_data, size_t _length) { return ota_stream_write(_data, _length); };
+    bool End(bool _ok) { return ota_stream_end(_ok); };
+};
+
+
+/**
+ * Firmware upload which gets written to the OTA partition while it is received (POST /ota_stream?md5=<hex>)
+ * Nothing gets staged on the SD card, so the image is only limited by the partition size.
+ * The new firmware gets booted after the reboot, answer "reboot" as the update task does.
+ */
+esp_err_t handler_ota_stream(httpd_req_t *req)
+{
+    char _query[100];
+    char _md5[40] = "";
+
+    if (httpd_req_get_url_query_str(req, _query, sizeof(_query)) == ESP_OK) {
+        httpd_query_key_value(_query, "md5", _md5, sizeof(_md5));
+    }
 
+    const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+    if (partition == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No OTA partition to write to");
+        return ESP_FAIL;
     }
-//    ESP_LOGI(TAG, "Prepare to restart system!");
-//    esp_restart();
 
-    return true ;
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Firmware upload to the OTA partition, " + to_string(req->content_len) + " bytes");
+
+    OtaPartitionWriter partitionWriter;
+    COtaStreamWriter writer(&partitionWriter, partition->size);
+    bool ok = writer.Begin(req->content_len, _md5);
+    size_t remaining = req->content_len;
+
+    while (ok && (remaining > 0)) {
+        int received = httpd_req_recv(req, ota_write_data, std::min(remaining, (size_t)SERVER_OTA_SCRATCH_BUFSIZE));
+        if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;   // Retry if timeout occurred
+        }
+
+        if (received <= 0) {
+            writer.Abort("Failed to receive the file");
+            ok = false;
+            break;
+        }
+
+        ok = writer.Write((const uint8_t *)ota_write_data, received);
+        remaining -= received;
+    }
+
+    if (ok) {
+        ok = writer.Finish() && ota_stream_activate();
+    }
+
+    if (!ok) {
+        std::string error = writer.getError().empty() ? "Failed to activate the new firmware" : writer.getError();
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Firmware upload failed: " + error);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, ("Firmware update failed: " + error).c_str());
+        return ESP_FAIL;
+    }
+
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Firmware written (MD5 " + writer.getMD5() + "), reboot to activate it");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_sendstr(req, "reboot\n");
+    return ESP_OK;
+}
+
+
+static bool ota_update_task(std::string fn)
+{
+    FILE* f = fopen(fn.c_str(), "rb");     // previously only "r
+
+    if (f == NULL) { // File does not exist
+        return false;
+    }
+
+    if (!ota_stream_begin()) {
+        fclose(f);
+        return false;
+    }
+
+    bool ok = true;
+    size_t data_read;
+
+    while (ok && ((data_read = fread(ota_write_data, 1, SERVER_OTA_SCRATCH_BUFSIZE, f)) > 0)) {
+        ok = ota_stream_write((const uint8_t *)ota_write_data, data_read);
+    }
+    fclose(f);  
+
+    return ota_stream_end(ok) && ota_stream_activate();
 }
 
 
@@ -521,10 +690,10 @@ esp_err_t handler_ota_update(httpd_req_t *req)
         in = "/sdcard/firmware/html.zip";
         out = "/sdcard/html";
 
-        delete_all_in_directory(out);
-
-        unzip(in, out+"/");
-        zw = "Web Interface Update Successfull!\nNo reboot necessary";
+        // Files get replaced one by one, the previous web interface stays if the ZIP file is broken
+        bool ok = unzip(in, out+"/", true);
+        static_file_index_build();  // New files, new ETags
+        zw = ok ? "Web Interface Update Successfull!\nNo reboot necessary" : "Web Interface Update failed, see the log file!";
         httpd_resp_send(req, zw.c_str(), strlen(zw.c_str()));
         httpd_resp_sendstr_chunk(req, NULL);  
         return ESP_OK;        
@@ -613,6 +782,8 @@ void task_reboot(void *DeleteMainFlow)
         DeleteMainFlowTask();  // Kill autoflow task if executed in extra task, if not don't kill parent task
     }
 
+    image_log_writer_flush(5000);   // Images of the last round which are still queued
+
     Camera.LightOnOff(false);
     StatusLEDOff();
 
@@ -709,6 +880,12 @@ void register_server_ota_sdcard_uri(httpd_handle_t server)
     camuri.user_ctx  = (void*) "Do OTA";    
     httpd_register_uri_handler(server, &camuri);
 
+    camuri.method    = HTTP_POST;
+    camuri.uri       = "/ota_stream";
+    camuri.handler = APPLY_BASIC_AUTH_FILTER(handler_ota_stream);
+    camuri.user_ctx  = (void*) "Stream OTA";
+    httpd_register_uri_handler(server, &camuri);
+
     camuri.method    = HTTP_GET;
     camuri.uri       = "/reboot";
     camuri.handler = APPLY_BASIC_AUTH_FILTER(handler_reboot);
@@ -0,0 +1,70 @@
+#include "ClassAdaptiveInterval.h"
+
+#include <math.h>
+
+
+ClassAdaptiveInterval::ClassAdaptiveInterval()
+{
+    Setup(false, 5, 5, 5);
+}
+
+
+void ClassAdaptiveInterval::Setup(bool _enabled, float _intervalBase, float _intervalMin, float _intervalMax, float _backoffFactor)
+{
+    intervalBase = _intervalBase;
+    intervalMin = _intervalMin;
+    intervalMax = _intervalMax;
+    backoffFactor = _backoffFactor;
+
+    /* Sanitize bounds: min <= base <= max, backoff > 1 */
+    if (intervalMin <= 0) {
+        intervalMin = intervalBase;
+    }
+
+    if (intervalMax < intervalMin) {
+        intervalMax = intervalMin;
+    }
+
+    if (backoffFactor <= 1.0) {
+        backoffFactor = 2.0;
+    }
+
+    enabled = _enabled && (intervalMin < intervalMax);
+
+    Reset();
+}
+
+
+void ClassAdaptiveInterval::Reset()
+{
+    intervalAct = fmin(fmax(intervalBase, intervalMin), intervalMax);
+    idleRounds = 0;
+}
+
+
+float ClassAdaptiveInterval::Update(double _rate, bool _valid)
+{
+    if (!enabled) {
+        return intervalBase;
+    }
+
+    if (!_valid) {
+        // No reliable reading -> keep current interval
+        return intervalAct;
+    }
+
+    double rate = fabs(_rate);
+
+    if (rate > 0) {
+        // Meter is moving (a rising rate is non-zero as well) -> finest resolution
+        intervalAct = intervalMin;
+        idleRounds = 0;
+    }
+    else {
+        // Meter is idle -> exponential backoff, capped
+        idleRounds++;
+        intervalAct = fmin(intervalAct * backoffFactor, intervalMax);
+    }
+
+    return intervalAct;
+}
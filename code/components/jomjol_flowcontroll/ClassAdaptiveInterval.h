@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef CLASSADAPTIVEINTERVAL_H
+#define CLASSADAPTIVEINTERVAL_H
+
+/**
+ * Adaptive round interval scheduler
+ * While the meter is moving (flow rate non-zero or rising), the round interval is shortened to the lower bound.
+ * While the meter is idle, the interval backs off exponentially until the upper bound is reached.
+ * The class has no ESP dependencies so that recorded value series can be replayed in a unit test.
+ */
+class ClassAdaptiveInterval
+{
+protected:
+    bool enabled;
+    float intervalBase;     // Minutes; configured fixed interval ([AutoTimer] Interval), used as start value
+    float intervalMin;      // Minutes; lower bound while the meter is moving
+    float intervalMax;      // Minutes; upper bound while the meter is idle
+    float backoffFactor;    // Multiplier applied per idle round
+    float intervalAct;      // Minutes; interval to be used for the next round
+    int idleRounds;         // Number of consecutive idle rounds
+
+public:
+    ClassAdaptiveInterval();
+
+    void Setup(bool _enabled, float _intervalBase, float _intervalMin, float _intervalMax, float _backoffFactor = 2.0);
+    void Reset();
+
+    /**
+     * Feed the result of a round into the scheduler
+     * @param _rate max. absolute flow rate (ΔValue/min) of all numbers of this round
+     * @param _valid false, if no number could be read without error (interval is kept unchanged)
+     * @return interval for the next round in minutes
+     */
+    float Update(double _rate, bool _valid);
+
+    bool isEnabled() { return enabled; };
+    float getInterval() { return enabled ? intervalAct : intervalBase; };
+    float getIntervalMax() { return enabled ? intervalMax : intervalBase; };
+    int getIdleRounds() { return idleRounds; };
+};
+
+#endif //CLASSADAPTIVEINTERVAL_H
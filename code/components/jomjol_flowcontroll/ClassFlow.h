@@ -19,6 +19,7 @@ struct HTMLInfo
 	CImageBasis *image_org = NULL;
 	std::string filename;
 	std::string filename_org;	
+	int posx = 0, posy = 0, deltax = 0, deltay = 0; // ROI area, used if there is no image_org
 };
 
 
@@ -4,9 +4,11 @@
 #include <iomanip> 
 #include <sys/types.h>
 #include <sstream>      // std::stringstream
+#include <algorithm>
 
 #include "CTfLiteClass.h"
 #include "ClassLogFile.h"
+#include "psram.h"
 #include "esp_log.h"
 #include "../../include/defines.h"
 
@@ -23,6 +25,10 @@ ClassFlowCNNGeneral::ClassFlowCNNGeneral(ClassFlowAlignment *_flowalign, t_CNNTy
     string cnnmodelfile = "";
     modelxsize = 1;
     modelysize = 1;
+    modelchannel = 1;
+    modelArenaUsed = 0;
+    roiBuffer = NULL;
+    keepROIOriginal = true;
     CNNGoodThreshold = 0.0;
     ListFlowControll = NULL;
     previousElement = NULL;   
@@ -332,6 +338,10 @@ bool ClassFlowCNNGeneral::ReadParameter(FILE* pfile, string& aktparamgraph) {
             this->isLogImage = true;
         }
         
+        if ((toUpper(splitted[0]) == "ROIIMAGESFORMAT") && (splitted.size() > 1)) {
+            this->isLogImagePack = (toUpper(splitted[1]) == "CONTAINER");
+        }
+
         if ((toUpper(splitted[0]) == "LOGIMAGESELECT") && (splitted.size() > 1)) {
             LogImageSelect = splitted[1];
             isLogImageSelect = true;            
@@ -382,16 +392,76 @@ bool ClassFlowCNNGeneral::ReadParameter(FILE* pfile, string& aktparamgraph) {
         return false;
     }
 
+    CreateROIImages();
+
+    return true;
+}
+
+
+/**
+ * The ROI buffers live for the whole uptime. All of them are exact size slices of one block:
+ * first the model input images (used one after another by the inference), then the original
+ * sized ROI images. The original images are only kept if they get logged or saved, else the
+ * ROIs get resized directly from the aligned image.
+ * If the block can not be allocated, the buffers get allocated one by one.
+ */
+void ClassFlowCNNGeneral::CreateROIImages()
+{
+    size_t imageSize = modelxsize * modelysize * modelchannel;
+    size_t blockSize = 0;
+
+    keepROIOriginal = isLogImage || SaveAllFiles;
+
     for (int _ana = 0; _ana < GENERAL.size(); ++_ana) {
         for (int i = 0; i < GENERAL[_ana]->ROI.size(); ++i) {
-            GENERAL[_ana]->ROI[i]->image = new CImageBasis("ROI " + GENERAL[_ana]->ROI[i]->name, 
-                    modelxsize, modelysize, modelchannel);
-            GENERAL[_ana]->ROI[i]->image_org = new CImageBasis("ROI " + GENERAL[_ana]->ROI[i]->name + " original",
-                    GENERAL[_ana]->ROI[i]->deltax, GENERAL[_ana]->ROI[i]->deltay, 3);
+            blockSize += (imageSize + CMemoryArena::ALIGNMENT - 1) & ~(CMemoryArena::ALIGNMENT - 1);
+
+            if (keepROIOriginal) {
+                size_t orgSize = GENERAL[_ana]->ROI[i]->deltax * GENERAL[_ana]->ROI[i]->deltay * 3;
+                blockSize += (orgSize + CMemoryArena::ALIGNMENT - 1) & ~(CMemoryArena::ALIGNMENT - 1);
+            }
         }
     }
 
-    return true;
+    if (blockSize == 0) {
+        return;
+    }
+
+    CMemoryArena slices;
+    roiBuffer = (uint8_t *)malloc_psram_heap(std::string(TAG) + "->ROI images", blockSize, MALLOC_CAP_SPIRAM);
+    slices.Init(roiBuffer, blockSize);
+
+    for (int _ana = 0; _ana < GENERAL.size(); ++_ana) {
+        for (int i = 0; i < GENERAL[_ana]->ROI.size(); ++i) {
+            roi *r = GENERAL[_ana]->ROI[i];
+            uint8_t *image = (uint8_t *)slices.Alloc(imageSize);
+
+            if (image) {
+                r->image = new CImageBasis("ROI " + r->name, image, modelchannel, modelxsize, modelysize, modelchannel);
+            }
+            else {
+                r->image = new CImageBasis("ROI " + r->name, modelxsize, modelysize, modelchannel);
+            }
+        }
+    }
+
+    if (!keepROIOriginal) {
+        return;
+    }
+
+    for (int _ana = 0; _ana < GENERAL.size(); ++_ana) {
+        for (int i = 0; i < GENERAL[_ana]->ROI.size(); ++i) {
+            roi *r = GENERAL[_ana]->ROI[i];
+            uint8_t *imageOrg = (uint8_t *)slices.Alloc(r->deltax * r->deltay * 3);
+
+            if (imageOrg) {
+                r->image_org = new CImageBasis("ROI " + r->name + " original", imageOrg, 3, r->deltax, r->deltay, 3);
+            }
+            else {
+                r->image_org = new CImageBasis("ROI " + r->name + " original", r->deltax, r->deltay, 3);
+            }
+        }
+    }
 }
 
 general* ClassFlowCNNGeneral::FindGENERAL(string _name_number) {
@@ -510,6 +580,11 @@ bool ClassFlowCNNGeneral::doAlignAndCut(string time) {
         for (int i = 0; i < GENERAL[_ana]->ROI.size(); ++i) {
             ESP_LOGD(TAG, "General %d - Align&Cut", i);
             
+            if (!GENERAL[_ana]->ROI[i]->image_org) { // Original not needed -> resize directly from the aligned image
+                caic->CutAndResize(GENERAL[_ana]->ROI[i]->posx, GENERAL[_ana]->ROI[i]->posy, GENERAL[_ana]->ROI[i]->deltax, GENERAL[_ana]->ROI[i]->deltay, GENERAL[_ana]->ROI[i]->image);
+                continue;
+            }
+
             caic->CutAndSave(GENERAL[_ana]->ROI[i]->posx, GENERAL[_ana]->ROI[i]->posy, GENERAL[_ana]->ROI[i]->deltax, GENERAL[_ana]->ROI[i]->deltay, GENERAL[_ana]->ROI[i]->image_org);
             if (SaveAllFiles) {
                 if (GENERAL[_ana]->name == "default") {
@@ -566,32 +641,32 @@ bool ClassFlowCNNGeneral::getNetworkParameter() {
         return true;
     }
 
-    CTfLiteClass *tflite = new CTfLiteClass;  
+    CTfLiteClass tflite; // Lives on the stack, the large buffers are in the shared PSRAM region
     string zwcnn = "/sdcard" + cnnmodelfile;
     zwcnn = FormatFileName(zwcnn);
     ESP_LOGD(TAG, "%s", zwcnn.c_str());
     
-    if (!tflite->LoadModel(zwcnn)) {
+    if (!tflite.LoadModel(zwcnn)) {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Can't load tflite model " + cnnmodelfile + " -> Init aborted!");
         LogFile.WriteHeapInfo("getNetworkParameter-LoadModel");
-        delete tflite;
         return false;
     } 
 
-    if (!tflite->MakeAllocate()) {
+    if (!tflite.MakeAllocate()) {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Can't allocate tflite model -> Init aborted!");
         LogFile.WriteHeapInfo("getNetworkParameter-MakeAllocate");
-        delete tflite;
         return false;
     }
 
+    modelArenaUsed = tflite.GetArenaUsedBytes();
+
     if (CNNType == AutoDetect) {
-        tflite->GetInputDimension(false);
-        modelxsize = tflite->ReadInputDimenstion(0);
-        modelysize = tflite->ReadInputDimenstion(1);
-        modelchannel = tflite->ReadInputDimenstion(2);
+        tflite.GetInputDimension(false);
+        modelxsize = tflite.ReadInputDimenstion(0);
+        modelysize = tflite.ReadInputDimenstion(1);
+        modelchannel = tflite.ReadInputDimenstion(2);
 
-        int _anzoutputdimensions = tflite->GetAnzOutPut();
+        int _anzoutputdimensions = tflite.GetAnzOutPut();
         switch (_anzoutputdimensions) {
             case 2:
                 CNNType = Analogue;
@@ -629,7 +704,6 @@ bool ClassFlowCNNGeneral::getNetworkParameter() {
         }
     }
 
-    delete tflite;
     return true;
 }
 
@@ -640,22 +714,20 @@ bool ClassFlowCNNGeneral::doNeuralNetwork(string time) {
 
     string logPath = CreateLogFolder(time);
 
-    CTfLiteClass *tflite = new CTfLiteClass;  
+    CTfLiteClass tflite; // Lives on the stack, the large buffers are in the shared PSRAM region
     string zwcnn = "/sdcard" + cnnmodelfile;
     zwcnn = FormatFileName(zwcnn);
     ESP_LOGD(TAG, "%s", zwcnn.c_str());
 
-    if (!tflite->LoadModel(zwcnn)) {
+    if (!tflite.LoadModel(zwcnn)) {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Can't load tflite model " + cnnmodelfile + " -> Exec aborted this round!");
         LogFile.WriteHeapInfo("doNeuralNetwork-LoadModel");
-        delete tflite;
         return false;
     }
 
-    if (!tflite->MakeAllocate()) {
+    if (!tflite.MakeAllocate()) {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Can't allocate tfilte model -> Exec aborted this round!");
         LogFile.WriteHeapInfo("doNeuralNetwork-MakeAllocate");
-        delete tflite;
         return false;
     }
 
@@ -674,12 +746,12 @@ bool ClassFlowCNNGeneral::doNeuralNetwork(string time) {
                         float f1, f2;
                         f1 = 0; f2 = 0;
 
-                        tflite->LoadInputImageBasis(GENERAL[n]->ROI[roi]->image);        
-                        tflite->Invoke();
+                        tflite.LoadInputImageBasis(GENERAL[n]->ROI[roi]->image);        
+                        tflite.Invoke();
                         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "After Invoke");
 
-                        f1 = tflite->GetOutputValue(0);
-                        f2 = tflite->GetOutputValue(1);
+                        f1 = tflite.GetOutputValue(0);
+                        f2 = tflite.GetOutputValue(1);
                         float result = fmod(atan2(f1, f2) / (M_PI * 2) + 2, 1);
                               
                         if(GENERAL[n]->ROI[roi]->CCW) {
@@ -699,7 +771,7 @@ bool ClassFlowCNNGeneral::doNeuralNetwork(string time) {
                     LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "CNN Type: Digit");
                     {
                         GENERAL[n]->ROI[roi]->result_klasse = 0;
-                        GENERAL[n]->ROI[roi]->result_klasse = tflite->GetClassFromImageBasis(GENERAL[n]->ROI[roi]->image);
+                        GENERAL[n]->ROI[roi]->result_klasse = tflite.GetClassFromImageBasis(GENERAL[n]->ROI[roi]->image);
                         ESP_LOGD(TAG, "General result (Digit)%i: %d", roi, GENERAL[n]->ROI[roi]->result_klasse);
 
                         if (isLogImage) {
@@ -723,17 +795,17 @@ bool ClassFlowCNNGeneral::doNeuralNetwork(string time) {
                         float _fit;
                         float _result_save_file;
 
-                        tflite->LoadInputImageBasis(GENERAL[n]->ROI[roi]->image);        
-                        tflite->Invoke();
+                        tflite.LoadInputImageBasis(GENERAL[n]->ROI[roi]->image);        
+                        tflite.Invoke();
                         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "After Invoke");
 
-                        _num = tflite->GetOutClassification(0, 9);
+                        _num = tflite.GetOutClassification(0, 9);
                         _numplus = (_num + 1) % 10;
                         _numminus = (_num - 1 + 10) % 10;
 
-                        _val = tflite->GetOutputValue(_num);
-                        _valplus = tflite->GetOutputValue(_numplus);
-                        _valminus = tflite->GetOutputValue(_numminus);
+                        _val = tflite.GetOutputValue(_num);
+                        _valplus = tflite.GetOutputValue(_numplus);
+                        _valminus = tflite.GetOutputValue(_numminus);
 
                         float result = _num;
 
@@ -794,10 +866,10 @@ bool ClassFlowCNNGeneral::doNeuralNetwork(string time) {
                         int _num;
                         float _result_save_file;
                         
-                        tflite->LoadInputImageBasis(GENERAL[n]->ROI[roi]->image);        
-                        tflite->Invoke();
+                        tflite.LoadInputImageBasis(GENERAL[n]->ROI[roi]->image);        
+                        tflite.Invoke();
     
-                        _num = tflite->GetOutClassification();
+                        _num = tflite.GetOutClassification();
                         
                         if(GENERAL[n]->ROI[roi]->CCW) {
                             GENERAL[n]->ROI[roi]->result_float = 10 - ((float)_num / 10.0);
@@ -832,7 +904,6 @@ bool ClassFlowCNNGeneral::doNeuralNetwork(string time) {
         }
     }
 
-    delete tflite;
 
     return true;
 }
@@ -879,6 +950,10 @@ std::vector<HTMLInfo*> ClassFlowCNNGeneral::GetHTMLInfo() {
             
             zw->image = GENERAL[_ana]->ROI[i]->image;
             zw->image_org = GENERAL[_ana]->ROI[i]->image_org;
+            zw->posx = GENERAL[_ana]->ROI[i]->posx;
+            zw->posy = GENERAL[_ana]->ROI[i]->posy;
+            zw->deltax = GENERAL[_ana]->ROI[i]->deltax;
+            zw->deltay = GENERAL[_ana]->ROI[i]->deltay;
 
             result.push_back(zw);
         }
@@ -5,6 +5,7 @@
 
 #include"ClassFlowDefineTypes.h"
 #include "ClassFlowAlignment.h"
+#include "CMemoryArena.h"
 
 
 enum t_CNNType {
@@ -28,12 +29,16 @@ protected:
 
     string cnnmodelfile;
     int modelxsize, modelysize, modelchannel;
+    size_t modelArenaUsed;
     bool isLogImageSelect;
     string LogImageSelect;
     ClassFlowAlignment* flowpostalignment;
 
     bool SaveAllFiles;   
 
+    uint8_t *roiBuffer;         // One block for all ROI images, see CreateROIImages()
+    bool keepROIOriginal;       // Original sized ROI images are needed (image logging, SaveAllFiles)
+
     int PointerEvalAnalogNew(float zahl, int numeral_preceder);
     int PointerEvalAnalogToDigitNew(float zahl, float numeral_preceder,  int eval_predecessors, float AnalogToDigitTransitionStart);
     int PointerEvalHybridNew(float zahl, float number_of_predecessors, int eval_predecessors, bool Analog_Predecessors = false, float AnalogToDigitTransitionStart=9.2);
@@ -44,6 +49,7 @@ protected:
     bool doAlignAndCut(string time);
 
     bool getNetworkParameter();
+    void CreateROIImages();
 
 public:
     ClassFlowCNNGeneral(ClassFlowAlignment *_flowalign, t_CNNType _cnntype = AutoDetect);
@@ -71,6 +77,9 @@ public:
     void UpdateNameNumbers(std::vector<std::string> *_name_numbers);
 
     t_CNNType getCNNType(){return CNNType;};
+    string getModelFile(){return cnnmodelfile;};
+    size_t getModelInputBytes(){return modelxsize * modelysize * modelchannel;};
+    size_t getModelArenaUsedBytes(){return modelArenaUsed;};
 
     string name(){return "ClassFlowCNNGeneral";}; 
 };
@@ -6,6 +6,7 @@
 #include "freertos/task.h"
 
 #include <sys/stat.h>
+#include <math.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,7 +19,10 @@ extern "C" {
 #include "ClassLogFile.h"
 #include "time_sntp.h"
 #include "Helper.h"
+#include "psram.h"
+#include "esp_timer.h"
 #include "server_ota.h"
+#include "server_events.h"
 #ifdef ENABLE_MQTT
     #include "interface_mqtt.h"
     #include "server_mqtt.h"
@@ -197,7 +201,8 @@ bool ClassFlowControll::StartMQTTService()
     /* Start the MQTT service */
     for (int i = 0; i < FlowControll.size(); ++i) {
         if (FlowControll[i]->name().compare("ClassFlowMQTT") == 0) {
-            return ((ClassFlowMQTT*) (FlowControll[i]))->Start(AutoInterval);
+            // Use the longest possible interval, otherwise the LWT could expire while the adaptive scheduler backs off
+            return ((ClassFlowMQTT*) (FlowControll[i]))->Start(adaptiveInterval.getIntervalMax());
         }  
     } 
     return false;
@@ -209,11 +214,15 @@ void ClassFlowControll::SetInitialParameter(void)
     AutoStart = true;
     SetupModeActive = false;
     AutoInterval = 10; // Minutes
+    AutoIntervalAdaptive = false;
+    AutoIntervalMin = 1; // Minutes, 0 = use AutoInterval
+    AutoIntervalMax = 60; // Minutes, 0 = use AutoInterval
     flowdigit = NULL;
     flowanalog = NULL;
     flowpostprocessing = NULL;
     disabled = false;
     aktRunNr = 0;
+    memoryBudgetOk = true;
     aktstatus = "Flow task not yet created";
     aktstatusWithTime = aktstatus;
 }
@@ -227,7 +236,34 @@ bool ClassFlowControll::getIsAutoStart(void)
 
 void ClassFlowControll::setAutoStartInterval(long &_interval)
 {
-    _interval = AutoInterval * 60 * 1000; // AutoInterval: minutes -> ms
+    _interval = adaptiveInterval.getInterval() * 60 * 1000; // Interval: minutes -> ms
+}
+
+
+void ClassFlowControll::UpdateAdaptiveInterval(void)
+{
+    if (!adaptiveInterval.isEnabled() || !flowpostprocessing) {
+        return;
+    }
+
+    double maxRate = 0;
+    bool valid = false;
+    std::vector<NumberPost*> *numbers = flowpostprocessing->GetNumbers();
+
+    for (int i = 0; i < (*numbers).size(); ++i) {
+        if ((*numbers)[i]->ErrorMessageText == "no error") {
+            valid = true;
+            maxRate = max(maxRate, fabs((*numbers)[i]->FlowRateAct));
+        }
+    }
+
+    float previousInterval = adaptiveInterval.getInterval();
+    float nextInterval = adaptiveInterval.Update(maxRate, valid);
+
+    if (nextInterval != previousInterval) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Adaptive interval: " + to_string(previousInterval) + " -> " + to_string(nextInterval) + 
+                                               " minutes (rate: " + to_string(maxRate) + ", idle rounds: " + to_string(adaptiveInterval.getIdleRounds()) + ")");
+    }
 }
 
 ClassFlow* ClassFlowControll::CreateClassFlow(std::string _type)
@@ -310,6 +346,7 @@ void ClassFlowControll::InitFlow(std::string config)
 {
     aktstatus = "Initialization";
     aktstatusWithTime = aktstatus;
+    server_events_publish("status", aktstatusWithTime);
 
     //#ifdef ENABLE_MQTT
         //MQTTPublish(mqttServer_getMainTopic() + "/" + "status", "Initialization", 1, false); // Right now, not possible -> MQTT Service is going to be started later
@@ -352,6 +389,65 @@ void ClassFlowControll::InitFlow(std::string config)
     }
 
     fclose(pFile);
+
+    float intervalMin = (AutoIntervalMin > 0) ? AutoIntervalMin : AutoInterval;
+    float intervalMax = (AutoIntervalMax > 0) ? AutoIntervalMax : AutoInterval;
+    adaptiveInterval.Setup(AutoIntervalAdaptive, AutoInterval, intervalMin, intervalMax);
+
+    if (AutoIntervalAdaptive && !adaptiveInterval.isEnabled()) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Adaptive interval disabled: IntervalMin (" + to_string(intervalMin) + 
+                            " min) must be smaller than IntervalMax (" + to_string(intervalMax) + " min)");
+    }
+
+    /* Check that the config fits into the memory before the first round gets started */
+    ClassMemoryPlanner planner;
+    memoryBudgetOk = PlanMemory(config, &planner);
+
+    for (int i = 0; i < planner.GetErrors()->size(); ++i) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Memory budget: " + (*planner.GetErrors())[i]);
+    }
+
+    for (int i = 0; i < planner.GetWarnings()->size(); ++i) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Memory budget: " + (*planner.GetWarnings())[i]);
+    }
+
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Memory budget: PSRAM peak " + std::to_string(planner.getPsramPeak()) + 
+            " bytes, internal RAM peak " + std::to_string(planner.getInternalPeak()) + " bytes");
+
+    if (planner.getSharedRegionSize() != psram_get_shared_region_size()) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Memory budget: shared PSRAM region is " + std::to_string(psram_get_shared_region_size()) + 
+                " bytes, config needs " + std::to_string(planner.getSharedRegionSize()) + " bytes (applied after the next reboot)");
+    }
+}
+
+
+/**
+ * Compute the memory plan of a config.ini. Values measured on the already loaded models
+ * (model input size, used Tensor Arena) replace the defaults of the planner.
+ */
+bool ClassFlowControll::PlanMemory(std::string _config, ClassMemoryPlanner *_planner)
+{
+    _planner->Clear();
+
+    if (!_planner->ReadConfig(FormatFileName(_config), "/sdcard")) {
+        return false;
+    }
+
+    std::vector<ClassMemoryPlanner::CNN> *cnns = _planner->GetCNNs();
+
+    for (int i = 0; i < cnns->size(); ++i) {
+        ClassFlowCNNGeneral *flow = ((*cnns)[i].section == "Digits") ? flowdigit : flowanalog;
+
+        if (flow && (flow->getModelFile() == (*cnns)[i].modelFile) && (flow->getModelArenaUsedBytes() > 0)) {
+            (*cnns)[i].modelInputBytes = flow->getModelInputBytes();
+            (*cnns)[i].arenaUsedBytes = flow->getModelArenaUsedBytes();
+        }
+    }
+
+    size_t psramTotal = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+    size_t psramBudget = (psramTotal > PSRAM_RESERVE_FIRMWARE) ? psramTotal - PSRAM_RESERVE_FIRMWARE : 0;
+
+    return _planner->Plan(psramBudget, heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
 }
 
 std::string* ClassFlowControll::getActStatusWithTime()
@@ -368,6 +464,7 @@ void ClassFlowControll::setActStatus(std::string _aktstatus)
 {
     aktstatus = _aktstatus;
     aktstatusWithTime = aktstatus;
+    server_events_publish("status", aktstatusWithTime);
 }
 
 void ClassFlowControll::doFlowTakeImageOnly(string time)
@@ -379,6 +476,7 @@ void ClassFlowControll::doFlowTakeImageOnly(string time)
             zw_time = getCurrentTimeString("%H:%M:%S");
             aktstatus = TranslateAktstatus(FlowControll[i]->name());
             aktstatusWithTime = aktstatus + " (" + zw_time + ")";
+            server_events_publish("status", aktstatusWithTime);
             #ifdef ENABLE_MQTT
                 MQTTPublish(mqttServer_getMainTopic() + "/" + "status", aktstatus, 1, false);
             #endif //ENABLE_MQTT
@@ -407,11 +505,15 @@ bool ClassFlowControll::doFlow(string time)
 
     //checkNtpStatus(0);
 
+    psram_round_arena_begin();
+    int64_t roundStart = esp_timer_get_time();
+
     for (int i = 0; i < FlowControll.size(); ++i) {
         zw_time = getCurrentTimeString("%H:%M:%S");
         aktstatus = TranslateAktstatus(FlowControll[i]->name());
         aktstatusWithTime = aktstatus + " (" + zw_time + ")";
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Status: " + aktstatusWithTime);
+        server_events_publish("status", aktstatusWithTime);
         #ifdef ENABLE_MQTT
             MQTTPublish(mqttServer_getMainTopic() + "/" + "status", aktstatus, qos, false);
         #endif //ENABLE_MQTT
@@ -421,7 +523,15 @@ bool ClassFlowControll::doFlow(string time)
             LogFile.WriteHeapInfo(zw);
         #endif
 
-        if (!FlowControll[i]->doFlow(time)) {
+        psram_stage_begin(FlowControll[i]->name());
+        int64_t stageStart = esp_timer_get_time();
+        bool stepResult = FlowControll[i]->doFlow(time);
+        std::string stage = FlowControll[i]->name();    // e.g. "ClassFlowTakeImage" -> label "TakeImage"
+        metrics_observe("stage_duration_seconds", (esp_timer_get_time() - stageStart) / 1000000.0,
+                        stage.c_str() + ((stage.compare(0, 9, "ClassFlow") == 0) ? 9 : 0));
+        psram_stage_end();
+
+        if (!stepResult) {
             repeat++;
             LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Fehler im vorheriger Schritt - wird zum " + to_string(repeat) + ". Mal wiederholt");
             if (i) { i -= 1; }   // vPrevious step must be repeated (probably take pictures)
@@ -445,10 +555,18 @@ bool ClassFlowControll::doFlow(string time)
     aktstatus = "Flow finished";
     aktstatusWithTime = aktstatus + " (" + zw_time + ")";
     //LogFile.WriteToFile(ESP_LOG_INFO, TAG, aktstatusWithTime);
+    server_events_publish("status", aktstatusWithTime);
     #ifdef ENABLE_MQTT
         MQTTPublish(mqttServer_getMainTopic() + "/" + "status", aktstatus, qos, false);
     #endif //ENABLE_MQTT
 
+    metrics_observe("round_duration_seconds", (esp_timer_get_time() - roundStart) / 1000000.0);
+
+    UpdateAdaptiveInterval();
+
+    // All temporary buffers of this round are released at once
+    psram_round_arena_reset();
+
     return result;
 }
 
@@ -575,10 +693,30 @@ bool ClassFlowControll::ReadParameter(FILE* pfile, string& aktparamgraph)
             }
         }
 
+        if ((toUpper(splitted[0]) == "INTERVALADAPTIVE") && (splitted.size() > 1)) {
+            AutoIntervalAdaptive = alphanumericToBoolean(splitted[1]);
+        }
+
+        if ((toUpper(splitted[0]) == "INTERVALMIN") && (splitted.size() > 1)) {
+            if (isStringNumeric(splitted[1])) {
+                AutoIntervalMin = std::stof(splitted[1]);
+            }
+        }
+
+        if ((toUpper(splitted[0]) == "INTERVALMAX") && (splitted.size() > 1)) {
+            if (isStringNumeric(splitted[1])) {
+                AutoIntervalMax = std::stof(splitted[1]);
+            }
+        }
+
         if ((toUpper(splitted[0]) == "DATALOGACTIVE") && (splitted.size() > 1)) {
             LogFile.SetDataLogToSD(alphanumericToBoolean(splitted[1]));
         }
 
+        if ((toUpper(splitted[0]) == "DATALOGFORMAT") && (splitted.size() > 1)) {
+            LogFile.SetDataLogBinary(toUpper(splitted[1]) == "BINARY");
+        }
+
         if ((toUpper(splitted[0]) == "DATAFILESRETENTION") && (splitted.size() > 1)) {
             if (isStringNumeric(splitted[1])) {
                 LogFile.SetDataLogRetention(std::stoi(splitted[1]));
@@ -868,8 +1006,9 @@ esp_err_t ClassFlowControll::GetJPGStream(std::string _fn, httpd_req_t *req)
             }
 
             if (_fn == htmlinfo[i]->filename_org) {
-                if (htmlinfo[i]->image_org) {
-                    _send = htmlinfo[i]->image_org;
+                CImageBasis *imageOrg = GetROIOriginal(htmlinfo[i], &_sendDelete);
+                if (imageOrg) {
+                    _send = imageOrg;
                 }
             }
             delete htmlinfo[i];
@@ -888,8 +1027,9 @@ esp_err_t ClassFlowControll::GetJPGStream(std::string _fn, httpd_req_t *req)
                 }
 
                 if (_fn == htmlinfo[i]->filename_org) {
-                    if (htmlinfo[i]->image_org) {
-                        _send = htmlinfo[i]->image_org;
+                    CImageBasis *imageOrg = GetROIOriginal(htmlinfo[i], &_sendDelete);
+                    if (imageOrg) {
+                        _send = imageOrg;
                     }
                 }
                 delete htmlinfo[i];
@@ -925,6 +1065,31 @@ esp_err_t ClassFlowControll::GetJPGStream(std::string _fn, httpd_req_t *req)
     return result;
 }
 
+/* Original sized ROI image. If it is not kept (no image logging), it gets cut from the aligned image on demand */
+CImageBasis* ClassFlowControll::GetROIOriginal(HTMLInfo *_info, bool *_sendDelete)
+{
+    if (_info->image_org) {
+        return _info->image_org;
+    }
+
+    if (!flowalignment || !flowalignment->GetAlignAndCutImage() || (_info->deltax <= 0) || (_info->deltay <= 0)) {
+        return NULL;
+    }
+
+    CImageBasis *image = new CImageBasis("ROI original", _info->deltax, _info->deltay, 3);
+
+    if (!image->ImageOkay()) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "GetROIOriginal: Not enough memory to cut " + _info->filename_org);
+        delete image;
+        return NULL;
+    }
+
+    flowalignment->GetAlignAndCutImage()->CutAndSave(_info->posx, _info->posy, _info->deltax, _info->deltay, image);
+    *_sendDelete = true; // delete temporary image after sending
+    return image;
+}
+
+
 string ClassFlowControll::getNumbersName()
 {
     return flowpostprocessing->getNumbersName();
@@ -935,6 +1100,11 @@ string ClassFlowControll::getJSON()
     return flowpostprocessing->GetJSON();
 }
 
+void ClassFlowControll::writeJSON(CJsonWriter *_json)
+{
+    flowpostprocessing->WriteJSON(_json);
+}
+
 /** 
  * @returns a vector of all current sequences
  **/
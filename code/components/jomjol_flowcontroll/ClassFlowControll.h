@@ -21,6 +21,8 @@
 	#include "ClassFlowWebhook.h"
 #endif //ENABLE_WEBHOOK
 #include "ClassFlowCNNGeneral.h"
+#include "ClassAdaptiveInterval.h"
+#include "ClassMemoryPlanner.h"
 
 class ClassFlowControll :
     public ClassFlow
@@ -37,15 +39,23 @@ protected:
 
 	bool AutoStart;
 	float AutoInterval;
+	bool AutoIntervalAdaptive;
+	float AutoIntervalMin;
+	float AutoIntervalMax;
+	ClassAdaptiveInterval adaptiveInterval;
+	void UpdateAdaptiveInterval(void);
 	void SetInitialParameter(void);	
 	std::string aktstatusWithTime;
 	std::string aktstatus;
 	int aktRunNr;
+	bool memoryBudgetOk;
 
 public:
 	bool SetupModeActive;
 
 	void InitFlow(std::string config);
+	bool PlanMemory(std::string _config, ClassMemoryPlanner *_planner);
+	bool isMemoryBudgetOk(){return memoryBudgetOk;};
 	bool doFlow(string time);
 	void doFlowTakeImageOnly(string time);
 	bool getStatusSetupModus(){return SetupModeActive;};
@@ -55,6 +65,7 @@ public:
 	string GetPrevalue(std::string _number = "");	
 	bool ReadParameter(FILE* pfile, string& aktparamgraph);	
 	string getJSON();
+	void writeJSON(CJsonWriter *_json);
 	const std::vector<NumberPost*> &getNumbers();
 	string getNumbersName();
 
@@ -66,6 +77,7 @@ public:
 	#endif
 
 	esp_err_t GetJPGStream(std::string _fn, httpd_req_t *req);
+	CImageBasis* GetROIOriginal(HTMLInfo *_info, bool *_sendDelete);
 	esp_err_t SendRawJPG(httpd_req_t *req);
 
 	std::string doSingleStep(std::string _stepname, std::string _host);
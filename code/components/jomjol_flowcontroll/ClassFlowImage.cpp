@@ -13,7 +13,10 @@ extern "C" {
 
 #include "time_sntp.h"
 #include "ClassLogFile.h"
+#include "retention_sweeper.h"
 #include "CImageBasis.h"
+#include "CImageLogQueue.h"
+#include "image_log_writer.h"
 #include "esp_log.h"
 #include "../../include/defines.h"
 
@@ -24,6 +27,7 @@ ClassFlowImage::ClassFlowImage(const char* logTag)
 {
 	this->logTag = logTag;
 	isLogImage = false;
+    isLogImagePack = false;
     disabled = false;
     this->imagesRetention = 5;
 }
@@ -32,6 +36,7 @@ ClassFlowImage::ClassFlowImage(std::vector<ClassFlow*> * lfc, const char* logTag
 {
 	this->logTag = logTag;
 	isLogImage = false;
+    isLogImagePack = false;
     disabled = false;
     this->imagesRetention = 5;
 }
@@ -40,6 +45,7 @@ ClassFlowImage::ClassFlowImage(std::vector<ClassFlow*> * lfc, ClassFlow *_prev,
 {
 	this->logTag = logTag;
 	isLogImage = false;
+    isLogImagePack = false;
     disabled = false;
     this->imagesRetention = 5;
 }
@@ -59,82 +65,24 @@ string ClassFlowImage::CreateLogFolder(string time) {
 }
 
 void ClassFlowImage::LogImage(string logPath, string name, float *resultFloat, int *resultInt, string time, CImageBasis *_img) {
-	if (!isLogImage)
+	if (!isLogImage || (_img == NULL))
+		return;
+
+	if (isLogImagePack) {
+		// One container per hour folder instead of a file per image
+		image_log_writer_save(name + "_" + time + ".jpg", _img, logPath + "/" + IMAGE_PACK_FILE, CImageLogQueue::GetLogImageResult(resultFloat, resultInt));
 		return;
-	
-    
-	char buf[10];
-
-	if (resultFloat != NULL) {
-        if (*resultFloat < 0)
-            sprintf(buf, "N.N_");
-        else
-        {
-            sprintf(buf, "%.1f_", *resultFloat);
-            if (strcmp(buf, "10.0_") == 0)
-                sprintf(buf, "0.0_");
-        }
-            
-	} else if (resultInt != NULL) {
-		sprintf(buf, "%d_", *resultInt);
-	} else {
-		buf[0] = '\0';
 	}
 
-	string nm = logPath + "/" + buf + name + "_" + time + ".jpg";
+	string nm = CImageLogQueue::GetLogImageName(logPath, name, resultFloat, resultInt, time);
 	nm = FormatFileName(nm);
-	string output = "/sdcard/img_tmp/" + name + ".jpg";
-	output = FormatFileName(output);
 	ESP_LOGD(logTag, "save to file: %s", nm.c_str());
-	_img->SaveToFile(nm);
-//	CopyFile(output, nm);
+	image_log_writer_save(nm, _img);   // Encoded and written in the background
 }
 
 void ClassFlowImage::RemoveOldLogs()
 {
-	if (!isLogImage)
-		return;
-	
-	ESP_LOGD(TAG, "remove old images");
-    if (imagesRetention == 0) {
-        return;
-    }
-
-    time_t rawtime;
-    struct tm* timeinfo;
-    char cmpfilename[30];
-
-    time(&rawtime);
-    rawtime = addDays(rawtime, -1 * imagesRetention + 1);
-    timeinfo = localtime(&rawtime);
-    //ESP_LOGD(TAG, "ImagefileRetentionInDays: %d", imagesRetention);
-    
-    strftime(cmpfilename, 30, LOGFILE_TIME_FORMAT, timeinfo);
-    //ESP_LOGD(TAG, "file name to compare: %s", cmpfilename);
-	string folderName = string(cmpfilename).LOGFILE_TIME_FORMAT_DATE_EXTR;
-
-    DIR *dir = opendir(imagesLocation.c_str());
-    if (!dir) {
-        ESP_LOGE(TAG, "Failed to stat dir: %s", imagesLocation.c_str());
-        return;
-    }
-
-    struct dirent *entry;
-    int deleted = 0;
-    int notDeleted = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        string folderPath = imagesLocation + "/" + entry->d_name;
-		if (entry->d_type == DT_DIR) {
-			//ESP_LOGD(TAG, "Compare %s to %s", entry->d_name, folderName.c_str());	
-			if ((strlen(entry->d_name) == folderName.length()) && (strcmp(entry->d_name, folderName.c_str()) < 0)) {
-                removeFolder(folderPath.c_str(), logTag);
-                deleted++;
-			} else {
-                notDeleted ++;
-            }
-		}
-    }
-    ESP_LOGD(TAG, "Image folder deleted: %d | Image folder not deleted: %d", deleted, notDeleted);	
-    closedir(dir);
+	// Folders are named by the date part of LOGFILE_TIME_FORMAT, deleted step by step in the background
+	retention_sweeper_set_job(imagesLocation, "%Y%m%d", isLogImage ? imagesRetention : 0, true);
 }
 
@@ -12,6 +12,7 @@ class ClassFlowImage : public ClassFlow
 protected:
 	string imagesLocation;
     bool isLogImage;
+    bool isLogImagePack;        // Images in a container per hour (see CImagePack)
     unsigned short imagesRetention;
 	const char* logTag;
 
@@ -6,6 +6,8 @@
 
 #include "time_sntp.h"
 #include "interface_influxdb.h"
+#include "store_forward.h"
+#include "metrics_registry.h"
 
 #include "ClassFlowPostProcessing.h"
 #include "esp_log.h"
@@ -107,6 +109,15 @@ bool ClassFlowInfluxDB::ReadParameter(FILE* pfile, string& aktparamgraph)
         {
             handleMeasurement(splitted[0], splitted[1]);
         }
+        if (((toUpper(_param) == "PUBLISHPOLICY") || (toUpper(_param) == "PUBLISHDEADBAND") || (toUpper(_param) == "PUBLISHHEARTBEAT")) && (splitted.size() > 1))
+        {
+            if (!publishPolicy.SetParameter(_param, splitted[1]))
+                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Invalid value for " + _param + ": " + splitted[1] + ", using default");
+        }
+        if (((toUpper(_param) == "GZIPCOMPRESSION")) && (splitted.size() > 1))
+        {
+            influxDB.InfluxDBSetCompression(alphanumericToBoolean(splitted[1]));
+        }
         if (((toUpper(_param) == "FIELD")) && (splitted.size() > 1))
         {
             handleFieldname(splitted[0], splitted[1]);
@@ -124,6 +135,7 @@ bool ClassFlowInfluxDB::ReadParameter(FILE* pfile, string& aktparamgraph)
 /////////////////////// NEW //////////////////////////
 
         InfluxDBenable = true;
+        store_forward_open(&queue, "influxdb");
     } else {
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "InfluxDB init skipped as we are missing some parameters");
     }
@@ -149,6 +161,8 @@ bool ClassFlowInfluxDB::doFlow(string zwtime)
     if (flowpostprocessing)
     {
         std::vector<NumberPost*>* NUMBERS = flowpostprocessing->GetNumbers();
+        std::string lines;      // All numbers of the round in one write
+        std::vector<NumberPost*> published;
 
         for (int i = 0; i < (*NUMBERS).size(); ++i)
         {
@@ -173,13 +187,25 @@ bool ClassFlowInfluxDB::doFlow(string zwtime)
                     namenumber = namenumber + "/value";
             }
 
-            if (result.length() > 0)   
-//////////////////////// NEW //////////////////////////            
-//                InfluxDBPublish(measurement, namenumber, result, timeutc);
-                influxDB.InfluxDBPublish(measurement, namenumber, result, timeutc);
-//////////////////////// NEW //////////////////////////
+            if ((result.length() > 0) && publishPolicy.Check((*NUMBERS)[i]->name, result, resulterror))
+            {
+                lines += (lines.empty() ? "" : "\n") + influxDB.InfluxDBLine(measurement, namenumber, result, timeutc);
+                published.push_back((*NUMBERS)[i]);
+            }
+        }
 
+        // Together with the readings from the time the server was not reachable (they keep their timestamp)
+        bool delivered = store_forward_send_joined(&queue, time(NULL), lines, "\n", INFLUXDB_BATCH_MAX,
+                                                   [this](const std::string &_lines) { return influxDB.InfluxDBWrite(_lines); });
 
+        if (!delivered)
+            metrics_inc("publish_failures_total", "influxdb");
+
+        // Kept in the queue counts as published as well, it gets written later
+        if (delivered || queue.isOpen())
+        {
+            for (int i = 0; i < published.size(); ++i)
+                publishPolicy.Published(published[i]->name, published[i]->ReturnValue, published[i]->ErrorMessageText);
         }
     }
    
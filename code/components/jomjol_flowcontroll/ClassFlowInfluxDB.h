@@ -9,6 +9,8 @@
 
 #include "ClassFlowPostProcessing.h"
 #include "interface_influxdb.h"
+#include "CStoreForwardQueue.h"
+#include "ClassPublishPolicy.h"
 
 #include <string>
 
@@ -23,6 +25,8 @@ protected:
     bool InfluxDBenable;
 
     InfluxDB influxDB;
+    CStoreForwardQueue queue;   // Lines which could not be written
+    ClassPublishPolicy publishPolicy;
 
     void SetInitialParameter(void);    
     
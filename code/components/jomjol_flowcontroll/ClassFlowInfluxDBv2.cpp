@@ -6,6 +6,8 @@
 
 #include "time_sntp.h"
 #include "interface_influxdb.h"
+#include "store_forward.h"
+#include "metrics_registry.h"
 
 #include "ClassFlowPostProcessing.h"
 #include "esp_log.h"
@@ -109,6 +111,15 @@ bool ClassFlowInfluxDBv2::ReadParameter(FILE* pfile, string& aktparamgraph)
         {
             handleMeasurement(splitted[0], splitted[1]);
         }
+        if (((toUpper(_param) == "PUBLISHPOLICY") || (toUpper(_param) == "PUBLISHDEADBAND") || (toUpper(_param) == "PUBLISHHEARTBEAT")) && (splitted.size() > 1))
+        {
+            if (!publishPolicy.SetParameter(_param, splitted[1]))
+                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Invalid value for " + _param + ": " + splitted[1] + ", using default");
+        }
+        if (((toUpper(_param) == "GZIPCOMPRESSION")) && (splitted.size() > 1))
+        {
+            influxdb.InfluxDBSetCompression(alphanumericToBoolean(splitted[1]));
+        }
         if (((toUpper(splitted[0]) == "BUCKET")) && (splitted.size() > 1))
         {
             this->bucket = splitted[1];
@@ -133,6 +144,7 @@ bool ClassFlowInfluxDBv2::ReadParameter(FILE* pfile, string& aktparamgraph)
 
 //        printf("nach V2 Init\n");
         InfluxDBenable = true;
+        store_forward_open(&queue, "influxdbv2");
     } else {
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "InfluxDBv2 (Verion2 !!!) init skipped as we are missing some parameters");
     }
@@ -211,6 +223,8 @@ bool ClassFlowInfluxDBv2::doFlow(string zwtime)
     if (flowpostprocessing)
     {
         std::vector<NumberPost*>* NUMBERS = flowpostprocessing->GetNumbers();
+        std::string lines;      // All numbers of the round in one write
+        std::vector<NumberPost*> published;
 
         for (int i = 0; i < (*NUMBERS).size(); ++i)
         {
@@ -238,9 +252,25 @@ bool ClassFlowInfluxDBv2::doFlow(string zwtime)
             
             printf("vor sende Influx_DB_V2 - namenumber. %s, result: %s, timestampt: %s", namenumber.c_str(), result.c_str(), resulttimestamp.c_str());
 
-            if (result.length() > 0)   
-                influxdb.InfluxDBPublish(measurement, namenumber, result, resulttimeutc);
-//                InfluxDB_V2_Publish(measurement, namenumber, result, resulttimeutc);
+            if ((result.length() > 0) && publishPolicy.Check((*NUMBERS)[i]->name, result, resulterror))
+            {
+                lines += (lines.empty() ? "" : "\n") + influxdb.InfluxDBLine(measurement, namenumber, result, resulttimeutc);
+                published.push_back((*NUMBERS)[i]);
+            }
+        }
+
+        // Together with the readings from the time the server was not reachable (they keep their timestamp)
+        bool delivered = store_forward_send_joined(&queue, time(NULL), lines, "\n", INFLUXDB_BATCH_MAX,
+                                                   [this](const std::string &_lines) { return influxdb.InfluxDBWrite(_lines); });
+
+        if (!delivered)
+            metrics_inc("publish_failures_total", "influxdbv2");
+
+        // Kept in the queue counts as published as well, it gets written later
+        if (delivered || queue.isOpen())
+        {
+            for (int i = 0; i < published.size(); ++i)
+                publishPolicy.Published(published[i]->name, published[i]->ReturnValue, published[i]->ErrorMessageText);
         }
     }
    
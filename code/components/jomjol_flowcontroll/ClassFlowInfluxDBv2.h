@@ -10,6 +10,8 @@
 #include "ClassFlowPostProcessing.h"
 
 #include "interface_influxdb.h"
+#include "CStoreForwardQueue.h"
+#include "ClassPublishPolicy.h"
 
 #include <string>
 
@@ -24,6 +26,8 @@ protected:
     bool InfluxDBenable;
 
     InfluxDB influxdb;
+    CStoreForwardQueue queue;   // Lines which could not be written
+    ClassPublishPolicy publishPolicy;
 
     void SetInitialParameter(void);     
 
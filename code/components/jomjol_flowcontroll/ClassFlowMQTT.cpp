@@ -10,6 +10,8 @@
 
 #include "time_sntp.h"
 #include "interface_mqtt.h"
+#include "store_forward.h"
+#include "metrics_registry.h"
 #include "ClassFlowPostProcessing.h"
 #include "ClassFlowControll.h"
 
@@ -48,6 +50,7 @@ void ClassFlowMQTT::SetInitialParameter(void)
     user = "";
     password = ""; 
     SetRetainFlag = false;
+    publishMode = MQTT_PUBLISH_COMPACT;
     previousElement = NULL;
     ListFlowControll = NULL; 
     disabled = false;
@@ -141,6 +144,23 @@ bool ClassFlowMQTT::ReadParameter(FILE* pfile, string& aktparamgraph)
             SetRetainFlag = alphanumericToBoolean(splitted[1]);
             setMqtt_Server_Retain(SetRetainFlag);
         }
+        if ((toUpper(_param) == "PUBLISHMODE") && (splitted.size() > 1))
+        {
+            if (toUpper(splitted[1]) == "LEGACY") {
+                publishMode = MQTT_PUBLISH_LEGACY;
+            }
+            else if (toUpper(splitted[1]) == "DEVICE") {
+                publishMode = MQTT_PUBLISH_DEVICE;
+            }
+            else {
+                publishMode = MQTT_PUBLISH_COMPACT;
+            }
+        }
+        if (((toUpper(_param) == "PUBLISHPOLICY") || (toUpper(_param) == "PUBLISHDEADBAND") || (toUpper(_param) == "PUBLISHHEARTBEAT")) && (splitted.size() > 1))
+        {
+            if (!publishPolicy.SetParameter(_param, splitted[1]))
+                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Invalid value for " + _param + ": " + splitted[1] + ", using default");
+        }
         if ((toUpper(_param) == "HOMEASSISTANTDISCOVERY") && (splitted.size() > 1))
         {
             if (toUpper(splitted[1]) == "TRUE")
@@ -219,6 +239,7 @@ bool ClassFlowMQTT::ReadParameter(FILE* pfile, string& aktparamgraph)
 
     mqttServer_setMainTopic(maintopic);
     mqttServer_setDmoticzInTopic(domoticzintopic);
+    mqttServer_setPublishMode(publishMode);
 
     return true;
 }
@@ -244,22 +265,90 @@ bool ClassFlowMQTT::Start(float AutoInterval)
         return false;
     }
 
+    store_forward_open(&queue, "mqtt");
+
     return (MQTT_Init() == 1);
 }
 
 
+/* QoS in the lower bits, retain flag in the upper bit of the queue options */
+static bool mqtt_send_entry(const CStoreForwardQueue::Entry &_entry)
+{
+    return getMQTTisConnected() && MQTTPublish(_entry.key, _entry.payload, _entry.options & 0x03, (_entry.options & 0x80) != 0);
+}
+
+
+/* Reading of a number: published or kept for later, see store_forward_send() */
+bool ClassFlowMQTT::publishReading(std::string _topic, std::string _payload, int _qos)
+{
+    return store_forward_send(&queue, time(NULL), _topic, _payload, (_qos & 0x03) | (SetRetainFlag ? 0x80 : 0), mqtt_send_entry);
+}
+
+
+static MqttReading get_reading(NumberPost *_number)
+{
+    MqttReading reading;
+
+    reading.name = _number->name;
+    reading.value = _number->ReturnValue;
+    reading.raw = _number->ReturnRawValue;
+    reading.pre = _number->ReturnPreValue;
+    reading.error = _number->ErrorMessageText;
+    reading.rate = _number->ReturnRateValue; // Unit per minutes
+    reading.changeAbsolute = _number->ReturnChangeAbsolute; // Units per round
+    reading.timestamp = _number->timeStamp;
+
+    if (reading.rate.length() > 0) {
+        if (getTimeUnit() == "h") { // Need conversion to be per hour
+            reading.ratePerTimeUnit = to_string(_number->FlowRateAct * 60); // per minutes => per hour
+        }
+        else { // Keep per minute
+            reading.ratePerTimeUnit = reading.rate;
+        }
+    }
+
+    return reading;
+}
+
+
+/* One topic per field, see parameter PublishMode */
+bool ClassFlowMQTT::publishLegacyTopics(NumberPost *_number, int _index, std::string _topic, int _qos)
+{
+    bool success = false;
+    MqttReading reading = get_reading(_number);
+
+    if (reading.value.length() > 0)
+        success |= publishReading(_topic + "value", reading.value, _qos);
+    if (reading.error.length() > 0)  
+        success |= publishReading(_topic + "error", reading.error, _qos);
+
+    if (reading.rate.length() > 0) {
+        success |= publishReading(_topic + "rate", reading.rate, _qos);
+        success |= publishReading(_topic + "rate_per_time_unit", reading.ratePerTimeUnit, _qos);
+    }
+
+    if (reading.changeAbsolute.length() > 0) {
+        success |= publishReading(_topic + "changeabsolut", reading.changeAbsolute, _qos); // Legacy API
+        success |= publishReading(_topic + "rate_per_digitization_round", reading.changeAbsolute, _qos);
+    }
+
+    if (reading.raw.length() > 0)   
+        success |= publishReading(_topic + "raw", reading.raw, _qos);
+
+    if (reading.timestamp.length() > 0)
+        success |= publishReading(_topic + "timestamp", reading.timestamp, _qos);
+
+    std::string json = flowpostprocessing->getJsonFromNumber(_index);
+    success |= publishReading(_topic + "json", json, _qos);
+
+    return success;
+}
+
+
 bool ClassFlowMQTT::doFlow(string zwtime)
 {
     bool success;
     std::string result;
-    std::string resulterror = "";
-    std::string resultraw = "";
-    std::string resultpre = "";
-    std::string resultrate = ""; // Always Unit / Minute
-    std::string resultRatePerTimeUnit = ""; // According to selection
-    std::string resulttimestamp = "";
-    std::string resultchangabs = "";
-    string zw = "";
     string namenumber = "";
     string domoticzpayload = "";
     string DomoticzIdx = "";
@@ -270,65 +359,74 @@ bool ClassFlowMQTT::doFlow(string zwtime)
 
     success = publishSystemData(qos);
 
-    if (flowpostprocessing && getMQTTisConnected())
+    // Readings from the time the broker was not reachable first, so they arrive in order
+    if (getMQTTisConnected()) {
+        store_forward_drain(&queue, mqtt_send_entry);
+    }
+
+    if (flowpostprocessing && (getMQTTisConnected() || queue.isOpen()))
     {
         std::vector<NumberPost*>* NUMBERS = flowpostprocessing->GetNumbers();
+        std::vector<MqttReading> readings;
 
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Publishing MQTT topics...");
 
+        bool deviceDue = false;
+
         for (int i = 0; i < (*NUMBERS).size(); ++i)
         {
-            result =  (*NUMBERS)[i]->ReturnValue;
-            resultraw =  (*NUMBERS)[i]->ReturnRawValue;
-            resultpre =  (*NUMBERS)[i]->ReturnPreValue;
-            resulterror = (*NUMBERS)[i]->ErrorMessageText;
-            resultrate = (*NUMBERS)[i]->ReturnRateValue; // Unit per minutes
-            resultchangabs = (*NUMBERS)[i]->ReturnChangeAbsolute; // Units per round
-            resulttimestamp = (*NUMBERS)[i]->timeStamp;
-
-            DomoticzIdx = (*NUMBERS)[i]->DomoticzIdx;
-            domoticzpayload = "{\"command\":\"udevice\",\"idx\":" + DomoticzIdx + ",\"svalue\":\""+ result + "\"}";
-
-            namenumber = (*NUMBERS)[i]->name;
-            if (namenumber == "default")
-                namenumber = maintopic + "/";
-            else
-                namenumber = maintopic + "/" + namenumber + "/";
+            NumberPost *number = (*NUMBERS)[i];
+            bool published = false;
+            result = number->ReturnValue;
 
-            if ((domoticzintopic.length() > 0) && (result.length() > 0)) 
-                success |= MQTTPublish(domoticzintopic, domoticzpayload, qos, SetRetainFlag);
-
-            if (result.length() > 0)
-                success |= MQTTPublish(namenumber + "value", result, qos, SetRetainFlag);
-            if (resulterror.length() > 0)  
-                success |= MQTTPublish(namenumber + "error", resulterror, qos, SetRetainFlag);
-
-            if (resultrate.length() > 0) {
-                success |= MQTTPublish(namenumber + "rate", resultrate, qos, SetRetainFlag);
-                
-                std::string resultRatePerTimeUnit;
-                if (getTimeUnit() == "h") { // Need conversion to be per hour
-                    resultRatePerTimeUnit = resultRatePerTimeUnit = to_string((*NUMBERS)[i]->FlowRateAct * 60); // per minutes => per hour
-                }
-                else { // Keep per minute
-                    resultRatePerTimeUnit = resultrate;
+            if (!publishPolicy.Check(number->name, number->ReturnValue, number->ErrorMessageText)) {
+                if (publishMode == MQTT_PUBLISH_DEVICE) {
+                    readings.push_back(get_reading(number));    // The message always contains all numbers
                 }
-                success |= MQTTPublish(namenumber + "rate_per_time_unit", resultRatePerTimeUnit, qos, SetRetainFlag);
+                continue;   // Unchanged, see parameter PublishPolicy
             }
 
-            if (resultchangabs.length() > 0) {
-                success |= MQTTPublish(namenumber + "changeabsolut", resultchangabs, qos, SetRetainFlag); // Legacy API
-                success |= MQTTPublish(namenumber + "rate_per_digitization_round", resultchangabs, qos, SetRetainFlag);
+            DomoticzIdx = number->DomoticzIdx;
+            domoticzpayload = "{\"command\":\"udevice\",\"idx\":" + DomoticzIdx + ",\"svalue\":\""+ result + "\"}";
+
+            if ((domoticzintopic.length() > 0) && (result.length() > 0)) 
+                published |= publishReading(domoticzintopic, domoticzpayload, qos);
+
+            if (publishMode == MQTT_PUBLISH_LEGACY) {
+                namenumber = number->name;
+                if (namenumber == "default")
+                    namenumber = maintopic + "/";
+                else
+                    namenumber = maintopic + "/" + namenumber + "/";
+
+                published |= publishLegacyTopics(number, i, namenumber, qos);
+            }
+            else if (publishMode == MQTT_PUBLISH_COMPACT) {
+                published |= publishReading(maintopic + "/" + mqtt_reading_subtopic(publishMode, number->name),
+                                            mqtt_reading_json(get_reading(number)), qos);
+            }
+            else {
+                readings.push_back(get_reading(number));
+                deviceDue = true;
             }
 
-            if (resultraw.length() > 0)   
-                success |= MQTTPublish(namenumber + "raw", resultraw, qos, SetRetainFlag);
+            success |= published;
 
-            if (resulttimestamp.length() > 0)
-                success |= MQTTPublish(namenumber + "timestamp", resulttimestamp, qos, SetRetainFlag);
+            // Kept in the queue counts as published as well, it gets delivered later
+            if ((publishMode != MQTT_PUBLISH_DEVICE) && (published || queue.isOpen())) {
+                publishPolicy.Published(number->name, number->ReturnValue, number->ErrorMessageText);
+            }
+        }
 
-            std::string json = flowpostprocessing->getJsonFromNumber(i, "\n");
-            success |= MQTTPublish(namenumber + "json", json, qos, SetRetainFlag);
+        if (deviceDue) {
+            bool published = publishReading(maintopic + "/" + mqtt_reading_subtopic(publishMode, ""), mqtt_readings_json(readings), qos);
+            success |= published;
+
+            if (published || queue.isOpen()) {
+                for (int i = 0; i < (*NUMBERS).size(); ++i) {
+                    publishPolicy.Published((*NUMBERS)[i]->name, (*NUMBERS)[i]->ReturnValue, (*NUMBERS)[i]->ErrorMessageText);
+                }
+            }
         }
     }
     
@@ -352,7 +450,9 @@ bool ClassFlowMQTT::doFlow(string zwtime)
     OldValue = result;
 
     if (!success) {
-        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "One or more MQTT topics failed to be published!");
+        metrics_inc("publish_failures_total", "mqtt");
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "One or more MQTT topics failed to be published!" +
+                            ((queue.getCount() > 0) ? " " + std::to_string(queue.getCount()) + " readings are kept for later." : std::string("")));
     }
     
     return true;
@@ -8,6 +8,9 @@
 #include "ClassFlow.h"
 
 #include "ClassFlowPostProcessing.h"
+#include "CStoreForwardQueue.h"
+#include "mqtt_reading.h"
+#include "ClassPublishPolicy.h"
 
 #include <string>
 
@@ -22,11 +25,16 @@ protected:
     std::string caCertFilename, clientCertFilename, clientKeyFilename;
     bool validateServerCert;
     bool SetRetainFlag;
+    MqttPublishMode publishMode;
     int keepAlive; // Seconds
     float roundInterval; // Minutes
     std::string maintopic, domoticzintopic; 
+    CStoreForwardQueue queue;       // Readings which could not be published
+    ClassPublishPolicy publishPolicy;
 	void SetInitialParameter(void);        
     void handleIdx(string _decsep, string _value);   
+    bool publishReading(std::string _topic, std::string _payload, int _qos);
+    bool publishLegacyTopics(NumberPost *_number, int _index, std::string _topic, int _qos);
 
 public:
     ClassFlowMQTT();
@@ -31,49 +31,45 @@ std::string ClassFlowPostProcessing::getNumbersName() {
     return ret;
 }
 
-std::string ClassFlowPostProcessing::GetJSON(std::string _lineend) {
-    std::string json="{" + _lineend;
+void ClassFlowPostProcessing::WriteJSON(CJsonWriter *_json) {
+    _json->BeginObject();
 
     for (int i = 0; i < NUMBERS.size(); ++i) {
-        json += "\"" + NUMBERS[i]->name + "\":"  + _lineend;
-        json += getJsonFromNumber(i, _lineend) + _lineend;
-
-        if ((i+1) < NUMBERS.size()) {
-            json += "," + _lineend;
-        }
+        _json->Key(NUMBERS[i]->name.c_str());
+        WriteJsonFromNumber(i, _json);
     }
-	
-    json += "}";
 
-    return json;
+    _json->EndObject();
 }
 
-string ClassFlowPostProcessing::getJsonFromNumber(int i, std::string _lineend) {
-    std::string json = "";
-
-    json += "  {" + _lineend;
-
-    if (NUMBERS[i]->ReturnValue.length() > 0) {
-        json += "    \"value\": \"" + NUMBERS[i]->ReturnValue + "\"," + _lineend;
-    }
-    else {
-        json += "    \"value\": \"\"," + _lineend;
-    }
+void ClassFlowPostProcessing::WriteJsonFromNumber(int i, CJsonWriter *_json) {
+    _json->BeginObject();
+    _json->Field("value", NUMBERS[i]->ReturnValue);
+    _json->Field("raw", NUMBERS[i]->ReturnRawValue);
+    _json->Field("pre", NUMBERS[i]->ReturnPreValue);
+    _json->Field("error", NUMBERS[i]->ErrorMessageText);
+    _json->Field("rate", NUMBERS[i]->ReturnRateValue);
+    _json->Field("timestamp", NUMBERS[i]->timeStamp);
+    _json->EndObject();
+}
 
-    json += "    \"raw\": \"" + NUMBERS[i]->ReturnRawValue + "\"," + _lineend;
-    json += "    \"pre\": \"" + NUMBERS[i]->ReturnPreValue + "\"," + _lineend;
-    json += "    \"error\": \"" + NUMBERS[i]->ErrorMessageText + "\"," + _lineend;
+std::string ClassFlowPostProcessing::GetJSON(bool _pretty) {
+    char buffer[JSON_WRITER_BUFFER];
+    std::string json;
+    CJsonWriter writer(buffer, sizeof(buffer), CJsonWriter::StringSink(&json), _pretty);
 
-    if (NUMBERS[i]->ReturnRateValue.length() > 0) {
-        json += "    \"rate\": \"" + NUMBERS[i]->ReturnRateValue + "\"," + _lineend;
-    }
-    else {
-        json += "    \"rate\": \"\"," + _lineend;
-    }
+    WriteJSON(&writer);
+    writer.Flush();
+    return json;
+}
 
-    json += "    \"timestamp\": \"" + NUMBERS[i]->timeStamp + "\"" + _lineend;
-    json += "  }" + _lineend;
+string ClassFlowPostProcessing::getJsonFromNumber(int i, bool _pretty) {
+    char buffer[JSON_WRITER_BUFFER];
+    std::string json;
+    CJsonWriter writer(buffer, sizeof(buffer), CJsonWriter::StringSink(&json), _pretty);
 
+    WriteJsonFromNumber(i, &writer);
+    writer.Flush();
     return json;
 }
 
@@ -1015,6 +1011,48 @@ void ClassFlowPostProcessing::WriteDataLog(int _index) {
     if (flowDigit) {
         digit = flowDigit->getReadoutRawString(_index);
     }
+
+    if (LogFile.GetDataLogBinary()) {
+        NumberPost *number = NUMBERS[_index];
+        CDataLog::Record record;
+
+        CDataLog::ClearRecord(&record);
+        record.timestamp = number->timeStampLastValue;
+        record.decimals = (number->Nachkomma > 0) ? number->Nachkomma : 0;
+        strncpy(record.raw, number->ReturnRawValue.c_str(), CDataLog::RAW_LENGTH - 1);
+
+        if (isStringNumeric(number->ReturnValue)) {
+            record.flags |= CDataLog::FLAG_VALUE;
+            record.value = std::stod(number->ReturnValue);
+        }
+        if (isStringNumeric(number->ReturnPreValue)) {
+            record.flags |= CDataLog::FLAG_PREVALUE;
+            record.preValue = std::stod(number->ReturnPreValue);
+        }
+        if (isStringNumeric(number->ReturnRateValue)) {
+            record.flags |= CDataLog::FLAG_RATE;
+            record.rate = std::stod(number->ReturnRateValue);
+        }
+        if (isStringNumeric(number->ReturnChangeAbsolute)) {
+            record.flags |= CDataLog::FLAG_CHANGE;
+            record.changeAbsolute = std::stod(number->ReturnChangeAbsolute);
+        }
+
+        // Only the kind of error is kept, the details are in the log file
+        if (number->ErrorMessageText == "no error") {
+            record.flags |= CDataLog::FLAG_NO_ERROR;
+        }
+        if (number->ErrorMessageText.find("Neg. Rate") != std::string::npos) {
+            record.flags |= CDataLog::FLAG_NEG_RATE;
+        }
+        if (number->ErrorMessageText.find("Rate too high") != std::string::npos) {
+            record.flags |= CDataLog::FLAG_RATE_TOO_HIGH;
+        }
+
+        CDataLog::SetROIs(&record, digit, analog);
+        LogFile.WriteToData(number->name, &record);
+        return;
+    }
 	
     LogFile.WriteToData(timezw, NUMBERS[_index]->name, NUMBERS[_index]->ReturnRawValue, NUMBERS[_index]->ReturnValue, NUMBERS[_index]->ReturnPreValue, 
         NUMBERS[_index]->ReturnRateValue, NUMBERS[_index]->ReturnChangeAbsolute, NUMBERS[_index]->ErrorMessageText, digit, analog);
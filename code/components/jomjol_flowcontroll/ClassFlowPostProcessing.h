@@ -7,6 +7,7 @@
 #include "ClassFlowTakeImage.h"
 #include "ClassFlowCNNGeneral.h"
 #include "ClassFlowDefineTypes.h"
+#include "CJsonWriter.h"
 
 #include <string>
 
@@ -60,11 +61,13 @@ public:
     string getReadoutRate(int _number = 0);
     string getReadoutTimeStamp(int _number = 0);
     void SavePreValue();
-    string getJsonFromNumber(int i, std::string _lineend);
+    string getJsonFromNumber(int i, bool _pretty = true);
+    void WriteJsonFromNumber(int i, CJsonWriter *_json);   // {"value": ..., "raw": ..., ...}
     string GetPreValue(std::string _number = "");
     bool SetPreValue(double zw, string _numbers, bool _extern = false);
 
-    std::string GetJSON(std::string _lineend = "\n");
+    std::string GetJSON(bool _pretty = true);
+    void WriteJSON(CJsonWriter *_json);     // {"<number>": {<number>}, ...}
     std::string getNumbersName();
 
     void UpdateNachkommaDecimalShift();
@@ -6,6 +6,8 @@
 
 #include "time_sntp.h"
 #include "interface_webhook.h"
+#include "store_forward.h"
+#include "metrics_registry.h"
 
 #include "ClassFlowPostProcessing.h"
 #include "ClassFlowAlignment.h"
@@ -115,10 +117,16 @@ bool ClassFlowWebhook::ReadParameter(FILE* pfile, string& aktparamgraph)
                 this->WebhookUploadImg = 2;
             }
         }
+        if (((toUpper(_param) == "PUBLISHPOLICY") || (toUpper(_param) == "PUBLISHDEADBAND") || (toUpper(_param) == "PUBLISHHEARTBEAT")) && (splitted.size() > 1))
+        {
+            if (!publishPolicy.SetParameter(_param, splitted[1]))
+                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Invalid value for " + _param + ": " + splitted[1] + ", using default");
+        }
     }
     
     WebhookInit(uri,apikey);
     WebhookEnable = true;
+    store_forward_open(&queue, "webhook");
     LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Webhook Enabled for Uri " + uri);
 
     printf("uri:         %s\n", uri.c_str());   
@@ -157,7 +165,34 @@ bool ClassFlowWebhook::doFlow(string zwtime)
     if (flowpostprocessing)
     {
         printf("vor sende WebHook");
-        bool numbersWithError = WebhookPublish(flowpostprocessing->GetNumbers());
+        auto send = [](const CStoreForwardQueue::Entry &_entry) { return WebhookSend(_entry.payload); };
+        std::vector<NumberPost*>* NUMBERS = flowpostprocessing->GetNumbers();
+        bool due = false;
+
+        // The payload always contains all numbers, it gets sent if one of them is due
+        for (int i = 0; i < (*NUMBERS).size(); ++i)
+            due |= publishPolicy.Check((*NUMBERS)[i]->name, (*NUMBERS)[i]->ReturnValue, (*NUMBERS)[i]->ErrorMessageText);
+
+        // Readings from the time the server was not reachable first
+        store_forward_drain(&queue, send);
+
+        if (!due)
+            return true;    // Unchanged, see parameter PublishPolicy
+
+        bool numbersWithError;
+        std::string payload = WebhookGetPayload(NUMBERS, &numbersWithError);
+
+        bool delivered = store_forward_send(&queue, time(NULL), "", payload, 0, send);
+
+        if (!delivered)
+            metrics_inc("publish_failures_total", "webhook");
+
+        // Kept in the queue counts as published as well, it gets sent later
+        if (delivered || queue.isOpen())
+        {
+            for (int i = 0; i < (*NUMBERS).size(); ++i)
+                publishPolicy.Published((*NUMBERS)[i]->name, (*NUMBERS)[i]->ReturnValue, (*NUMBERS)[i]->ErrorMessageText);
+        }
 
         #ifdef ALGROI_LOAD_FROM_MEM_AS_JPG
             if ((WebhookUploadImg == 1 || (WebhookUploadImg != 0 && numbersWithError)) && flowAlignment && flowAlignment->AlgROI) {
@@ -9,6 +9,8 @@
 
 #include "ClassFlowPostProcessing.h"
 #include "ClassFlowAlignment.h"
+#include "CStoreForwardQueue.h"
+#include "ClassPublishPolicy.h"
 
 #include <string>
 
@@ -22,6 +24,8 @@ protected:
 
     bool WebhookEnable;
     int WebhookUploadImg;
+    CStoreForwardQueue queue;   // Readings which could not be sent
+    ClassPublishPolicy publishPolicy;
 
     void SetInitialParameter(void); 
 
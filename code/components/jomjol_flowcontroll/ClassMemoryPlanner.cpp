@@ -0,0 +1,494 @@
+#include "ClassMemoryPlanner.h"
+#include "CTfLiteArenaInfo.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+#include <sys/stat.h>
+
+#include "../../include/defines.h"
+
+
+/* Estimates for buffers which are not allocated by the firmware itself */
+#define PLANNER_CAMERA_FB_DIVIDER       5           // esp32-camera reserves width * height / 5 for a JPEG frame buffer
+#define PLANNER_STBI_DECODE_FACTOR      2           // STBI JPEG decoding: component buffers + output image
+#define PLANNER_STBI_SHARED_THRESHOLD   100000      // STBI buffers >= this size are placed in the shared region (see psram.cpp)
+#define PLANNER_FILE_BUFFER             4096        // Internal RAM for writing an image file
+#define PLANNER_SHARED_REGION_SPARE     (16 * 1024) // On top of the estimated usage if the shared region gets shrinked
+#define PLANNER_DEFAULT_INPUT_DIGITS    (20 * 32 * 3)
+#define PLANNER_DEFAULT_INPUT_ANALOG    (32 * 32 * 3)
+
+
+static size_t align8(size_t _value)
+{
+    return (_value + 7) & ~((size_t)7);
+}
+
+
+static size_t align16(size_t _value)
+{
+    return (_value + 15) & ~((size_t)15);
+}
+
+
+static std::string kb(size_t _bytes)
+{
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%.1f KB", _bytes / 1024.0);
+    return std::string(buf);
+}
+
+
+static std::vector<std::string> splitLine(std::string _line)
+{
+    std::vector<std::string> result;
+    std::string act;
+
+    for (size_t i = 0; i < _line.size(); ++i) {
+        char c = _line[i];
+
+        if ((c == ' ') || (c == '=') || (c == '\t') || (c == '\r') || (c == '\n')) {
+            if (act.size() > 0) {
+                result.push_back(act);
+                act = "";
+            }
+        }
+        else {
+            act += c;
+        }
+    }
+
+    if (act.size() > 0) {
+        result.push_back(act);
+    }
+
+    return result;
+}
+
+
+static bool isNumber(std::string _in)
+{
+    if (_in.empty()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < _in.size(); ++i) {
+        if (!isdigit((unsigned char)_in[i]) && (_in[i] != '-') && (_in[i] != '.')) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+static std::string upper(std::string _in)
+{
+    for (size_t i = 0; i < _in.size(); ++i) {
+        _in[i] = toupper((unsigned char)_in[i]);
+    }
+
+    return _in;
+}
+
+
+static std::string jsonEscape(std::string _in)
+{
+    std::string out;
+
+    for (size_t i = 0; i < _in.size(); ++i) {
+        if ((_in[i] == '"') || (_in[i] == '\\')) {
+            out += '\\';
+        }
+        out += _in[i];
+    }
+
+    return out;
+}
+
+
+ClassMemoryPlanner::ClassMemoryPlanner()
+{
+    Clear();
+}
+
+
+void ClassMemoryPlanner::Clear()
+{
+    imageWidth = 640;
+    imageHeight = 480;
+    logRawImages = false;
+    gzipCompression = false;
+    cnns.clear();
+    refImageBytes.clear();
+    stages.clear();
+    errors.clear();
+    warnings.clear();
+    configErrors.clear();
+    configWarnings.clear();
+    sharedRegionSize = TENSOR_ARENA_SIZE + MAX_MODEL_SIZE;
+    tensorArenaSize = TENSOR_ARENA_SIZE;
+    psramPersistent = 0;
+    psramPeak = 0;
+    internalPeak = 0;
+    psramBudget = 0;
+    internalBudget = 0;
+}
+
+
+void ClassMemoryPlanner::SetImageSize(int _width, int _height)
+{
+    imageWidth = _width;
+    imageHeight = _height;
+}
+
+
+void ClassMemoryPlanner::AddReferenceImage(int _width, int _height)
+{
+    refImageBytes.push_back((size_t)_width * _height * 3);
+}
+
+
+void ClassMemoryPlanner::AddCNN(CNN _cnn)
+{
+    cnns.push_back(_cnn);
+}
+
+
+bool ClassMemoryPlanner::ReadJpegSize(std::string _file, int *_width, int *_height)
+{
+    FILE *pFile = fopen(_file.c_str(), "rb");
+
+    if (pFile == NULL) {
+        return false;
+    }
+
+    bool found = false;
+    int c;
+
+    if ((fgetc(pFile) == 0xFF) && (fgetc(pFile) == 0xD8)) {
+        while (!found && ((c = fgetc(pFile)) != EOF)) {
+            if (c != 0xFF) {
+                continue;
+            }
+
+            int marker = fgetc(pFile);
+            while (marker == 0xFF) {
+                marker = fgetc(pFile);
+            }
+
+            if ((marker == EOF) || (marker == 0xD9) || (marker == 0xDA)) {
+                break;
+            }
+
+            int len = (fgetc(pFile) << 8) | fgetc(pFile);
+
+            if ((marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC)) {
+                unsigned char sof[5];
+
+                if (fread(sof, 1, 5, pFile) == 5) {
+                    *_height = (sof[1] << 8) | sof[2];
+                    *_width = (sof[3] << 8) | sof[4];
+                    found = true;
+                }
+            }
+            else if ((len < 2) || (fseek(pFile, len - 2, SEEK_CUR) != 0)) {
+                break;
+            }
+        }
+    }
+
+    fclose(pFile);
+    return found;
+}
+
+
+bool ClassMemoryPlanner::ReadConfig(std::string _configFile, std::string _sdcardRoot)
+{
+    FILE *pFile = fopen(_configFile.c_str(), "r");
+
+    if (pFile == NULL) {
+        configErrors.push_back("Can't open " + _configFile);
+        errors = configErrors;
+        return false;
+    }
+
+    char zw[1024];
+    std::string section = "";
+    bool sectionEnabled = false;
+    CNN *cnn = NULL;
+
+    while (fgets(zw, sizeof(zw), pFile)) {
+        std::vector<std::string> splitted = splitLine(zw);
+
+        if (splitted.empty()) {
+            continue;
+        }
+
+        if ((splitted[0][0] == '[') || ((splitted[0].size() > 1) && (splitted[0][0] == ';') && (splitted[0][1] == '['))) {
+            sectionEnabled = (splitted[0][0] == '[');
+            section = upper(splitted[0].substr(sectionEnabled ? 1 : 2, splitted[0].find(']') - (sectionEnabled ? 1 : 2)));
+            cnn = NULL;
+
+            if (sectionEnabled && ((section == "DIGITS") || (section == "ANALOG"))) {
+                CNN entry = {};
+                entry.section = (section == "DIGITS") ? "Digits" : "Analog";
+                entry.modelInputBytes = (section == "DIGITS") ? PLANNER_DEFAULT_INPUT_DIGITS : PLANNER_DEFAULT_INPUT_ANALOG;
+                cnns.push_back(entry);
+                cnn = &cnns.back();
+            }
+            continue;
+        }
+
+        if (!sectionEnabled || (splitted[0][0] == ';')) {
+            continue;
+        }
+
+        std::string key = upper(splitted[0]);
+
+        if (section == "TAKEIMAGE") {
+            if ((key == "RAWIMAGESLOCATION") && (splitted.size() > 1)) {
+                logRawImages = true;
+            }
+        }
+        else if ((section == "INFLUXDB") || (section == "INFLUXDBV2")) {
+            if ((key == "GZIPCOMPRESSION") && (splitted.size() > 1) && (upper(splitted[1]) == "TRUE")) {
+                gzipCompression = true;
+            }
+        }
+        else if (section == "ALIGNMENT") {
+            if ((splitted[0][0] == '/') && (splitted.size() >= 3)) {
+                int w = 0, h = 0;
+
+                if (ReadJpegSize(_sdcardRoot + splitted[0], &w, &h)) {
+                    AddReferenceImage(w, h);
+                }
+                else {
+                    configWarnings.push_back("Can't read size of reference image " + splitted[0]);
+                }
+            }
+        }
+        else if (cnn != NULL) {
+            if ((key == "MODEL") && (splitted.size() > 1)) {
+                struct stat file_stat;
+                cnn->modelFile = splitted[1];
+                cnn->modelFileSize = (stat((_sdcardRoot + splitted[1]).c_str(), &file_stat) == 0) ? file_stat.st_size : 0;
+                cnn->arenaUsedBytes = tflite_read_arena_info(_sdcardRoot + splitted[1]);
+            }
+            else if ((key == "ROIIMAGESLOCATION") && (splitted.size() > 1)) {
+                cnn->logImages = true;
+            }
+            else if ((key == "SAVEALLFILES") && (splitted.size() > 1)) {
+                cnn->saveAllFiles = (upper(splitted[1]) == "TRUE");
+            }
+            else if ((splitted.size() >= 5) && isNumber(splitted[3]) && isNumber(splitted[4])) {
+                cnn->roiCount++;
+                cnn->roiOriginalBytes += align8(atoi(splitted[3].c_str()) * atoi(splitted[4].c_str()) * 3);
+            }
+        }
+    }
+
+    fclose(pFile);
+    return true;
+}
+
+
+void ClassMemoryPlanner::AddStage(std::string _name, size_t _shared, size_t _psram, size_t _internal, std::string _layout)
+{
+    Stage stage;
+    stage.name = _name;
+    stage.sharedRegionUsed = _shared;
+    stage.psramTransient = _psram;
+    stage.internalTransient = _internal;
+    stage.layout = _layout;
+    stages.push_back(stage);
+
+    if (_shared > TENSOR_ARENA_SIZE + MAX_MODEL_SIZE) {
+        errors.push_back(_name + ": needs " + kb(_shared) + " of the shared PSRAM region, only " +
+                kb(TENSOR_ARENA_SIZE + MAX_MODEL_SIZE) + " available");
+    }
+}
+
+
+bool ClassMemoryPlanner::Plan(size_t _psramBudget, size_t _internalBudget)
+{
+    size_t imageBytes = (size_t)imageWidth * imageHeight * 3;
+    bool arenaMeasured = true;
+
+    psramBudget = _psramBudget;
+    internalBudget = _internalBudget;
+    stages.clear();
+    errors = configErrors;
+    warnings = configWarnings;
+
+    /* The Tensor Arena only gets shrinked if all models are measured */
+    tensorArenaSize = 0;
+
+    for (int i = 0; i < cnns.size(); ++i) {
+        arenaMeasured = arenaMeasured && (cnns[i].arenaUsedBytes > 0);
+        tensorArenaSize = std::max(tensorArenaSize, align16(cnns[i].arenaUsedBytes + TENSOR_ARENA_SPARE));
+    }
+
+    if (!arenaMeasured || (tensorArenaSize > TENSOR_ARENA_SIZE)) {
+        tensorArenaSize = TENSOR_ARENA_SIZE;
+    }
+
+    /* Take Image: STBI decodes the camera JPEG, large buffers in the shared region */
+    size_t decodeBytes = imageBytes * PLANNER_STBI_DECODE_FACTOR;
+    AddStage("Take Image", decodeBytes, 0, logRawImages ? PLANNER_FILE_BUFFER : 0,
+            "STBI decoding " + kb(decodeBytes));
+
+    /* Aligning: tmpImage in the shared region, reference images get decoded into the heap */
+    size_t refDecode = 0;
+
+    for (int i = 0; i < refImageBytes.size(); ++i) {
+        refDecode = std::max(refDecode, refImageBytes[i] * PLANNER_STBI_DECODE_FACTOR);
+
+        if (refImageBytes[i] >= PLANNER_STBI_SHARED_THRESHOLD) {
+            errors.push_back("Aligning: reference image " + std::to_string(i) + " is too large (" + kb(refImageBytes[i]) +
+                    " decoded), it would overlap the tmpImage in the shared region. Use a smaller reference image");
+        }
+    }
+
+    AddStage("Aligning", imageBytes, refDecode, 0, "tmpImage " + kb(imageBytes));
+
+    /* Digitization: Tensor Arena + model in the shared region, interpreter and resize scratch in the round arena */
+    for (int i = 0; i < cnns.size(); ++i) {
+        CNN *cnn = &cnns[i];
+        size_t arena = (cnn->arenaUsedBytes > 0) ? cnn->arenaUsedBytes : TENSOR_ARENA_SIZE;
+
+        if (cnn->modelFile.empty() || (cnn->modelFileSize == 0)) {
+            errors.push_back(cnn->section + ": model file " + cnn->modelFile + " not found");
+        }
+        else if (cnn->modelFileSize > MAX_MODEL_SIZE) {
+            errors.push_back(cnn->section + ": model " + cnn->modelFile + " (" + kb(cnn->modelFileSize) +
+                    ") is larger than the reserved model memory (" + kb(MAX_MODEL_SIZE) + ")");
+        }
+
+        if (cnn->arenaUsedBytes + TENSOR_ARENA_SPARE > TENSOR_ARENA_SIZE) {
+            errors.push_back(cnn->section + ": model needs a Tensor Arena of " + kb(cnn->arenaUsedBytes) +
+                    ", only " + kb(TENSOR_ARENA_SIZE) + " reserved");
+        }
+        else if (cnn->arenaUsedBytes == 0) {
+            warnings.push_back(cnn->section + ": Tensor Arena usage not measured, assuming " + kb(TENSOR_ARENA_SIZE) +
+                    " (gets measured with the first round, the shared region shrinks after the next reboot)");
+        }
+
+        if (cnn->roiCount == 0) {
+            warnings.push_back(cnn->section + ": no ROIs defined");
+        }
+
+        AddStage(cnn->section, tensorArenaSize + cnn->modelFileSize, 0, cnn->logImages ? PLANNER_FILE_BUFFER : 0,
+                "Tensor Arena " + kb(arena) + " (reserved " + kb(tensorArenaSize) + ") + model " + kb(cnn->modelFileSize));
+    }
+
+    /* Shared region: large enough for the step which uses most of it */
+    sharedRegionSize = TENSOR_ARENA_SIZE + MAX_MODEL_SIZE;
+
+    if (arenaMeasured) {
+        sharedRegionSize = tensorArenaSize;
+
+        for (int i = 0; i < stages.size(); ++i) {
+            sharedRegionSize = std::max(sharedRegionSize, stages[i].sharedRegionUsed);
+        }
+
+        sharedRegionSize = std::min(align16(sharedRegionSize + PLANNER_SHARED_REGION_SPARE), (size_t)(TENSOR_ARENA_SIZE + MAX_MODEL_SIZE));
+    }
+
+    /* Allocated once at startup and kept for the whole uptime */
+    psramPersistent = sharedRegionSize + ROUND_ARENA_SIZE + imageBytes + (size_t)imageWidth * imageHeight / PLANNER_CAMERA_FB_DIVIDER;
+#ifdef ALGROI_LOAD_FROM_MEM_AS_JPG
+    psramPersistent += MAX_JPG_SIZE;
+#endif
+    if (gzipCompression) {
+        psramPersistent += INFLUXDB_GZIP_WORKSPACE;
+    }
+
+    for (int i = 0; i < cnns.size(); ++i) {
+        // ROI images in model input size, original sized ROIs only if they get logged or saved
+        psramPersistent += cnns[i].roiCount * align8(cnns[i].modelInputBytes);
+        if (cnns[i].logImages || cnns[i].saveAllFiles) {
+            psramPersistent += cnns[i].roiOriginalBytes;
+        }
+    }
+
+    psramPeak = psramPersistent;
+    internalPeak = 0;
+
+    for (int i = 0; i < stages.size(); ++i) {
+        psramPeak = std::max(psramPeak, psramPersistent + stages[i].psramTransient);
+        internalPeak = std::max(internalPeak, stages[i].internalTransient);
+    }
+
+    if ((psramBudget > 0) && (psramPeak > psramBudget)) {
+        errors.push_back("PSRAM: peak " + kb(psramPeak) + " exceeds the available " + kb(psramBudget));
+    }
+
+    if ((internalBudget > 0) && (internalPeak > internalBudget)) {
+        warnings.push_back("Internal RAM: peak " + kb(internalPeak) + " exceeds the free " + kb(internalBudget));
+    }
+
+    return errors.empty();
+}
+
+
+std::string ClassMemoryPlanner::getReport()
+{
+    std::string out = "PSRAM persistent: " + kb(psramPersistent) + "\n";
+    out += "PSRAM peak: " + kb(psramPeak) + " (available: " + (psramBudget ? kb(psramBudget) : "not checked") + ")\n";
+    out += "Internal RAM peak: " + kb(internalPeak) + " (free: " + (internalBudget ? kb(internalBudget) : "not checked") + ")\n";
+    out += "Shared region: " + kb(sharedRegionSize) + " (Tensor Arena " + kb(tensorArenaSize) + ", default " + 
+            kb(TENSOR_ARENA_SIZE + MAX_MODEL_SIZE) + ")\n\n";
+
+    for (int i = 0; i < stages.size(); ++i) {
+        out += stages[i].name + ": shared " + kb(stages[i].sharedRegionUsed) + " [" + stages[i].layout + "], PSRAM +" +
+                kb(stages[i].psramTransient) + ", internal +" + kb(stages[i].internalTransient) + "\n";
+    }
+
+    for (int i = 0; i < errors.size(); ++i) {
+        out += "ERROR: " + errors[i] + "\n";
+    }
+
+    for (int i = 0; i < warnings.size(); ++i) {
+        out += "WARNING: " + warnings[i] + "\n";
+    }
+
+    return out;
+}
+
+
+std::string ClassMemoryPlanner::getJSON()
+{
+    std::string out = "{\"ok\":" + std::string(errors.empty() ? "true" : "false");
+    out += ",\"psram_persistent\":" + std::to_string(psramPersistent);
+    out += ",\"psram_peak\":" + std::to_string(psramPeak);
+    out += ",\"psram_available\":" + std::to_string(psramBudget);
+    out += ",\"internal_peak\":" + std::to_string(internalPeak);
+    out += ",\"internal_available\":" + std::to_string(internalBudget);
+    out += ",\"shared_region\":" + std::to_string(sharedRegionSize);
+    out += ",\"tensor_arena\":" + std::to_string(tensorArenaSize);
+    out += ",\"stages\":[";
+
+    for (int i = 0; i < stages.size(); ++i) {
+        out += std::string(i ? "," : "") + "{\"name\":\"" + jsonEscape(stages[i].name) + "\"";
+        out += ",\"shared\":" + std::to_string(stages[i].sharedRegionUsed);
+        out += ",\"psram\":" + std::to_string(stages[i].psramTransient);
+        out += ",\"internal\":" + std::to_string(stages[i].internalTransient);
+        out += ",\"layout\":\"" + jsonEscape(stages[i].layout) + "\"}";
+    }
+
+    out += "],\"errors\":[";
+    for (int i = 0; i < errors.size(); ++i) {
+        out += std::string(i ? "," : "") + "\"" + jsonEscape(errors[i]) + "\"";
+    }
+
+    out += "],\"warnings\":[";
+    for (int i = 0; i < warnings.size(); ++i) {
+        out += std::string(i ? "," : "") + "\"" + jsonEscape(warnings[i]) + "\"";
+    }
+
+    out += "]}";
+    return out;
+}
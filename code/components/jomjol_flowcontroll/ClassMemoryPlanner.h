@@ -0,0 +1,108 @@
+#pragma once
+
+#ifndef CLASSMEMORYPLANNER_H
+#define CLASSMEMORYPLANNER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Memory budget planner
+ * Computes from a config.ini the PSRAM and internal RAM needed per flow step and the layout of the
+ * shared PSRAM region (see psram.cpp), before a round is started.
+ * The class only uses the C/C++ standard library, so it is also used by the host tool in tools/memory-planner.
+ */
+class ClassMemoryPlanner
+{
+public:
+    struct CNN {
+        std::string section;        // "Digits" or "Analog"
+        std::string modelFile;      // Path relative to the SD card root
+        size_t modelFileSize;       // 0 if the file is missing
+        size_t modelInputBytes;     // Model input size (x * y * channels)
+        size_t arenaUsedBytes;      // Tensor arena really used by the model, 0 if not measured (see CTfLiteArenaInfo.h)
+        int roiCount;
+        size_t roiOriginalBytes;    // All original sized ROIs (dx * dy * 3, 8 byte aligned each)
+        bool logImages;             // ROIImagesLocation set
+        bool saveAllFiles;          // SaveAllFiles set
+    };
+
+    struct Stage {
+        std::string name;
+        size_t sharedRegionUsed;    // Part of the shared PSRAM region used in this step
+        size_t psramTransient;      // Additional PSRAM (heap or round arena) used only in this step
+        size_t internalTransient;   // Internal RAM used only in this step
+        std::string layout;         // Usage of the shared region, human readable
+    };
+
+protected:
+    int imageWidth, imageHeight;
+    bool logRawImages;
+    bool gzipCompression;           // InfluxDB compressor, allocated once
+    std::vector<CNN> cnns;
+    std::vector<size_t> refImageBytes; // Decoded size of the alignment reference images
+
+    std::vector<Stage> stages;
+    size_t sharedRegionSize;        // Shared PSRAM region needed by the config
+    size_t tensorArenaSize;         // Tensor Arena part of it
+    size_t psramPersistent;
+    size_t psramPeak;
+    size_t internalPeak;
+    size_t psramBudget;
+    size_t internalBudget;
+    std::vector<std::string> errors;
+    std::vector<std::string> warnings;
+    std::vector<std::string> configErrors;     // From ReadConfig(), kept over several Plan() calls
+    std::vector<std::string> configWarnings;
+
+    void AddStage(std::string _name, size_t _shared, size_t _psram, size_t _internal, std::string _layout);
+
+public:
+    ClassMemoryPlanner();
+
+    void Clear();
+
+    /**
+     * Read all memory relevant parameters of a config.ini
+     * @param _configFile path of the config.ini
+     * @param _sdcardRoot prefix for the file paths inside the config (e.g. "/sdcard")
+     */
+    bool ReadConfig(std::string _configFile, std::string _sdcardRoot);
+
+    void SetImageSize(int _width, int _height);
+    void SetLogRawImages(bool _enabled) { logRawImages = _enabled; };
+    void SetGzipCompression(bool _enabled) { gzipCompression = _enabled; };
+    void AddReferenceImage(int _width, int _height);
+    void AddCNN(CNN _cnn);
+    std::vector<CNN> *GetCNNs() { return &cnns; };
+
+    /**
+     * Compute the plan
+     * @param _psramBudget PSRAM which can be used by the flow (total PSRAM minus reserve for the rest of the firmware)
+     * @param _internalBudget internal RAM which can be used by the flow
+     * @return false if the config can not run (errors), warnings do not fail the plan
+     */
+    bool Plan(size_t _psramBudget, size_t _internalBudget);
+
+    std::vector<Stage> *GetStages() { return &stages; };
+    std::vector<std::string> *GetErrors() { return &errors; };
+    std::vector<std::string> *GetWarnings() { return &warnings; };
+    size_t getPsramPersistent() { return psramPersistent; };
+
+    /* Shared region sized from the measured Tensor Arena of all models, default size if one is not measured yet */
+    size_t getSharedRegionSize() { return sharedRegionSize; };
+    size_t getTensorArenaSize() { return tensorArenaSize; };
+    size_t getPsramPeak() { return psramPeak; };
+    size_t getInternalPeak() { return internalPeak; };
+
+    std::string getReport();
+    std::string getJSON();
+
+    /* Dimensions from the SOF marker of a JPEG file, false if it can not be read */
+    static bool ReadJpegSize(std::string _file, int *_width, int *_height);
+};
+
+#endif //CLASSMEMORYPLANNER_H
@@ -0,0 +1,136 @@
+#include "ClassPublishPolicy.h"
+
+#include <stdlib.h>
+#include <math.h>
+#include <ctype.h>
+
+
+ClassPublishPolicy::ClassPublishPolicy()
+{
+    Setup(ALWAYS);
+}
+
+
+void ClassPublishPolicy::Setup(Mode _mode, double _deadband, int _heartbeat)
+{
+    mode = _mode;
+    deadband = (_deadband > 0) ? _deadband : 0;
+    heartbeat = (_heartbeat > 0) ? _heartbeat : 0;
+    states.clear();
+}
+
+
+bool ClassPublishPolicy::ParseMode(std::string _text, Mode *_mode)
+{
+    for (size_t i = 0; i < _text.length(); ++i) {
+        _text[i] = (char)tolower((unsigned char)_text[i]);
+    }
+
+    if (_text == "always") {
+        *_mode = ALWAYS;
+    }
+    else if (_text == "onchange") {
+        *_mode = ON_CHANGE;
+    }
+    else if (_text == "deadband") {
+        *_mode = DEADBAND;
+    }
+    else {
+        return false;
+    }
+
+    return true;
+}
+
+
+bool ClassPublishPolicy::SetParameter(std::string _name, std::string _value)
+{
+    for (size_t i = 0; i < _name.length(); ++i) {
+        _name[i] = (char)toupper((unsigned char)_name[i]);
+    }
+
+    if (_name == "PUBLISHPOLICY") {
+        Mode newMode;
+        if (!ParseMode(_value, &newMode)) {
+            return false;
+        }
+        Setup(newMode, deadband, heartbeat);
+    }
+    else if (_name == "PUBLISHDEADBAND") {
+        Setup(mode, atof(_value.c_str()), heartbeat);
+    }
+    else if (_name == "PUBLISHHEARTBEAT") {
+        Setup(mode, deadband, atoi(_value.c_str()));
+    }
+    else {
+        return false;
+    }
+
+    return true;
+}
+
+
+ClassPublishPolicy::State *ClassPublishPolicy::find(const std::string &_name)
+{
+    for (size_t i = 0; i < states.size(); ++i) {
+        if (states[i].name == _name) {
+            return &states[i];
+        }
+    }
+    return NULL;
+}
+
+
+/* Numeric value of a reading, false if it is empty or contains anything else */
+static bool to_number(const std::string &_value, double *_number)
+{
+    char *end = NULL;
+
+    *_number = strtod(_value.c_str(), &end);
+    return !_value.empty() && (end != NULL) && (*end == '\0');
+}
+
+
+bool ClassPublishPolicy::Check(const std::string &_name, const std::string &_value, const std::string &_error)
+{
+    if (mode == ALWAYS) {
+        return true;
+    }
+
+    State *state = find(_name);
+    if (state == NULL) {
+        return true;    // Never published
+    }
+
+    state->rounds++;
+
+    if ((_error != state->error) || ((heartbeat > 0) && (state->rounds >= heartbeat))) {
+        return true;
+    }
+
+    double value, published;
+    if ((mode == DEADBAND) && to_number(_value, &value) && to_number(state->value, &published)) {
+        return fabs(value - published) > deadband;
+    }
+
+    return _value != state->value;
+}
+
+
+void ClassPublishPolicy::Published(const std::string &_name, const std::string &_value, const std::string &_error)
+{
+    if (mode == ALWAYS) {
+        return;
+    }
+
+    State *state = find(_name);
+    if (state == NULL) {
+        states.push_back(State());
+        state = &states.back();
+        state->name = _name;
+    }
+
+    state->value = _value;
+    state->error = _error;
+    state->rounds = 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef CLASSPUBLISHPOLICY_H
+#define CLASSPUBLISHPOLICY_H
+
+#include <string>
+#include <vector>
+
+/**
+ * Publish policy of a destination (MQTT, InfluxDB, Webhook)
+ * Decides per number and round whether its reading gets published, compared with the last reading which got
+ * published. A changed error message always gets published, so does the first reading after the start.
+ * With a heartbeat, an unchanged reading gets published again after the given number of rounds.
+ * The class has no ESP dependencies so that it can be tested with recorded value series.
+ */
+class ClassPublishPolicy
+{
+public:
+    enum Mode {
+        ALWAYS,         // Every round (previous behaviour)
+        ON_CHANGE,      // Value or error changed
+        DEADBAND        // Value changed by more than the deadband (non-numeric values: on change)
+    };
+
+protected:
+    struct State {
+        std::string name;
+        std::string value;      // Last published
+        std::string error;
+        int rounds;             // Rounds since it got published
+    };
+
+    Mode mode;
+    double deadband;
+    int heartbeat;              // Rounds, 0: none
+    std::vector<State> states;
+
+    State *find(const std::string &_name);
+
+public:
+    ClassPublishPolicy();
+
+    /* Forgets the published readings, the next round gets published */
+    void Setup(Mode _mode, double _deadband = 0, int _heartbeat = 0);
+
+    /* "always", "onchange" or "deadband" (case-insensitive), false for other values */
+    static bool ParseMode(std::string _text, Mode *_mode);
+
+    /**
+     * Parameters PublishPolicy, PublishDeadband and PublishHeartbeat of a destination section
+     * @return false for other parameters and invalid values
+     */
+    bool SetParameter(std::string _name, std::string _value);
+
+    /* To be called once per number and round, true if its reading has to be published */
+    bool Check(const std::string &_name, const std::string &_value, const std::string &_error);
+
+    /* The reading got published (or is queued for later), the following rounds get compared with it */
+    void Published(const std::string &_name, const std::string &_value, const std::string &_error);
+
+    Mode getMode() { return mode; };
+    double getDeadband() { return deadband; };
+    int getHeartbeat() { return heartbeat; };
+};
+
+#endif //CLASSPUBLISHPOLICY_H
@@ -20,15 +20,23 @@
 #include "ClassFlowControll.h"
 
 #include "ClassLogFile.h"
+#include "retention_sweeper.h"
+#include "image_log_writer.h"
 #include "server_GPIO.h"
 
 #include "server_file.h"
+#include "server_events.h"
 
 #include "read_wlanini.h"
 #include "connect_wlan.h"
 #include "psram.h"
+#include "http_client_pool.h"
 #include "basic_auth.h"
 
+#ifdef ENABLE_MQTT
+    #include "mqtt_outbox.h"
+#endif //ENABLE_MQTT
+
 // support IDF 5.x
 #ifndef portTICK_RATE_MS
 #define portTICK_RATE_MS portTICK_PERIOD_MS
@@ -137,6 +145,17 @@ bool doflow(void)
     flowctrl.doFlow(zw_time);
     flowisrunning = false;
 
+    // The document of /json, formatted once for all subscribers of /events
+    std::string reading;
+    char buffer[JSON_WRITER_BUFFER];
+    CJsonWriter json(buffer, sizeof(buffer), CJsonWriter::StringSink(&reading));
+    flowctrl.writeJSON(&json);
+
+    if (json.Flush())
+    {
+        server_events_publish("reading", reading);
+    }
+
 #ifdef DEBUG_DETAIL_ON
     ESP_LOGD(TAG, "doflow - end %s", zw_time.c_str());
 #endif
@@ -304,6 +323,41 @@ esp_err_t setCFstatusToCam(void)
     }
 }
 
+/**
+ * Memory budget of a config.ini, computed without running a round
+ * Optional parameter: file (relative to the SD card, default: /config/config.ini), only files in /config/ are allowed
+ * Example: /memory_plan?file=/config/config_new.ini
+ */
+esp_err_t handler_memory_plan(httpd_req_t *req)
+{
+    char _query[100];
+    char _file[80] = "/config/config.ini";
+
+    if (httpd_req_get_url_query_str(req, _query, sizeof(_query)) == ESP_OK)
+    {
+        httpd_query_key_value(_query, "file", _file, sizeof(_file));
+    }
+
+    std::string file = std::string(_file);
+
+    if ((file.compare(0, 8, "/config/") != 0) || (file.find("..") != std::string::npos))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid parameter file, only files in /config/ are allowed");
+        return ESP_FAIL;
+    }
+
+    ClassMemoryPlanner planner;
+    flowctrl.PlanMemory("/sdcard" + file, &planner);
+
+    std::string zw = planner.getJSON();
+
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, zw.c_str(), zw.length());
+
+    return ESP_OK;
+}
+
 esp_err_t handler_get_heap(httpd_req_t *req)
 {
 #ifdef DEBUG_DETAIL_ON
@@ -312,6 +366,14 @@ esp_err_t handler_get_heap(httpd_req_t *req)
 #endif
 
     std::string zw = "Heap info:<br>" + getESPHeapInfo();
+    zw = zw + "<br><br>Allocations per step (last round):<br>" + psram_get_stage_statistics();
+    zw = zw + "<br><br>Log lines dropped (log buffer full): " + std::to_string(LogFile.GetDroppedLines());
+    zw = zw + "<br><br>Retention: " + retention_sweeper_get_status();
+    zw = zw + "<br><br>Image log: " + image_log_writer_get_status();
+    zw = zw + "<br><br>HTTP clients: " + http_client_pool_get_status();
+#ifdef ENABLE_MQTT
+    zw = zw + "<br><br>MQTT outbox: " + mqtt_outbox_get_status();
+#endif //ENABLE_MQTT
 
 #ifdef TASK_ANALYSIS_ON
     char *pcTaskList = (char *)calloc_psram_heap(std::string(TAG) + "->pcTaskList", 1, sizeof(char) * 768, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
@@ -473,15 +535,21 @@ esp_err_t handler_json(httpd_req_t *req)
         httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
         httpd_resp_set_type(req, "application/json");
 
-        std::string zw = flowctrl.getJSON();
-        if (zw.length() > 0)
-        {
-            httpd_resp_send(req, zw.c_str(), zw.length());
-        }
-        else
+        // Streamed in chunks, the JSON never exists as a whole
+        char buffer[JSON_WRITER_BUFFER];
+        CJsonWriter json(buffer, sizeof(buffer), [req](const char *_data, size_t _length) {
+            return httpd_resp_send_chunk(req, _data, _length) == ESP_OK;
+        }, true);
+
+        flowctrl.writeJSON(&json);
+
+        if (!json.Flush())
         {
-            httpd_resp_send(req, NULL, 0);
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Sending /json failed");
+            return ESP_FAIL;
         }
+
+        httpd_resp_send_chunk(req, NULL, 0);
     }
     else
     {
@@ -501,7 +569,9 @@ esp_err_t handler_json(httpd_req_t *req)
  * according to https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md#text-format.
  * 
  * A MetricFamily with a Metric for each Sequence is provided. If no valid value is available, the metric is not provided.
- * MetricPoints are provided without a timestamp. Additional metrics with some device information is also provided.
+ * MetricPoints are provided without a timestamp. Additional metrics with some device information is also provided,
+ * as well as histograms of the round and flow step durations, the model inference and the SD card writes
+ * (see metrics_registry.cpp). The response gets rendered into a buffer which is kept for the next scrape.
  * 
  * The metric name prefix is 'ai_on_the_edge_device_'.
  * 
@@ -525,28 +595,28 @@ esp_err_t handler_openmetrics(httpd_req_t *req)
         httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
         httpd_resp_set_type(req, "text/plain"); // application/openmetrics-text is not yet supported by prometheus so we use text/plain for now
 
-        const string metricNamePrefix = "ai_on_the_edge_device";
-
-        // get current measurement (flow)
-        string response = createSequenceMetrics(metricNamePrefix, flowctrl.getNumbers());
+        const char *metricNamePrefix = "ai_on_the_edge_device";
 
-        // CPU Temperature
-        response += createMetric(metricNamePrefix + "_cpu_temperature_celsius", "current cpu temperature in celsius", "gauge", std::to_string((int)temperatureRead())); 
+        // Device values at the time of the scrape, the flow updates its metrics itself
+        metrics_set("cpu_temperature_celsius", (int)temperatureRead());
+        metrics_set("rssi_dbm", get_WIFI_RSSI());
+        metrics_set("memory_heap_free_bytes", getESPHeapSize());
+        metrics_set("memory_heap_min_free_bytes", heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL), "internal");
+        metrics_set("memory_heap_min_free_bytes", heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM), "spiram");
+        metrics_set("uptime_seconds", (long)getUpTime());
+        metrics_set("rounds_total", countRounds);
 
-        // WiFi signal strength
-        response += createMetric(metricNamePrefix + "_rssi_dbm", "current WiFi signal strength in dBm", "gauge", std::to_string(get_WIFI_RSSI())); 
+        size_t length = 0;
+        const char *response = metrics_render(metricNamePrefix, flowctrl.getNumbers(), &length);
 
-        // memory info
-        response += createMetric(metricNamePrefix + "_memory_heap_free_bytes", "available heap memory", "gauge", std::to_string(getESPHeapSize())); 
-
-        // device uptime
-        response += createMetric(metricNamePrefix + "_uptime_seconds", "device uptime in seconds", "gauge", std::to_string((long)getUpTime())); 
-
-        // data aquisition round
-        response += createMetric(metricNamePrefix + "_rounds_total", "data aquisition rounds since device startup", "counter", std::to_string(countRounds));
+        if (response == NULL)
+        {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+            return ESP_FAIL;
+        }
 
         // the response always contains at least the metadata (HELP, TYPE) for the MetricFamily so no length check is needed
-        httpd_resp_send(req, response.c_str(), response.length());
+        httpd_resp_send(req, response, length);
     }
     else
     {
@@ -1661,6 +1731,13 @@ void task_autodoFlow(void *pvParameter)
     flowctrl.setAutoStartInterval(auto_interval);
     autostartIsEnabled = flowctrl.getIsAutoStart();
 
+    if (!flowctrl.isMemoryBudgetOk())
+    {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Configuration does not fit into the memory -> Not starting Auto Flow! Details: /memory_plan");
+        flowctrl.setActStatus("Memory budget exceeded");
+        autostartIsEnabled = false;
+    }
+
     if (isSetupModusActive())
     {
         LogFile.WriteToFile(ESP_LOG_INFO, TAG, "We are in Setup Mode -> Not starting Auto Flow!");
@@ -1703,7 +1780,7 @@ void task_autodoFlow(void *pvParameter)
             flowisrunning = true;
             doflow();
 #ifdef DEBUG_DETAIL_ON
-            ESP_LOGD(TAG, "Remove older log files");
+            ESP_LOGD(TAG, "Update retention of log files");
 #endif
             LogFile.RemoveOldLogFile();
             LogFile.RemoveOldDataLog();
@@ -1737,6 +1814,9 @@ void task_autodoFlow(void *pvParameter)
 
         fr_delta_ms = (esp_timer_get_time() - fr_start) / 1000;
 
+        // Interval might have been adapted by the adaptive scheduler depending on the flow rate
+        flowctrl.setAutoStartInterval(auto_interval);
+
         if (auto_interval > fr_delta_ms)
         {
             const TickType_t xDelay = (auto_interval - fr_delta_ms) / portTICK_PERIOD_MS;
@@ -1877,6 +1957,11 @@ void register_server_main_flow_task_uri(httpd_handle_t server)
     camuri.user_ctx = (void *)"Heap";
     httpd_register_uri_handler(server, &camuri);
 
+    camuri.uri = "/memory_plan";
+    camuri.handler = APPLY_BASIC_AUTH_FILTER(handler_memory_plan);
+    camuri.user_ctx = (void *)"MemoryPlan";
+    httpd_register_uri_handler(server, &camuri);
+
     camuri.uri = "/stream";
     camuri.handler = APPLY_BASIC_AUTH_FILTER(handler_stream);
     camuri.user_ctx = (void *)"stream";
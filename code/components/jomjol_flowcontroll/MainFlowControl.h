@@ -10,6 +10,7 @@
 #include "CImageBasis.h"
 #include "ClassFlowControll.h"
 #include "openmetrics.h"
+#include "metrics_registry.h"
 
 typedef struct
 {
@@ -0,0 +1,221 @@
+#include "CHttpClientPool.h"
+
+#include <ctype.h>
+
+
+CHttpClientPool::CHttpClientPool(size_t _maxClients, int64_t _idleTimeout,
+                                 CreateFunction _create, ResetFunction _reset, DestroyFunction _destroy)
+{
+    maxClients = (_maxClients > 0) ? _maxClients : 1;
+    idleTimeout = _idleTimeout;
+    createFunction = _create;
+    resetFunction = _reset;
+    destroyFunction = _destroy;
+    stats = Stats();
+}
+
+
+CHttpClientPool::~CHttpClientPool()
+{
+    CloseAll();
+}
+
+
+std::string CHttpClientPool::GetKey(const std::string &_url)
+{
+    size_t schemeEnd = _url.find("://");
+    if (schemeEnd == std::string::npos || schemeEnd == 0) {
+        return "";
+    }
+
+    std::string key;
+    for (size_t i = 0; i < schemeEnd; ++i) {
+        key += (char)tolower((unsigned char)_url[i]);
+    }
+
+    size_t start = schemeEnd + 3;
+    size_t end = _url.find_first_of("/?#", start);
+    std::string authority = _url.substr(start, (end == std::string::npos) ? std::string::npos : end - start);
+
+    size_t userEnd = authority.rfind('@');
+    if (userEnd != std::string::npos) {
+        authority.erase(0, userEnd + 1);
+    }
+
+    // Port after the host, the host can be an IPv6 address in brackets
+    size_t hostEnd = (authority[0] == '[') ? authority.find(']') : 0;
+    size_t colon = authority.find(':', (hostEnd == std::string::npos) ? 0 : hostEnd);
+    std::string host = authority.substr(0, colon);
+    std::string port = (colon == std::string::npos) ? "" : authority.substr(colon + 1);
+
+    if (host.empty()) {
+        return "";
+    }
+
+    if (port.empty()) {
+        port = (key == "https") ? "443" : "80";
+    }
+
+    key += "://";
+    for (size_t i = 0; i < host.length(); ++i) {
+        key += (char)tolower((unsigned char)host[i]);
+    }
+    return key + ":" + port;
+}
+
+
+int CHttpClientPool::find(void *_handle)
+{
+    for (int i = 0; i < (int)clients.size(); ++i) {
+        if (clients[i].handle == _handle) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+void CHttpClientPool::close(int _index)
+{
+    destroyFunction(clients[_index].handle);
+    clients.erase(clients.begin() + _index);
+}
+
+
+void *CHttpClientPool::Acquire(const std::string &_url, int64_t _now, bool *_reused)
+{
+    std::string key = GetKey(_url);
+
+    if (_reused != NULL) {
+        *_reused = false;
+    }
+
+    if (key.empty()) {
+        return NULL;
+    }
+
+    CloseIdle(_now);
+
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if (!clients[i].inUse && clients[i].key == key) {
+            clients[i].inUse = true;
+            clients[i].requests++;
+            stats.reused++;
+
+            if (_reused != NULL) {
+                *_reused = true;
+            }
+            return clients[i].handle;
+        }
+    }
+
+    // Make room: the least recently used idle client (of another host) gets closed
+    size_t kept = 0;
+    int oldest = -1;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if (!clients[i].transient) {
+            kept++;
+            if (!clients[i].inUse && (oldest < 0 || clients[i].lastUsed < clients[oldest].lastUsed)) {
+                oldest = i;
+            }
+        }
+    }
+
+    if (kept >= maxClients && oldest >= 0) {
+        close(oldest);
+        stats.closedIdle++;
+        kept--;
+    }
+
+    void *handle = createFunction(_url);
+    if (handle == NULL) {
+        return NULL;
+    }
+
+    Client client;
+    client.key = key;
+    client.handle = handle;
+    client.lastUsed = _now;
+    client.requests = 1;
+    client.inUse = true;
+    client.transient = (kept >= maxClients);
+    clients.push_back(client);
+    stats.created++;
+    return handle;
+}
+
+
+void CHttpClientPool::AddHeader(void *_handle, const std::string &_name)
+{
+    int index = find(_handle);
+    if (index >= 0) {
+        clients[index].headers.push_back(_name);
+    }
+}
+
+
+void CHttpClientPool::Release(void *_handle, int64_t _now, bool _ok)
+{
+    int index = find(_handle);
+    if (index < 0) {
+        return;
+    }
+
+    if (!_ok) {
+        stats.closedError++;
+    }
+
+    if (!_ok || clients[index].transient) {
+        close(index);
+        return;
+    }
+
+    resetFunction(_handle, clients[index].headers);
+    clients[index].headers.clear();
+    clients[index].inUse = false;
+    clients[index].lastUsed = _now;
+}
+
+
+int CHttpClientPool::CloseIdle(int64_t _now)
+{
+    int closed = 0;
+
+    for (int i = (int)clients.size() - 1; i >= 0; --i) {
+        if (!clients[i].inUse && (_now - clients[i].lastUsed) >= idleTimeout) {
+            close(i);
+            closed++;
+        }
+    }
+
+    stats.closedIdle += closed;
+    return closed;
+}
+
+
+void CHttpClientPool::CloseAll()
+{
+    for (int i = (int)clients.size() - 1; i >= 0; --i) {
+        close(i);
+    }
+}
+
+
+size_t CHttpClientPool::getInUse()
+{
+    size_t inUse = 0;
+
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if (clients[i].inUse) {
+            inUse++;
+        }
+    }
+    return inUse;
+}
+
+
+uint32_t CHttpClientPool::getRequests(void *_handle)
+{
+    int index = find(_handle);
+    return (index >= 0) ? clients[index].requests : 0;
+}
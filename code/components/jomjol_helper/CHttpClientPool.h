@@ -0,0 +1,94 @@
+#pragma once
+
+#ifndef CHTTPCLIENTPOOL_H
+#define CHTTPCLIENTPOOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+
+/**
+ * Pool of HTTP clients with kept connections (keep-alive), keyed by scheme, host and port.
+ * A client gets created on the first Acquire() for a host and is reused by the following requests
+ * to the same host, so only the first request pays the TCP (and TLS) setup. Clients idle for longer
+ * than the idle timeout get closed, a client whose request failed gets destroyed on Release(), the
+ * next Acquire() creates a new one (reconnect-on-error).
+ * If all clients are in use and the pool is full, a transient client gets created which is destroyed
+ * on Release().
+ * The clients are opaque handles, they get created, reset and destroyed by the given functions.
+ * The class only uses the C/C++ standard library, the caller is responsible for locking.
+ */
+class CHttpClientPool
+{
+    public:
+        typedef std::function<void *(const std::string &_url)> CreateFunction;
+        typedef std::function<void(void *_client, const std::vector<std::string> &_headers)> ResetFunction;
+        typedef std::function<void(void *_client)> DestroyFunction;
+
+        struct Stats {
+            uint32_t created;       // New clients (connections)
+            uint32_t reused;        // Requests on an existing client
+            uint32_t closedIdle;    // Closed after the idle timeout or to make room for another host
+            uint32_t closedError;   // Destroyed after a failed request
+        };
+
+    protected:
+        struct Client {
+            std::string key;
+            void *handle;
+            int64_t lastUsed;
+            uint32_t requests;
+            bool inUse;
+            bool transient;
+            std::vector<std::string> headers;   // Set for the current request, removed on Release()
+        };
+
+        std::vector<Client> clients;
+        size_t maxClients;
+        int64_t idleTimeout;
+        CreateFunction createFunction;
+        ResetFunction resetFunction;
+        DestroyFunction destroyFunction;
+        Stats stats;
+
+        int find(void *_handle);
+        void close(int _index);
+
+    public:
+        /**
+         * @param _maxClients clients kept open (idle and in use)
+         * @param _idleTimeout idle clients get closed after this time (same unit as the _now arguments)
+         */
+        CHttpClientPool(size_t _maxClients, int64_t _idleTimeout,
+                        CreateFunction _create, ResetFunction _reset, DestroyFunction _destroy);
+        ~CHttpClientPool();
+
+        /* "scheme://host:port" in lower case, the default port gets added. Empty if _url has no scheme or host */
+        static std::string GetKey(const std::string &_url);
+
+        /**
+         * @return client for the host of _url, NULL if the URL is invalid or no client can be created
+         * @param _reused set to true if the client has already sent requests (its connection may be stale)
+         */
+        void *Acquire(const std::string &_url, int64_t _now, bool *_reused = NULL);
+
+        /* Header set for the current request, it gets passed to the reset function on Release() */
+        void AddHeader(void *_handle, const std::string &_name);
+
+        /* _ok: false destroys the client (its connection is in an unknown state) */
+        void Release(void *_handle, int64_t _now, bool _ok);
+
+        /* Closes the clients idle for longer than the idle timeout, returns their count */
+        int CloseIdle(int64_t _now);
+        void CloseAll();    // Also the clients in use, e.g. on shutdown
+
+        size_t getCount() { return clients.size(); };
+        size_t getInUse();
+        uint32_t getRequests(void *_handle);    // Requests of the client incl. the current one, 0 if unknown
+        Stats getStats() { return stats; };
+};
+
+#endif //CHTTPCLIENTPOOL_H
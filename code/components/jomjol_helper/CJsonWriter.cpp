@@ -0,0 +1,216 @@
+#include "CJsonWriter.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+
+CJsonWriter::CJsonWriter(char *_buffer, size_t _size, SinkFunction _sink, bool _pretty)
+{
+    buffer = _buffer;
+    size = _size;
+    used = 0;
+    sink = _sink;
+    pretty = _pretty;
+    depth = 0;
+    empty[0] = true;
+    afterKey = false;
+    failed = (_buffer == NULL) || (_size == 0);
+    flushed = 0;
+    flushCount = 0;
+}
+
+
+CJsonWriter::SinkFunction CJsonWriter::StringSink(std::string *_out)
+{
+    return [_out](const char *_data, size_t _length) {
+        _out->append(_data, _length);
+        return true;
+    };
+}
+
+
+bool CJsonWriter::Flush()
+{
+    if (!failed && (used > 0)) {
+        failed = !sink(buffer, used);
+        flushed += used;
+        flushCount++;
+    }
+
+    used = 0;
+    return !failed;
+}
+
+
+void CJsonWriter::put(char _c)
+{
+    if (used == size) {
+        Flush();
+    }
+
+    if (!failed) {
+        buffer[used++] = _c;
+    }
+}
+
+
+void CJsonWriter::put(const char *_data, size_t _length)
+{
+    while ((_length > 0) && !failed) {
+        if (used == size) {
+            Flush();
+            continue;
+        }
+
+        size_t part = (_length < size - used) ? _length : size - used;
+        memcpy(buffer + used, _data, part);
+        used += part;
+        _data += part;
+        _length -= part;
+    }
+}
+
+
+/* Quotes, backslashes and control characters (e.g. in error messages), UTF-8 passes unchanged */
+void CJsonWriter::putEscaped(const char *_data, size_t _length)
+{
+    size_t start = 0;
+
+    for (size_t i = 0; i < _length; ++i) {
+        unsigned char c = (unsigned char)_data[i];
+        char escaped[8];
+
+        if ((c == '"') || (c == '\\')) {
+            escaped[0] = '\\';
+            escaped[1] = (char)c;
+            escaped[2] = '\0';
+        }
+        else if (c == '\n') {
+            strcpy(escaped, "\\n");
+        }
+        else if (c == '\r') {
+            strcpy(escaped, "\\r");
+        }
+        else if (c == '\t') {
+            strcpy(escaped, "\\t");
+        }
+        else if (c < 0x20) {
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        }
+        else {
+            continue;
+        }
+
+        put(_data + start, i - start);
+        put(escaped, strlen(escaped));
+        start = i + 1;
+    }
+
+    put(_data + start, _length - start);
+}
+
+
+void CJsonWriter::putIndent(int _depth)
+{
+    put('\n');
+    for (int i = 0; i < _depth; ++i) {
+        put("  ", 2);
+    }
+}
+
+
+/* Separator before a value resp. key, nothing after a key */
+void CJsonWriter::beginValue()
+{
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+
+    if (depth == 0) {
+        return;
+    }
+
+    if (!empty[depth]) {
+        put(',');
+    }
+    empty[depth] = false;
+
+    if (pretty) {
+        putIndent(depth);
+    }
+}
+
+
+void CJsonWriter::begin(char _bracket)
+{
+    beginValue();
+    put(_bracket);
+
+    if (depth + 1 >= MAX_DEPTH) {
+        failed = true;  // Nesting too deep, the output would be invalid
+        return;
+    }
+
+    depth++;
+    empty[depth] = true;
+}
+
+
+void CJsonWriter::end(char _bracket)
+{
+    if (depth == 0) {
+        failed = true;  // Not opened
+        return;
+    }
+
+    depth--;
+
+    if (pretty && !empty[depth + 1]) {
+        putIndent(depth);
+    }
+    put(_bracket);
+}
+
+
+void CJsonWriter::Key(const char *_key)
+{
+    beginValue();
+    put('"');
+    putEscaped(_key, strlen(_key));
+    put(pretty ? "\": " : "\":", pretty ? 3 : 2);
+    afterKey = true;
+}
+
+
+void CJsonWriter::putValue(const char *_value, size_t _length)
+{
+    beginValue();
+    put('"');
+    putEscaped(_value, _length);
+    put('"');
+}
+
+
+void CJsonWriter::String(const char *_value)
+{
+    putValue(_value, strlen(_value));
+}
+
+
+void CJsonWriter::Int(int64_t _value)
+{
+    char number[24];
+    int length = snprintf(number, sizeof(number), "%" PRId64, _value);
+
+    beginValue();
+    put(number, length);
+}
+
+
+void CJsonWriter::Bool(bool _value)
+{
+    beginValue();
+    put(_value ? "true" : "false", _value ? 4 : 5);
+}
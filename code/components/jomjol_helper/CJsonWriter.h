@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef CJSONWRITER_H
+#define CJSONWRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <functional>
+
+
+/**
+ * Streaming JSON writer.
+ * The output gets collected in a small buffer given by the caller (e.g. on the stack) and passed to the
+ * sink whenever the buffer is full, e.g. as a chunk of a HTTP response. Commas, quotes and escaping are
+ * done by the writer, no JSON tree and no intermediate strings are built.
+ * After a failed sink call everything else gets discarded, isOk() returns false then.
+ * The class only uses the C/C++ standard library and never allocates memory itself.
+ */
+class CJsonWriter
+{
+    public:
+        /* Gets the output in pieces of up to the buffer size, false aborts the output */
+        typedef std::function<bool(const char *_data, size_t _length)> SinkFunction;
+
+        static const int MAX_DEPTH = 16;
+
+    protected:
+        char *buffer;
+        size_t size;
+        size_t used;
+        SinkFunction sink;
+        bool pretty;
+        int depth;
+        bool empty[MAX_DEPTH];      // Nothing written yet into the object resp. array of this level
+        bool afterKey;
+        bool failed;
+        size_t flushed;
+        uint32_t flushCount;
+
+        void put(char _c);
+        void put(const char *_data, size_t _length);
+        void putEscaped(const char *_data, size_t _length);
+        void putIndent(int _depth);
+        void beginValue();
+        void putValue(const char *_value, size_t _length);
+        void begin(char _bracket);
+        void end(char _bracket);
+
+    public:
+        /* _pretty: one field per line, indented by 2 spaces per level */
+        CJsonWriter(char *_buffer, size_t _size, SinkFunction _sink, bool _pretty = false);
+
+        /* Sink which appends to _out (e.g. for a MQTT payload), reserve its size beforehand to avoid reallocations */
+        static SinkFunction StringSink(std::string *_out);
+
+        void BeginObject() { begin('{'); };
+        void EndObject() { end('}'); };
+        void BeginArray() { begin('['); };
+        void EndArray() { end(']'); };
+
+        void Key(const char *_key);
+        void String(const char *_value);
+        void String(const std::string &_value) { putValue(_value.data(), _value.length()); };
+        void Int(int64_t _value);
+        void Bool(bool _value);
+
+        /* "_key": "_value" */
+        void Field(const char *_key, const char *_value) { Key(_key); String(_value); };
+        void Field(const char *_key, const std::string &_value) { Key(_key); String(_value); };
+
+        /* Passes the buffered output to the sink, returns isOk() */
+        bool Flush();
+
+        bool isOk() { return !failed; };
+        size_t getLength() { return flushed + used; };
+        uint32_t getFlushCount() { return flushCount; };
+};
+
+#endif //CJSONWRITER_H
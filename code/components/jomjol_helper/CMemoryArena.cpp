@@ -0,0 +1,156 @@
+#include "CMemoryArena.h"
+
+
+static size_t alignUp(size_t _value, size_t _alignment)
+{
+    return (_value + _alignment - 1) & ~(_alignment - 1);
+}
+
+
+/*******************************************************************
+ * Arena
+ *******************************************************************/
+CMemoryArena::CMemoryArena()
+{
+    Init(NULL, 0);
+}
+
+
+void CMemoryArena::Init(void *_buffer, size_t _size)
+{
+    buffer = (uint8_t *)_buffer;
+    size = (_buffer != NULL) ? _size : 0;
+    overflowCount = 0;
+    highWater = 0;
+    Reset();
+}
+
+
+void *CMemoryArena::Alloc(size_t _size)
+{
+    size_t offset = alignUp(used, ALIGNMENT);
+
+    if ((buffer == NULL) || (_size == 0) || (offset + _size > size) || (offset + _size < offset)) {
+        overflowCount++;
+        return NULL;
+    }
+
+    lastOffset = offset;
+    used = offset + _size;
+    allocCount++;
+
+    if (used > highWater) {
+        highWater = used;
+    }
+
+    return buffer + offset;
+}
+
+
+bool CMemoryArena::Free(void *_ptr)
+{
+    if (!Owns(_ptr)) {
+        return false;
+    }
+
+    // Only the most recent allocation can be given back, all others are released with Reset()
+    if ((uint8_t *)_ptr == buffer + lastOffset) {
+        used = lastOffset;
+    }
+
+    return true;
+}
+
+
+bool CMemoryArena::Owns(void *_ptr)
+{
+    return (buffer != NULL) && ((uint8_t *)_ptr >= buffer) && ((uint8_t *)_ptr < buffer + size);
+}
+
+
+void CMemoryArena::Reset()
+{
+    used = 0;
+    lastOffset = 0;
+    allocCount = 0;
+}
+
+
+
+/*******************************************************************
+ * Pool
+ *******************************************************************/
+CMemoryPool::CMemoryPool()
+{
+    Init(NULL, 0, 0);
+}
+
+
+size_t CMemoryPool::getBufferSize(size_t _slotSize, int _slotCount)
+{
+    if (_slotSize < sizeof(void *)) {
+        _slotSize = sizeof(void *);
+    }
+
+    return alignUp(_slotSize, CMemoryArena::ALIGNMENT) * (_slotCount > 0 ? _slotCount : 0);
+}
+
+
+void CMemoryPool::Init(void *_buffer, size_t _slotSize, int _slotCount)
+{
+    buffer = (uint8_t *)_buffer;
+    slotSize = alignUp((_slotSize < sizeof(void *)) ? sizeof(void *) : _slotSize, CMemoryArena::ALIGNMENT);
+    slotCount = (buffer != NULL) && (_slotCount > 0) ? _slotCount : 0;
+    usedSlots = 0;
+    highWater = 0;
+    freeList = NULL;
+
+    // Chain all slots into the free list, first slot on top
+    for (int i = slotCount - 1; i >= 0; --i) {
+        void *slot = buffer + i * slotSize;
+        *(void **)slot = freeList;
+        freeList = slot;
+    }
+}
+
+
+void *CMemoryPool::Alloc(size_t _size)
+{
+    if ((freeList == NULL) || (_size > slotSize)) {
+        return NULL;
+    }
+
+    void *slot = freeList;
+    freeList = *(void **)slot;
+    usedSlots++;
+
+    if (usedSlots > highWater) {
+        highWater = usedSlots;
+    }
+
+    return slot;
+}
+
+
+bool CMemoryPool::Free(void *_ptr)
+{
+    if (!Owns(_ptr)) {
+        return false;
+    }
+
+    *(void **)_ptr = freeList;
+    freeList = _ptr;
+    usedSlots--;
+
+    return true;
+}
+
+
+bool CMemoryPool::Owns(void *_ptr)
+{
+    if ((buffer == NULL) || ((uint8_t *)_ptr < buffer) || ((uint8_t *)_ptr >= buffer + slotCount * slotSize)) {
+        return false;
+    }
+
+    return (((uint8_t *)_ptr - buffer) % slotSize) == 0;
+}
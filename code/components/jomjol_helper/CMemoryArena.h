@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef CMEMORYARENA_H
+#define CMEMORYARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Bump allocator on top of a preallocated buffer.
+ * All allocations are released at once with Reset(). Only the most recent allocation can be
+ * given back individually (LIFO), which covers the typical "allocate scratch, use, free" pattern.
+ * The class does not allocate memory itself and has no ESP dependencies.
+ */
+class CMemoryArena
+{
+    protected:
+        uint8_t *buffer;
+        size_t size;
+        size_t used;
+        size_t lastOffset;      // Start of the most recent allocation (for LIFO free)
+        size_t highWater;       // Max. used bytes since last ResetHighWater()
+        uint32_t allocCount;    // Successful allocations since last Reset()
+        uint32_t overflowCount; // Failed allocations (arena full) since Init()
+
+    public:
+        static const size_t ALIGNMENT = 8;
+
+        CMemoryArena();
+
+        void Init(void *_buffer, size_t _size);
+        void *Alloc(size_t _size);
+        bool Free(void *_ptr);  // Returns false if the pointer does not belong to the arena
+        bool Owns(void *_ptr);
+        void Reset();
+        void ResetHighWater() { highWater = used; };
+
+        bool isInitialized() { return buffer != NULL; };
+        size_t getSize() { return size; };
+        size_t getUsed() { return used; };
+        size_t getHighWater() { return highWater; };
+        uint32_t getAllocCount() { return allocCount; };
+        uint32_t getOverflowCount() { return overflowCount; };
+};
+
+
+/**
+ * Fixed-size slot pool on top of a preallocated buffer.
+ * Free slots are kept in an intrusive free list, so Alloc() and Free() are O(1) and never fragment.
+ */
+class CMemoryPool
+{
+    protected:
+        uint8_t *buffer;
+        size_t slotSize;
+        int slotCount;
+        int usedSlots;
+        int highWater;
+        void *freeList;
+
+    public:
+        CMemoryPool();
+
+        /* Buffer size needed for _slotCount slots of _slotSize bytes */
+        static size_t getBufferSize(size_t _slotSize, int _slotCount);
+
+        void Init(void *_buffer, size_t _slotSize, int _slotCount);
+        void *Alloc(size_t _size);  // Returns NULL if _size does not fit into a slot or the pool is exhausted
+        bool Free(void *_ptr);      // Returns false if the pointer does not belong to the pool
+        bool Owns(void *_ptr);
+
+        bool isInitialized() { return buffer != NULL; };
+        size_t getSlotSize() { return slotSize; };
+        int getSlotCount() { return slotCount; };
+        int getUsedSlots() { return usedSlots; };
+        int getHighWater() { return highWater; };
+};
+
+#endif //CMEMORYARENA_H
@@ -0,0 +1,220 @@
+#include "http_client_pool.h"
+
+#include <errno.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ClassLogFile.h"
+#include "CHttpClientPool.h"
+#include "../../include/defines.h"
+
+static const char *TAG = "HTTP_POOL";
+
+
+static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+{
+    switch(evt->event_id)
+    {
+        case HTTP_EVENT_ERROR:
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client Error encountered");
+            break;
+        case HTTP_EVENT_ON_CONNECTED:
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client connected");
+            break;
+        case HTTP_EVENT_HEADERS_SENT:
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client sent all request headers");
+            break;
+        case HTTP_EVENT_ON_HEADER:
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Header: key=" + std::string(evt->header_key) + ", value="  + std::string(evt->header_value));
+            break;
+        case HTTP_EVENT_ON_DATA:
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client data recevied: len=" + std::to_string(evt->data_len));
+            break;
+        case HTTP_EVENT_ON_FINISH:
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client finished");
+            break;
+        case HTTP_EVENT_DISCONNECTED:
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client Disconnected");
+            break;
+        case HTTP_EVENT_REDIRECT:
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Redirect");
+            break;
+    }
+    return ESP_OK;
+}
+
+
+static void *create_client(const std::string &_url)
+{
+    esp_http_client_config_t config = {};
+
+    config.url = _url.c_str();
+    config.user_agent = "ESP32 Meter reader";
+    config.event_handler = http_event_handler;
+    config.buffer_size = MAX_HTTP_OUTPUT_BUFFER;
+    config.keep_alive_enable = true;
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to initialize HTTP client for " + CHttpClientPool::GetKey(_url));
+        return NULL;
+    }
+
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "New HTTP client for " + CHttpClientPool::GetKey(_url));
+    return client;
+}
+
+
+/* The next request must not send the headers, authentication and body of the previous one */
+static void reset_client(void *_client, const std::vector<std::string> &_headers)
+{
+    esp_http_client_handle_t client = (esp_http_client_handle_t)_client;
+
+    for (int i = 0; i < _headers.size(); ++i) {
+        esp_http_client_delete_header(client, _headers[i].c_str());
+    }
+
+    esp_http_client_set_authtype(client, HTTP_AUTH_TYPE_NONE);
+    esp_http_client_set_username(client, NULL);
+    esp_http_client_set_password(client, NULL);
+    esp_http_client_set_post_field(client, NULL, 0);
+}
+
+
+static void destroy_client(void *_client)
+{
+    esp_http_client_cleanup((esp_http_client_handle_t)_client);
+}
+
+
+static CHttpClientPool pool(HTTP_CLIENT_POOL_SIZE, HTTP_CLIENT_POOL_IDLE_TIMEOUT, create_client, reset_client, destroy_client);
+static SemaphoreHandle_t poolMutex = NULL;
+
+
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+
+void http_client_pool_init(void)
+{
+    if (poolMutex != NULL) {
+        return;
+    }
+
+    poolMutex = xSemaphoreCreateMutex();
+    if (poolMutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create mutex");
+    }
+}
+
+
+esp_http_client_handle_t http_client_pool_acquire(const std::string &_url, esp_http_client_method_t _method)
+{
+    if (poolMutex == NULL) {
+        return NULL;
+    }
+
+    xSemaphoreTake(poolMutex, portMAX_DELAY);
+    esp_http_client_handle_t client = (esp_http_client_handle_t)pool.Acquire(_url, now_ms());
+    xSemaphoreGive(poolMutex);
+
+    if (client == NULL) {
+        return NULL;
+    }
+
+    // A reused client still has the URL of its previous request (same host, the connection stays open)
+    if (esp_http_client_set_url(client, _url.c_str()) != ESP_OK) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Invalid URL: " + _url);
+        http_client_pool_release(client, false);
+        return NULL;
+    }
+    esp_http_client_set_method(client, _method);
+
+    return client;
+}
+
+
+void http_client_pool_set_header(esp_http_client_handle_t _client, const char *_name, const char *_value)
+{
+    esp_http_client_set_header(_client, _name, _value);
+
+    xSemaphoreTake(poolMutex, portMAX_DELAY);
+    pool.AddHeader(_client, _name);
+    xSemaphoreGive(poolMutex);
+}
+
+
+void http_client_pool_set_basic_auth(esp_http_client_handle_t _client, const std::string &_user, const std::string &_password)
+{
+    esp_http_client_set_username(_client, _user.c_str());
+    esp_http_client_set_password(_client, _password.c_str());
+    esp_http_client_set_authtype(_client, HTTP_AUTH_TYPE_BASIC);
+}
+
+
+/**
+ * True if the request did not reach the server: the kept connection could not be written or the server had
+ * already closed it (reset without any response). A timeout or EAGAIN is not repeated, the server may have
+ * processed the request already (e.g. a webhook POST would get sent twice).
+ */
+static bool request_not_sent(esp_http_client_handle_t _client, esp_err_t _err)
+{
+    if ((_err == ESP_ERR_HTTP_CONNECT) || (_err == ESP_ERR_HTTP_WRITE_DATA)) {
+        return true;
+    }
+
+    if ((_err != ESP_ERR_HTTP_FETCH_HEADER) || (esp_http_client_get_status_code(_client) > 0)) {
+        return false;
+    }
+
+    int error = esp_http_client_get_errno(_client);
+    return (error == ECONNRESET) || (error == ECONNABORTED) || (error == EPIPE) || (error == ENOTCONN);
+}
+
+
+esp_err_t http_client_pool_perform(esp_http_client_handle_t _client)
+{
+    xSemaphoreTake(poolMutex, portMAX_DELAY);
+    bool reused = (pool.getRequests(_client) > 1);
+    xSemaphoreGive(poolMutex);
+
+    esp_err_t err = esp_http_client_perform(_client);
+
+    if ((err != ESP_OK) && reused && request_not_sent(_client, err)) {
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Kept connection failed (" + std::string(esp_err_to_name(err)) + "), reconnecting");
+        esp_http_client_close(_client);
+        err = esp_http_client_perform(_client);
+    }
+
+    return err;
+}
+
+
+void http_client_pool_release(esp_http_client_handle_t _client, bool _ok)
+{
+    xSemaphoreTake(poolMutex, portMAX_DELAY);
+    pool.Release(_client, now_ms(), _ok);
+    xSemaphoreGive(poolMutex);
+}
+
+
+std::string http_client_pool_get_status(void)
+{
+    if (poolMutex == NULL) {
+        return "not used";
+    }
+
+    xSemaphoreTake(poolMutex, portMAX_DELAY);
+    pool.CloseIdle(now_ms());
+    CHttpClientPool::Stats stats = pool.getStats();
+    std::string status = std::to_string(pool.getCount()) + " clients, " + std::to_string(stats.created) + " connects, " +
+                         std::to_string(stats.reused) + " reused, " + std::to_string(stats.closedError) + " failed";
+    xSemaphoreGive(poolMutex);
+
+    return status;
+}
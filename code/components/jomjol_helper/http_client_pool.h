@@ -0,0 +1,37 @@
+#pragma once
+
+#ifndef HTTP_CLIENT_POOL_H
+#define HTTP_CLIENT_POOL_H
+
+#include <string>
+#include "esp_http_client.h"
+
+
+/**
+ * HTTP clients shared by the webhook and InfluxDB, their connections are kept between the rounds (see CHttpClientPool).
+ * Usage: acquire, set headers and post field, perform, release. Headers and authentication set with the functions
+ * below only apply to the current request, they get removed on release.
+ */
+
+/* Creates the lock of the pool, once at startup before the flow task sends a request */
+void http_client_pool_init(void);
+
+/* Client for the host of _url with URL and method set, NULL on errors. It connects with the first perform */
+esp_http_client_handle_t http_client_pool_acquire(const std::string &_url, esp_http_client_method_t _method);
+
+void http_client_pool_set_header(esp_http_client_handle_t _client, const char *_name, const char *_value);
+void http_client_pool_set_basic_auth(esp_http_client_handle_t _client, const std::string &_user, const std::string &_password);
+
+/**
+ * Like esp_http_client_perform(). A request on a kept connection which the server has closed meanwhile gets
+ * repeated once, but only if it did not reach the server (no repeat after a timeout)
+ */
+esp_err_t http_client_pool_perform(esp_http_client_handle_t _client);
+
+/* _ok: false if the request failed, the client gets destroyed then and the next acquire connects again */
+void http_client_pool_release(esp_http_client_handle_t _client, bool _ok);
+
+/* Clients and reuse counters, human readable */
+std::string http_client_pool_get_status(void);
+
+#endif //HTTP_CLIENT_POOL_H
@@ -1,6 +1,12 @@
 #include "ClassLogFile.h"
 #include "../../include/defines.h"
 #include "psram.h"
+#include "CMemoryArena.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <algorithm>
 
 static const char* TAG = "PSRAM";
 
@@ -8,28 +14,56 @@ using namespace std;
 
 
 void *shared_region = NULL;
+size_t sharedRegionSize = 0;
+size_t sharedTensorArenaSize = 0;
 uint32_t allocatedBytesForSTBI = 0;
 std::string sharedMemoryInUseFor = "";
 
+CMemoryArena roundArena;
+TaskHandle_t roundArenaOwner = NULL;   // Only this task allocates from the arena (set by psram_round_arena_begin)
+
+struct PsramStage {
+    std::string name;
+    size_t arenaHighWater;      // Arena usage peak in the last round
+    size_t arenaHighWaterMax;   // Arena usage peak since boot
+    uint32_t mallocCalls;       // Heap allocations in the last round
+    size_t freeAfter;           // Free PSRAM after the step
+    size_t largestBlockAfter;   // Largest free PSRAM block after the step (fragmentation indicator)
+};
+
+PsramStage psramStages[MAX_PSRAM_STAGES];
+int psramStageCount = 0;
+int psramStageAct = -1;
+uint32_t psramMallocCalls = 0;
+uint32_t psramMallocCallsAtStageBegin = 0;
+
 
 /** Reserve a large block in the PSRAM which will be shared between the different steps.
- * Each step uses it differently but only wiuthin itself. */
-bool reserve_psram_shared_region(void) {
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Allocating shared PSRAM region (" + 
-            std::to_string(TENSOR_ARENA_SIZE + MAX_MODEL_SIZE) + " bytes)...");
-    shared_region = malloc_psram_heap("Shared PSRAM region", TENSOR_ARENA_SIZE + MAX_MODEL_SIZE, 
-            MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+ * Each step uses it differently but only wiuthin itself.
+ * The size depends on the configured models (see ClassMemoryPlanner::getSharedRegionRequired),
+ * the Tensor Arena is at the start of the region, followed by the model. */
+bool reserve_psram_shared_region(size_t _tensorArenaSize, size_t _sharedRegionSize) {
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Allocating shared PSRAM region (" + std::to_string(_sharedRegionSize) + 
+            " bytes, Tensor Arena: " + std::to_string(_tensorArenaSize) + " bytes)...");
+    shared_region = malloc_psram_heap("Shared PSRAM region", _sharedRegionSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
 
     if (shared_region == NULL) {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to allocating shared PSRAM region!");
         return false;
     }
     else {
+        sharedRegionSize = _sharedRegionSize;
+        sharedTensorArenaSize = std::min(_tensorArenaSize, _sharedRegionSize);
         return true;
     }
 }
 
 
+size_t psram_get_shared_region_size(void) {
+    return sharedRegionSize;
+}
+
+
 
 /*******************************************************************
  * Memory used in Take Image (STBI)
@@ -59,9 +93,9 @@ void *psram_reserve_shared_stbi_memory(size_t size) {
     /* Only large buffers should be placed in the shared PSRAM 
      * If we also place all smaller STBI buffers here, we get artefacts for some reasons. */
     if (size >= 100000) {
-        if ((allocatedBytesForSTBI + size) > TENSOR_ARENA_SIZE + MAX_MODEL_SIZE) { // Check if it still fits in the shared region
+        if ((allocatedBytesForSTBI + size) > sharedRegionSize) { // Check if it still fits in the shared region
             LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Shared memory in PSRAM too small (STBI) to fit additional " + 
-                    std::to_string(size) + " bytes! Available: " + std::to_string(TENSOR_ARENA_SIZE + MAX_MODEL_SIZE - allocatedBytesForSTBI) + " bytes!");
+                    std::to_string(size) + " bytes! Available: " + std::to_string(sharedRegionSize - allocatedBytesForSTBI) + " bytes!");
 
             return NULL;
         }
@@ -123,13 +157,14 @@ void psram_free_shared_temp_image_memory(void) {
  * Memory used in Digitization Steps
  * During this step we only use the shared part of the PSRAM for the
  * Tensor Arena and one of the Models.
- * The shared memory is large enough for the largest model and the
- * Tensor Arena. Therefore we do not need to monitor the usage.
+ * The Tensor Arena is sized from the measured usage of the configured
+ * models (or TENSOR_ARENA_SIZE if not measured yet), the model file
+ * size gets checked against the remaining part when loading it.
  *******************************************************************/
 void *psram_get_shared_tensor_arena_memory(void) {
     if ((sharedMemoryInUseFor == "") || (sharedMemoryInUseFor == "Digitization_Model")) {
         sharedMemoryInUseFor = "Digitization_Tensor";
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Allocating Tensor Arena (" + std::to_string(TENSOR_ARENA_SIZE) + " bytes, use shared memory in PSRAM)...");
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Allocating Tensor Arena (" + std::to_string(sharedTensorArenaSize) + " bytes, use shared memory in PSRAM)...");
         return shared_region; // Use 1th part of the shared memory for Tensor
     }
     else {
@@ -142,8 +177,8 @@ void *psram_get_shared_tensor_arena_memory(void) {
 void *psram_get_shared_model_memory(void) {
     if ((sharedMemoryInUseFor == "") || (sharedMemoryInUseFor == "Digitization_Tensor")) {
         sharedMemoryInUseFor = "Digitization_Model";
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Allocating Model memory (" + std::to_string(MAX_MODEL_SIZE) + " bytes, use shared memory in PSRAM)...");
-        return (uint8_t *)shared_region + TENSOR_ARENA_SIZE; // Use 2nd part of the shared memory (after Tensor Arena) for the model
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Allocating Model memory (" + std::to_string(psram_get_shared_model_memory_size()) + " bytes, use shared memory in PSRAM)...");
+        return (uint8_t *)shared_region + sharedTensorArenaSize; // Use 2nd part of the shared memory (after Tensor Arena) for the model
     }
     else {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Shared memory in PSRAM already in use for " + sharedMemoryInUseFor + "!");
@@ -152,6 +187,16 @@ void *psram_get_shared_model_memory(void) {
 }
 
 
+size_t psram_get_shared_tensor_arena_size(void) {
+    return sharedTensorArenaSize;
+}
+
+
+size_t psram_get_shared_model_memory_size(void) {
+    return sharedRegionSize - sharedTensorArenaSize;
+}
+
+
 void psram_free_shared_tensor_arena_and_model_memory(void) {
     sharedMemoryInUseFor = "";
     LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Shared memory used for Tensor Arena and model (PSRAM, part of shared memory) is free again");
@@ -159,12 +204,140 @@ void psram_free_shared_tensor_arena_and_model_memory(void) {
 
 
 
+/*******************************************************************
+ * Per-round arena
+ * One block in PSRAM which holds all short living buffers of the
+ * flow task. It gets reset at the end of each round, so the heap
+ * does not fragment from the many small allocations of a round.
+ *******************************************************************/
+bool reserve_psram_round_arena(void) {
+    void *buffer = malloc_psram_heap("Round arena", ROUND_ARENA_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+
+    if (buffer == NULL) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Failed to allocate round arena, using normal PSRAM heap for temporary buffers");
+        return false;
+    }
+
+    roundArena.Init(buffer, ROUND_ARENA_SIZE);
+    return true;
+}
+
+
+void psram_round_arena_begin(void) {
+    roundArena.Reset();
+    roundArenaOwner = xTaskGetCurrentTaskHandle();
+}
+
+
+void psram_round_arena_reset(void) {
+    if (roundArena.getUsed() > 0) {
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Round arena reset (" + to_string(roundArena.getAllocCount()) + " allocations, high water mark " +
+                to_string(roundArena.getHighWater()) + " of " + to_string(roundArena.getSize()) + " bytes)");
+    }
+
+    roundArena.Reset();
+    roundArenaOwner = NULL;
+}
+
+
+void *psram_round_arena_malloc(std::string name, size_t size) {
+    if (roundArena.isInitialized() && (roundArenaOwner != NULL) && (roundArenaOwner == xTaskGetCurrentTaskHandle())) {
+        void *ptr = roundArena.Alloc(size);
+
+        if (ptr != NULL) {
+            return ptr;
+        }
+
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Round arena full, using normal PSRAM heap for '" + name + "' (" + to_string(size) + " bytes)");
+    }
+
+    return malloc_psram_heap(name, size, MALLOC_CAP_SPIRAM);
+}
+
+
+void psram_round_arena_free(std::string name, void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    if (!roundArena.Free(ptr)) { // Not part of the arena
+        free_psram_heap(name, ptr);
+    }
+}
+
+
+
+/*******************************************************************
+ * Allocation statistics per flow step
+ *******************************************************************/
+void psram_stage_begin(std::string stage) {
+    psramStageAct = -1;
+
+    for (int i = 0; i < psramStageCount; ++i) {
+        if (psramStages[i].name == stage) {
+            psramStageAct = i;
+            break;
+        }
+    }
+
+    if (psramStageAct < 0) {
+        if (psramStageCount >= MAX_PSRAM_STAGES) {
+            return;
+        }
+
+        psramStageAct = psramStageCount++;
+        psramStages[psramStageAct].name = stage;
+        psramStages[psramStageAct].arenaHighWaterMax = 0;
+    }
+
+    roundArena.ResetHighWater();
+    psramMallocCallsAtStageBegin = psramMallocCalls;
+}
+
+
+void psram_stage_end(void) {
+    if (psramStageAct < 0) {
+        return;
+    }
+
+    PsramStage *stage = &psramStages[psramStageAct];
+    stage->arenaHighWater = roundArena.getHighWater();
+    stage->arenaHighWaterMax = std::max(stage->arenaHighWaterMax, stage->arenaHighWater);
+    stage->mallocCalls = psramMallocCalls - psramMallocCallsAtStageBegin;
+    stage->freeAfter = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    stage->largestBlockAfter = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+
+    psramStageAct = -1;
+}
+
+
+std::string psram_get_stage_statistics(void) {
+    char buf[160];
+    std::string result;
+
+    snprintf(buf, sizeof(buf), "Round arena: %d bytes, overflows: %ld<br>", (int)roundArena.getSize(), (long)roundArena.getOverflowCount());
+    result = buf;
+
+    for (int i = 0; i < psramStageCount; ++i) {
+        snprintf(buf, sizeof(buf), "%s: Arena HWM: %d (max %d) | Heap allocs: %ld | SPI Free: %d | SPI Large Block: %d<br>",
+                psramStages[i].name.c_str(), (int)psramStages[i].arenaHighWater, (int)psramStages[i].arenaHighWaterMax,
+                (long)psramStages[i].mallocCalls, (int)psramStages[i].freeAfter, (int)psramStages[i].largestBlockAfter);
+        result += buf;
+    }
+
+    return result;
+}
+
+
+
 /*******************************************************************
  * General
  *******************************************************************/
 void *malloc_psram_heap(std::string name, size_t size, uint32_t caps) {
 	void *ptr;
 
+    psramMallocCalls++;
+
 	ptr = heap_caps_malloc(size, caps);
     if (ptr != NULL) {
 	    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Allocated " + to_string(size) + " bytes in PSRAM for '" + name + "'");
@@ -178,6 +351,7 @@ void *malloc_psram_heap(std::string name, size_t size, uint32_t caps) {
 
 
 void *realloc_psram_heap(std::string name, void *ptr, size_t size, uint32_t caps) {
+    psramMallocCalls++;
 	ptr = heap_caps_realloc(ptr, size, caps);
     if (ptr != NULL) {
 	    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Reallocated " + to_string(size) + " bytes in PSRAM for '" + name + "'");
@@ -193,6 +367,7 @@ void *realloc_psram_heap(std::string name, void *ptr, size_t size, uint32_t caps
 void *calloc_psram_heap(std::string name, size_t n, size_t size, uint32_t caps) {
 	void *ptr;
 
+    psramMallocCalls++;
 	ptr = heap_caps_calloc(n, size, caps);
     if (ptr != NULL) {
 	    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Allocated " + to_string(size) + " bytes in PSRAM for '" + name + "'");
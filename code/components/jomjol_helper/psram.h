@@ -2,10 +2,13 @@
 #ifndef PSRAM_h
 #define PSRAM_h
 
+#include <string>
 #include "esp_heap_caps.h"
 
 
-bool reserve_psram_shared_region(void);
+/* _tensorArenaSize: first part of the region, the model follows behind it */
+bool reserve_psram_shared_region(size_t _tensorArenaSize, size_t _sharedRegionSize);
+size_t psram_get_shared_region_size(void);
 
 
 /* Memory used in Take Image Step */
@@ -23,8 +26,24 @@ void psram_free_shared_temp_image_memory(void);
 /* Memory used in Digitization Steps */
 void *psram_get_shared_tensor_arena_memory(void);
 void *psram_get_shared_model_memory(void);
+size_t psram_get_shared_tensor_arena_size(void);
+size_t psram_get_shared_model_memory_size(void);
 void psram_free_shared_tensor_arena_and_model_memory(void);
 
+/* Per-round arena
+ * Temporary buffers of the flow task which only live within one round.
+ * Outside of a round or in other tasks the requests fall back to the normal PSRAM heap. */
+bool reserve_psram_round_arena(void);
+void psram_round_arena_begin(void);
+void psram_round_arena_reset(void);
+void *psram_round_arena_malloc(std::string name, size_t size);
+void psram_round_arena_free(std::string name, void *ptr);
+
+/* Allocation statistics per flow step (stage) */
+void psram_stage_begin(std::string stage);
+void psram_stage_end(void);
+std::string psram_get_stage_statistics(void);
+
 /* General */
 void *malloc_psram_heap(std::string name, size_t size, uint32_t caps);
 void *realloc_psram_heap(std::string name, void *ptr, size_t size, uint32_t caps);
@@ -39,23 +39,21 @@ bool CAlignAndCutImage::Align(RefInfo *_temp1, RefInfo *_temp2)
     int r0_x, r0_y, r1_x, r1_y;
     bool isSimilar1, isSimilar2;
 
-    CFindTemplate* ft = new CFindTemplate("align", rgb_image, channels, width, height, bpp);
+    CFindTemplate ft("align", rgb_image, channels, width, height, bpp);
 
     r0_x = _temp1->target_x;
     r0_y = _temp1->target_y;
-    ESP_LOGD(TAG, "Before ft->FindTemplate(_temp1); %s", _temp1->image_file.c_str());
-    isSimilar1 = ft->FindTemplate(_temp1);
-    _temp1->width = ft->tpl_width;
-    _temp1->height = ft->tpl_height; 
+    ESP_LOGD(TAG, "Before ft.FindTemplate(_temp1); %s", _temp1->image_file.c_str());
+    isSimilar1 = ft.FindTemplate(_temp1);
+    _temp1->width = ft.tpl_width;
+    _temp1->height = ft.tpl_height; 
 
     r1_x = _temp2->target_x;
     r1_y = _temp2->target_y;
-    ESP_LOGD(TAG, "Before ft->FindTemplate(_temp2); %s", _temp2->image_file.c_str());
-    isSimilar2 = ft->FindTemplate(_temp2);
-    _temp2->width = ft->tpl_width;
-    _temp2->height = ft->tpl_height; 
-
-    delete ft;
+    ESP_LOGD(TAG, "Before ft.FindTemplate(_temp2); %s", _temp2->image_file.c_str());
+    isSimilar2 = ft.FindTemplate(_temp2);
+    _temp2->width = ft.tpl_width;
+    _temp2->height = ft.tpl_height; 
 
 
     dx = _temp1->target_x - _temp1->found_x;
@@ -109,7 +107,7 @@ void CAlignAndCutImage::CutAndSave(std::string _template1, int x1, int y1, int d
     dy = y2 - y1;
 
     int memsize = dx * dy * channels;
-    uint8_t* odata = (unsigned char*) malloc_psram_heap(std::string(TAG) + "->odata", memsize, MALLOC_CAP_SPIRAM);
+    uint8_t* odata = (unsigned char*)psram_round_arena_malloc(std::string(TAG) + "->odata", memsize);
 
     stbi_uc* p_target;
     stbi_uc* p_source;
@@ -134,7 +132,7 @@ void CAlignAndCutImage::CutAndSave(std::string _template1, int x1, int y1, int d
 
     RGBImageRelease();
 
-    stbi_image_free(odata);
+    psram_round_arena_free(std::string(TAG) + "->odata", odata);
 }
 
 void CAlignAndCutImage::CutAndSave(int x1, int y1, int dx, int dy, CImageBasis *_target)
@@ -175,6 +173,36 @@ void CAlignAndCutImage::CutAndSave(int x1, int y1, int dx, int dy, CImageBasis *
 }
 
 
+/* Resize the area directly into the target, without an intermediate copy of the cut out area */
+void CAlignAndCutImage::CutAndResize(int x1, int y1, int dx, int dy, CImageBasis *_target)
+{
+    int x2, y2;
+
+    x2 = x1 + dx;
+    y2 = y1 + dy;
+    x2 = std::min(x2, width - 1);
+    y2 = std::min(y2, height - 1);
+
+    dx = x2 - x1;
+    dy = y2 - y1;
+
+    if ((x1 < 0) || (y1 < 0) || (dx <= 0) || (dy <= 0) || (_target->channels != channels))
+    {
+        ESP_LOGD(TAG, "CAlignAndCutImage::CutAndResize - Area outside of image or channels do not match!");
+        return;
+    }
+
+    uint8_t* odata = _target->RGBImageLock();
+    RGBImageLock();
+
+    stbir_resize_uint8(rgb_image + channels * (y1 * width + x1), dx, dy, width * channels, 
+            odata, _target->width, _target->height, 0, channels);
+
+    RGBImageRelease();
+    _target->RGBImageRelease();
+}
+
+
 CImageBasis* CAlignAndCutImage::CutAndSave(int x1, int y1, int dx, int dy)
 {
     int x2, y2;
@@ -21,6 +21,7 @@ class CAlignAndCutImage : public CImageBasis
         void CutAndSave(std::string _template1, int x1, int y1, int dx, int dy);
         CImageBasis* CutAndSave(int x1, int y1, int dx, int dy);
         void CutAndSave(int x1, int y1, int dx, int dy, CImageBasis *_target);
+        void CutAndResize(int x1, int y1, int dx, int dy, CImageBasis *_target);
         void GetRefSize(int *ref_dx, int *ref_dy);
 };
 
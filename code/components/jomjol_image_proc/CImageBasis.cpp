@@ -720,7 +720,7 @@ void CImageBasis::SaveToFile(std::string _imageout)
 void CImageBasis::Resize(int _new_dx, int _new_dy)
 {
     memsize = _new_dx * _new_dy * channels;
-    uint8_t* odata = (unsigned char*)malloc_psram_heap(std::string(TAG) + "->odata", memsize, MALLOC_CAP_SPIRAM);
+    uint8_t* odata = (unsigned char*)psram_round_arena_malloc(std::string(TAG) + "->odata", memsize);
 
     RGBImageLock();
 
@@ -731,7 +731,7 @@ void CImageBasis::Resize(int _new_dx, int _new_dy)
     width = _new_dx;
     height = _new_dy;
 
-    free_psram_heap(std::string(TAG) + "->odata", odata);
+    psram_round_arena_free(std::string(TAG) + "->odata", odata);
 
     RGBImageRelease();
 }
@@ -0,0 +1,194 @@
+#include "CImageLogQueue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../stb/stb_image_write.h"
+#include "CImagePack.h"
+
+
+CImageLogQueue::CImageLogQueue()
+{
+    memset(&stats, 0, sizeof(stats));
+    bytes = 0;
+    allocFunction = malloc;
+    freeFunction = free;
+    Setup(POLICY_DROP_OLDEST, 1, 0);
+}
+
+
+CImageLogQueue::~CImageLogQueue()
+{
+    while (!jobs.empty()) {
+        release(&jobs.front());
+        jobs.pop_front();
+    }
+}
+
+
+void CImageLogQueue::Setup(Policy _policy, size_t _maxJobs, size_t _maxBytes, void *(*_alloc)(size_t), void (*_free)(void *))
+{
+    policy = _policy;
+    maxJobs = (_maxJobs > 0) ? _maxJobs : 1;
+    maxBytes = _maxBytes;
+
+    if (jobs.empty()) {
+        // The allocator of queued jobs must not change
+        allocFunction = (_alloc != NULL) ? _alloc : malloc;
+        freeFunction = (_free != NULL) ? _free : free;
+    }
+}
+
+
+void CImageLogQueue::release(Job *_job)
+{
+    if (_job->pixels != NULL) {
+        freeFunction(_job->pixels);
+        _job->pixels = NULL;
+    }
+
+    bytes -= _job->size;
+    _job->size = 0;
+}
+
+
+CImageLogQueue::PushResult CImageLogQueue::Push(std::string _fileName, const uint8_t *_pixels, int _width, int _height, int _channels,
+                                                std::string _packFile, std::string _result)
+{
+    size_t size = (size_t)_width * _height * _channels;
+
+    if ((_pixels == NULL) || (size == 0) || (size > maxBytes)) {
+        return PUSH_TOO_LARGE;
+    }
+
+    while ((jobs.size() >= maxJobs) || (bytes + size > maxBytes)) {
+        if ((policy == POLICY_DROP_OLDEST) && !jobs.empty()) {
+            release(&jobs.front());
+            jobs.pop_front();
+            stats.droppedOldest++;
+            continue;
+        }
+
+        if (policy == POLICY_BLOCK) {
+            return PUSH_FULL;
+        }
+
+        // Skip, or only the job being written is left
+        stats.skipped++;
+        return PUSH_SKIPPED;
+    }
+
+    Job job;
+    job.fileName = _fileName;
+    job.packFile = _packFile;
+    job.result = _result;
+    job.width = _width;
+    job.height = _height;
+    job.channels = _channels;
+    job.size = size;
+    job.pixels = (uint8_t *)allocFunction(size);
+
+    if (job.pixels == NULL) {
+        return PUSH_TOO_LARGE;
+    }
+
+    memcpy(job.pixels, _pixels, size);
+    bytes += size;
+    jobs.push_back(job);
+
+    stats.queued++;
+    if (jobs.size() > stats.maxDepth) {
+        stats.maxDepth = jobs.size();
+    }
+    if (bytes > stats.maxBytes) {
+        stats.maxBytes = bytes;
+    }
+
+    return PUSH_QUEUED;
+}
+
+
+bool CImageLogQueue::Pop(Job *_job)
+{
+    if (jobs.empty()) {
+        return false;
+    }
+
+    *_job = jobs.front();
+    jobs.pop_front();
+    return true;
+}
+
+
+void CImageLogQueue::Done(Job *_job, bool _written)
+{
+    if (_written) {
+        stats.written++;
+    }
+    else {
+        stats.failed++;
+    }
+
+    release(_job);
+}
+
+
+bool CImageLogQueue::WriteJPG(const Job *_job)
+{
+    if (!_job->packFile.empty()) {
+        return CImagePack::Append(_job->packFile, _job->result, _job->fileName, _job->pixels, _job->width, _job->height, _job->channels);
+    }
+
+    // Quality 0 selects the stb default, same as CImageBasis::SaveToFile()
+    return stbi_write_jpg(_job->fileName.c_str(), _job->width, _job->height, _job->channels, _job->pixels, 0) != 0;
+}
+
+
+std::string CImageLogQueue::GetLogImageResult(const float *_resultFloat, const int *_resultInt)
+{
+    char buf[20];
+
+    if (_resultFloat != NULL) {
+        if (*_resultFloat < 0) {
+            return "N.N";
+        }
+
+        snprintf(buf, sizeof(buf), "%.1f", *_resultFloat);
+        if (strcmp(buf, "10.0") == 0) {
+            return "0.0";
+        }
+        return std::string(buf);
+    }
+
+    if (_resultInt != NULL) {
+        snprintf(buf, sizeof(buf), "%d", *_resultInt);
+        return std::string(buf);
+    }
+
+    return "";
+}
+
+
+std::string CImageLogQueue::GetLogImageName(std::string _logPath, std::string _name, const float *_resultFloat, const int *_resultInt, std::string _time)
+{
+    std::string result = GetLogImageResult(_resultFloat, _resultInt);
+
+    return _logPath + "/" + (result.empty() ? "" : result + "_") + _name + "_" + _time + ".jpg";
+}
+
+
+std::string CImageLogQueue::getStatus()
+{
+    char status[300];
+    const char *policyName[] = {"drop oldest", "block", "skip"};
+
+    snprintf(status, sizeof(status), "%d/%d queued (%d kB), policy %s; %lu queued, %lu written, %lu failed, %lu dropped, "
+             "%lu skipped, %lu blocked, %lu direct, max. %lu queued (%d kB)",
+             (int)jobs.size(), (int)maxJobs, (int)(bytes / 1024), policyName[policy],
+             (unsigned long)stats.queued, (unsigned long)stats.written, (unsigned long)stats.failed,
+             (unsigned long)stats.droppedOldest, (unsigned long)stats.skipped, (unsigned long)stats.blocked,
+             (unsigned long)stats.direct, (unsigned long)stats.maxDepth, (int)(stats.maxBytes / 1024));
+
+    return std::string(status);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#ifndef CIMAGELOGQUEUE_H
+#define CIMAGELOGQUEUE_H
+
+#include <string>
+#include <deque>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Queue of images which are to be logged to the SD card (see ClassFlowImage::LogImage())
+ * A job holds a copy of the RGB pixels, so the round can go on with its image buffers while a
+ * background task encodes and writes the JPG. The queue is limited by the number of jobs and by the
+ * pixel bytes. When it is full, the policy decides: drop the oldest job, let the caller wait or skip
+ * the new image. A job larger than the byte limit is not queued at all (the caller writes it directly).
+ * The class only uses the C/C++ standard library and stb_image_write, the caller is responsible for locking.
+ */
+class CImageLogQueue
+{
+public:
+    enum Policy {
+        POLICY_DROP_OLDEST = 0,
+        POLICY_BLOCK = 1,
+        POLICY_SKIP = 2,            // Skip when busy
+    };
+
+    enum PushResult {
+        PUSH_QUEUED = 0,
+        PUSH_FULL,                  // POLICY_BLOCK only: nothing queued, push again when the writer made room
+        PUSH_SKIPPED,
+        PUSH_TOO_LARGE,             // Larger than the byte limit or out of memory, nothing queued
+    };
+
+    struct Job {
+        std::string fileName;       // Container: name of the image in it
+        std::string packFile;       // Container (see CImagePack), empty: single file
+        std::string result;         // Container: result of the image
+        int width;
+        int height;
+        int channels;
+        uint8_t *pixels;
+        size_t size;
+    };
+
+    struct Stats {
+        uint32_t queued;
+        uint32_t written;
+        uint32_t failed;            // Write failed (e.g. SD card full)
+        uint32_t droppedOldest;
+        uint32_t skipped;
+        uint32_t blocked;           // Times a caller had to wait
+        uint32_t direct;            // Written by the caller (too large)
+        uint32_t maxDepth;
+        size_t maxBytes;            // Max. pixel bytes in the queue
+    };
+
+protected:
+    std::deque<Job> jobs;
+    Policy policy;
+    size_t maxJobs;
+    size_t maxBytes;
+    size_t bytes;                   // Pixel bytes of the queued jobs and the job being written
+    Stats stats;
+    void *(*allocFunction)(size_t);
+    void (*freeFunction)(void *);
+
+    void release(Job *_job);
+
+public:
+    CImageLogQueue();
+    ~CImageLogQueue();
+
+    /* _alloc/_free: memory for the pixel copies (e.g. PSRAM), NULL for malloc()/free() */
+    void Setup(Policy _policy, size_t _maxJobs, size_t _maxBytes, void *(*_alloc)(size_t) = NULL, void (*_free)(void *) = NULL);
+
+    /* Copy the pixels into a new job, with _packFile the image gets appended to the container */
+    PushResult Push(std::string _fileName, const uint8_t *_pixels, int _width, int _height, int _channels,
+                    std::string _packFile = "", std::string _result = "");
+
+    /* Take the oldest job, its memory stays reserved until Done() */
+    bool Pop(Job *_job);
+    void Done(Job *_job, bool _written);
+
+    /* Statistics of the caller's decisions */
+    void CountBlocked() { stats.blocked++; };
+    void CountSkipped() { stats.skipped++; };
+    void CountDirect() { stats.direct++; };
+
+    /* Same encoding as CImageBasis::SaveToFile(), single file or appended to the container */
+    static bool WriteJPG(const Job *_job);
+
+    /* Result prefix of a logged image ("3.5", "N.N", "7" or empty) */
+    static std::string GetLogImageResult(const float *_resultFloat, const int *_resultInt);
+
+    /* Name of a logged image (result prefix, ROI name, time), as used by ClassFlowImage::LogImage() */
+    static std::string GetLogImageName(std::string _logPath, std::string _name, const float *_resultFloat, const int *_resultInt, std::string _time);
+
+    Stats getStats() { return stats; };
+    size_t getDepth() { return jobs.size(); };
+    size_t getBytes() { return bytes; };
+    Policy getPolicy() { return policy; };
+    std::string getStatus();
+};
+
+#endif //CIMAGELOGQUEUE_H
@@ -0,0 +1,159 @@
+#include "CImagePack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../stb/stb_image_write.h"
+
+
+struct PackWriter {
+    FILE *file;
+    bool ok;
+};
+
+
+static void write_pack_data(void *context, void *data, int size)
+{
+    PackWriter *writer = (PackWriter *)context;
+
+    if (writer->ok && (fwrite(data, 1, size, writer->file) != (size_t)size)) {
+        writer->ok = false;
+    }
+}
+
+
+static bool append_index(std::string _packFile, std::string _result, std::string _name, long _offset, long _length)
+{
+    FILE *file = fopen(CImagePack::GetIndexFileName(_packFile).c_str(), "a");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    bool ok = fprintf(file, "%ld,%ld,%s,%s\n", _offset, _length, _result.c_str(), _name.c_str()) > 0;
+    return (fclose(file) == 0) && ok;
+}
+
+
+std::string CImagePack::GetIndexFileName(std::string _packFile)
+{
+    size_t dot = _packFile.find_last_of('.');
+    size_t slash = _packFile.find_last_of('/');
+
+    if ((dot == std::string::npos) || ((slash != std::string::npos) && (dot < slash))) {
+        return _packFile + ".idx";
+    }
+
+    return _packFile.substr(0, dot) + ".idx";
+}
+
+
+bool CImagePack::Append(std::string _packFile, std::string _result, std::string _name, const uint8_t *_pixels, int _width, int _height, int _channels)
+{
+    FILE *file = fopen(_packFile.c_str(), "ab");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long offset = ftell(file);
+
+    // Quality 0 selects the stb default, same as CImageBasis::SaveToFile()
+    PackWriter writer = {file, true};
+    bool ok = stbi_write_jpg_to_func(write_pack_data, &writer, _width, _height, _channels, _pixels, 0) != 0;
+    long end = ftell(file);
+
+    if ((fclose(file) != 0) || !ok || !writer.ok || (offset < 0) || (end <= offset)) {
+        return false;   // Data without index line, never read
+    }
+
+    return append_index(_packFile, _result, _name, offset, end - offset);
+}
+
+
+bool CImagePack::AppendData(std::string _packFile, std::string _result, std::string _name, const uint8_t *_data, size_t _length)
+{
+    FILE *file = fopen(_packFile.c_str(), "ab");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long offset = ftell(file);
+    bool ok = fwrite(_data, 1, _length, file) == _length;
+
+    if ((fclose(file) != 0) || !ok || (offset < 0) || (_length == 0)) {
+        return false;
+    }
+
+    return append_index(_packFile, _result, _name, offset, _length);
+}
+
+
+bool CImagePack::ParseIndexLine(const char *_line, Entry *_entry)
+{
+    char *end;
+    unsigned long offset = strtoul(_line, &end, 10);
+
+    if ((end == _line) || (*end != ',')) {
+        return false;
+    }
+
+    const char *lengthStart = end + 1;
+    unsigned long length = strtoul(lengthStart, &end, 10);
+
+    if ((end == lengthStart) || (*end != ',') || (length == 0)) {
+        return false;
+    }
+
+    const char *result = end + 1;
+    const char *name = strchr(result, ',');
+
+    if (name == NULL) {
+        return false;
+    }
+    name++;
+
+    size_t nameLength = strcspn(name, "\r\n");
+
+    if ((nameLength == 0) || (name[nameLength] == '\0')) {
+        return false;   // Empty or incomplete line (no line end)
+    }
+
+    _entry->offset = offset;
+    _entry->length = length;
+    _entry->result = std::string(result, name - 1 - result);
+    _entry->name = std::string(name, nameLength);
+    return true;
+}
+
+
+bool CImagePack::Find(std::string _packFile, std::string _name, Entry *_entry)
+{
+    FILE *file = fopen(GetIndexFileName(_packFile).c_str(), "r");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    char line[256];
+    bool found = false;
+    Entry entry;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (!ParseIndexLine(line, &entry)) {
+            continue;
+        }
+
+        if ((entry.name == _name) || (!entry.result.empty() && (entry.result + "_" + entry.name == _name))) {
+            *_entry = entry;
+            found = true;
+        }
+    }
+    fclose(file);
+
+    return found;
+}
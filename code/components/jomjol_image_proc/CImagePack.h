@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef CIMAGEPACK_H
+#define CIMAGEPACK_H
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Container for logged ROI images: all images of an hour folder are appended as JPG to one file
+ * (IMAGE_PACK_FILE), instead of one small file per ROI and round.
+ * The index file next to it has one text line per image: "offset,length,result,name\n". It gets
+ * appended after the image data is written, so it never points to incomplete data.
+ * The legacy file name of an image is "<result>_<name>" (only "<name>" without result), an image can
+ * be looked up by both.
+ * The class only uses the C/C++ standard library and stb_image_write.
+ */
+class CImagePack
+{
+public:
+    struct Entry {
+        uint32_t offset;
+        uint32_t length;
+        std::string result;     // e.g. "3.5", "N.N", "7", empty if none
+        std::string name;       // e.g. "dig1_20240101-101500.jpg"
+    };
+
+    static std::string GetIndexFileName(std::string _packFile);
+
+    /* Encode the pixels as JPG (same as CImageBasis::SaveToFile()) and append them */
+    static bool Append(std::string _packFile, std::string _result, std::string _name, const uint8_t *_pixels, int _width, int _height, int _channels);
+
+    /* Append data which is already encoded */
+    static bool AppendData(std::string _packFile, std::string _result, std::string _name, const uint8_t *_data, size_t _length);
+
+    /* Look up an image by its name or legacy file name, the last one wins if it got appended twice */
+    static bool Find(std::string _packFile, std::string _name, Entry *_entry);
+
+    /* Parse an index line, false if it is incomplete */
+    static bool ParseIndexLine(const char *_line, Entry *_entry);
+};
+
+#endif //CIMAGEPACK_H
@@ -0,0 +1,200 @@
+#include "image_log_writer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "ClassLogFile.h"
+#include "CImageLogQueue.h"
+#include "CImagePack.h"
+#include "../../include/defines.h"
+
+static const char *TAG = "IMAGE LOG";
+
+static CImageLogQueue queue;
+static SemaphoreHandle_t queueMutex = NULL;         // Short locks only, never held while writing
+static TaskHandle_t writerTaskHandle = NULL;
+static bool writerBusy = false;                     // A job is being written
+
+
+static void *image_log_malloc(size_t _size)
+{
+    return heap_caps_malloc(_size, MALLOC_CAP_SPIRAM);
+}
+
+
+static void image_log_free(void *_ptr)
+{
+    heap_caps_free(_ptr);
+}
+
+
+static void task_image_log_writer(void *pvParameter)
+{
+    uint32_t reportedFailed = 0;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (true) {
+            CImageLogQueue::Job job;
+
+            xSemaphoreTake(queueMutex, portMAX_DELAY);
+            writerBusy = queue.Pop(&job);
+            xSemaphoreGive(queueMutex);
+
+            if (!writerBusy) {
+                break;
+            }
+
+            bool written = CImageLogQueue::WriteJPG(&job);
+
+            xSemaphoreTake(queueMutex, portMAX_DELAY);
+            queue.Done(&job, written);
+            writerBusy = false;
+            uint32_t failed = queue.getStats().failed;
+            xSemaphoreGive(queueMutex);
+
+            if (!written && (failed - reportedFailed == 1)) {    // Only the first of a series, e.g. SD card full
+                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to write " + job.fileName);
+            }
+            reportedFailed = failed;
+        }
+    }
+}
+
+
+bool image_log_writer_start(void)
+{
+    if (writerTaskHandle != NULL) {
+        return true;
+    }
+
+    if (queueMutex == NULL) {
+        queueMutex = xSemaphoreCreateMutex();
+    }
+
+    if (queueMutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create mutex");
+        return false;
+    }
+
+    queue.Setup(IMAGE_LOG_QUEUE_POLICY, IMAGE_LOG_QUEUE_MAX_JOBS, IMAGE_LOG_QUEUE_MAX_BYTES, image_log_malloc, image_log_free);
+
+    // stbi JPG encoder needs about 3 kB of stack
+    if (xTaskCreate(&task_image_log_writer, "image_log", 6 * 1024, NULL, tskIDLE_PRIORITY + 1, &writerTaskHandle) != pdPASS) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to start the image log writer, images get written in the round");
+        writerTaskHandle = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+
+static void image_log_write_direct(std::string _fileName, CImageBasis *_img, std::string _packFile, std::string _result)
+{
+    if (_packFile.empty()) {
+        _img->SaveToFile(_fileName);
+        return;
+    }
+
+    _img->RGBImageLock();
+    bool written = CImagePack::Append(_packFile, _result, _fileName, _img->rgb_image, _img->width, _img->height, _img->channels);
+    _img->RGBImageRelease();
+
+    if (!written) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to append " + _fileName + " to " + _packFile);
+    }
+}
+
+
+void image_log_writer_save(std::string _fileName, CImageBasis *_img, std::string _packFile, std::string _result)
+{
+    if (writerTaskHandle == NULL) {
+        image_log_write_direct(_fileName, _img, _packFile, _result);
+        return;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    bool counted = false;
+    CImageLogQueue::PushResult result;
+
+    while (true) {
+        _img->RGBImageLock();
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        result = queue.Push(_fileName, _img->rgb_image, _img->width, _img->height, _img->channels, _packFile, _result);
+
+        if ((result == CImageLogQueue::PUSH_FULL) && !counted) {
+            queue.CountBlocked();
+            counted = true;
+        }
+        else if ((result == CImageLogQueue::PUSH_FULL) && ((xTaskGetTickCount() - start) >= pdMS_TO_TICKS(IMAGE_LOG_QUEUE_BLOCK_TIMEOUT))) {
+            queue.CountSkipped();
+            result = CImageLogQueue::PUSH_SKIPPED;
+        }
+        else if (result == CImageLogQueue::PUSH_TOO_LARGE) {
+            queue.CountDirect();
+        }
+        xSemaphoreGive(queueMutex);
+        _img->RGBImageRelease();
+
+        if (result != CImageLogQueue::PUSH_FULL) {
+            break;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+
+    if (result == CImageLogQueue::PUSH_QUEUED) {
+        xTaskNotifyGive(writerTaskHandle);
+    }
+    else if (result == CImageLogQueue::PUSH_TOO_LARGE) {
+        image_log_write_direct(_fileName, _img, _packFile, _result);
+    }
+    else if (result == CImageLogQueue::PUSH_SKIPPED) {
+        ESP_LOGD(TAG, "Queue full, skipped %s", _fileName.c_str());
+    }
+}
+
+
+bool image_log_writer_flush(int _timeoutMs)
+{
+    if (writerTaskHandle == NULL) {
+        return true;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+
+    while (true) {
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        bool pending = (queue.getDepth() > 0) || writerBusy;
+        xSemaphoreGive(queueMutex);
+
+        if (!pending) {
+            return true;
+        }
+
+        if ((xTaskGetTickCount() - start) >= pdMS_TO_TICKS(_timeoutMs)) {
+            return false;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+}
+
+
+std::string image_log_writer_get_status(void)
+{
+    if (writerTaskHandle == NULL) {
+        return "not running, images are written in the round";
+    }
+
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    std::string status = queue.getStatus();
+    xSemaphoreGive(queueMutex);
+
+    return status;
+}
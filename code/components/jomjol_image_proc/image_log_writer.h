@@ -0,0 +1,26 @@
+#pragma once
+
+#ifndef IMAGE_LOG_WRITER_H
+#define IMAGE_LOG_WRITER_H
+
+#include <string>
+
+#include "CImageBasis.h"
+
+
+/* Background task which writes logged images (see CImageLogQueue) */
+bool image_log_writer_start(void);
+
+/**
+ * Save the image as JPG: queued if the writer runs, otherwise (or if too large) written right away
+ * With _packFile the image is appended to this container (see CImagePack) as _fileName with _result
+ */
+void image_log_writer_save(std::string _fileName, CImageBasis *_img, std::string _packFile = "", std::string _result = "");
+
+/* Wait until all queued images are written, false on timeout */
+bool image_log_writer_flush(int _timeoutMs);
+
+/* Queue depth and counters, human readable */
+std::string image_log_writer_get_status(void);
+
+#endif //IMAGE_LOG_WRITER_H
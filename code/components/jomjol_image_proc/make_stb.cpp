@@ -24,5 +24,9 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "../stb/stb_image_write.h"
 
+/* The resize scratch buffer only lives during one call -> per-round arena (LIFO free makes it reusable) */
+#define STBIR_MALLOC(size,c)      ((void)(c), psram_round_arena_malloc("STBIR", size))
+#define STBIR_FREE(ptr,c)         ((void)(c), psram_round_arena_free("STBIR", ptr))
+
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #include "../stb/stb_image_resize.h"
\ No newline at end of file
@@ -5,71 +5,16 @@
 #include <time.h>
 #include "ClassLogFile.h"
 #include "esp_http_client.h"
+#include "esp_heap_caps.h"
+#include "http_client_pool.h"
 #include "time_sntp.h"
+#include "CGzip.h"
 #include "../../include/defines.h"
 
 static const char *TAG = "INFLUXDB";
 
-/**
- * @brief Buffer to store the HTTP response.
- * 
- * This character array is used to store the output of an HTTP response.
- * The size of the buffer is defined by the constant MAX_HTTP_OUTPUT_BUFFER.
- */
-char response_buffer[MAX_HTTP_OUTPUT_BUFFER] = {0};
-
-
-/**
- * @brief HTTP event handler callback function.
- *
- * This function handles various HTTP client events and logs appropriate messages.
- *
- * @param evt Pointer to the HTTP client event structure.
- * @return esp_err_t ESP_OK on success.
- *
- * Event types handled:
- * - HTTP_EVENT_ERROR: Logs an error message when an HTTP error is encountered.
- * - HTTP_EVENT_ON_CONNECTED: Logs a message when the HTTP client successfully connects.
- * - HTTP_EVENT_HEADERS_SENT: Logs a message when all request headers are sent.
- * - HTTP_EVENT_ON_HEADER: Logs the received header key and value.
- * - HTTP_EVENT_ON_DATA: Logs the length of the received data.
- * - HTTP_EVENT_ON_FINISH: Logs a message when the HTTP client finishes the request.
- * - HTTP_EVENT_DISCONNECTED: Logs a message when the HTTP client disconnects.
- * - HTTP_EVENT_REDIRECT: Logs a message when an HTTP redirect occurs.
- */
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
-{
-    switch(evt->event_id)
-    {
-        case HTTP_EVENT_ERROR:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client Error encountered");
-            break;
-        case HTTP_EVENT_ON_CONNECTED:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client connected");
-            ESP_LOGI(TAG, "HTTP Client Connected");
-            break;
-        case HTTP_EVENT_HEADERS_SENT:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client sent all request headers");
-            break;
-        case HTTP_EVENT_ON_HEADER:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Header: key=" + std::string(evt->header_key) + ", value="  + std::string(evt->header_value));
-            break;
-        case HTTP_EVENT_ON_DATA:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client data recevied: len=" + std::to_string(evt->data_len));
-            break;
-        case HTTP_EVENT_ON_FINISH:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client finished");
-            break;
-         case HTTP_EVENT_DISCONNECTED:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client Disconnected");
-            break;
-        case HTTP_EVENT_REDIRECT:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Redirect");
-            break;
-    }
-    return ESP_OK;
-}
-
+/* Compressor of both connections (flow task only), allocated once and kept to not fragment the PSRAM */
+static void *gzipWorkspace = NULL;
 
 
 /**
@@ -88,6 +33,7 @@ void InfluxDB::InfluxDBInitV1(std::string _influxDBURI, std::string _database, s
     database = _database;
     user = _user;
     password = _password;
+    apiURI = influxDBURI + "/write?db=" + database;
 }
 
 /**
@@ -107,142 +53,132 @@ void InfluxDB::InfluxDBInitV2(std::string _influxDBURI, std::string _bucket, std
     bucket = _bucket;
     org = _org;
     token = _token;
+    apiURI = influxDBURI + "/api/v2/write?org=" + org + "&bucket=" + bucket;
 }
 
 /**
- * @brief Establishes an HTTP connection to the InfluxDB server.
- *
- * This function configures and initializes an HTTP client to connect to the InfluxDB server.
- * It sets up the necessary parameters such as the URL, event handler, buffer size, and user data.
- * Depending on the InfluxDB version, it also configures the authentication type and credentials.
+ * @brief Enables or disables gzip compression of the written lines.
  *
- * @note This function destroys any existing HTTP client before initializing a new one.
+ * The compressor needs about 312 kB of PSRAM (INFLUXDB_GZIP_WORKSPACE), it gets allocated once on enabling
+ * and is kept. If it can not be allocated, the lines get sent uncompressed.
  *
- * @param None
- * @return None
+ * @param _compression true to send the lines with "Content-Encoding: gzip".
  */
-void InfluxDB::connectHTTP() {
-    esp_http_client_config_t config = {};
+void InfluxDB::InfluxDBSetCompression(bool _compression) {
+    compression = _compression;
 
-    config.url = influxDBURI.c_str();
-    config.event_handler = http_event_handler;
-    config.buffer_size = MAX_HTTP_OUTPUT_BUFFER;
-    config.user_data = response_buffer;
+    if (compression && (gzipWorkspace == NULL)) {
+        gzipWorkspace = heap_caps_malloc(CGzip::GetWorkspaceSize(), MALLOC_CAP_SPIRAM);
 
-
-    switch (version) {
-        case INFLUXDB_V1:
-            config.auth_type = HTTP_AUTH_TYPE_BASIC;
-            config.username = user.c_str();
-            config.password = password.c_str();
-            break;
-        case INFLUXDB_V2:
-            break;
-    }
-
-    InfluxDBdestroy();
-    httpClient = esp_http_client_init(&config);
-    if (!httpClient) {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to initialize HTTP client");
-    } else {
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "HTTP client initialized successfully");
+        if (gzipWorkspace == NULL) {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Not enough memory for the gzip compressor, sending uncompressed");
+        }
     }
 }
 
-
 /**
- * @brief Destroys the InfluxDB instance by cleaning up the HTTP client.
+ * @brief Builds a line of the InfluxDB line protocol.
  *
- * This function checks if the HTTP client is initialized. If it is, it cleans up the HTTP client
- * and logs the cleanup action. The HTTP client pointer is then set to NULL.
+ * @param _measurement The measurement name.
+ * @param _key The key associated with the measurement.
+ * @param _content The content or value.
+ * @param _timeUTC The timestamp in UTC. If greater than 0, it will be included in the line.
+ * @return The line (without line end).
  */
-void InfluxDB::InfluxDBdestroy() {
-    if (httpClient) {
-        esp_http_client_cleanup(httpClient);
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "HTTP client cleaned up");
-        httpClient = NULL;
+std::string InfluxDB::InfluxDBLine(std::string _measurement, std::string _key, std::string _content, long int _timeUTC) {
+    char nowTimestamp[21];
+
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "InfluxDBLine - Key: " + _key + ", Content: " + _content + ", timeUTC: " + std::to_string(_timeUTC));
+
+    if (_timeUTC > 0)
+    {
+        sprintf(nowTimestamp,"%ld000000000", _timeUTC);           // UTC
+        return _measurement + " " + _key + "=" + _content + " " + nowTimestamp;
     }
+
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "no timestamp given");
+    return _measurement + " " + _key + "=" + _content;
 }
 
 /**
- * @brief Publishes data to an InfluxDB instance.
- *
- * This function sends a measurement, key, and content to an InfluxDB server.
- * It supports both InfluxDB v1 and v2 APIs.
+ * @brief Writes lines of the line protocol to an InfluxDB instance.
  *
- * @param _measurement The measurement name to publish.
- * @param _key The key associated with the measurement.
- * @param _content The content or value to publish.
- * @param _timeUTC The timestamp in UTC. If greater than 0, it will be included in the payload.
+ * It supports both InfluxDB v1 and v2 APIs. All lines get sent in one HTTP POST request, gzip compressed
+ * if enabled (and worth it). The HTTP client comes from the shared pool, so its connection is kept open
+ * between the writes (keep-alive). After a failed request the client gets destroyed, the next write connects again.
  *
- * The function logs the process and handles HTTP communication with the InfluxDB server.
- * It constructs the appropriate API URI based on the InfluxDB version and sends the data
- * using an HTTP POST request.
+ * @param _payload One or more lines of the line protocol, separated by '\n'.
+ * @return true if the server got the data. A rejected request (4xx) counts as delivered as well,
+ *         it would fail again if it gets repeated.
  */
-void InfluxDB::InfluxDBPublish(std::string _measurement, std::string _key, std::string _content, long int _timeUTC) {
-    std::string apiURI;        
-    std::string payload;
-    char nowTimestamp[21];
+bool InfluxDB::InfluxDBWrite(std::string _payload) {
+    std::string gzip;
 
-    connectHTTP();
+    esp_http_client_handle_t httpClient = http_client_pool_acquire(apiURI, HTTP_METHOD_POST);
+    if (!httpClient) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to initialize HTTP client");
+        return false;
+    }
 
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "sending lines to influxdb:" + _payload);
 
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "InfluxDBPublish - Key: " + _key + ", Content: " + _content + ", timeUTC: " + std::to_string(_timeUTC));
+    http_client_pool_set_header(httpClient, "Content-Type", "text/plain; charset=utf-8");
 
-    if (_timeUTC > 0)
-    {
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Timestamp (UTC): " + std::to_string(_timeUTC));
-        sprintf(nowTimestamp,"%ld000000000", _timeUTC);           // UTC
-        payload = _measurement + " " + _key + "=" + _content + " " + nowTimestamp;
+    switch (version) {
+        case INFLUXDB_V1:
+            http_client_pool_set_basic_auth(httpClient, user, password);
+            break;
+        case INFLUXDB_V2:
+            http_client_pool_set_header(httpClient, "Authorization", ("Token " + token).c_str());
+            break;
     }
-    else
-    {
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "no timestamp given");
-        payload = _measurement + " " + _key + "=" + _content;
+
+    if (compression && (gzipWorkspace != NULL) && (_payload.length() >= INFLUXDB_GZIP_MIN) &&
+        CGzip::Compress(_payload.data(), _payload.length(), &gzip, gzipWorkspace)) {
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Compressed " + std::to_string(_payload.length()) + " to " + std::to_string(gzip.length()) + " bytes");
+        http_client_pool_set_header(httpClient, "Content-Encoding", "gzip");
+        esp_http_client_set_post_field(httpClient, gzip.data(), gzip.length());
+    }
+    else {
+        esp_http_client_set_post_field(httpClient, _payload.c_str(), _payload.length());
     }
 
-    payload.shrink_to_fit();
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "sending line to influxdb:" + payload);
+    esp_err_t err = ESP_ERROR_CHECK_WITHOUT_ABORT(http_client_pool_perform(httpClient));
+    if (err != ESP_OK) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to publish data: " + std::string(esp_err_to_name(err)));
+        http_client_pool_release(httpClient, false);
+        return false;
+    }
 
-    esp_err_t err;
+    int status_code = esp_http_client_get_status_code(httpClient);
+    if (status_code >= 500) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to publish data, HTTP status code: " + std::to_string(status_code));
+        http_client_pool_release(httpClient, false);
+        return false;
+    }
 
-    switch (version) {
-        case INFLUXDB_V1: 
-            apiURI = influxDBURI + "/write?db=" + database;
-            apiURI.shrink_to_fit();
-
-            esp_http_client_set_url(httpClient, apiURI.c_str());
-            esp_http_client_set_method(httpClient, HTTP_METHOD_POST);
-            esp_http_client_set_header(httpClient, "Content-Type", "text/plain");
-            esp_http_client_set_post_field(httpClient, payload.c_str(), payload.length());
-
-            err = esp_http_client_perform(httpClient);
-            if (err == ESP_OK) {
-                LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Data published successfully: " + payload);
-            } else {
-                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to publish data: " + std::string(esp_err_to_name(err)));
-            }
-            break;
+    http_client_pool_release(httpClient, true);
 
-        case INFLUXDB_V2:        
-            apiURI = influxDBURI + "/api/v2/write?org=" + org + "&bucket=" + bucket;
-            apiURI.shrink_to_fit();
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "apiURI: " + apiURI);
-
-            esp_http_client_set_url(httpClient, apiURI.c_str());
-            esp_http_client_set_method(httpClient, HTTP_METHOD_POST);
-            esp_http_client_set_header(httpClient, "Content-Type", "text/plain");
-            std::string _zw = "Token " + token;
-            esp_http_client_set_header(httpClient, "Authorization", _zw.c_str());
-            esp_http_client_set_post_field(httpClient, payload.c_str(), payload.length());
-            err = ESP_ERROR_CHECK_WITHOUT_ABORT(esp_http_client_perform(httpClient));
-            if (err == ESP_OK) {
-                LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Data published successfully: " + payload);
-            } else {
-                LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Failed to publish data: " + std::string(esp_err_to_name(err)));
-            }
-        break;
+    if (status_code >= 300) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Data rejected, HTTP status code: " + std::to_string(status_code));
+        return true;
     }
+
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Data published successfully");
+    return true;
+}
+
+/**
+ * @brief Publishes data to an InfluxDB instance.
+ *
+ * @param _measurement The measurement name to publish.
+ * @param _key The key associated with the measurement.
+ * @param _content The content or value to publish.
+ * @param _timeUTC The timestamp in UTC. If greater than 0, it will be included in the payload.
+ * @return true if the server got the data.
+ */
+bool InfluxDB::InfluxDBPublish(std::string _measurement, std::string _key, std::string _content, long int _timeUTC) {
+    return InfluxDBWrite(InfluxDBLine(_measurement, _key, _content, _timeUTC));
 }
 
 #endif //ENABLE_INFLUXDB
@@ -24,7 +24,7 @@ enum InfluxDBVersion {
  * @brief A class to handle connections and data publishing to InfluxDB servers.
  * 
  * This class supports both InfluxDB v1.x and v2.x versions. It provides methods to initialize
- * the connection parameters, publish data, and destroy the connection.
+ * the connection parameters and publish data. The HTTP connection is kept in the shared HTTP client pool.
  * 
  * @private
  * @var std::string influxDBURI
@@ -51,11 +51,11 @@ enum InfluxDBVersion {
  * @var InfluxDBVersion version
  * Version of the InfluxDB server (v1.x or v2.x).
  * 
- * @var esp_http_client_handle_t httpClient
- * HTTP client handle for making requests to the InfluxDB server.
+ * @var std::string apiURI
+ * Write endpoint, built once by the init functions.
  * 
- * @var void connectHTTP()
- * Establishes an HTTP connection to the InfluxDB server.
+ * @var bool compression
+ * Send the lines gzip compressed.
  * 
  * @public
  * @fn void InfluxDBInitV1(std::string _influxDBURI, std::string _database, std::string _user, std::string _password)
@@ -64,10 +64,16 @@ enum InfluxDBVersion {
  * @fn void InfluxDBInitV2(std::string _influxDBURI, std::string _bucket, std::string _org, std::string _token)
  * Initializes the connection parameters for InfluxDB v2.x.
  * 
- * @fn void InfluxDBdestroy()
- * Destroys the InfluxDB connection.
+ * @fn void InfluxDBSetCompression(bool _compression)
+ * Enables gzip compression of the lines (Content-Encoding: gzip).
  * 
- * @fn void InfluxDBPublish(std::string _measurement, std::string _key, std::string _content, long int _timeUTC)
+ * @fn std::string InfluxDBLine(std::string _measurement, std::string _key, std::string _content, long int _timeUTC)
+ * Builds a line of the line protocol.
+ * 
+ * @fn bool InfluxDBWrite(std::string _payload)
+ * Writes lines of the line protocol (separated by '\n') in one request to the InfluxDB server, false if it could not be reached.
+ * 
+ * @fn bool InfluxDBPublish(std::string _measurement, std::string _key, std::string _content, long int _timeUTC)
  * Publishes data to the InfluxDB server.
  * 
  * @param _measurement The measurement name.
@@ -92,19 +98,19 @@ private:
 
     InfluxDBVersion version;
 
-    esp_http_client_handle_t httpClient = NULL;
-
-    void connectHTTP();
+    std::string apiURI = "";
+    bool compression = false;
 
 public:
     // Initialize the InfluxDB connection parameters
     void InfluxDBInitV1(std::string _influxDBURI, std::string _database, std::string _user, std::string _password);
     void InfluxDBInitV2(std::string _influxDBURI, std::string _bucket, std::string _org, std::string _token);
+    void InfluxDBSetCompression(bool _compression);
 
-    // Destroy the InfluxDB connection
-    void InfluxDBdestroy();
     // Publish data to the InfluxDB server
-    void InfluxDBPublish(std::string _measurement, std::string _key, std::string _content, long int _timeUTC);
+    std::string InfluxDBLine(std::string _measurement, std::string _key, std::string _content, long int _timeUTC);
+    bool InfluxDBWrite(std::string _payload);
+    bool InfluxDBPublish(std::string _measurement, std::string _key, std::string _content, long int _timeUTC);
 };
 
 
@@ -0,0 +1,564 @@
+#include "CDataLog.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+static_assert(sizeof(CDataLog::Header) == 512, "Data log header must be 512 bytes");
+static_assert(sizeof(CDataLog::Record) == 96, "Data log record must be 96 bytes");
+static_assert(sizeof(CDataLog::IndexEntry) == 8, "Data log index entry must be 8 bytes");
+
+
+CDataLog::CDataLog()
+{
+    dataFile = NULL;
+    indexFile = NULL;
+    recordCount = 0;
+    position = -1;
+    memset(&header, 0, sizeof(header));
+}
+
+
+CDataLog::~CDataLog()
+{
+    Close();
+}
+
+
+std::string CDataLog::getIndexFileName(std::string _dataFile)
+{
+    size_t pos = _dataFile.find_last_of("./");
+
+    if ((pos != std::string::npos) && (_dataFile[pos] == '.')) {
+        _dataFile = _dataFile.substr(0, pos);
+    }
+
+    return _dataFile + ".idx";
+}
+
+
+void CDataLog::ClearRecord(Record *_record)
+{
+    memset(_record, 0, sizeof(Record));
+}
+
+
+void CDataLog::SetROIs(Record *_record, std::string _digits, std::string _analogs)
+{
+    int count = 0;
+
+    _record->digitCount = 0;
+    _record->analogCount = 0;
+
+    for (int part = 0; part < 2; ++part) {
+        std::string &values = (part == 0) ? _digits : _analogs;
+        size_t start = 0;
+
+        while ((start < values.length()) && (count < MAX_ROIS)) {
+            size_t end = values.find(',', start);
+
+            if (end == std::string::npos) {
+                end = values.length();
+            }
+
+            std::string value = values.substr(start, end - start);
+            start = end + 1;
+
+            if (value.empty()) {
+                continue;   // Leading separator
+            }
+
+            if ((part == 0) && (value.find('.') != std::string::npos)) {
+                _record->flags |= FLAG_DIGIT_DECIMALS;
+            }
+
+            if ((value == "N") || (value == "NaN")) {
+                _record->roi[count] = ROI_NAN;
+            }
+            else {
+                double roi = atof(value.c_str()) * 10;
+                _record->roi[count] = (int16_t)((roi < 0) ? roi - 0.5 : roi + 0.5);
+            }
+
+            count++;
+
+            if (part == 0) {
+                _record->digitCount++;
+            }
+            else {
+                _record->analogCount++;
+            }
+        }
+    }
+}
+
+
+uint32_t CDataLog::calcCheck(const Record *_record)
+{
+    // FNV-1a over everything but the check value itself
+    const uint8_t *data = (const uint8_t *)_record;
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < offsetof(Record, check); ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+
+bool CDataLog::readHeader(FILE *_file, Header *_header)
+{
+    if ((fseek(_file, 0, SEEK_SET) != 0) || (fread(_header, sizeof(Header), 1, _file) != 1)) {
+        return false;
+    }
+
+    return (_header->magic == MAGIC) && (_header->version == VERSION) && (_header->recordSize == sizeof(Record)) &&
+           (_header->indexStep > 0) && (_header->numberCount <= MAX_NUMBERS);
+}
+
+
+uint32_t CDataLog::countRecords(FILE *_file)
+{
+    if (fseek(_file, 0, SEEK_END) != 0) {
+        return 0;
+    }
+
+    long size = ftell(_file);
+
+    if (size < (long)sizeof(Header)) {
+        return 0;
+    }
+
+    // A partly written record at the end (power loss) is not counted and gets overwritten by the next one
+    return (size - sizeof(Header)) / sizeof(Record);
+}
+
+
+bool CDataLog::updateIndex(FILE *_dataFile, FILE *_indexFile, uint32_t _recordCount)
+{
+    if (fseek(_indexFile, 0, SEEK_END) != 0) {
+        return false;
+    }
+
+    uint32_t entries = ftell(_indexFile) / sizeof(IndexEntry);
+    uint32_t expected = (_recordCount + INDEX_STEP - 1) / INDEX_STEP;
+
+    // Normally only the entry of the new record, more if entries got lost
+    for (uint32_t i = entries; i < expected; ++i) {
+        IndexEntry entry;
+        entry.record = i * INDEX_STEP;
+
+        if ((fseek(_dataFile, sizeof(Header) + entry.record * sizeof(Record), SEEK_SET) != 0) ||
+            (fread(&entry.timestamp, sizeof(entry.timestamp), 1, _dataFile) != 1)) {
+            return false;
+        }
+
+        if ((fseek(_indexFile, i * sizeof(IndexEntry), SEEK_SET) != 0) || (fwrite(&entry, sizeof(entry), 1, _indexFile) != 1)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool CDataLog::Append(std::string _file, std::string _name, Record *_record)
+{
+    Header fileHeader;
+    FILE *file = fopen(_file.c_str(), "r+b");
+
+    if (file == NULL) {
+        file = fopen(_file.c_str(), "w+b");
+
+        if (file == NULL) {
+            return false;
+        }
+    }
+
+    if (!readHeader(file, &fileHeader)) {
+        if (countRecords(file) > 0) {
+            fclose(file);       // Not a data log of this version, do not overwrite it
+            return false;
+        }
+
+        memset(&fileHeader, 0, sizeof(fileHeader));
+        fileHeader.magic = MAGIC;
+        fileHeader.version = VERSION;
+        fileHeader.recordSize = sizeof(Record);
+        fileHeader.indexStep = INDEX_STEP;
+        remove(getIndexFileName(_file).c_str());
+    }
+
+    int number = -1;
+
+    for (int i = 0; i < fileHeader.numberCount; ++i) {
+        if (strncmp(fileHeader.names[i], _name.c_str(), MAX_NAME_LENGTH - 1) == 0) {
+            number = i;
+            break;
+        }
+    }
+
+    if (number < 0) {
+        if (fileHeader.numberCount >= MAX_NUMBERS) {
+            fclose(file);
+            return false;
+        }
+
+        number = fileHeader.numberCount++;
+        strncpy(fileHeader.names[number], _name.c_str(), MAX_NAME_LENGTH - 1);
+        fileHeader.names[number][MAX_NAME_LENGTH - 1] = '\0';
+
+        if ((fseek(file, 0, SEEK_SET) != 0) || (fwrite(&fileHeader, sizeof(fileHeader), 1, file) != 1)) {
+            fclose(file);
+            return false;
+        }
+    }
+
+    uint32_t count = countRecords(file);
+
+    _record->number = number;
+    _record->check = calcCheck(_record);
+
+    if ((fseek(file, sizeof(Header) + count * sizeof(Record), SEEK_SET) != 0) || (fwrite(_record, sizeof(Record), 1, file) != 1)) {
+        fclose(file);
+        return false;
+    }
+
+    bool ret = true;
+
+    if ((count + 1) % INDEX_STEP == 1) {   // First record of a new index step
+        fflush(file);
+        std::string indexName = getIndexFileName(_file);
+        FILE *index = fopen(indexName.c_str(), "r+b");
+
+        if (index == NULL) {
+            index = fopen(indexName.c_str(), "w+b");
+        }
+
+        ret = (index != NULL) && updateIndex(file, index, count + 1);
+
+        if (index != NULL) {
+            fclose(index);
+        }
+    }
+
+    fclose(file);
+    return ret;
+}
+
+
+bool CDataLog::Open(std::string _file)
+{
+    Close();
+
+    dataFile = fopen(_file.c_str(), "rb");
+
+    if (dataFile == NULL) {
+        return false;
+    }
+
+    if (!readHeader(dataFile, &header)) {
+        Close();
+        return false;
+    }
+
+    recordCount = countRecords(dataFile);
+    position = -1;
+
+    // Without index FindFirst() does the binary search on the records
+    indexFile = fopen(getIndexFileName(_file).c_str(), "rb");
+
+    return true;
+}
+
+
+void CDataLog::Close()
+{
+    if (dataFile != NULL) {
+        fclose(dataFile);
+        dataFile = NULL;
+    }
+
+    if (indexFile != NULL) {
+        fclose(indexFile);
+        indexFile = NULL;
+    }
+
+    recordCount = 0;
+    position = -1;
+}
+
+
+std::string CDataLog::getName(int _number)
+{
+    if ((_number < 0) || (_number >= header.numberCount)) {
+        return "";
+    }
+
+    return std::string(header.names[_number], strnlen(header.names[_number], MAX_NAME_LENGTH));
+}
+
+
+int CDataLog::getNumber(std::string _name)
+{
+    for (int i = 0; i < header.numberCount; ++i) {
+        if (getName(i) == _name) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+uint32_t CDataLog::FindFirst(uint32_t _from)
+{
+    if (dataFile == NULL) {
+        return 0;
+    }
+
+    uint32_t low = 0;               // First record which can be >= _from
+    uint32_t high = recordCount;    // All records from here on are >= _from
+    uint32_t entries = 0;
+
+    if ((indexFile != NULL) && (fseek(indexFile, 0, SEEK_END) == 0)) {
+        entries = ftell(indexFile) / sizeof(IndexEntry);
+        uint32_t expected = (recordCount + header.indexStep - 1) / header.indexStep;
+        entries = (entries < expected) ? entries : expected;
+    }
+
+    if (entries > 0) {
+        // Last index entry < _from, the searched record is within the following step
+        uint32_t first = 0, last = entries;
+
+        while (first < last) {
+            uint32_t mid = first + (last - first) / 2;
+            IndexEntry entry;
+
+            if ((fseek(indexFile, mid * sizeof(IndexEntry), SEEK_SET) != 0) || (fread(&entry, sizeof(entry), 1, indexFile) != 1)) {
+                entries = 0;
+                break;
+            }
+
+            if (entry.timestamp < _from) {
+                first = mid + 1;
+            }
+            else {
+                last = mid;
+            }
+        }
+
+        if (entries > 0) {
+            low = (first > 0) ? (first - 1) * header.indexStep : 0;
+            high = (first < entries) ? first * header.indexStep : recordCount;
+            high = (high < recordCount) ? high : recordCount;
+        }
+    }
+
+    // Binary search over the timestamps of the records, only over one index step if the index could be used
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        uint32_t timestamp;
+
+        if ((fseek(dataFile, sizeof(Header) + mid * sizeof(Record), SEEK_SET) != 0) ||
+            (fread(&timestamp, sizeof(timestamp), 1, dataFile) != 1)) {
+            break;
+        }
+
+        if (timestamp < _from) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    position = -1;
+    return low;
+}
+
+
+bool CDataLog::Read(uint32_t _recordNo, Record *_record)
+{
+    if ((dataFile == NULL) || (_recordNo >= recordCount)) {
+        return false;
+    }
+
+    long offset = sizeof(Header) + _recordNo * sizeof(Record);
+
+    if ((offset != position) && (fseek(dataFile, offset, SEEK_SET) != 0)) {
+        position = -1;
+        return false;
+    }
+
+    if (fread(_record, sizeof(Record), 1, dataFile) != 1) {
+        position = -1;
+        return false;
+    }
+
+    position = offset + sizeof(Record);
+
+    return (_record->check == calcCheck(_record)) && (_record->number < header.numberCount);
+}
+
+
+static int appendValue(char *_buffer, size_t _size, int _len, bool _valid, double _value, int _decimals)
+{
+    if ((_len < 0) || ((size_t)_len >= _size)) {
+        return _len;
+    }
+
+    if (!_valid) {
+        return _len + snprintf(_buffer + _len, _size - _len, ",");
+    }
+
+    if (_decimals > 0) {
+        return _len + snprintf(_buffer + _len, _size - _len, ",%.*f", _decimals, _value);
+    }
+
+    return _len + snprintf(_buffer + _len, _size - _len, ",%lld", (long long)_value);  // Same as RundeOutput()
+}
+
+
+static const char *errorText(uint16_t _flags)
+{
+    if (_flags & CDataLog::FLAG_NEG_RATE) {
+        return "Neg. Rate";
+    }
+
+    if (_flags & CDataLog::FLAG_RATE_TOO_HIGH) {
+        return "Rate too high";
+    }
+
+    if (_flags & CDataLog::FLAG_NO_ERROR) {
+        return "no error";
+    }
+
+    return "";
+}
+
+
+int CDataLog::FormatCSV(const Record *_record, std::string _name, const char *_timeFormat, char *_buffer, size_t _bufferSize)
+{
+    char timeString[40];
+    char raw[RAW_LENGTH];
+    time_t timestamp = _record->timestamp;
+
+    strftime(timeString, sizeof(timeString), _timeFormat, localtime(&timestamp));
+    memcpy(raw, _record->raw, RAW_LENGTH);
+    raw[RAW_LENGTH - 1] = '\0';
+
+    int len = snprintf(_buffer, _bufferSize, "%s,%s,%s", timeString, _name.c_str(), raw);
+    len = appendValue(_buffer, _bufferSize, len, _record->flags & FLAG_VALUE, _record->value, _record->decimals);
+    len = appendValue(_buffer, _bufferSize, len, _record->flags & FLAG_PREVALUE, _record->preValue, _record->decimals);
+    len = appendValue(_buffer, _bufferSize, len, _record->flags & FLAG_RATE, _record->rate, 6);
+    len = appendValue(_buffer, _bufferSize, len, _record->flags & FLAG_CHANGE, _record->changeAbsolute, _record->decimals);
+
+    if ((len >= 0) && ((size_t)len < _bufferSize)) {
+        len += snprintf(_buffer + len, _bufferSize - len, ",%s", errorText(_record->flags));
+    }
+
+    for (int i = 0; (i < _record->digitCount + _record->analogCount) && (i < MAX_ROIS); ++i) {
+        if ((len < 0) || ((size_t)len >= _bufferSize)) {
+            break;
+        }
+
+        if (_record->roi[i] == ROI_NAN) {
+            len += snprintf(_buffer + len, _bufferSize - len, ",N");
+        }
+        else if ((i < _record->digitCount) && !(_record->flags & FLAG_DIGIT_DECIMALS)) {
+            len += snprintf(_buffer + len, _bufferSize - len, ",%d", _record->roi[i] / 10);
+        }
+        else {
+            len += snprintf(_buffer + len, _bufferSize - len, ",%.1f", _record->roi[i] / 10.0);
+        }
+    }
+
+    return ((len >= 0) && ((size_t)len < _bufferSize)) ? len : (int)_bufferSize - 1;
+}
+
+
+static int appendJSONValue(char *_buffer, size_t _size, int _len, const char *_key, bool _valid, double _value, int _decimals)
+{
+    if ((_len < 0) || ((size_t)_len >= _size)) {
+        return _len;
+    }
+
+    if (!_valid) {
+        return _len + snprintf(_buffer + _len, _size - _len, ",\"%s\":null", _key);
+    }
+
+    return _len + snprintf(_buffer + _len, _size - _len, ",\"%s\":%.*f", _key, _decimals, _value);
+}
+
+
+std::string CDataLog::EscapeJSON(std::string _text)
+{
+    std::string escaped;
+
+    for (size_t i = 0; i < _text.length(); ++i) {
+        if ((_text[i] == '"') || (_text[i] == '\\')) {
+            escaped += '\\';
+        }
+        else if ((unsigned char)_text[i] < 0x20) {
+            continue;
+        }
+
+        escaped += _text[i];
+    }
+
+    return escaped;
+}
+
+
+int CDataLog::FormatJSON(const Record *_record, std::string _name, const char *_timeFormat, char *_buffer, size_t _bufferSize)
+{
+    char timeString[40];
+    char raw[RAW_LENGTH];
+    time_t timestamp = _record->timestamp;
+
+    strftime(timeString, sizeof(timeString), _timeFormat, localtime(&timestamp));
+    memcpy(raw, _record->raw, RAW_LENGTH);
+    raw[RAW_LENGTH - 1] = '\0';
+
+    int len = snprintf(_buffer, _bufferSize, "{\"time\":\"%s\",\"timestamp\":%lu,\"name\":\"%s\",\"raw\":\"%s\"",
+                       timeString, (unsigned long)_record->timestamp, EscapeJSON(_name).c_str(), EscapeJSON(raw).c_str());
+    len = appendJSONValue(_buffer, _bufferSize, len, "value", _record->flags & FLAG_VALUE, _record->value, _record->decimals);
+    len = appendJSONValue(_buffer, _bufferSize, len, "pre", _record->flags & FLAG_PREVALUE, _record->preValue, _record->decimals);
+    len = appendJSONValue(_buffer, _bufferSize, len, "rate", _record->flags & FLAG_RATE, _record->rate, 6);
+    len = appendJSONValue(_buffer, _bufferSize, len, "change", _record->flags & FLAG_CHANGE, _record->changeAbsolute, _record->decimals);
+
+    if ((len >= 0) && ((size_t)len < _bufferSize)) {
+        len += snprintf(_buffer + len, _bufferSize - len, ",\"error\":\"%s\",\"rois\":[", errorText(_record->flags));
+    }
+
+    for (int i = 0; (i < _record->digitCount + _record->analogCount) && (i < MAX_ROIS); ++i) {
+        if ((len < 0) || ((size_t)len >= _bufferSize)) {
+            break;
+        }
+
+        const char *separator = (i > 0) ? "," : "";
+
+        if (_record->roi[i] == ROI_NAN) {
+            len += snprintf(_buffer + len, _bufferSize - len, "%snull", separator);
+        }
+        else {
+            len += snprintf(_buffer + len, _bufferSize - len, "%s%.1f", separator, _record->roi[i] / 10.0);
+        }
+    }
+
+    if ((len >= 0) && ((size_t)len < _bufferSize)) {
+        len += snprintf(_buffer + len, _bufferSize - len, "]}");
+    }
+
+    if ((len < 0) || ((size_t)len >= _bufferSize)) {
+        if (_bufferSize > 0) {
+            _buffer[0] = '\0';
+        }
+        return 0;
+    }
+
+    return len;
+}
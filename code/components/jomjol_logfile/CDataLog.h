@@ -0,0 +1,135 @@
+#pragma once
+
+#ifndef CDATALOG_H
+#define CDATALOG_H
+
+#include <string>
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Binary data log
+ * One file per day with a fixed-size header (names of the numbers) followed by fixed-size records,
+ * appended in time order. A sparse index file next to it (same name, extension ".idx") holds the
+ * timestamp of every INDEX_STEP-th record, so the first record of a time range is found with a
+ * binary search over the index and a short scan instead of reading the whole file.
+ * A record or index entry which got lost by a crash while writing gets detected (check value) or
+ * re-created on the next append.
+ * The class only uses the C/C++ standard library.
+ */
+class CDataLog
+{
+public:
+    static const uint32_t MAGIC = 0x474F4C44;   // "DLOG"
+    static const uint16_t VERSION = 1;
+    static const int MAX_NUMBERS = 15;
+    static const int MAX_NAME_LENGTH = 32;      // Including the terminating zero
+    static const int MAX_ROIS = 16;
+    static const int RAW_LENGTH = 16;           // Including the terminating zero
+    static const uint32_t INDEX_STEP = 64;
+    static const int16_t ROI_NAN = INT16_MIN;   // ROI without result ("N")
+
+    enum Flags {
+        FLAG_VALUE          = 0x0001,   // value is valid
+        FLAG_PREVALUE       = 0x0002,   // preValue is valid
+        FLAG_RATE           = 0x0004,   // rate is valid
+        FLAG_CHANGE         = 0x0008,   // changeAbsolute is valid
+        FLAG_NO_ERROR       = 0x0010,   // Consistency checks passed ("no error")
+        FLAG_NEG_RATE       = 0x0020,   // Error: negative rate
+        FLAG_RATE_TOO_HIGH  = 0x0040,   // Error: rate too high
+        FLAG_DIGIT_DECIMALS = 0x0080,   // Digit ROIs have one decimal (Digit100 models)
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;
+        uint16_t indexStep;
+        uint16_t numberCount;
+        uint8_t reserved[4];
+        char names[MAX_NUMBERS][MAX_NAME_LENGTH];
+        uint8_t padding[16];
+    };
+
+    struct Record {
+        uint32_t timestamp;                 // Unix time of the reading
+        uint8_t number;                     // Index of the name in the header
+        uint8_t decimals;                   // Decimal places of value, preValue and changeAbsolute
+        uint16_t flags;
+        double value;
+        double preValue;
+        double rate;                        // Change per minute
+        double changeAbsolute;
+        char raw[RAW_LENGTH];               // Raw value incl. leading zeros and "N"
+        uint8_t digitCount;
+        uint8_t analogCount;
+        uint16_t reserved;
+        int16_t roi[MAX_ROIS];              // Digit ROIs followed by analog ROIs, in 1/10
+        uint32_t check;
+    };
+
+    struct IndexEntry {
+        uint32_t timestamp;
+        uint32_t record;
+    };
+
+protected:
+    FILE *dataFile;
+    FILE *indexFile;
+    Header header;
+    uint32_t recordCount;
+    long position;                          // File position after the last read, to avoid seeks while reading in sequence
+
+    static uint32_t calcCheck(const Record *_record);
+    static bool readHeader(FILE *_file, Header *_header);
+    static uint32_t countRecords(FILE *_file);
+    static bool updateIndex(FILE *_dataFile, FILE *_indexFile, uint32_t _recordCount);
+
+public:
+    CDataLog();
+    ~CDataLog();
+
+    static std::string getIndexFileName(std::string _dataFile);
+    static void ClearRecord(Record *_record);
+
+    /* ROI results as written by ClassFlowCNNGeneral::getReadoutRawString() (",1,2,N" / ",3.4,5.6") */
+    static void SetROIs(Record *_record, std::string _digits, std::string _analogs);
+
+    /**
+     * Append a record to a day file, the file and its index get created if needed
+     * @param _name name of the number, gets added to the header if not yet known
+     * @return false if the file can not be written or the header has no room for another name
+     */
+    static bool Append(std::string _file, std::string _name, Record *_record);
+
+    /* Reading */
+    bool Open(std::string _file);
+    void Close();
+    bool isOpen() { return dataFile != NULL; };
+    uint32_t getRecordCount() { return recordCount; };
+    std::string getName(int _number);
+    int getNumber(std::string _name);       // -1 if the name is not in the file
+
+    /* Number of the first record with a timestamp >= _from, getRecordCount() if there is none */
+    uint32_t FindFirst(uint32_t _from);
+
+    /* false at the end of the file or if the record is damaged */
+    bool Read(uint32_t _recordNo, Record *_record);
+
+    /**
+     * Format a record like a line of the CSV data log (without line end)
+     * @param _timeFormat strftime format of the timestamp (local time)
+     * @return length of the line, it is cut if _bufferSize is too small
+     */
+    static int FormatCSV(const Record *_record, std::string _name, const char *_timeFormat, char *_buffer, size_t _bufferSize);
+
+    /* Same as a JSON object, a cut object would be invalid: 0 and an empty string if _bufferSize is too small */
+    static int FormatJSON(const Record *_record, std::string _name, const char *_timeFormat, char *_buffer, size_t _bufferSize);
+
+    /* Content of a JSON string: quotes and backslashes escaped, control characters removed */
+    static std::string EscapeJSON(std::string _text);
+};
+
+#endif //CDATALOG_H
@@ -0,0 +1,150 @@
+#include "CDataLogQuery.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+CDataLogQuery::CDataLogQuery()
+{
+    Init(0, UINT32_MAX, 0);
+}
+
+
+void CDataLogQuery::Init(uint32_t _from, uint32_t _to, uint32_t _interval)
+{
+    from = _from;
+    to = _to;
+    interval = _interval;
+    pending = false;
+    bucketCount = 0;
+    valueCount = 0;
+    memset(&bucket, 0, sizeof(bucket));
+}
+
+
+bool CDataLogQuery::Add(uint32_t _timestamp, double _value, Bucket *_done)
+{
+    if ((_timestamp < from) || (_timestamp > to)) {
+        return false;
+    }
+
+    uint32_t start = (interval > 0) ? from + ((_timestamp - from) / interval) * interval : _timestamp;
+    bool completed = false;
+
+    valueCount++;
+
+    // A value older than the current bucket (clock set back) is added to the current bucket
+    if (pending && (start > bucket.start)) {
+        *_done = bucket;
+        bucketCount++;
+        pending = false;
+        completed = true;
+    }
+
+    if (!pending) {
+        bucket.start = start;
+        bucket.count = 0;
+        bucket.min = _value;
+        bucket.max = _value;
+        bucket.sum = 0;
+        pending = true;
+    }
+
+    bucket.count++;
+    bucket.sum += _value;
+    bucket.last = _value;
+
+    if (_value < bucket.min) {
+        bucket.min = _value;
+    }
+
+    if (_value > bucket.max) {
+        bucket.max = _value;
+    }
+
+    return completed;
+}
+
+
+bool CDataLogQuery::Finish(Bucket *_done)
+{
+    if (!pending) {
+        return false;
+    }
+
+    *_done = bucket;
+    bucketCount++;
+    pending = false;
+
+    return true;
+}
+
+
+bool CDataLogQuery::ParseCSVLine(const char *_line, std::string _number, uint32_t *_timestamp, double *_value)
+{
+    // time,name,raw,value,...
+    const char *name = strchr(_line, ',');
+    const char *raw = name ? strchr(name + 1, ',') : NULL;
+    const char *value = raw ? strchr(raw + 1, ',') : NULL;
+
+    if (value == NULL) {
+        return false;
+    }
+
+    name++;
+    value++;
+
+    if (!_number.empty() && ((size_t)(raw - name) != _number.length() || (strncmp(name, _number.c_str(), raw - name) != 0))) {
+        return false;
+    }
+
+    char *end;
+    *_value = strtod(value, &end);
+
+    if ((end == value) || ((*end != ',') && (*end != '\0') && (*end != '\r') && (*end != '\n'))) {
+        return false;   // Empty (no valid value)
+    }
+
+    struct tm tm = {};
+
+    if (sscanf(_line, "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+        return false;
+    }
+
+    // Written in local time
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    time_t timestamp = mktime(&tm);
+
+    if (timestamp < 0) {
+        return false;
+    }
+
+    *_timestamp = timestamp;
+    return true;
+}
+
+
+int CDataLogQuery::FormatBucket(const Bucket *_bucket, bool _json, const char *_timeFormat, char *_buffer, size_t _bufferSize)
+{
+    char timeString[40];
+    time_t start = _bucket->start;
+    double avg = (_bucket->count > 0) ? _bucket->sum / _bucket->count : 0;
+    int len;
+
+    strftime(timeString, sizeof(timeString), _timeFormat, localtime(&start));
+
+    if (_json) {
+        len = snprintf(_buffer, _bufferSize, "{\"time\":\"%s\",\"timestamp\":%lu,\"count\":%lu,\"min\":%.12g,\"max\":%.12g,\"avg\":%.12g,\"last\":%.12g}",
+                       timeString, (unsigned long)_bucket->start, (unsigned long)_bucket->count, _bucket->min, _bucket->max, avg, _bucket->last);
+    }
+    else {
+        len = snprintf(_buffer, _bufferSize, "%s,%lu,%.12g,%.12g,%.12g,%.12g",
+                       timeString, (unsigned long)_bucket->count, _bucket->min, _bucket->max, avg, _bucket->last);
+    }
+
+    return ((len >= 0) && ((size_t)len < _bufferSize)) ? len : (int)_bufferSize - 1;
+}
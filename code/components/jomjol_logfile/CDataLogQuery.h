@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef CDATALOGQUERY_H
+#define CDATALOGQUERY_H
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Aggregation of data log values into time buckets (min/max/avg per bucket)
+ * The values are given in time order, only the current bucket is kept in memory, a completed one
+ * is handed out right away. The buckets start at "from" and have a fixed length, buckets without
+ * values are skipped. A length of 0 hands out every value as its own bucket.
+ * The class only uses the C/C++ standard library.
+ */
+class CDataLogQuery
+{
+public:
+    struct Bucket {
+        uint32_t start;         // Start of the bucket (length 0: time of the value)
+        uint32_t count;
+        double min;
+        double max;
+        double sum;
+        double last;            // Most recent value of the bucket
+    };
+
+protected:
+    uint32_t from;
+    uint32_t to;
+    uint32_t interval;
+    Bucket bucket;
+    bool pending;               // bucket holds values
+    uint32_t bucketCount;       // Handed out buckets
+    uint32_t valueCount;
+
+public:
+    CDataLogQuery();
+
+    void Init(uint32_t _from, uint32_t _to, uint32_t _interval);
+
+    /**
+     * Add a value, values outside of the time range are ignored
+     * @return true if a bucket got completed, it is copied to _done
+     */
+    bool Add(uint32_t _timestamp, double _value, Bucket *_done);
+
+    /* Hand out the last bucket, false if there is none */
+    bool Finish(Bucket *_done);
+
+    uint32_t getBucketCount() { return bucketCount; };
+    uint32_t getValueCount() { return valueCount; };
+
+    /**
+     * Parse a line of the CSV data log (see ClassLogFile::WriteToData())
+     * @param _number only lines of this number are used, all if empty
+     * @return false if the line is not of _number or has no valid value
+     */
+    static bool ParseCSVLine(const char *_line, std::string _number, uint32_t *_timestamp, double *_value);
+
+    /* Bucket as CSV line (time,count,min,max,avg,last) or JSON object, returns the length (cut if the buffer is too small) */
+    static int FormatBucket(const Bucket *_bucket, bool _json, const char *_timeFormat, char *_buffer, size_t _bufferSize);
+};
+
+#endif //CDATALOGQUERY_H
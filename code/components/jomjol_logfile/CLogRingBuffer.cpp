@@ -0,0 +1,132 @@
+#include "CLogRingBuffer.h"
+
+#include <string.h>
+#include <algorithm>
+
+
+CLogRingBuffer::CLogRingBuffer()
+{
+    header = NULL;
+    data = NULL;
+}
+
+
+uint32_t CLogRingBuffer::calcCheck()
+{
+    return ~(header->magic ^ header->size ^ (header->head << 1) ^ (header->tail << 2) ^ (header->dropped << 3));
+}
+
+
+bool CLogRingBuffer::Attach(void *_memory, size_t _size)
+{
+    if ((_memory == NULL) || (_size <= sizeof(Header) + 1)) {
+        header = NULL;
+        data = NULL;
+        return false;
+    }
+
+    header = (Header *)_memory;
+    data = (char *)_memory + sizeof(Header);
+    uint32_t size = _size - sizeof(Header);
+
+    if ((header->magic == MAGIC) && (header->size == size) && (header->head < size) && (header->tail < size) && 
+            (header->check == calcCheck())) {
+        return true;
+    }
+
+    header->magic = MAGIC;
+    header->size = size;
+    header->dropped = 0;
+    Clear();
+    return false;
+}
+
+
+size_t CLogRingBuffer::getUsed()
+{
+    if (header == NULL) {
+        return 0;
+    }
+
+    return (header->head + header->size - header->tail) % header->size;
+}
+
+
+bool CLogRingBuffer::Push(const char *_line, size_t _len)
+{
+    if (header == NULL) {
+        return false;
+    }
+
+    if (_len > getFree()) {
+        header->dropped++;
+        updateCheck();
+        return false;
+    }
+
+    size_t first = header->size - header->head;
+
+    if (_len <= first) {
+        memcpy(data + header->head, _line, _len);
+    }
+    else { // Wraps around
+        memcpy(data + header->head, _line, first);
+        memcpy(data, _line + first, _len - first);
+    }
+
+    // Only now the line becomes visible, a reset while copying does not leave a partial line
+    header->head = (header->head + _len) % header->size;
+    updateCheck();
+    return true;
+}
+
+
+size_t CLogRingBuffer::Peek(const char **_data)
+{
+    if (header == NULL) {
+        *_data = NULL;
+        return 0;
+    }
+
+    *_data = data + header->tail;
+
+    if (header->head >= header->tail) {
+        return header->head - header->tail;
+    }
+
+    return header->size - header->tail; // Up to the end, the rest follows with the next Peek()
+}
+
+
+void CLogRingBuffer::Consume(size_t _len)
+{
+    if (header == NULL) {
+        return;
+    }
+
+    header->tail = (header->tail + std::min(_len, getUsed())) % header->size;
+    updateCheck();
+}
+
+
+void CLogRingBuffer::Clear()
+{
+    if (header == NULL) {
+        return;
+    }
+
+    header->head = 0;
+    header->tail = 0;
+    updateCheck();
+}
+
+
+void CLogRingBuffer::ResetDropped()
+{
+    if (header == NULL) {
+        return;
+    }
+
+    header->dropped = 0;
+    updateCheck();
+}
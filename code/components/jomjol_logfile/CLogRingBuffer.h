@@ -0,0 +1,61 @@
+#pragma once
+
+#ifndef CLOGRINGBUFFER_H
+#define CLOGRINGBUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Byte ring buffer for log lines.
+ * A line is either stored completely or dropped (counted), the reader takes contiguous chunks.
+ * The state lives in the given memory (header + data), so the content survives a software reset
+ * or panic if that memory is not initialized at boot (.noinit) and can be written after the reboot.
+ * The class has no ESP dependencies, the caller is responsible for locking.
+ */
+class CLogRingBuffer
+{
+    public:
+        struct Header {
+            uint32_t magic;
+            uint32_t size;      // Size of the data part
+            uint32_t head;      // Write position
+            uint32_t tail;      // Read position
+            uint32_t dropped;   // Dropped lines since last ResetDropped()
+            uint32_t check;     // Consistency check of the values above
+        };
+
+        static const uint32_t MAGIC = 0x424C4F47; // "GOLB"
+
+    protected:
+        Header *header;
+        char *data;
+
+        uint32_t calcCheck();
+        void updateCheck() { header->check = calcCheck(); };
+
+    public:
+        CLogRingBuffer();
+
+        /**
+         * Use _memory for header and data.
+         * @return true if it already holds a consistent buffer (content from before a reset is kept),
+         *         false if it got initialized empty
+         */
+        bool Attach(void *_memory, size_t _size);
+
+        bool Push(const char *_line, size_t _len);  // false if it does not fit (line gets counted as dropped)
+        size_t Peek(const char **_data);            // Contiguous pending bytes from the read position
+        void Consume(size_t _len);
+        void Clear();
+
+        bool isAttached() { return header != NULL; };
+        size_t getSize() { return header ? header->size - 1 : 0; }; // One byte stays free to tell full from empty
+        size_t getUsed();
+        size_t getFree() { return getSize() - getUsed(); };
+        uint32_t getDropped() { return header ? header->dropped : 0; };
+        void ResetDropped();
+};
+
+#endif //CLOGRINGBUFFER_H
@@ -0,0 +1,315 @@
+#include "CRetentionSweeper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <dirent.h>
+#ifdef __cplusplus
+}
+#endif
+
+
+enum {
+    TREE_BUDGET_USED = 0,   // Budget used up, continue with the next tick
+    TREE_DELETED = 1,
+    TREE_FAILED = -1,       // Something in it can not be deleted
+};
+
+
+CRetentionSweeper::CRetentionSweeper()
+{
+    stats.deletedFiles = 0;
+    stats.deletedFolders = 0;
+    stats.bytesReclaimed = 0;
+    stats.passes = 0;
+    stats.pendingJob = 0;
+    stats.current = "";
+    passDeletes = 0;
+}
+
+
+void CRetentionSweeper::SetJob(std::string _directory, std::string _nameFormat, unsigned short _retentionDays, bool _folders, std::string _keep)
+{
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (jobs[i].directory == _directory) {
+            jobs[i].nameFormat = _nameFormat;
+            jobs[i].retentionDays = _retentionDays;
+            jobs[i].folders = _folders;
+            jobs[i].keep = _keep;
+            return;
+        }
+    }
+
+    Job job;
+    job.directory = _directory;
+    job.nameFormat = _nameFormat;
+    job.retentionDays = _retentionDays;
+    job.folders = _folders;
+    job.keep = _keep;
+    jobs.push_back(job);
+}
+
+
+void CRetentionSweeper::SetCursorFile(std::string _cursorFile)
+{
+    cursorFile = _cursorFile;
+
+    FILE *file = fopen(cursorFile.c_str(), "r");
+    if (file == NULL) {
+        return;
+    }
+
+    char line[300];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *value = strchr(line, '=');
+        if (value == NULL) {
+            continue;
+        }
+        *value++ = '\0';
+        value[strcspn(value, "\r\n")] = '\0';
+
+        if (strcmp(line, "job") == 0) {
+            stats.pendingJob = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(line, "current") == 0) {
+            stats.current = value;
+        }
+        else if (strcmp(line, "files") == 0) {
+            stats.deletedFiles = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(line, "folders") == 0) {
+            stats.deletedFolders = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(line, "bytes") == 0) {
+            stats.bytesReclaimed = strtoull(value, NULL, 10);
+        }
+        else if (strcmp(line, "passes") == 0) {
+            stats.passes = strtoul(value, NULL, 10);
+        }
+    }
+    fclose(file);
+}
+
+
+void CRetentionSweeper::saveCursor()
+{
+    if (cursorFile.empty()) {
+        return;
+    }
+
+    FILE *file = fopen(cursorFile.c_str(), "w");
+    if (file == NULL) {
+        return;
+    }
+
+    fprintf(file, "job=%lu\ncurrent=%s\nfiles=%lu\nfolders=%lu\nbytes=%llu\npasses=%lu\n",
+            (unsigned long)stats.pendingJob, stats.current.c_str(), (unsigned long)stats.deletedFiles,
+            (unsigned long)stats.deletedFolders, (unsigned long long)stats.bytesReclaimed, (unsigned long)stats.passes);
+    fclose(file);
+}
+
+
+std::string CRetentionSweeper::getCutoffName(Job *_job, time_t _now)
+{
+    struct tm timeinfo = *localtime(&_now);
+    char name[64];
+
+    // Same as the former RemoveOld...() functions: today counts as the first day
+    timeinfo.tm_mday -= _job->retentionDays - 1;
+    timeinfo.tm_isdst = -1;
+    mktime(&timeinfo);
+
+    strftime(name, sizeof(name), _job->nameFormat.c_str(), &timeinfo);
+    return std::string(name);
+}
+
+
+/* Text after the last conversion of the format (e.g. ".csv"), it is not part of the date */
+size_t CRetentionSweeper::getSuffixLength(Job *_job)
+{
+    size_t conversion = _job->nameFormat.rfind('%');
+
+    if ((conversion == std::string::npos) || (conversion + 2 > _job->nameFormat.length())) {
+        return 0;
+    }
+
+    return _job->nameFormat.length() - (conversion + 2);
+}
+
+
+bool CRetentionSweeper::deleteFile(std::string _path)
+{
+    struct stat fileStat;
+    off_t size = (stat(_path.c_str(), &fileStat) == 0) ? fileStat.st_size : 0;
+
+    if (unlink(_path.c_str()) != 0) {
+        return false;
+    }
+
+    stats.deletedFiles++;
+    stats.bytesReclaimed += size;
+    passDeletes++;
+    return true;
+}
+
+
+int CRetentionSweeper::deleteTree(std::string _path, int *_budget)
+{
+    DIR *dir = opendir(_path.c_str());
+
+    if (dir == NULL) {
+        struct stat folderStat;
+        return (stat(_path.c_str(), &folderStat) != 0) ? TREE_DELETED : TREE_FAILED;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) {
+            continue;
+        }
+
+        std::string path = _path + "/" + entry->d_name;
+
+        if (entry->d_type == DT_DIR) {
+            if (deleteTree(path, _budget) == TREE_BUDGET_USED) {
+                closedir(dir);
+                return TREE_BUDGET_USED;
+            }
+        }
+        else {
+            if (*_budget <= 0) {
+                closedir(dir);
+                return TREE_BUDGET_USED;
+            }
+
+            (*_budget)--; // Also a failed attempt, an undeletable file must not block the tick
+            deleteFile(path);
+        }
+    }
+    closedir(dir);
+
+    if (rmdir(_path.c_str()) != 0) {
+        return TREE_FAILED;
+    }
+
+    stats.deletedFolders++;
+    passDeletes++;
+    return TREE_DELETED;
+}
+
+
+bool CRetentionSweeper::sweepJob(Job *_job, time_t _now, int *_budget)
+{
+    if (_job->retentionDays == 0) {
+        return true;
+    }
+
+    std::string cutoff = getCutoffName(_job, _now);
+    size_t dateLength = cutoff.length() - std::min(getSuffixLength(_job), cutoff.length());
+    DIR *dir = opendir(_job->directory.c_str());
+
+    if (dir == NULL) {
+        return true;
+    }
+
+    bool done = true;
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        std::string name = entry->d_name;
+        std::string path = _job->directory + "/" + name;
+
+        // Only the date gets compared, so files of one day with other extensions (e.g. .bin, .idx) go together
+        if ((name.length() != cutoff.length()) || (name.compare(0, dateLength, cutoff, 0, dateLength) >= 0) || (name == _job->keep) ||
+            ((entry->d_type == DT_DIR) != _job->folders) ||
+            (std::find(failed.begin(), failed.end(), path) != failed.end())) {
+            continue;
+        }
+
+        if (*_budget <= 0) {
+            done = false;
+            break;
+        }
+
+        if (_job->folders) {
+            // Gets deleted step by step by Tick()
+            stats.current = path;
+            saveCursor();
+            done = false;
+            break;
+        }
+
+        (*_budget)--;
+        if (!deleteFile(path)) {
+            failed.push_back(path);
+        }
+    }
+    closedir(dir);
+
+    return done;
+}
+
+
+bool CRetentionSweeper::Tick(int _maxDeletes, time_t _now)
+{
+    int budget = _maxDeletes;
+
+    while (budget > 0) {
+        if (!stats.current.empty()) {
+            int result = deleteTree(stats.current, &budget);
+
+            if (result == TREE_BUDGET_USED) {
+                break;
+            }
+
+            if (result == TREE_FAILED) {
+                failed.push_back(stats.current);
+            }
+
+            stats.current = "";
+            saveCursor();
+            continue;
+        }
+
+        if (stats.pendingJob >= jobs.size()) {
+            // Pass completed
+            stats.pendingJob = 0;
+            stats.passes++;
+            failed.clear();
+
+            if (passDeletes > 0) {
+                passDeletes = 0;
+                saveCursor();
+            }
+
+            return false;
+        }
+
+        if (sweepJob(&jobs[stats.pendingJob], _now, &budget)) {
+            stats.pendingJob++;
+        }
+    }
+
+    return true;
+}
+
+
+std::string CRetentionSweeper::getStatus()
+{
+    char status[300];
+
+    snprintf(status, sizeof(status), "%lu passes, %lu files and %lu folders deleted, %llu kB reclaimed%s%s",
+             (unsigned long)stats.passes, (unsigned long)stats.deletedFiles, (unsigned long)stats.deletedFolders,
+             (unsigned long long)(stats.bytesReclaimed / 1024),
+             stats.current.empty() ? "" : ", in progress: ", stats.current.c_str());
+
+    return std::string(status);
+}
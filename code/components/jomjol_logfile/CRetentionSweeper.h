@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef CRETENTIONSWEEPER_H
+#define CRETENTIONSWEEPER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <time.h>
+
+
+/**
+ * Incremental removal of old log files and image folders
+ * Each job is a directory whose entries are named by date (strftime format). Entries of the same
+ * name length whose date part sorts before the date "retention days ago" get deleted, folders with all
+ * their content. The text after the date (e.g. ".csv") is not compared, so other extensions of the same
+ * length are covered as well.
+ * Tick() deletes at most a given number of files and folders, so the work is spread over many short
+ * steps. The folder in progress and the totals are kept in a cursor file, a pass interrupted by a reboot
+ * continues there.
+ * The class only uses the C/C++ standard library and POSIX file functions, the caller is responsible for locking.
+ */
+class CRetentionSweeper
+{
+public:
+    struct Job {
+        std::string directory;
+        std::string nameFormat;         // strftime format of the entry names, e.g. "log_%Y-%m-%d.txt"
+        unsigned short retentionDays;   // 0: keep forever
+        bool folders;                   // Entries are folders (e.g. images per day), otherwise files
+        std::string keep;               // Entry which never gets deleted
+    };
+
+    struct Stats {
+        uint32_t deletedFiles;          // Since the cursor file got created
+        uint32_t deletedFolders;
+        uint64_t bytesReclaimed;
+        uint32_t passes;                // Completed passes over all jobs
+        uint32_t pendingJob;            // Job of the current pass
+        std::string current;            // Folder in progress, empty if none
+    };
+
+protected:
+    std::vector<Job> jobs;
+    std::string cursorFile;
+    Stats stats;
+    uint32_t passDeletes;               // Deleted in the current pass
+    std::vector<std::string> failed;    // Can not be deleted, skipped for the rest of the pass
+
+    std::string getCutoffName(Job *_job, time_t _now);
+    size_t getSuffixLength(Job *_job);
+    bool deleteFile(std::string _path);
+    int deleteTree(std::string _path, int *_budget);
+    bool sweepJob(Job *_job, time_t _now, int *_budget); // true if the job has nothing more to delete
+    void saveCursor();
+
+public:
+    CRetentionSweeper();
+
+    /* Add a job or update the one of the same directory */
+    void SetJob(std::string _directory, std::string _nameFormat, unsigned short _retentionDays, bool _folders, std::string _keep = "");
+    std::vector<Job> *GetJobs() { return &jobs; };
+
+    /* Cursor file to continue after a reboot, gets read right away */
+    void SetCursorFile(std::string _cursorFile);
+
+    /**
+     * Delete up to _maxDeletes files or folders
+     * @param _now current time, the retention is counted from its day
+     * @return true if there is more to delete (call again soon), false if the pass is completed
+     */
+    bool Tick(int _maxDeletes, time_t _now);
+
+    Stats getStats() { return stats; };
+    std::string getStatus();
+};
+
+#endif //CRETENTIONSWEEPER_H
@@ -0,0 +1,406 @@
+#include "CStoreForwardQueue.h"
+
+#include <string.h>
+
+
+static_assert(sizeof(CStoreForwardQueue::Header) == 40, "Store-and-forward header must be 40 bytes");
+static_assert(sizeof(CStoreForwardQueue::RecordHeader) == 20, "Store-and-forward record header must be 20 bytes");
+
+#define DATA_OFFSET (2 * sizeof(CStoreForwardQueue::Header))
+
+
+/* FNV-1a */
+static uint32_t check_update(uint32_t _check, const void *_data, size_t _length)
+{
+    const uint8_t *data = (const uint8_t *)_data;
+
+    for (size_t i = 0; i < _length; ++i) {
+        _check = (_check ^ data[i]) * 16777619;
+    }
+
+    return _check;
+}
+
+
+CStoreForwardQueue::CStoreForwardQueue()
+{
+    memset(&header, 0, sizeof(header));
+    slot = 0;
+}
+
+
+uint32_t CStoreForwardQueue::calcHeaderCheck(const Header *_header)
+{
+    return check_update(2166136261u, _header, offsetof(Header, check));
+}
+
+
+uint32_t CStoreForwardQueue::calcRecordCheck(const RecordHeader *_record, const std::string &_key, const std::string &_payload)
+{
+    uint32_t check = check_update(2166136261u, _record, offsetof(RecordHeader, check));
+    check = check_update(check, _key.data(), _key.length());
+    return check_update(check, _payload.data(), _payload.length());
+}
+
+
+bool CStoreForwardQueue::readRing(FILE *_file, uint32_t _position, void *_data, size_t _length)
+{
+    uint8_t *data = (uint8_t *)_data;
+
+    while (_length > 0) {
+        size_t part = header.capacity - _position;     // Up to the end of the data area, then from its start
+        if (part > _length) {
+            part = _length;
+        }
+
+        if ((fseek(_file, DATA_OFFSET + _position, SEEK_SET) != 0) || (fread(data, 1, part, _file) != part)) {
+            return false;
+        }
+
+        data += part;
+        _length -= part;
+        _position = 0;
+    }
+
+    return true;
+}
+
+
+bool CStoreForwardQueue::writeRing(FILE *_file, uint32_t _position, const void *_data, size_t _length)
+{
+    const uint8_t *data = (const uint8_t *)_data;
+
+    while (_length > 0) {
+        size_t part = header.capacity - _position;
+        if (part > _length) {
+            part = _length;
+        }
+
+        if ((fseek(_file, DATA_OFFSET + _position, SEEK_SET) != 0) || (fwrite(data, 1, part, _file) != part)) {
+            return false;
+        }
+
+        data += part;
+        _length -= part;
+        _position = 0;
+    }
+
+    return true;
+}
+
+
+/* _entry NULL: only the size of the message */
+bool CStoreForwardQueue::readRecord(FILE *_file, uint32_t _position, Entry *_entry, uint32_t *_size)
+{
+    RecordHeader record;
+
+    if (!readRing(_file, _position, &record, sizeof(record))) {
+        return false;
+    }
+
+    uint64_t size = (uint64_t)sizeof(record) + record.keyLength + record.payloadLength;
+    if (size > header.used) {
+        return false;
+    }
+
+    *_size = (uint32_t)size;
+
+    if (_entry == NULL) {
+        return true;
+    }
+
+    uint32_t position = (_position + sizeof(record)) % header.capacity;
+    _entry->key.resize(record.keyLength);
+    _entry->payload.resize(record.payloadLength);
+
+    if (!readRing(_file, position, &_entry->key[0], record.keyLength) ||
+        !readRing(_file, (position + record.keyLength) % header.capacity, &_entry->payload[0], record.payloadLength)) {
+        return false;
+    }
+
+    if (calcRecordCheck(&record, _entry->key, _entry->payload) != record.check) {
+        return false;
+    }
+
+    _entry->seq = record.seq;
+    _entry->time = record.time;
+    _entry->options = record.options;
+    return true;
+}
+
+
+bool CStoreForwardQueue::writeHeader(FILE *_file)
+{
+    header.generation++;
+    header.check = calcHeaderCheck(&header);
+    slot = 1 - slot;
+
+    if ((fseek(_file, slot * sizeof(Header), SEEK_SET) != 0) || (fwrite(&header, sizeof(header), 1, _file) != 1)) {
+        return false;
+    }
+
+    return fflush(_file) == 0;
+}
+
+
+bool CStoreForwardQueue::create(uint32_t _capacity)
+{
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.capacity = _capacity;
+    header.nextSeq = 1;
+    header.check = calcHeaderCheck(&header);
+    slot = 0;
+
+    // Both header slots, then the data area gets allocated, so the file does not grow later on
+    bool ok = (fwrite(&header, sizeof(header), 1, file) == 1) && (fwrite(&header, sizeof(header), 1, file) == 1);
+
+    uint8_t zeros[512] = { };
+    for (uint32_t written = 0; ok && (written < _capacity); written += sizeof(zeros)) {
+        size_t part = (_capacity - written < sizeof(zeros)) ? _capacity - written : sizeof(zeros);
+        ok = (fwrite(zeros, 1, part, file) == part);
+    }
+
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+
+bool CStoreForwardQueue::Open(std::string _file, size_t _capacity)
+{
+    Header slots[2];
+    int current = -1;
+
+    fileName = _file;
+
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (file != NULL) {
+        for (int i = 0; i < 2; ++i) {
+            if ((fread(&slots[i], sizeof(Header), 1, file) == 1) && (slots[i].magic == MAGIC) && (slots[i].version == VERSION) &&
+                (slots[i].check == calcHeaderCheck(&slots[i])) && (slots[i].capacity == _capacity) &&
+                (slots[i].used <= slots[i].capacity) && (slots[i].tail < slots[i].capacity) &&
+                ((current < 0) || (slots[i].generation > slots[current].generation))) {
+                current = i;
+            }
+        }
+        fclose(file);
+    }
+
+    if (current < 0) {
+        if (!create(_capacity)) {
+            fileName = "";
+            return false;
+        }
+        return true;
+    }
+
+    header = slots[current];
+    slot = current;
+    return true;
+}
+
+
+bool CStoreForwardQueue::Push(uint32_t _time, std::string _key, std::string _payload, uint8_t _options)
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    uint64_t size = (uint64_t)sizeof(RecordHeader) + _key.length() + _payload.length();
+    if ((_key.length() > UINT16_MAX) || (size > header.capacity)) {
+        return false;
+    }
+
+    FILE *file = fopen(fileName.c_str(), "r+b");
+    if (file == NULL) {
+        return false;
+    }
+
+    bool ok = true;
+    bool dropped = false;
+
+    while (ok && (header.capacity - header.used < size)) {
+        uint32_t oldest;
+
+        if (!readRecord(file, header.tail, NULL, &oldest)) {
+            header.dropped += header.count;     // Damaged, nothing after it can be trusted
+            header.tail = 0;
+            header.used = 0;
+            header.count = 0;
+        }
+        else {
+            header.tail = (header.tail + oldest) % header.capacity;
+            header.used -= oldest;
+            header.count--;
+            header.dropped++;
+        }
+        dropped = true;
+    }
+
+    // The dropped messages get overwritten, so they have to be gone from the header first
+    if (dropped) {
+        ok = writeHeader(file);
+    }
+
+    RecordHeader record = { };
+    record.seq = header.nextSeq;
+    record.time = _time;
+    record.keyLength = (uint16_t)_key.length();
+    record.options = _options;
+    record.payloadLength = (uint32_t)_payload.length();
+    record.check = calcRecordCheck(&record, _key, _payload);
+
+    uint32_t position = (header.tail + header.used) % header.capacity;
+
+    ok = ok && writeRing(file, position, &record, sizeof(record));
+    ok = ok && writeRing(file, (position + sizeof(record)) % header.capacity, _key.data(), _key.length());
+    ok = ok && writeRing(file, (position + sizeof(record) + _key.length()) % header.capacity, _payload.data(), _payload.length());
+
+    if (ok) {
+        header.used += (uint32_t)size;
+        header.count++;
+        header.nextSeq++;
+        ok = writeHeader(file);
+    }
+
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+
+size_t CStoreForwardQueue::Peek(std::vector<Entry> *_entries, size_t _maxEntries)
+{
+    _entries->clear();
+
+    if (!isOpen() || (header.count == 0)) {
+        return 0;
+    }
+
+    FILE *file = fopen(fileName.c_str(), "r+b");
+    if (file == NULL) {
+        return 0;
+    }
+
+    uint32_t position = header.tail;
+    uint32_t read = 0;
+
+    while ((_entries->size() < _maxEntries) && (_entries->size() < header.count)) {
+        Entry entry;
+        uint32_t size;
+
+        if (!readRecord(file, position, &entry, &size) || (size > header.used - read)) {
+            // Keep the messages before the damaged one
+            header.dropped += header.count - (uint32_t)_entries->size();
+            header.count = (uint32_t)_entries->size();
+            header.used = read;
+            writeHeader(file);
+            break;
+        }
+
+        _entries->push_back(entry);
+        position = (position + size) % header.capacity;
+        read += size;
+    }
+
+    fclose(file);
+    return _entries->size();
+}
+
+
+bool CStoreForwardQueue::Pop(size_t _count)
+{
+    if (!isOpen() || (_count == 0)) {
+        return isOpen();
+    }
+
+    FILE *file = fopen(fileName.c_str(), "r+b");
+    if (file == NULL) {
+        return false;
+    }
+
+    if (_count >= header.count) {
+        header.tail = 0;
+        header.used = 0;
+        header.count = 0;
+    }
+    else {
+        for (size_t i = 0; i < _count; ++i) {
+            uint32_t size;
+
+            if (!readRecord(file, header.tail, NULL, &size)) {
+                header.dropped += header.count - (uint32_t)(_count - i);   // The rest was delivered
+                header.tail = 0;
+                header.used = 0;
+                header.count = 0;
+                break;
+            }
+
+            header.tail = (header.tail + size) % header.capacity;
+            header.used -= size;
+            header.count--;
+        }
+    }
+
+    bool ok = writeHeader(file);
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+
+size_t CStoreForwardQueue::Drain(size_t _maxEntries, std::function<bool(const Entry &)> _send)
+{
+    std::vector<Entry> entries;
+    size_t sent = 0;
+
+    Peek(&entries, _maxEntries);
+
+    while ((sent < entries.size()) && _send(entries[sent])) {
+        sent++;
+    }
+
+    Pop(sent);
+    return sent;
+}
+
+
+size_t CStoreForwardQueue::DrainJoined(size_t _maxEntries, size_t _maxBytes, const std::string &_separator,
+                                       std::function<bool(const std::string &)> _send)
+{
+    std::vector<Entry> entries;
+    std::string payload;
+    size_t count = 0;
+
+    Peek(&entries, _maxEntries);
+
+    for (; count < entries.size(); ++count) {
+        size_t length = entries[count].payload.length() + ((count > 0) ? _separator.length() : 0);
+
+        if ((count > 0) && (payload.length() + length > _maxBytes)) {
+            break;
+        }
+
+        if (count > 0) {
+            payload += _separator;
+        }
+        payload += entries[count].payload;
+    }
+
+    if ((count == 0) || !_send(payload)) {
+        return 0;
+    }
+
+    Pop(count);
+    return count;
+}
+
+
+void CStoreForwardQueue::Clear()
+{
+    Pop(header.count);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#ifndef CSTOREFORWARDQUEUE_H
+#define CSTOREFORWARDQUEUE_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Store-and-forward queue of messages which could not be delivered (e.g. MQTT broker or server down)
+ * The queue is a file with two header slots followed by a data area of fixed size, which is used as a
+ * ring. Every message gets a sequence number and keeps its original time. When the ring is full the
+ * oldest messages get dropped (counted). The headers are written alternately, so a header which got
+ * damaged by a crash while writing is replaced by the previous one. A damaged message (check value)
+ * drops the rest of the queue.
+ * The file is only opened for an operation, so many queues do not use up the open files.
+ * The class only uses the C/C++ standard library, the caller is responsible for locking.
+ */
+class CStoreForwardQueue
+{
+public:
+    static const uint32_t MAGIC = 0x51574653;   // "SFWQ"
+    static const uint16_t VERSION = 1;
+
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t generation;                // The slot with the higher generation is the current one
+        uint32_t capacity;                  // Size of the data area
+        uint32_t tail;                      // Position of the oldest message in the data area
+        uint32_t used;                      // Bytes of all messages
+        uint32_t count;
+        uint32_t nextSeq;
+        uint32_t dropped;                   // Messages dropped since the file got created
+        uint32_t check;
+    };
+
+    struct RecordHeader {
+        uint32_t seq;
+        uint32_t time;                      // Unix time of the original message
+        uint16_t keyLength;
+        uint8_t options;                    // Destination specific, e.g. QoS and retain flag
+        uint8_t reserved;
+        uint32_t payloadLength;
+        uint32_t check;
+    };
+
+    struct Entry {
+        uint32_t seq;
+        uint32_t time;
+        uint8_t options;
+        std::string key;                    // E.g. MQTT topic, may be empty
+        std::string payload;
+    };
+
+protected:
+    std::string fileName;
+    Header header;
+    int slot;                               // Header slot which holds the current header
+
+    static uint32_t calcHeaderCheck(const Header *_header);
+    static uint32_t calcRecordCheck(const RecordHeader *_record, const std::string &_key, const std::string &_payload);
+
+    bool readRing(FILE *_file, uint32_t _position, void *_data, size_t _length);
+    bool writeRing(FILE *_file, uint32_t _position, const void *_data, size_t _length);
+    bool readRecord(FILE *_file, uint32_t _position, Entry *_entry, uint32_t *_size);
+    bool writeHeader(FILE *_file);
+    bool create(uint32_t _capacity);
+
+public:
+    CStoreForwardQueue();
+
+    /**
+     * Open the queue file, it gets created if it does not exist, is damaged or has another capacity
+     * @param _capacity bytes for the messages (each message needs its key and payload plus 20 bytes)
+     */
+    bool Open(std::string _file, size_t _capacity);
+    bool isOpen() { return !fileName.empty(); };
+
+    /* Append a message, the oldest ones get dropped if there is no room. False if it is too large or on write errors. */
+    bool Push(uint32_t _time, std::string _key, std::string _payload, uint8_t _options = 0);
+
+    /* Read up to _maxEntries of the oldest messages without removing them */
+    size_t Peek(std::vector<Entry> *_entries, size_t _maxEntries);
+
+    /* Remove the oldest _count messages (delivered) */
+    bool Pop(size_t _count);
+
+    /**
+     * Send the oldest messages in order until _send fails or _maxEntries are sent, the sent ones get removed
+     * @return number of messages sent
+     */
+    size_t Drain(size_t _maxEntries, std::function<bool(const Entry &)> _send);
+
+    /**
+     * Send the oldest messages in one go: their payloads joined by _separator, as many as fit into _maxBytes
+     * (at least one). For destinations which take several messages per request, e.g. InfluxDB line protocol.
+     * @return number of messages sent, 0 if _send failed
+     */
+    size_t DrainJoined(size_t _maxEntries, size_t _maxBytes, const std::string &_separator, std::function<bool(const std::string &)> _send);
+
+    void Clear();
+
+    uint32_t getCount() { return header.count; };
+    uint32_t getUsed() { return header.used; };
+    uint32_t getCapacity() { return header.capacity; };
+    uint32_t getDropped() { return header.dropped; };
+    uint32_t getNextSeq() { return header.nextSeq; };
+};
+
+#endif //CSTOREFORWARDQUEUE_H
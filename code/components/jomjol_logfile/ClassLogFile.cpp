@@ -14,12 +14,30 @@ extern "C" {
 }
 #endif
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
 #include "Helper.h"
 #include "time_sntp.h"
+#include "CLogRingBuffer.h"
+#include "retention_sweeper.h"
+#include "metrics_registry.h"
 #include "../../include/defines.h"
 
 static const char *TAG = "LOGFILE";
 
+static __NOINIT_ATTR uint8_t logBufferMemory[LOG_BUFFER_SIZE]; // Survives a panic/software reset
+static CLogRingBuffer logBuffer;
+static SemaphoreHandle_t logBufferMutex = NULL;     // Access to the ring buffer (short)
+static SemaphoreHandle_t logWriteMutex = NULL;      // Only one writer at a time (writer task, Flush)
+static TaskHandle_t logWriterTaskHandle = NULL;
+static std::string logBufferFileName = "";          // Log file of the pending lines
+static uint32_t logDroppedLines = 0;
+
 ClassLogFile LogFile("/sdcard/log/message", "log_%Y-%m-%d.txt", "/sdcard/log/data", "data_%Y-%m-%d.csv");
 
 
@@ -79,6 +97,18 @@ void ClassLogFile::WriteToData(std::string _timestamp, std::string _name, std::s
 }
 
 
+void ClassLogFile::WriteToData(std::string _name, CDataLog::Record *_record)
+{
+    std::string logpath = GetDataFileName(_record->timestamp);
+
+    ESP_LOGD(TAG, "Datalogfile: %s", logpath.c_str());
+
+    if (!CDataLog::Append(logpath, _name, _record)) {
+        ESP_LOGE(TAG, "Can't write data file %s", logpath.c_str());
+    }
+}
+
+
 void ClassLogFile::setLogLevel(esp_log_level_t _logLevel)
 {
     std::string levelText;
@@ -131,6 +161,16 @@ void ClassLogFile::SetDataLogToSD(bool _doDataLogToSD){
 }
 
 
+void ClassLogFile::SetDataLogBinary(bool _binary){
+    dataLogBinary = _binary;
+}
+
+
+bool ClassLogFile::GetDataLogBinary(){
+    return dataLogBinary;
+}
+
+
 bool ClassLogFile::GetDataLogToSD(){
     return doDataLogToSD;
 }
@@ -206,6 +246,11 @@ void ClassLogFile::WriteToFile(esp_log_level_t level, std::string tag, std::stri
     std::string fullmessage = "[" + formatedUptime + "] "  + ntpTime + "\t<" + loglevelString + ">\t" + message + "\n";
 
 
+    if (logWriterTaskHandle != NULL) {
+        BufferLine(fileNameDateNew, fullmessage);
+        return;
+    }
+
 #ifdef KEEP_LOGFILE_OPEN_FOR_APPENDING
     if (fileNameDateNew != fileNameDate) { // Filename changed
         // Make sure each day gets its own logfile
@@ -250,151 +295,255 @@ void ClassLogFile::CloseLogFileAppendHandle() {
 }
 
 
-void ClassLogFile::WriteToFile(esp_log_level_t level, std::string tag, std::string message) {
-    LogFile.WriteToFile(level, tag, message, true);
+/* Queue a line for the writer task. Must not log via WriteToFile() itself */
+void ClassLogFile::BufferLine(std::string _fileName, std::string &_line)
+{
+    xSemaphoreTake(logBufferMutex, portMAX_DELAY);
+
+    // New day: the pending lines still belong to the old file. The name only gets switched with an empty
+    // buffer and under the lock, so lines of another task can not end up in the file of the wrong day.
+    while ((_fileName != logBufferFileName) && (logBuffer.getUsed() > 0)) {
+        size_t pending = logBuffer.getUsed();
+        xSemaphoreGive(logBufferMutex);
+
+        WritePending(true);
+
+        xSemaphoreTake(logBufferMutex, portMAX_DELAY);
+        if (logBuffer.getUsed() >= pending) { // SD card not writable, keep the lines instead of waiting
+            break;
+        }
+    }
+
+    logBufferFileName = _fileName;
+
+    uint32_t dropped = logBuffer.getDropped();
+    if (dropped > 0) {
+        std::string note = "[" + getFormatedUptime(true) + "] \t<WRN>\t[" + TAG + "] " + std::to_string(dropped) + 
+                " log lines dropped (buffer full)\n";
+
+        if (note.size() + _line.size() <= logBuffer.getFree()) {
+            logBuffer.Push(note.c_str(), note.size());
+            logBuffer.ResetDropped();
+        }
+    }
+
+    bool stored = logBuffer.Push(_line.c_str(), _line.size());
+    if (!stored) {
+        logDroppedLines++;
+    }
+
+    size_t pending = logBuffer.getUsed();
+    xSemaphoreGive(logBufferMutex);
+
+    if (!stored || (pending >= LOG_FLUSH_THRESHOLD)) {
+        xTaskNotifyGive(logWriterTaskHandle);
+    }
 }
 
 
-std::string ClassLogFile::GetCurrentFileNameData()
+/**
+ * Append the pending lines to the log file in large chunks.
+ * The ring buffer is only locked to take the chunk positions, not while writing to the SD card.
+ */
+void ClassLogFile::WritePending(bool _all)
 {
-    time_t rawtime;
-    struct tm* timeinfo;
-    char buffer[60];
+    if ((logWriteMutex == NULL) || (xSemaphoreTake(logWriteMutex, 5000 / portTICK_PERIOD_MS) != pdTRUE)) {
+        return;
+    }
 
-    time(&rawtime);
-    timeinfo = localtime(&rawtime);
+    xSemaphoreTake(logBufferMutex, portMAX_DELAY);
+    size_t pending = logBuffer.getUsed();
+    std::string logpath = logroot + "/" + logBufferFileName;
+    xSemaphoreGive(logBufferMutex);
 
-    strftime(buffer, 60, datafile.c_str(), timeinfo);
-    std::string logpath = dataroot + "/" + buffer; 
+    if (pending == 0) {
+        xSemaphoreGive(logWriteMutex);
+        return;
+    }
 
-    return logpath;
+    FILE *pFile = fopen(logpath.c_str(), "a");
+    if (pFile == NULL) { // Lines stay in the buffer, new ones get dropped once it is full
+        ESP_LOGE(TAG, "Can't open log file %s", logpath.c_str());
+        xSemaphoreGive(logWriteMutex);
+        return;
+    }
+
+    setvbuf(pFile, NULL, _IONBF, 0); // The chunks are large already, write them directly
+
+    if (!_all) { // Keep the rest for the next time, so the file ends on a sector boundary
+        fseek(pFile, 0, SEEK_END);
+        size_t end = ftell(pFile) + pending;
+        pending -= std::min(pending, end % LOG_WRITE_ALIGNMENT);
+    }
+
+    int64_t writeStart = esp_timer_get_time();
+
+    while (pending > 0) {
+        const char *chunk;
+
+        xSemaphoreTake(logBufferMutex, portMAX_DELAY);
+        size_t len = std::min(logBuffer.Peek(&chunk), pending);
+        xSemaphoreGive(logBufferMutex);
+
+        // The producers only write into the free part, the pending chunk can be written without lock
+        size_t written = fwrite(chunk, 1, len, pFile);
+
+        xSemaphoreTake(logBufferMutex, portMAX_DELAY);
+        logBuffer.Consume(written);
+        xSemaphoreGive(logBufferMutex);
+
+        if (written != len) {
+            ESP_LOGE(TAG, "Failed to write log file %s", logpath.c_str());
+            break;
+        }
+
+        pending -= written;
+    }
+
+    fclose(pFile);
+    metrics_observe("sd_write_duration_seconds", (esp_timer_get_time() - writeStart) / 1000000.0);
+    xSemaphoreGive(logWriteMutex);
 }
 
 
-std::string ClassLogFile::GetCurrentFileName()
+void ClassLogFile::Flush()
 {
-    time_t rawtime;
-    struct tm* timeinfo;
-    char buffer[60];
-
-    time(&rawtime);
-    timeinfo = localtime(&rawtime);
+    WritePending(true);
+}
 
-    strftime(buffer, 60, logfile.c_str(), timeinfo);
-    std::string logpath = logroot + "/" + buffer; 
 
-    return logpath;
+uint32_t ClassLogFile::GetDroppedLines()
+{
+    return logDroppedLines;
 }
 
 
-void ClassLogFile::RemoveOldLogFile()
+static void task_log_writer(void *pvParameter)
 {
-    if (logFileRetentionInDays == 0) {
-        return;
+    TickType_t lastFullWrite = xTaskGetTickCount();
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, LOG_FLUSH_INTERVAL / portTICK_PERIOD_MS);
+
+        // Threshold reached: only full sectors, interval elapsed: everything
+        bool all = (xTaskGetTickCount() - lastFullWrite) >= (LOG_FLUSH_INTERVAL / portTICK_PERIOD_MS);
+        LogFile.WritePending(all);
+
+        if (all) {
+            lastFullWrite = xTaskGetTickCount();
+        }
     }
+}
 
-    ESP_LOGD(TAG, "Remove old log files");
 
-    time_t rawtime;
-    struct tm* timeinfo;
-    char cmpfilename[30];
+static void log_shutdown_handler(void)
+{
+    LogFile.Flush();
+}
 
-    time(&rawtime);
-    rawtime = addDays(rawtime, -logFileRetentionInDays + 1);
-    timeinfo = localtime(&rawtime);
-    //ESP_LOGD(TAG, "logFileRetentionInDays: %d", logFileRetentionInDays);
 
+/**
+ * Switch to buffered writing. Lines which were still in the buffer before a panic or
+ * software reset get written first.
+ */
+bool ClassLogFile::StartWriterTask()
+{
+    logBufferMutex = xSemaphoreCreateMutex();
+    logWriteMutex = xSemaphoreCreateMutex();
 
-    strftime(cmpfilename, 30, logfile.c_str(), timeinfo);
-    //ESP_LOGD(TAG, "log file name to compare: %s", cmpfilename);
+    if ((logBufferMutex == NULL) || (logWriteMutex == NULL)) {
+        ESP_LOGE(TAG, "Failed to create log buffer mutex, writing log lines directly");
+        return false;
+    }
 
-    DIR *dir = opendir(logroot.c_str());
-    if (!dir) {
-        ESP_LOGE(TAG, "Failed to stat dir: %s", logroot.c_str());
-        return;
+    bool recovered = logBuffer.Attach(logBufferMemory, sizeof(logBufferMemory));
+    if (esp_reset_reason() == ESP_RST_POWERON) { // Content is random after power on
+        logBuffer.Clear();
+        recovered = false;
     }
 
-    struct dirent *entry;
-    int deleted = 0;
-    int notDeleted = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_type == DT_REG) {
-            //ESP_LOGD(TAG, "compare log file: %s to %s", entry->d_name, cmpfilename);
-            if ((strlen(entry->d_name) == strlen(cmpfilename)) && (strcmp(entry->d_name, cmpfilename) < 0)) {
-                //ESP_LOGD(TAG, "delete log file: %s", entry->d_name);
-                std::string filepath = logroot + "/" + entry->d_name;
-                if ((strcmp(entry->d_name, "log_1970-01-01.txt") == 0) && getTimeWasNotSetAtBoot()) { // keep logfile log_1970-01-01.txt if time was not set at boot (some boot logs are in there)
-                    //ESP_LOGD(TAG, "Skip deleting this file: %s", entry->d_name); 
-                    notDeleted++;
-                }
-                else {          
-                    if (unlink(filepath.c_str()) == 0) {
-                        deleted++;
-                    } 
-                    else {
-                        ESP_LOGE(TAG, "can't delete file: %s", entry->d_name);
-                        notDeleted++;
-                    }
-                }
-            } 
-            else {
-                notDeleted++;
-            }
-        }
+    size_t recoveredBytes = logBuffer.getUsed();
+    logBufferFileName = GetCurrentFileName().substr(logroot.size() + 1);
+    WritePending(true);
+
+    BaseType_t xReturned = xTaskCreate(&task_log_writer, "task_log_writer", 4 * 1024, NULL, tskIDLE_PRIORITY + 1, &logWriterTaskHandle);
+    if (xReturned != pdPASS) {
+        logWriterTaskHandle = NULL;
+        WriteToFile(ESP_LOG_ERROR, TAG, "Failed to create log writer task, writing log lines directly");
+        return false;
     }
-    ESP_LOGD(TAG, "log files deleted: %d | files not deleted (incl. leer.txt): %d", deleted, notDeleted);	
-    closedir(dir);
+
+    esp_register_shutdown_handler(log_shutdown_handler);
+
+    if (recovered && (recoveredBytes > 0)) {
+        WriteToFile(ESP_LOG_WARN, TAG, "Wrote " + std::to_string(recoveredBytes) + " bytes of log lines from before the reset");
+    }
+
+    return true;
 }
 
 
-void ClassLogFile::RemoveOldDataLog()
+void ClassLogFile::WriteToFile(esp_log_level_t level, std::string tag, std::string message) {
+    LogFile.WriteToFile(level, tag, message, true);
+}
+
+
+std::string ClassLogFile::GetCurrentFileNameData()
 {
-    if (dataLogRetentionInDays == 0 || !doDataLogToSD) {
-        return;
+    time_t rawtime;
+
+    time(&rawtime);
+
+    return GetDataFileName(rawtime);
+}
+
+
+std::string ClassLogFile::GetDataFileName(time_t _time)
+{
+    struct tm* timeinfo;
+    char buffer[60];
+
+    timeinfo = localtime(&_time);
+
+    strftime(buffer, 60, datafile.c_str(), timeinfo);
+    std::string logpath = dataroot + "/" + buffer; 
+
+    if (dataLogBinary) {
+        size_t pos = logpath.find_last_of(".");
+        logpath = logpath.substr(0, pos) + ".bin";
     }
 
-    ESP_LOGD(TAG, "Remove old data files");
+    return logpath;
+}
 
+
+std::string ClassLogFile::GetCurrentFileName()
+{
     time_t rawtime;
     struct tm* timeinfo;
-    char cmpfilename[30];
+    char buffer[60];
 
     time(&rawtime);
-    rawtime = addDays(rawtime, -dataLogRetentionInDays + 1);
     timeinfo = localtime(&rawtime);
-    //ESP_LOGD(TAG, "dataLogRetentionInDays: %d", dataLogRetentionInDays);
 
-    strftime(cmpfilename, 30, datafile.c_str(), timeinfo);
-    //ESP_LOGD(TAG, "data file name to compare: %s", cmpfilename);
+    strftime(buffer, 60, logfile.c_str(), timeinfo);
+    std::string logpath = logroot + "/" + buffer; 
 
-    DIR *dir = opendir(dataroot.c_str());
-    if (!dir) {
-        ESP_LOGE(TAG, "Failed to stat dir: %s", dataroot.c_str());
-        return;
-    }
+    return logpath;
+}
 
-    struct dirent *entry;
-    int deleted = 0;
-    int notDeleted = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_type == DT_REG) {
-            //ESP_LOGD(TAG, "Compare data file: %s to %s", entry->d_name, cmpfilename);
-            if ((strlen(entry->d_name) == strlen(cmpfilename)) && (strcmp(entry->d_name, cmpfilename) < 0)) {
-                //ESP_LOGD(TAG, "delete data file: %s", entry->d_name);
-                std::string filepath = dataroot + "/" + entry->d_name; 
-                if (unlink(filepath.c_str()) == 0) {
-                    deleted ++;
-                } else {
-                    ESP_LOGE(TAG, "can't delete file: %s", entry->d_name);
-                    notDeleted ++;
-                }
-            } else {
-                notDeleted ++;
-            }
-        }
-    }
-    ESP_LOGD(TAG, "data files deleted: %d | files not deleted (incl. leer.txt): %d", deleted, notDeleted);	
-    closedir(dir);
+
+void ClassLogFile::RemoveOldLogFile()
+{
+    // Deleted step by step in the background, keep log_1970-01-01.txt if time was not set at boot (some boot logs are in there)
+    retention_sweeper_set_job(logroot, logfile, logFileRetentionInDays, false, getTimeWasNotSetAtBoot() ? "log_1970-01-01.txt" : "");
+}
+
+
+void ClassLogFile::RemoveOldDataLog()
+{
+    // Same name length for all formats (.csv, .bin, .idx), only the date part gets compared, so the retention covers all of them
+    retention_sweeper_set_job(dataroot, datafile, doDataLogToSD ? dataLogRetentionInDays : 0, false);
 }
 
 
@@ -421,5 +570,6 @@ ClassLogFile::ClassLogFile(std::string _logroot, std::string _logfile, std::stri
     logFileRetentionInDays = 3;
     dataLogRetentionInDays = 3;
     doDataLogToSD = true;
+    dataLogBinary = false;
     loglevel = ESP_LOG_INFO;
 }
@@ -5,7 +5,9 @@
 
 
 #include <string>
+#include <time.h>
 #include "esp_log.h"
+#include "CDataLog.h"
 
 
 class ClassLogFile
@@ -18,7 +20,10 @@ private:
     unsigned short logFileRetentionInDays;
     unsigned short dataLogRetentionInDays;
     bool doDataLogToSD;
+    bool dataLogBinary;
     esp_log_level_t loglevel;
+
+    void BufferLine(std::string _fileName, std::string &_line);
 public:
     ClassLogFile(std::string _logpath, std::string _logfile, std::string _logdatapath, std::string _datafile);
 
@@ -29,22 +34,33 @@ public:
     void SetDataLogRetention(unsigned short _DataLogRetentionInDays);
     void SetDataLogToSD(bool _doDataLogToSD);
     bool GetDataLogToSD();
+    void SetDataLogBinary(bool _binary);    // Binary records with time index (CDataLog) instead of CSV lines
+    bool GetDataLogBinary();
 
     void WriteToFile(esp_log_level_t level, std::string tag, std::string message, bool _time);
     void WriteToFile(esp_log_level_t level, std::string tag, std::string message);
 
     void CloseLogFileAppendHandle();
 
+    /* Buffered writing, see LOG_BUFFER_SIZE. Without the writer task every line gets written directly */
+    bool StartWriterTask();
+    void WritePending(bool _all);   // _all = false: only up to a sector boundary of the file
+    void Flush();
+    uint32_t GetDroppedLines();
+
     bool CreateLogDirectories();
+    /* Hand the retention to the background sweeper (see retention_sweeper.h) */
     void RemoveOldLogFile();
     void RemoveOldDataLog();
 
 //    void WriteToData(std::string _ReturnRawValue, std::string _ReturnValue, std::string _ReturnPreValue, std::string _ErrorMessageText, std::string _digit, std::string _analog);
     void WriteToData(std::string _timestamp, std::string _name, std::string  _ReturnRawValue, std::string  _ReturnValue, std::string  _ReturnPreValue, std::string  _ReturnRateValue, std::string  _ReturnChangeAbsolute, std::string  _ErrorMessageText, std::string  _digit, std::string  _analog);
+    void WriteToData(std::string _name, CDataLog::Record *_record);
 
 
     std::string GetCurrentFileName();
     std::string GetCurrentFileNameData();
+    std::string GetDataFileName(time_t _time);  // Data file of the day of _time in the active format
 };
 
 extern ClassLogFile LogFile;
@@ -0,0 +1,127 @@
+#include "retention_sweeper.h"
+
+#include <time.h>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+
+#include "ClassLogFile.h"
+#include "CRetentionSweeper.h"
+#include "../../include/defines.h"
+
+static const char *TAG = "RETENTION";
+
+static CRetentionSweeper sweeper;                           // Only used by the sweeper task
+static SemaphoreHandle_t sweeperMutex = NULL;               // Short locks only, a round never waits for a deletion
+static std::vector<CRetentionSweeper::Job> pendingJobs;     // Job updates for the sweeper task
+static std::string sweeperStatus = "starting";
+static TaskHandle_t sweeperTaskHandle = NULL;
+
+
+static void task_retention_sweeper(void *pvParameter)
+{
+    uint32_t reportedFiles = 0;
+    uint32_t reportedFolders = 0;
+
+    sweeper.SetCursorFile(RETENTION_SWEEP_CURSOR_FILE); // Continue an interrupted pass
+
+    while (true) {
+        std::vector<CRetentionSweeper::Job> jobs;
+
+        xSemaphoreTake(sweeperMutex, portMAX_DELAY);
+        jobs.swap(pendingJobs);
+        xSemaphoreGive(sweeperMutex);
+
+        for (int i = 0; i < jobs.size(); ++i) {
+            sweeper.SetJob(jobs[i].directory, jobs[i].nameFormat, jobs[i].retentionDays, jobs[i].folders, jobs[i].keep);
+        }
+
+        bool more = sweeper.Tick(RETENTION_SWEEP_MAX_DELETES, time(NULL));
+        CRetentionSweeper::Stats stats = sweeper.getStats();
+
+        xSemaphoreTake(sweeperMutex, portMAX_DELAY);
+        sweeperStatus = sweeper.getStatus();
+        xSemaphoreGive(sweeperMutex);
+
+        if (!more && ((stats.deletedFiles != reportedFiles) || (stats.deletedFolders != reportedFolders))) {
+            if (reportedFiles + reportedFolders > 0) {
+                LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Pass completed: " + std::to_string(stats.deletedFiles - reportedFiles) + " files, " +
+                                    std::to_string(stats.deletedFolders - reportedFolders) + " folders deleted");
+            }
+            LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Total: " + sweeper.getStatus());
+            reportedFiles = stats.deletedFiles;
+            reportedFolders = stats.deletedFolders;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(more ? RETENTION_SWEEP_BUSY_DELAY : RETENTION_SWEEP_IDLE_DELAY));
+    }
+}
+
+
+bool retention_sweeper_start(void)
+{
+    if (sweeperTaskHandle != NULL) {
+        return true;
+    }
+
+    if (sweeperMutex == NULL) {
+        sweeperMutex = xSemaphoreCreateMutex();
+    }
+
+    if (sweeperMutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create mutex");
+        return false;
+    }
+
+    // Lowest priority above idle, deleting must never delay a round
+    if (xTaskCreate(&task_retention_sweeper, "retention", 4 * 1024, NULL, tskIDLE_PRIORITY + 1, &sweeperTaskHandle) != pdPASS) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to start the retention sweeper, old files do not get deleted");
+        sweeperTaskHandle = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+
+void retention_sweeper_set_job(std::string _directory, std::string _nameFormat, unsigned short _retentionDays, bool _folders, std::string _keep)
+{
+    if (sweeperMutex == NULL) {
+        return; // Not started
+    }
+
+    CRetentionSweeper::Job job;
+    job.directory = _directory;
+    job.nameFormat = _nameFormat;
+    job.retentionDays = _retentionDays;
+    job.folders = _folders;
+    job.keep = _keep;
+
+    xSemaphoreTake(sweeperMutex, portMAX_DELAY);
+    for (int i = 0; i < pendingJobs.size(); ++i) {
+        if (pendingJobs[i].directory == _directory) {
+            pendingJobs[i] = job;
+            xSemaphoreGive(sweeperMutex);
+            return;
+        }
+    }
+    pendingJobs.push_back(job);
+    xSemaphoreGive(sweeperMutex);
+}
+
+
+std::string retention_sweeper_get_status(void)
+{
+    if (sweeperMutex == NULL) {
+        return "not running";
+    }
+
+    xSemaphoreTake(sweeperMutex, portMAX_DELAY);
+    std::string status = sweeperStatus;
+    xSemaphoreGive(sweeperMutex);
+
+    return status;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#ifndef RETENTION_SWEEPER_H
+#define RETENTION_SWEEPER_H
+
+#include <string>
+
+
+/* Background task which deletes old log files and image folders in small steps (see CRetentionSweeper) */
+bool retention_sweeper_start(void);
+
+/* Add or update the retention of a directory, _retentionDays = 0 keeps everything */
+void retention_sweeper_set_job(std::string _directory, std::string _nameFormat, unsigned short _retentionDays, bool _folders, std::string _keep = "");
+
+/* Progress and reclaimed space, human readable */
+std::string retention_sweeper_get_status(void);
+
+#endif //RETENTION_SWEEPER_H
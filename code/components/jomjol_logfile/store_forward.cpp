@@ -0,0 +1,138 @@
+#include "store_forward.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "ClassLogFile.h"
+#include "Helper.h"
+#include "../../include/defines.h"
+
+static const char *TAG = "STORE FWD";
+
+
+bool store_forward_open(CStoreForwardQueue *_queue, std::string _name)
+{
+    if (STORE_FORWARD_CAPACITY == 0) {
+        return false;
+    }
+
+    MakeDir(STORE_FORWARD_FOLDER);
+    std::string file = std::string(STORE_FORWARD_FOLDER) + "/" + _name + ".bin";
+
+    if (!_queue->Open(file, STORE_FORWARD_CAPACITY)) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to open " + file + ", undelivered readings get lost");
+        return false;
+    }
+
+    if (_queue->getCount() > 0) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, _name + ": " + std::to_string(_queue->getCount()) + " undelivered messages from before the restart");
+    }
+
+    return true;
+}
+
+
+/* Keep a message for later, false if it gets lost */
+static bool keep_message(CStoreForwardQueue *_queue, uint32_t _time, std::string _key, std::string _payload, uint8_t _options)
+{
+    if (!_queue->isOpen()) {
+        return false;
+    }
+
+    uint32_t dropped = _queue->getDropped();
+
+    if (!_queue->Push(_time, _key, _payload, _options)) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to keep a message for later, it gets lost");
+        return false;
+    }
+
+    if (_queue->getDropped() != dropped) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Queue full, dropped the oldest messages (" + std::to_string(_queue->getDropped()) + " in total)");
+    }
+
+    return true;
+}
+
+
+bool store_forward_send(CStoreForwardQueue *_queue, uint32_t _time, std::string _key, std::string _payload, uint8_t _options,
+                        std::function<bool(const CStoreForwardQueue::Entry &)> _send)
+{
+    if (_queue->getCount() == 0) {
+        CStoreForwardQueue::Entry entry;
+        entry.seq = 0;
+        entry.time = _time;
+        entry.options = _options;
+        entry.key = _key;
+        entry.payload = _payload;
+
+        if (_send(entry)) {
+            return true;
+        }
+    }
+
+    keep_message(_queue, _time, _key, _payload, _options);
+    return false;
+}
+
+
+size_t store_forward_drain(CStoreForwardQueue *_queue, std::function<bool(const CStoreForwardQueue::Entry &)> _send)
+{
+    if (!_queue->isOpen() || (_queue->getCount() == 0)) {
+        return 0;
+    }
+
+    bool first = true;
+    size_t sent = _queue->Drain(STORE_FORWARD_DRAIN_MAX, [&](const CStoreForwardQueue::Entry &_entry) {
+        if (!first) {
+            vTaskDelay(pdMS_TO_TICKS(STORE_FORWARD_DRAIN_DELAY));    // Do not flood the destination
+        }
+        first = false;
+        return _send(_entry);
+    });
+
+    if (sent > 0) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Sent " + std::to_string(sent) + " queued messages, " +
+                            std::to_string(_queue->getCount()) + " pending");
+    }
+
+    return sent;
+}
+
+
+bool store_forward_send_joined(CStoreForwardQueue *_queue, uint32_t _time, std::string _payload, std::string _separator, size_t _maxBytes,
+                               std::function<bool(const std::string &)> _send)
+{
+    if (_queue->getCount() == 0) {
+        if (_payload.empty() || _send(_payload)) {
+            return true;
+        }
+
+        keep_message(_queue, _time, "", _payload, 0);
+        return false;
+    }
+
+    if (!_payload.empty()) {
+        keep_message(_queue, _time, "", _payload, 0);    // After the pending ones, so the order is kept
+    }
+
+    size_t sent = 0;
+    while ((_queue->getCount() > 0) && (sent < STORE_FORWARD_DRAIN_MAX)) {
+        if (sent > 0) {
+            vTaskDelay(pdMS_TO_TICKS(STORE_FORWARD_DRAIN_DELAY));    // Do not flood the destination
+        }
+
+        size_t count = _queue->DrainJoined(STORE_FORWARD_DRAIN_MAX - sent, _maxBytes, _separator, _send);
+        if (count == 0) {
+            break;
+        }
+        sent += count;
+    }
+
+    if (sent > 0) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Sent " + std::to_string(sent) + " queued messages, " +
+                            std::to_string(_queue->getCount()) + " pending");
+    }
+
+    return _queue->getCount() == 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef STORE_FORWARD_H
+#define STORE_FORWARD_H
+
+#include <string>
+#include <functional>
+
+#include "CStoreForwardQueue.h"
+
+
+/* Open the queue of a destination (file in STORE_FORWARD_FOLDER), false if it is disabled or can not be used */
+bool store_forward_open(CStoreForwardQueue *_queue, std::string _name);
+
+/**
+ * Deliver a message right away, or keep it in the queue if older messages are pending or _send fails
+ * @return true if it got delivered
+ */
+bool store_forward_send(CStoreForwardQueue *_queue, uint32_t _time, std::string _key, std::string _payload, uint8_t _options,
+                        std::function<bool(const CStoreForwardQueue::Entry &)> _send);
+
+/* Send pending messages in order, at most STORE_FORWARD_DRAIN_MAX per call with a pause between them */
+size_t store_forward_drain(CStoreForwardQueue *_queue, std::function<bool(const CStoreForwardQueue::Entry &)> _send);
+
+/**
+ * Batch variant of store_forward_send() for destinations which take several messages per request (e.g. InfluxDB
+ * line protocol): if older messages are pending, _payload gets queued and the pending ones are sent joined by
+ * _separator, up to _maxBytes per request and STORE_FORWARD_DRAIN_MAX messages per call
+ * @param _payload may be empty to only send the pending messages
+ * @return true if nothing is pending anymore
+ */
+bool store_forward_send_joined(CStoreForwardQueue *_queue, uint32_t _time, std::string _payload, std::string _separator, size_t _maxBytes,
+                               std::function<bool(const std::string &)> _send);
+
+#endif //STORE_FORWARD_H
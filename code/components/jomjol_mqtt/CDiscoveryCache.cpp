@@ -0,0 +1,162 @@
+#include "CDiscoveryCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+
+CDiscoveryCache::CDiscoveryCache()
+{
+    modified = false;
+    running = false;
+}
+
+
+uint32_t CDiscoveryCache::Hash(const std::string &_payload)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < _payload.length(); ++i) {
+        hash ^= (uint8_t)_payload[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+bool CDiscoveryCache::isChanged(const std::string &_topic, const std::string &_payload)
+{
+    std::map<std::string, uint32_t>::iterator it = hashes.find(_topic);
+
+    return (it == hashes.end()) || (it->second != Hash(_payload));
+}
+
+
+void CDiscoveryCache::Published(const std::string &_topic, const std::string &_payload)
+{
+    uint32_t hash = Hash(_payload);
+    std::map<std::string, uint32_t>::iterator it = hashes.find(_topic);
+
+    if ((it != hashes.end()) && (it->second == hash)) {
+        return;
+    }
+
+    hashes[_topic] = hash;
+    modified = true;
+}
+
+
+void CDiscoveryCache::BeginRun()
+{
+    pending.clear();
+    early.clear();
+    running = true;
+}
+
+
+void CDiscoveryCache::EndRun()
+{
+    early.clear();
+    running = false;
+}
+
+
+void CDiscoveryCache::Sent(int _msgId, const std::string &_topic, const std::string &_payload)
+{
+    std::vector<int>::iterator it = std::find(early.begin(), early.end(), _msgId);
+
+    if (it != early.end()) {
+        early.erase(it);
+        Published(_topic, _payload);
+        return;
+    }
+
+    Pending &entry = pending[_msgId];
+    entry.topic = _topic;
+    entry.hash = Hash(_payload);
+}
+
+
+bool CDiscoveryCache::Acknowledged(int _msgId)
+{
+    std::map<int, Pending>::iterator it = pending.find(_msgId);
+
+    if (it == pending.end()) {
+        // Only while a run is sending, the acknowledges of other messages are not of interest
+        if (running) {
+            early.push_back(_msgId);
+        }
+        return false;
+    }
+
+    std::map<std::string, uint32_t>::iterator known = hashes.find(it->second.topic);
+
+    if ((known == hashes.end()) || (known->second != it->second.hash)) {
+        hashes[it->second.topic] = it->second.hash;
+        modified = true;
+    }
+
+    pending.erase(it);
+    return true;
+}
+
+
+void CDiscoveryCache::Clear()
+{
+    if (!hashes.empty()) {
+        hashes.clear();
+        modified = true;
+    }
+}
+
+
+std::string CDiscoveryCache::Serialize()
+{
+    std::string text;
+    char hash[12];
+
+    for (std::map<std::string, uint32_t>::iterator it = hashes.begin(); it != hashes.end(); ++it) {
+        snprintf(hash, sizeof(hash), "%08lx ", (unsigned long)it->second);
+        text += hash + it->first + "\n";
+    }
+
+    modified = false;
+    return text;
+}
+
+
+int CDiscoveryCache::Deserialize(const std::string &_text)
+{
+    size_t start = 0;
+
+    hashes.clear();
+    modified = false;
+
+    while (start < _text.length()) {
+        size_t end = _text.find('\n', start);
+        if (end == std::string::npos) {
+            end = _text.length();
+        }
+
+        std::string line = _text.substr(start, end - start);
+        start = end + 1;
+
+        // "<8 hex digits> <topic>"
+        if ((line.length() < 10) || (line[8] != ' ')) {
+            continue;
+        }
+
+        char *hashEnd = NULL;
+        std::string hash = line.substr(0, 8);
+        unsigned long value = strtoul(hash.c_str(), &hashEnd, 16);
+
+        if ((hashEnd == NULL) || (*hashEnd != '\0')) {
+            continue;
+        }
+
+        hashes[line.substr(9)] = (uint32_t)value;
+    }
+
+    return (int)hashes.size();
+}
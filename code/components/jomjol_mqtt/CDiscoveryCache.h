@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef CDISCOVERYCACHE_H
+#define CDISCOVERYCACHE_H
+
+#include <string>
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+
+/**
+ * Homeassistant Discovery topics which are already known to the broker
+ * Keeps a hash of the payload last published per topic, so a discovery run only publishes topics which are
+ * new or whose payload changed (e.g. after a firmware update, an IP change or a changed configuration).
+ * A topic only counts as published once the broker acknowledged its message (QoS 1). A message which only got
+ * queued may still get dropped from the outbox, its topic has to be published again by the next run.
+ * The hashes get saved as text ("<hash> <topic>" per line) so they survive a reboot.
+ * The class only uses the C/C++ standard library, the caller is responsible for locking and the file.
+ */
+class CDiscoveryCache
+{
+protected:
+    struct Pending {
+        std::string topic;
+        uint32_t hash;
+    };
+
+    std::map<std::string, uint32_t> hashes;
+    bool modified;
+    std::map<int, Pending> pending;     // Sent, waiting for the acknowledge of the broker (message id)
+    std::vector<int> early;             // Acknowledged before Sent() got called (the client task was faster)
+    bool running;
+
+public:
+    CDiscoveryCache();
+
+    /* FNV-1a, 32 bit */
+    static uint32_t Hash(const std::string &_payload);
+
+    /* True if the topic is unknown or got published with another payload */
+    bool isChanged(const std::string &_topic, const std::string &_payload);
+
+    /* The payload got accepted by the broker */
+    void Published(const std::string &_topic, const std::string &_payload);
+
+    /* Start of a discovery run, messages of a previous run which never got acknowledged are forgotten */
+    void BeginRun();
+    void EndRun();
+
+    /* The client queued the payload as message _msgId, it counts as published with Acknowledged(_msgId) */
+    void Sent(int _msgId, const std::string &_topic, const std::string &_payload);
+
+    /* The broker acknowledged message _msgId. @return false if it is not a discovery message */
+    bool Acknowledged(int _msgId);
+
+    /* Forgets all topics, the next discovery run publishes all of them */
+    void Clear();
+
+    /* Text to save, clears the modified flag */
+    std::string Serialize();
+
+    /* Replaces the hashes by the saved ones, invalid lines get skipped. @return number of topics */
+    int Deserialize(const std::string &_text);
+
+    int getCount() { return (int)hashes.size(); };
+    int getPendingCount() { return (int)pending.size(); };
+    bool isModified() { return modified; };
+};
+
+#endif //CDISCOVERYCACHE_H
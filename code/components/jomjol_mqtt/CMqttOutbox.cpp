@@ -0,0 +1,400 @@
+#include "CMqttOutbox.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+static size_t item_size(size_t _length)
+{
+    return sizeof(CMqttOutbox::Item) + _length;
+}
+
+
+CMqttOutbox::CMqttOutbox()
+{
+    head = NULL;
+    tail = NULL;
+    classCount = 0;
+    policy = POLICY_REJECT;
+    count = 0;
+    bytes = 0;
+    memset(&stats, 0, sizeof(stats));
+    allocFunction = NULL;
+    freeFunction = NULL;
+}
+
+
+CMqttOutbox::~CMqttOutbox()
+{
+    DeleteAll();
+}
+
+
+size_t CMqttOutbox::getBufferSize(const size_t *_slotSizes, const int *_slotCounts, int _classCount)
+{
+    size_t size = 0;
+
+    for (int i = 0; (i < _classCount) && (i < MAX_CLASSES); ++i) {
+        size += CMemoryPool::getBufferSize(item_size(_slotSizes[i]), _slotCounts[i]);
+    }
+
+    return size;
+}
+
+
+void CMqttOutbox::Setup(void *_buffer, const size_t *_slotSizes, const int *_slotCounts, int _classCount, Policy _policy,
+                        void *(*_alloc)(size_t), void (*_free)(void *))
+{
+    DeleteAll();
+
+    uint8_t *buffer = (uint8_t *)_buffer;
+    classCount = (_buffer != NULL) ? ((_classCount < MAX_CLASSES) ? _classCount : MAX_CLASSES) : 0;
+
+    for (int i = 0; i < MAX_CLASSES; ++i) {
+        if (i < classCount) {
+            pools[i].Init(buffer, item_size(_slotSizes[i]), _slotCounts[i]);
+            buffer += CMemoryPool::getBufferSize(item_size(_slotSizes[i]), _slotCounts[i]);
+        }
+        else {
+            pools[i].Init(NULL, 0, 0);
+        }
+    }
+
+    policy = _policy;
+    allocFunction = _alloc;
+    freeFunction = _free;
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+CMqttOutbox::Item *CMqttOutbox::allocItem(size_t _length)
+{
+    size_t size = item_size(_length);
+    int fitting = -1;       // Smallest class the message fits into
+
+    for (int i = 0; i < classCount; ++i) {
+        if (size > pools[i].getSlotSize()) {
+            continue;
+        }
+
+        if (fitting < 0) {
+            fitting = i;
+        }
+
+        Item *item = (Item *)pools[i].Alloc(size);
+        if (item != NULL) {
+            item->sizeClass = i;
+            return item;
+        }
+    }
+
+    if (fitting < 0) {
+        // Larger than all classes
+        Item *item = (allocFunction != NULL) ? (Item *)allocFunction(size) : NULL;
+        if (item != NULL) {
+            item->sizeClass = -1;
+            stats.fallback++;
+        }
+        return item;
+    }
+
+    if (policy != POLICY_DROP_OLDEST) {
+        return NULL;
+    }
+
+    // Oldest message in a slot which is large enough
+    Item *previous = NULL;
+    for (Item *item = head; item != NULL; previous = item, item = item->next) {
+        if (item->sizeClass >= fitting) {
+            int sizeClass = item->sizeClass;
+            unlink(item, previous);
+            release(item);
+            stats.droppedOldest++;
+
+            item = (Item *)pools[sizeClass].Alloc(size);
+            item->sizeClass = sizeClass;
+            return item;
+        }
+    }
+
+    return NULL;
+}
+
+
+CMqttOutbox::Item *CMqttOutbox::Enqueue(const uint8_t *_data, size_t _length, const uint8_t *_remaining, size_t _remainingLength,
+                                        int _msgId, int _msgType, int _qos, long long _tick)
+{
+    size_t length = _length + ((_remaining != NULL) ? _remainingLength : 0);
+    Item *item = allocItem(length);
+
+    if (item == NULL) {
+        stats.rejected++;
+        return NULL;
+    }
+
+    item->next = NULL;
+    item->data = (uint8_t *)(item + 1);
+    item->length = length;
+    item->msgId = _msgId;
+    item->msgType = _msgType;
+    item->qos = _qos;
+    item->tick = _tick;
+    item->pending = 0;      // QUEUED
+
+    memcpy(item->data, _data, _length);
+    if (_remaining != NULL) {
+        memcpy(item->data + _length, _remaining, _remainingLength);
+    }
+
+    if (tail != NULL) {
+        tail->next = item;
+    }
+    else {
+        head = item;
+    }
+    tail = item;
+
+    count++;
+    bytes += length;
+    stats.enqueued++;
+
+    if (count > stats.maxItems) {
+        stats.maxItems = count;
+    }
+    if (bytes > stats.maxBytes) {
+        stats.maxBytes = bytes;
+    }
+
+    return item;
+}
+
+
+void CMqttOutbox::unlink(Item *_item, Item *_previous)
+{
+    if (_previous != NULL) {
+        _previous->next = _item->next;
+    }
+    else {
+        head = _item->next;
+    }
+
+    if (tail == _item) {
+        tail = _previous;
+    }
+
+    count--;
+    bytes -= _item->length;
+}
+
+
+void CMqttOutbox::release(Item *_item)
+{
+    if (_item->sizeClass >= 0) {
+        pools[_item->sizeClass].Free(_item);
+    }
+    else if (freeFunction != NULL) {
+        freeFunction(_item);
+    }
+}
+
+
+CMqttOutbox::Item *CMqttOutbox::Get(int _msgId)
+{
+    for (Item *item = head; item != NULL; item = item->next) {
+        if (item->msgId == _msgId) {
+            return item;
+        }
+    }
+
+    return NULL;
+}
+
+
+CMqttOutbox::Item *CMqttOutbox::Dequeue(int _pending, long long *_tick)
+{
+    for (Item *item = head; item != NULL; item = item->next) {
+        if (item->pending == _pending) {
+            if (_tick != NULL) {
+                *_tick = item->tick;
+            }
+            return item;
+        }
+    }
+
+    return NULL;
+}
+
+
+bool CMqttOutbox::Delete(int _msgId, int _msgType)
+{
+    Item *previous = NULL;
+
+    for (Item *item = head; item != NULL; previous = item, item = item->next) {
+        if ((item->msgId == _msgId) && ((item->msgType & 0xFF) == _msgType)) {
+            unlink(item, previous);
+            release(item);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void CMqttOutbox::DeleteMsgId(int _msgId)
+{
+    Item *previous = NULL;
+    Item *item = head;
+
+    while (item != NULL) {
+        Item *next = item->next;
+
+        if (item->msgId == _msgId) {
+            unlink(item, previous);
+            release(item);
+        }
+        else {
+            previous = item;
+        }
+
+        item = next;
+    }
+}
+
+
+void CMqttOutbox::DeleteMsgType(int _msgType)
+{
+    Item *previous = NULL;
+    Item *item = head;
+
+    while (item != NULL) {
+        Item *next = item->next;
+
+        if (item->msgType == _msgType) {
+            unlink(item, previous);
+            release(item);
+        }
+        else {
+            previous = item;
+        }
+
+        item = next;
+    }
+}
+
+
+bool CMqttOutbox::DeleteItem(Item *_item)
+{
+    Item *previous = NULL;
+
+    for (Item *item = head; item != NULL; previous = item, item = item->next) {
+        if (item == _item) {
+            unlink(item, previous);
+            release(item);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+int CMqttOutbox::DeleteExpired(long long _tick, long long _timeout)
+{
+    Item *previous = NULL;
+    Item *item = head;
+    int deleted = 0;
+
+    while (item != NULL) {
+        Item *next = item->next;
+
+        if (_tick - item->tick > _timeout) {
+            unlink(item, previous);
+            release(item);
+            deleted++;
+        }
+        else {
+            previous = item;
+        }
+
+        item = next;
+    }
+
+    stats.expired += deleted;
+    return deleted;
+}
+
+
+int CMqttOutbox::DeleteSingleExpired(long long _tick, long long _timeout)
+{
+    Item *previous = NULL;
+
+    for (Item *item = head; item != NULL; previous = item, item = item->next) {
+        if (_tick - item->tick > _timeout) {
+            int msgId = item->msgId;
+            unlink(item, previous);
+            release(item);
+            stats.expired++;
+            return msgId;
+        }
+    }
+
+    return -1;
+}
+
+
+void CMqttOutbox::DeleteAll()
+{
+    while (head != NULL) {
+        Item *item = head;
+        unlink(item, NULL);
+        release(item);
+    }
+}
+
+
+bool CMqttOutbox::SetPending(int _msgId, int _pending)
+{
+    Item *item = Get(_msgId);
+
+    if (item == NULL) {
+        return false;
+    }
+
+    item->pending = _pending;
+    return true;
+}
+
+
+bool CMqttOutbox::SetTick(int _msgId, long long _tick)
+{
+    Item *item = Get(_msgId);
+
+    if (item == NULL) {
+        return false;
+    }
+
+    item->tick = _tick;
+    return true;
+}
+
+
+std::string CMqttOutbox::getStatus()
+{
+    char status[300];
+    std::string slots;
+
+    for (int i = 0; i < classCount; ++i) {
+        snprintf(status, sizeof(status), "%s%d/%d x %d B", (i > 0) ? ", " : "", pools[i].getUsedSlots(), pools[i].getSlotCount(),
+                 (int)(pools[i].getSlotSize() - sizeof(Item)));
+        slots += status;
+    }
+
+    snprintf(status, sizeof(status), "%d messages (%d B), policy %s; slots %s; %lu queued, %lu rejected, %lu dropped, "
+             "%lu expired, %lu too large, max. %d messages (%d B)",
+             count, (int)bytes, (policy == POLICY_DROP_OLDEST) ? "drop oldest" : "reject", slots.empty() ? "none" : slots.c_str(),
+             (unsigned long)stats.enqueued, (unsigned long)stats.rejected, (unsigned long)stats.droppedOldest,
+             (unsigned long)stats.expired, (unsigned long)stats.fallback, stats.maxItems, (int)stats.maxBytes);
+
+    return std::string(status);
+}
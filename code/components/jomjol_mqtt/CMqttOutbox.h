@@ -0,0 +1,111 @@
+#pragma once
+
+#ifndef CMQTTOUTBOX_H
+#define CMQTTOUTBOX_H
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "CMemoryArena.h"
+
+
+/**
+ * Outbox of the MQTT client (messages waiting to be sent or acknowledged, see mqtt_outbox.h)
+ * The messages live in fixed-size slots of a few size classes, carved out of one buffer which gets
+ * allocated at boot, so queuing messages does not fragment the heap. A message takes the smallest
+ * free slot it fits into (item header, topic and payload). When no slot is free the policy decides:
+ * reject the new message or drop the oldest message of the size class. Messages larger than the
+ * largest class go to the fallback allocator if there is one, otherwise they get rejected.
+ * The class only uses the C/C++ standard library, the caller is responsible for locking.
+ */
+class CMqttOutbox
+{
+public:
+    static const int MAX_CLASSES = 4;
+
+    enum Policy {
+        POLICY_REJECT = 0,
+        POLICY_DROP_OLDEST = 1,
+    };
+
+    struct Item {
+        Item *next;
+        uint8_t *data;              // Behind the item in the same slot
+        size_t length;
+        int msgId;
+        int msgType;
+        int qos;
+        long long tick;
+        int pending;                // pending_state_t
+        int sizeClass;              // -1: fallback allocator
+    };
+
+    struct Stats {
+        uint32_t enqueued;
+        uint32_t rejected;          // No room (POLICY_REJECT) or too large
+        uint32_t droppedOldest;
+        uint32_t expired;
+        uint32_t fallback;          // Larger than the largest size class
+        int maxItems;
+        size_t maxBytes;
+    };
+
+protected:
+    Item *head;
+    Item *tail;
+    CMemoryPool pools[MAX_CLASSES];
+    int classCount;
+    Policy policy;
+    int count;
+    size_t bytes;
+    Stats stats;
+    void *(*allocFunction)(size_t);
+    void (*freeFunction)(void *);
+
+    void unlink(Item *_item, Item *_previous);
+    void release(Item *_item);
+    Item *allocItem(size_t _length);
+
+public:
+    CMqttOutbox();
+    ~CMqttOutbox();
+
+    /* Buffer size for the size classes, _slotSizes is the room for topic and payload */
+    static size_t getBufferSize(const size_t *_slotSizes, const int *_slotCounts, int _classCount);
+
+    /**
+     * @param _buffer getBufferSize() bytes, NULL: only the fallback allocator
+     * @param _slotSizes ascending
+     * @param _alloc/_free fallback for large messages, NULL: they get rejected
+     */
+    void Setup(void *_buffer, const size_t *_slotSizes, const int *_slotCounts, int _classCount, Policy _policy,
+               void *(*_alloc)(size_t) = NULL, void (*_free)(void *) = NULL);
+
+    /* Copy of the message (_data followed by _remaining), NULL if it gets rejected */
+    Item *Enqueue(const uint8_t *_data, size_t _length, const uint8_t *_remaining, size_t _remainingLength,
+                  int _msgId, int _msgType, int _qos, long long _tick);
+
+    Item *Get(int _msgId);
+    Item *Dequeue(int _pending, long long *_tick);     // Oldest message in this state
+
+    bool Delete(int _msgId, int _msgType);
+    void DeleteMsgId(int _msgId);
+    void DeleteMsgType(int _msgType);
+    bool DeleteItem(Item *_item);
+    int DeleteExpired(long long _tick, long long _timeout);
+    int DeleteSingleExpired(long long _tick, long long _timeout);  // msgId of the deleted message or -1
+    void DeleteAll();
+
+    bool SetPending(int _msgId, int _pending);
+    bool SetTick(int _msgId, long long _tick);
+
+    int getCount() { return count; };
+    size_t getBytes() { return bytes; };
+    int getClassCount() { return classCount; };
+    int getUsedSlots(int _class) { return pools[_class].getUsedSlots(); };
+    Stats getStats() { return stats; };
+    std::string getStatus();
+};
+
+#endif //CMQTTOUTBOX_H
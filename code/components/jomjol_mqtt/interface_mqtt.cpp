@@ -20,6 +20,7 @@ static const char *TAG = "MQTT IF";
 
 std::map<std::string, std::function<void()>>* connectFunktionMap = NULL;  
 std::map<std::string, std::function<bool(std::string, char*, int)>>* subscribeFunktionMap = NULL;
+static std::function<void(int)> publishedFunction;
 
 int failedOnRound = -1;
 int MQTTReconnectCnt = 0;
@@ -40,14 +41,14 @@ int keepalive;
 bool SetRetainFlag;
 void (*callbackOnConnected)(std::string, bool) = NULL;
 
-bool MQTTPublish(std::string _key, std::string _content, int qos, bool retained_flag) 
+bool MQTTPublish(std::string _key, std::string _content, int qos, bool retained_flag, int *_msgId) 
 {
     if (!mqtt_enabled) {                            // MQTT sevice not started / configured (MQTT_Init not called before)      
         return false;
     }
 
     if (failedOnRound == getCountFlowRounds()) {    // we already failed in this round, do not retry until the next round
-        return true; // Fail quietly
+        return false; // Fail quietly, readings get kept for later by the caller
     }
 
     #ifdef DEBUG_DETAIL_ON  
@@ -86,6 +87,10 @@ bool MQTTPublish(std::string _key, std::string _content, int qos, bool retained_
         }
 
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Published topic: " + _key + ", content: " + _content + " (msg_id=" + std::to_string(msg_id) + ")");
+
+        if (_msgId != NULL) {
+            *_msgId = msg_id;
+        }
         return true;
     }
     else {
@@ -129,6 +134,9 @@ static esp_err_t mqtt_event_handler_cb(esp_mqtt_event_handle_t event) {
         
         case MQTT_EVENT_PUBLISHED:
             ESP_LOGD(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+            if (publishedFunction) {
+                publishedFunction(event->msg_id);
+            }
             break;
         
         case MQTT_EVENT_DATA:
@@ -476,6 +484,10 @@ void MQTTconnected(){
     }
 }
 
+void MQTTregisterPublishedFunction(std::function<void(int)> func) {
+    publishedFunction = func;
+}
+
 void MQTTregisterConnectFunction(std::string name, std::function<void()> func){
     ESP_LOGD(TAG, "MQTTregisteronnectFunction %s\r\n", name.c_str());
     if (connectFunktionMap == NULL) {
@@ -16,7 +16,10 @@ bool MQTT_Configure(std::string _mqttURI, std::string _clientid, std::string _us
 int MQTT_Init();
 void MQTTdestroy_client(bool _disable);
 
-bool MQTTPublish(std::string _key, std::string _content, int qos, bool retained_flag = 1);            // retained Flag as Standart
+bool MQTTPublish(std::string _key, std::string _content, int qos, bool retained_flag = 1, int *_msgId = NULL); // retained Flag as Standart
+
+/* Called by the MQTT task when the broker acknowledged a message (QoS > 0) */
+void MQTTregisterPublishedFunction(std::function<void(int)> func);
 
 bool getMQTTisEnabled();
 bool getMQTTisConnected();
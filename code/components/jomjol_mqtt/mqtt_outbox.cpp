@@ -0,0 +1,207 @@
+/* Outbox of the MQTT client, replaces https://github.com/espressif/esp-mqtt/blob/master/lib/mqtt_outbox.c
+ * The messages are kept in fixed slots of a pool which gets allocated in the PSRAM at boot (see CMqttOutbox).
+ * Allocating every message on the PSRAM heap saved 10 kBytes of internal RAM (https://github.com/jomjol/AI-on-the-edge-device/pull/2113),
+ * but fragmented the PSRAM until the model could not be loaded anymore (https://github.com/jomjol/AI-on-the-edge-device/issues/2200).
+ * The outbox functions get called by the MQTT client with its lock taken.
+*/
+#include "mqtt_outbox.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "CMqttOutbox.h"
+#include "ClassLogFile.h"
+#include "../../include/defines.h"
+
+#ifdef CONFIG_MQTT_CUSTOM_OUTBOX
+static const char *TAG = "outbox";
+static const size_t poolSlotSizes[] = MQTT_OUTBOX_SLOT_SIZES;
+static const int poolSlotCounts[] = MQTT_OUTBOX_SLOT_COUNTS;
+static void *poolBuffer = NULL;
+static CMqttOutbox *poolOutbox = NULL;      // Outbox which uses the pool (there is only one MQTT client)
+
+
+static void *outbox_fallback_malloc(size_t _size)
+{
+    return heap_caps_malloc(_size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+}
+
+
+static void outbox_fallback_free(void *_ptr)
+{
+    heap_caps_free(_ptr);
+}
+#endif /* CONFIG_MQTT_CUSTOM_OUTBOX */
+
+
+bool mqtt_outbox_reserve(void)
+{
+#ifdef CONFIG_MQTT_CUSTOM_OUTBOX
+    if (poolBuffer != NULL) {
+        return true;
+    }
+
+    int classes = sizeof(poolSlotSizes) / sizeof(poolSlotSizes[0]);
+    size_t size = CMqttOutbox::getBufferSize(poolSlotSizes, poolSlotCounts, classes);
+
+    poolBuffer = heap_caps_malloc(size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+    if (poolBuffer == NULL) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Failed to allocate the MQTT outbox pool (" + std::to_string(size) + " bytes), using the heap");
+        return false;
+    }
+
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "MQTT outbox pool: " + std::to_string(size) + " bytes");
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+std::string mqtt_outbox_get_status(void)
+{
+#ifdef CONFIG_MQTT_CUSTOM_OUTBOX
+    if (poolOutbox != NULL) {
+        return poolOutbox->getStatus();
+    }
+    return "not in use";
+#else
+    return "not used (CONFIG_MQTT_CUSTOM_OUTBOX)";
+#endif
+}
+
+
+#ifdef CONFIG_MQTT_CUSTOM_OUTBOX
+struct outbox_list_t {
+    CMqttOutbox outbox;
+};
+
+#define ITEM(item) ((CMqttOutbox::Item *)(item))
+#define HANDLE(item) ((outbox_item_handle_t)(item))
+
+
+outbox_handle_t outbox_init(void)
+{
+    outbox_handle_t outbox = new outbox_list_t;
+
+    if ((poolOutbox == NULL) && (poolBuffer != NULL)) {
+        outbox->outbox.Setup(poolBuffer, poolSlotSizes, poolSlotCounts, sizeof(poolSlotSizes) / sizeof(poolSlotSizes[0]),
+                             MQTT_OUTBOX_POLICY, outbox_fallback_malloc, outbox_fallback_free);
+        poolOutbox = &outbox->outbox;
+    }
+    else {
+        // No pool (or already in use): every message on the heap as before
+        outbox->outbox.Setup(NULL, NULL, NULL, 0, CMqttOutbox::POLICY_REJECT, outbox_fallback_malloc, outbox_fallback_free);
+    }
+
+    return outbox;
+}
+
+outbox_item_handle_t outbox_enqueue(outbox_handle_t outbox, outbox_message_handle_t message, outbox_tick_t tick)
+{
+    CMqttOutbox::Item *item = outbox->outbox.Enqueue(message->data, message->len, message->remaining_data, message->remaining_len,
+                                                     message->msg_id, message->msg_type, message->msg_qos, tick);
+    if (item == NULL) {
+        ESP_LOGW(TAG, "Outbox full, message rejected (msgid=%d, len=%d)", message->msg_id, message->len + message->remaining_len);
+        return NULL;
+    }
+
+    ESP_LOGD(TAG, "ENQUEUE msgid=%d, msg_type=%d, len=%d, size=%d", message->msg_id, message->msg_type, (int)item->length, outbox_get_size(outbox));
+    return HANDLE(item);
+}
+
+outbox_item_handle_t outbox_get(outbox_handle_t outbox, int msg_id)
+{
+    return HANDLE(outbox->outbox.Get(msg_id));
+}
+
+outbox_item_handle_t outbox_dequeue(outbox_handle_t outbox, pending_state_t pending, outbox_tick_t *tick)
+{
+    return HANDLE(outbox->outbox.Dequeue(pending, tick));
+}
+
+esp_err_t outbox_delete_item(outbox_handle_t outbox, outbox_item_handle_t item_to_delete)
+{
+    return outbox->outbox.DeleteItem(ITEM(item_to_delete)) ? ESP_OK : ESP_FAIL;
+}
+
+uint8_t *outbox_item_get_data(outbox_item_handle_t item,  size_t *len, uint16_t *msg_id, int *msg_type, int *qos)
+{
+    if (item) {
+        *len = ITEM(item)->length;
+        *msg_id = ITEM(item)->msgId;
+        *msg_type = ITEM(item)->msgType;
+        *qos = ITEM(item)->qos;
+        return ITEM(item)->data;
+    }
+    return NULL;
+}
+
+esp_err_t outbox_delete(outbox_handle_t outbox, int msg_id, int msg_type)
+{
+    if (outbox->outbox.Delete(msg_id, msg_type)) {
+        ESP_LOGD(TAG, "DELETED msgid=%d, msg_type=%d, remain size=%d", msg_id, msg_type, outbox_get_size(outbox));
+        return ESP_OK;
+    }
+    return ESP_FAIL;
+}
+
+esp_err_t outbox_delete_msgid(outbox_handle_t outbox, int msg_id)
+{
+    outbox->outbox.DeleteMsgId(msg_id);
+    return ESP_OK;
+}
+
+esp_err_t outbox_set_pending(outbox_handle_t outbox, int msg_id, pending_state_t pending)
+{
+    return outbox->outbox.SetPending(msg_id, pending) ? ESP_OK : ESP_FAIL;
+}
+
+pending_state_t outbox_item_get_pending(outbox_item_handle_t item)
+{
+    if (item) {
+        return (pending_state_t)ITEM(item)->pending;
+    }
+    return QUEUED;
+}
+
+esp_err_t outbox_set_tick(outbox_handle_t outbox, int msg_id, outbox_tick_t tick)
+{
+    return outbox->outbox.SetTick(msg_id, tick) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t outbox_delete_msgtype(outbox_handle_t outbox, int msg_type)
+{
+    outbox->outbox.DeleteMsgType(msg_type);
+    return ESP_OK;
+}
+
+int outbox_delete_single_expired(outbox_handle_t outbox, outbox_tick_t current_tick, outbox_tick_t timeout)
+{
+    return outbox->outbox.DeleteSingleExpired(current_tick, timeout);
+}
+
+int outbox_delete_expired(outbox_handle_t outbox, outbox_tick_t current_tick, outbox_tick_t timeout)
+{
+    return outbox->outbox.DeleteExpired(current_tick, timeout);
+}
+
+int outbox_get_size(outbox_handle_t outbox)
+{
+    return (int)outbox->outbox.getBytes();
+}
+
+void outbox_delete_all_items(outbox_handle_t outbox)
+{
+    outbox->outbox.DeleteAll();
+}
+
+void outbox_destroy(outbox_handle_t outbox)
+{
+    if (poolOutbox == &outbox->outbox) {
+        poolOutbox = NULL;
+    }
+
+    delete outbox;      // Gives back all messages
+}
+
+#endif /* CONFIG_MQTT_CUSTOM_OUTBOX */
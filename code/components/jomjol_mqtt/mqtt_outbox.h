@@ -6,6 +6,8 @@
 #ifndef _MQTT_OUTOBX_H_
 #define _MQTT_OUTOBX_H_
 //#include "platform.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
 
 #ifdef  __cplusplus
@@ -60,7 +62,15 @@ int outbox_get_size(outbox_handle_t outbox);
 void outbox_destroy(outbox_handle_t outbox);
 void outbox_delete_all_items(outbox_handle_t outbox);
 
+/* Allocate the slot pool of the outbox (at boot, before the MQTT client gets started), false: messages use the heap */
+bool mqtt_outbox_reserve(void);
+
 #ifdef  __cplusplus
 }
+
+#include <string>
+
+/* Usage and counters of the outbox, human readable */
+std::string mqtt_outbox_get_status(void);
 #endif
 #endif
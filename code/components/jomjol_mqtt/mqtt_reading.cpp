@@ -0,0 +1,71 @@
+#include "mqtt_reading.h"
+
+#include "CJsonWriter.h"
+
+
+static void write_reading(CJsonWriter *_json, const MqttReading &_reading)
+{
+    _json->BeginObject();
+    _json->Field("value", _reading.value);
+    _json->Field("raw", _reading.raw);
+    _json->Field("pre", _reading.pre);
+    _json->Field("error", _reading.error);
+    _json->Field("rate", _reading.rate);
+    _json->Field("rate_per_time_unit", _reading.ratePerTimeUnit);
+    _json->Field("rate_per_digitization_round", _reading.changeAbsolute);
+    _json->Field("timestamp", _reading.timestamp);
+    _json->EndObject();
+}
+
+
+std::string mqtt_reading_json(const MqttReading &_reading)
+{
+    char buffer[128];
+    std::string json;
+    CJsonWriter writer(buffer, sizeof(buffer), CJsonWriter::StringSink(&json));
+
+    json.reserve(256);
+    write_reading(&writer, _reading);
+    writer.Flush();
+    return json;
+}
+
+
+std::string mqtt_readings_json(const std::vector<MqttReading> &_readings)
+{
+    char buffer[128];
+    std::string json;
+    CJsonWriter writer(buffer, sizeof(buffer), CJsonWriter::StringSink(&json));
+
+    json.reserve(256 * _readings.size() + 2);
+    writer.BeginObject();
+
+    for (size_t i = 0; i < _readings.size(); ++i) {
+        writer.Key(_readings[i].name.c_str());
+        write_reading(&writer, _readings[i]);
+    }
+
+    writer.EndObject();
+    writer.Flush();
+    return json;
+}
+
+
+std::string mqtt_reading_subtopic(MqttPublishMode _mode, std::string _name)
+{
+    if (_mode == MQTT_PUBLISH_DEVICE) {
+        return "readings";
+    }
+
+    return (_name == "default") ? "json" : _name + "/json";
+}
+
+
+std::string mqtt_reading_template_path(MqttPublishMode _mode, std::string _name)
+{
+    if (_mode == MQTT_PUBLISH_DEVICE) {
+        return "value_json['" + _name + "']";
+    }
+
+    return "value_json";
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#ifndef MQTTREADING_H
+#define MQTTREADING_H
+
+#include <string>
+#include <vector>
+
+
+/* How the readings of a round get published, see parameter PublishMode */
+enum MqttPublishMode {
+    MQTT_PUBLISH_LEGACY = 0,        // One topic per field and number (value, error, rate, ...) plus the JSON
+    MQTT_PUBLISH_COMPACT = 1,       // One JSON message per number (<number>/json)
+    MQTT_PUBLISH_DEVICE = 2,        // One JSON message with all numbers (readings)
+};
+
+/* Fields of a number which get published */
+struct MqttReading {
+    std::string name;               // "default" for the unnamed number
+    std::string value;
+    std::string raw;
+    std::string pre;
+    std::string error;
+    std::string rate;               // Unit per minute
+    std::string ratePerTimeUnit;    // According to the meter type
+    std::string changeAbsolute;     // Since the last round
+    std::string timestamp;
+};
+
+/* {"value":"...","raw":"...",...}, all fields are strings and always present */
+std::string mqtt_reading_json(const MqttReading &_reading);
+
+/* {"<name>":{<reading>},...} */
+std::string mqtt_readings_json(const std::vector<MqttReading> &_readings);
+
+/* Topic of the JSON message below the main topic: "json", "<name>/json" or "readings" */
+std::string mqtt_reading_subtopic(MqttPublishMode _mode, std::string _name);
+
+/* Path of the reading in a Homeassistant value template: "value_json" or "value_json['<name>']" */
+std::string mqtt_reading_template_path(MqttPublishMode _mode, std::string _name);
+
+#endif //MQTTREADING_H
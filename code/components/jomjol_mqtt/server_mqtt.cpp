@@ -4,6 +4,8 @@
 #include <iomanip>
 #include <vector>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "ClassLogFile.h"
 #include "connect_wlan.h"
@@ -13,6 +15,8 @@
 #include "time_sntp.h"
 #include "../../include/defines.h"
 #include "basic_auth.h"
+#include "CJsonWriter.h"
+#include "CDiscoveryCache.h"
 
 
 
@@ -34,7 +38,13 @@ float roundInterval; // Minutes
 int keepAlive = 0; // Seconds
 bool retainFlag;
 static std::string maintopic, domoticzintopic;
+static MqttPublishMode publishMode = MQTT_PUBLISH_COMPACT;
 bool sendingOf_DiscoveryAndStaticTopics_scheduled = true; // Set it to true to make sure it gets sent at least once after startup
+static CDiscoveryCache discoveryCache;                      // Discovery topics the broker already has, see MQTT_DISCOVERY_CACHE_FILE
+static SemaphoreHandle_t discoveryMutex = NULL;             // Flow task and MQTT task (acknowledges) use the cache
+static bool discoveryCacheLoaded = false;
+static bool discoveryCacheClear = false;                   // Publish all topics in the next discovery run
+static int discoveryPublished, discoveryUnchanged;          // Of the last discovery run
 
 
 
@@ -55,6 +65,24 @@ void mqttServer_setMeterType(std::string _meterType, std::string _valueUnit, std
  * Takes any multi-level MQTT-topic and returns the last topic level as nodeId
  * see https://www.hivemq.com/blog/mqtt-essentials-part-5-mqtt-topics-best-practices/ for details about MQTT topics
 */
+/* False before register_server_mqtt_uri(), the cache is not used then (all topics get published) */
+static bool discovery_lock(void) {
+    if (discoveryMutex == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(discoveryMutex, portMAX_DELAY);
+    return true;
+}
+
+/* MQTT task: the topic is known to the broker only now, a message which got dropped from the outbox never gets here */
+static void discovery_acknowledged(int _msgId) {
+    if (discovery_lock()) {
+        discoveryCache.Acknowledged(_msgId);
+        xSemaphoreGive(discoveryMutex);
+    }
+}
+
 std::string createNodeId(std::string &topic) {
     auto splitPos = topic.find_last_of('/');
     return (splitPos == std::string::npos) ? topic : topic.substr(splitPos + 1);
@@ -62,7 +90,7 @@ std::string createNodeId(std::string &topic) {
 
 bool sendHomeAssistantDiscoveryTopic(std::string group, std::string field,
     std::string name, std::string icon, std::string unit, std::string deviceClass, std::string stateClass, std::string entityCategory,
-    int qos) {
+    int qos, std::string readingName = "") {
     std::string version = std::string(libfive_git_version());
 
     if (version == "") {
@@ -98,67 +126,168 @@ bool sendHomeAssistantDiscoveryTopic(std::string group, std::string field,
     }
 
     /* See https://www.home-assistant.io/docs/mqtt/discovery/ */
-    payload = string("{")  +
-        "\"~\": \"" + maintopic + "\","  +
-        "\"unique_id\": \"" + maintopic + "-" + configTopic + "\","  +
-        "\"object_id\": \"" + maintopic + "_" + configTopic + "\","  + // This used to generate the Entity ID
-        "\"name\": \"" + name + "\","  +
-        "\"icon\": \"mdi:" + icon + "\",";        
-
-    if (group != "") {
+    char buffer[JSON_WRITER_BUFFER];
+    CJsonWriter json(buffer, sizeof(buffer), CJsonWriter::StringSink(&payload));
+
+    payload.reserve(768);
+    json.BeginObject();
+    json.Field("~", maintopic);
+    json.Field("unique_id", maintopic + "-" + configTopic);
+    json.Field("object_id", maintopic + "_" + configTopic); // This used to generate the Entity ID
+    json.Field("name", name);
+    json.Field("icon", "mdi:" + icon);
+
+    if (readingName != "" && publishMode != MQTT_PUBLISH_LEGACY) { // Field of the JSON message of the number, see parameter PublishMode
+        std::string path = mqtt_reading_template_path(publishMode, readingName);
+        json.Field("state_topic", "~/" + mqtt_reading_subtopic(publishMode, readingName));
+
+        if (field == "problem") {
+            json.Field("value_template", "{{ 'OFF' if 'no error' in " + path + ".error else 'ON'}}");
+        }
+        else if (field == "json") {
+            json.Field("value_template", "{{ " + path + " | tojson }}");
+        }
+        else {
+            json.Field("value_template", "{{ " + path + "." + field + " }}");
+        }
+    }
+    else if (group != "") {
         if (field == "problem") { // Special case: Binary sensor which is based on error topic
-            payload += "\"state_topic\": \"~/" + group + "/error\",";
-            payload += "\"value_template\": \"{{ 'OFF' if 'no error' in value else 'ON'}}\",";
+            json.Field("state_topic", "~/" + group + "/error");
+            json.Field("value_template", "{{ 'OFF' if 'no error' in value else 'ON'}}");
         }
         else {
-            payload += "\"state_topic\": \"~/" + group + "/" + field + "\",";
+            json.Field("state_topic", "~/" + group + "/" + field);
         }
     }
     else {
         if (field == "problem") { // Special case: Binary sensor which is based on error topic
-            payload += "\"state_topic\": \"~/error\",";
-            payload += "\"value_template\": \"{{ 'OFF' if 'no error' in value else 'ON'}}\",";
+            json.Field("state_topic", "~/error");
+            json.Field("value_template", "{{ 'OFF' if 'no error' in value else 'ON'}}");
         }
         else if (field == "flowstart") { // Special case: Button
-            payload += "\"cmd_t\":\"~/ctrl/flow_start\","; // Add command topic
+            json.Field("cmd_t", "~/ctrl/flow_start"); // Add command topic
         }
         else {
-            payload += "\"state_topic\": \"~/" + field + "\",";
+            json.Field("state_topic", "~/" + field);
         }
     }
 
     if (unit != "") {
-        payload += "\"unit_of_meas\": \"" + unit + "\",";
+        json.Field("unit_of_meas", unit);
     }
 
     if (deviceClass != "") {
-        payload += "\"device_class\": \"" + deviceClass + "\",";
+        json.Field("device_class", deviceClass);
     }
 
     if (stateClass != "") {
-        payload += "\"state_class\": \"" + stateClass + "\",";
+        json.Field("state_class", stateClass);
     } 
 
     if (entityCategory != "") {
-        payload += "\"entity_category\": \"" + entityCategory + "\",";
+        json.Field("entity_category", entityCategory);
     } 
 
-    payload += 
-        "\"availability_topic\": \"~/" + std::string(LWT_TOPIC) + "\","  +
-        "\"payload_available\": \"" + LWT_CONNECTED + "\","  +
-        "\"payload_not_available\": \"" + LWT_DISCONNECTED + "\",";
-
-    payload += string("\"device\": {")  +
-        "\"identifiers\": [\"" + maintopic + "\"],"  +
-        "\"name\": \"" + maintopic + "\","  +
-        "\"model\": \"Meter Digitizer\","  +
-        "\"manufacturer\": \"AI on the Edge Device\","  +
-      "\"sw_version\": \"" + version + "\","  +
-      "\"configuration_url\": \"http://" + *getIPAddress() + "\""  +
-    "}"  +
-    "}";
-
-    return MQTTPublish(topicFull, payload, qos, true);
+    json.Field("availability_topic", "~/" + std::string(LWT_TOPIC));
+    json.Field("payload_available", LWT_CONNECTED);
+    json.Field("payload_not_available", LWT_DISCONNECTED);
+
+    json.Key("device");
+    json.BeginObject();
+    json.Key("identifiers");
+    json.BeginArray();
+    json.String(maintopic);
+    json.EndArray();
+    json.Field("name", maintopic);
+    json.Field("model", "Meter Digitizer");
+    json.Field("manufacturer", "AI on the Edge Device");
+    json.Field("sw_version", version);
+    json.Field("configuration_url", "http://" + *getIPAddress());
+    json.EndObject();
+
+    json.EndObject();
+    json.Flush();
+
+    bool changed = true;
+    if (discovery_lock()) {
+        changed = discoveryCache.isChanged(topicFull, payload);
+        xSemaphoreGive(discoveryMutex);
+    }
+
+    if (!changed) {
+        discoveryUnchanged++;
+        return true;    // The broker keeps it (retained)
+    }
+
+    // Not locked while publishing, the MQTT task may need the lock for an acknowledge meanwhile
+    int msgId = -1;
+    if (!MQTTPublish(topicFull, payload, qos, true, &msgId)) {
+        return false;
+    }
+
+    if (discovery_lock()) {
+        discoveryCache.Sent(msgId, topicFull, payload);
+        xSemaphoreGive(discoveryMutex);
+    }
+    discoveryPublished++;
+    return true;
+}
+
+
+static void discovery_cache_load(void) {
+    if (discoveryCacheLoaded) {
+        return;
+    }
+    discoveryCacheLoaded = true;
+
+    FILE *file = fopen(MQTT_DISCOVERY_CACHE_FILE, "r");
+    if (file == NULL) {
+        return;     // First start, everything gets published
+    }
+
+    std::string text;
+    char buffer[128];
+    size_t length;
+
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, length);
+    }
+    fclose(file);
+
+    if (discovery_lock()) {
+        int count = discoveryCache.Deserialize(text);
+        xSemaphoreGive(discoveryMutex);
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Homeassistant Discovery: " + std::to_string(count) + " topics known to the broker");
+    }
+}
+
+
+/* The acknowledges arrive after the discovery run, so this gets called by each round as well */
+static void discovery_cache_save(void) {
+    std::string text;
+
+    if (!discovery_lock()) {
+        return;
+    }
+    bool modified = discoveryCache.isModified();
+    if (modified) {
+        text = discoveryCache.Serialize();
+    }
+    xSemaphoreGive(discoveryMutex);
+
+    if (!modified) {
+        return;
+    }
+
+    FILE *file = fopen(MQTT_DISCOVERY_CACHE_FILE, "w");
+    if (file == NULL) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Unable to save " + std::string(MQTT_DISCOVERY_CACHE_FILE) + ", all discovery topics get published after a reboot");
+        return;
+    }
+
+    fwrite(text.c_str(), 1, text.length(), file);
+    fclose(file);
 }
 
 bool MQTThomeassistantDiscovery(int qos) {  
@@ -173,6 +302,18 @@ bool MQTThomeassistantDiscovery(int qos) {
 
 	int aFreeInternalHeapSizeBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
 
+    discovery_cache_load();
+    if (discovery_lock()) {
+        if (discoveryCacheClear) {
+            discoveryCacheClear = false;
+            discoveryCache.Clear();
+        }
+        discoveryCache.BeginRun();
+        xSemaphoreGive(discoveryMutex);
+    }
+    discoveryPublished = 0;
+    discoveryUnchanged = 0;
+
     //                                                   Group | Field            | User Friendly Name | Icon                      | Unit | Device Class     | State Class  | Entity Category
     allSendsSuccessed |= sendHomeAssistantDiscoveryTopic("",     "uptime",          "Uptime",            "clock-time-eight-outline", "s",   "",                "",            "diagnostic", qos);
     allSendsSuccessed |= sendHomeAssistantDiscoveryTopic("",     "MAC",             "MAC Address",       "network-outline",          "",    "",                "",            "diagnostic", qos);
@@ -208,20 +349,27 @@ bool MQTThomeassistantDiscovery(int qos) {
             rate_device_class = "power";
         }
 
-    //                                                       Group   | Field                       | User Friendly Name                    | Icon                       | Unit                 | Device Class     | State Class       | Entity Category | QoS
-        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "value",                      "Value",                                "gauge",                     valueUnit,             meterType,         value_state_class,  "",               qos); // State Class = "total_increasing" if <NUMBERS>.AllowNegativeRates = false, "measurement" in case of a thermometer, else use "total".
-        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "raw",                        "Raw Value",                            "raw",                       valueUnit,             meterType,         value_state_class,  "diagnostic",     qos);
-        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "error",                      "Error",                                "alert-circle-outline",      "",                    "",                "",                 "diagnostic",     qos);
+    //                                                       Group   | Field                       | User Friendly Name                    | Icon                       | Unit                 | Device Class     | State Class       | Entity Category | QoS | Reading
+        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "value",                      "Value",                                "gauge",                     valueUnit,             meterType,         value_state_class,  "",               qos, (*NUMBERS)[i]->name); // State Class = "total_increasing" if <NUMBERS>.AllowNegativeRates = false, "measurement" in case of a thermometer, else use "total".
+        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "raw",                        "Raw Value",                            "raw",                       valueUnit,             meterType,         value_state_class,  "diagnostic",     qos, (*NUMBERS)[i]->name);
+        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "error",                      "Error",                                "alert-circle-outline",      "",                    "",                "",                 "diagnostic",     qos, (*NUMBERS)[i]->name);
         /* Not announcing "rate" as it is better to use rate_per_time_unit resp. rate_per_digitization_round */
-     // allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "rate",                       "Rate (Unit/Minute)",                   "swap-vertical",             "",                    "",                "",                 "",               qos); // Legacy, always Unit per Minute
-        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "rate_per_time_unit",         "Rate (" + rateUnit + ")",              "swap-vertical",             rateUnit,              rate_device_class, "measurement",      "",               qos);
-        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "rate_per_digitization_round","Change since last Digitization round", "arrow-expand-vertical",     valueUnit,             "",                "measurement",      "",               qos); // correctly the Unit is Unit/Interval!
-        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "timestamp",                  "Timestamp",                            "clock-time-eight-outline",  "",                    "timestamp",       "",                 "diagnostic",     qos);
-        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "json",                       "JSON",                                 "code-json",                 "",                    "",                "",                 "diagnostic",     qos);
-        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "problem",                    "Problem",                              "alert-outline",             "",                    "problem",         "",                 "",               qos); // Special binary sensor which is based on error topic
+     // allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "rate",                       "Rate (Unit/Minute)",                   "swap-vertical",             "",                    "",                "",                 "",               qos, (*NUMBERS)[i]->name); // Legacy, always Unit per Minute
+        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "rate_per_time_unit",         "Rate (" + rateUnit + ")",              "swap-vertical",             rateUnit,              rate_device_class, "measurement",      "",               qos, (*NUMBERS)[i]->name);
+        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "rate_per_digitization_round","Change since last Digitization round", "arrow-expand-vertical",     valueUnit,             "",                "measurement",      "",               qos, (*NUMBERS)[i]->name); // correctly the Unit is Unit/Interval!
+        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "timestamp",                  "Timestamp",                            "clock-time-eight-outline",  "",                    "timestamp",       "",                 "diagnostic",     qos, (*NUMBERS)[i]->name);
+        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "json",                       "JSON",                                 "code-json",                 "",                    "",                "",                 "diagnostic",     qos, (*NUMBERS)[i]->name);
+        allSendsSuccessed |= sendHomeAssistantDiscoveryTopic(group,   "problem",                    "Problem",                              "alert-outline",             "",                    "problem",         "",                 "",               qos, (*NUMBERS)[i]->name); // Special binary sensor which is based on error topic
+    }
+
+    if (discovery_lock()) {
+        discoveryCache.EndRun();
+        xSemaphoreGive(discoveryMutex);
     }
+    discovery_cache_save();
 
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Successfully published all Homeassistant Discovery MQTT topics");
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Homeassistant Discovery: " + std::to_string(discoveryPublished) + " topics published, " +
+            std::to_string(discoveryUnchanged) + " unchanged");
 
     int aFreeInternalHeapSizeAfter = heap_caps_get_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
     int aMinFreeInternalHeapSize =  heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
@@ -236,6 +384,8 @@ bool MQTThomeassistantDiscovery(int qos) {
 bool publishSystemData(int qos) {
     bool allSendsSuccessed = false;
 
+    discovery_cache_save();     // Discovery topics acknowledged since the last round
+
     if (!getMQTTisConnected()) {
         LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Unable to send System Topics, we are not connected to the MQTT broker!");
         return false;
@@ -310,6 +460,7 @@ bool publishStaticData(int qos) {
 
 esp_err_t scheduleSendingDiscovery_and_static_Topics(httpd_req_t *req) {
     sendingOf_DiscoveryAndStaticTopics_scheduled = true;
+    discoveryCacheClear = true; // Requested explicitly (e.g. the broker lost its retained messages): publish all topics
     char msg[] = "MQTT Homeassistant Discovery and Static Topics scheduled";
     httpd_resp_send(req, msg, strlen(msg));  
     return ESP_OK;
@@ -347,6 +498,14 @@ void GotConnected(std::string maintopic, bool retainFlag) {
 }
 
 void register_server_mqtt_uri(httpd_handle_t server) {
+    if (discoveryMutex == NULL) {
+        discoveryMutex = xSemaphoreCreateMutex();
+        if (discoveryMutex == NULL) {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to create mutex, all discovery topics get published each time");
+        }
+    }
+    MQTTregisterPublishedFunction(discovery_acknowledged);
+
     httpd_uri_t uri = { };
     uri.method    = HTTP_GET;
 
@@ -383,5 +542,9 @@ void mqttServer_setDmoticzInTopic( std::string _domoticzintopic) {
     domoticzintopic = _domoticzintopic;
 }
 
+void mqttServer_setPublishMode(MqttPublishMode _publishMode) {
+    publishMode = _publishMode;
+}
+
 
 #endif //ENABLE_MQTT
@@ -6,6 +6,7 @@
 #define SERVERMQTT_H
 
 #include "ClassFlowDefineTypes.h"
+#include "mqtt_reading.h"
 
 void SetHomeassistantDiscoveryEnabled(bool enabled);
 void mqttServer_setParameter(std::vector<NumberPost*>* _NUMBERS, int interval, float roundInterval);
@@ -13,6 +14,7 @@ void mqttServer_setMeterType(std::string meterType, std::string valueUnit, std::
 void setMqtt_Server_Retain(bool SetRetainFlag);
 void mqttServer_setMainTopic( std::string maintopic);
 void mqttServer_setDmoticzInTopic( std::string domoticzintopic);
+void mqttServer_setPublishMode(MqttPublishMode _publishMode);
 
 
 std::string mqttServer_getMainTopic();
@@ -0,0 +1,75 @@
+#include "CTfLiteArenaInfo.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+
+
+static long getModelFileSize(std::string _modelFile)
+{
+    struct stat file_stat;
+
+    if (stat(_modelFile.c_str(), &file_stat) != 0) {
+        return -1;
+    }
+
+    return file_stat.st_size;
+}
+
+
+std::string tflite_arena_info_file(std::string _modelFile)
+{
+    return _modelFile + ".arena";
+}
+
+
+size_t tflite_read_arena_info(std::string _modelFile)
+{
+    long modelSize = getModelFileSize(_modelFile);
+    long storedModelSize = -1;
+    unsigned long arenaUsedBytes = 0;
+
+    if (modelSize < 0) {
+        return 0;
+    }
+
+    FILE *pFile = fopen(tflite_arena_info_file(_modelFile).c_str(), "r");
+
+    if (pFile == NULL) {
+        return 0;
+    }
+
+    if (fscanf(pFile, "model_size=%ld\narena_used_bytes=%lu", &storedModelSize, &arenaUsedBytes) != 2) {
+        arenaUsedBytes = 0;
+    }
+
+    fclose(pFile);
+
+    return (storedModelSize == modelSize) ? arenaUsedBytes : 0;
+}
+
+
+bool tflite_write_arena_info(std::string _modelFile, size_t _arenaUsedBytes)
+{
+    long modelSize = getModelFileSize(_modelFile);
+
+    if ((modelSize < 0) || (_arenaUsedBytes == 0)) {
+        return false;
+    }
+
+    FILE *pFile = fopen(tflite_arena_info_file(_modelFile).c_str(), "w");
+
+    if (pFile == NULL) {
+        return false;
+    }
+
+    fprintf(pFile, "model_size=%ld\narena_used_bytes=%lu\n", modelSize, (unsigned long)_arenaUsedBytes);
+    fclose(pFile);
+
+    return true;
+}
+
+
+void tflite_remove_arena_info(std::string _modelFile)
+{
+    remove(tflite_arena_info_file(_modelFile).c_str());
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#ifndef CTFLITEARENAINFO_H
+#define CTFLITEARENAINFO_H
+
+#include <string>
+#include <stddef.h>
+
+
+/**
+ * Measured Tensor Arena usage of a model, persisted next to the model file (<model>.arena).
+ * The file also holds the size of the model, so a replaced model gets measured again.
+ * Only uses the C/C++ standard library, so it is also used by the host tools.
+ */
+std::string tflite_arena_info_file(std::string _modelFile);
+
+/* Used Tensor Arena in bytes, 0 if not measured yet or the model file changed */
+size_t tflite_read_arena_info(std::string _modelFile);
+
+bool tflite_write_arena_info(std::string _modelFile, size_t _arenaUsedBytes);
+void tflite_remove_arena_info(std::string _modelFile);
+
+#endif //CTFLITEARENAINFO_H
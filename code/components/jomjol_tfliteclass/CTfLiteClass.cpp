@@ -1,17 +1,24 @@
 #include "CTfLiteClass.h"
+#include "CTfLiteArenaInfo.h"
 #include "ClassLogFile.h"
 #include "Helper.h"
 #include "psram.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "metrics_registry.h"
 #include "../../include/defines.h"
 
 #include <sys/stat.h>
+#include <new>
+#include <set>
 
 // #define DEBUG_DETAIL_ON
 
 
 static const char *TAG = "TFLITE";
 
+static std::set<std::string> arenaMeasuredModels; // Models with persisted Tensor Arena usage (checked once per boot)
+
 
 void CTfLiteClass::MakeStaticResolver()
 {
@@ -155,7 +162,11 @@ int CTfLiteClass::GetAnzOutPut(bool silent)
 void CTfLiteClass::Invoke()
 {
     if (interpreter != nullptr)
+    {
+      int64_t start = esp_timer_get_time();
       interpreter->Invoke();
+      metrics_observe("inference_duration_seconds", (esp_timer_get_time() - start) / 1000000.0);
+    }
 }
 
 
@@ -205,7 +216,11 @@ bool CTfLiteClass::MakeAllocate()
     #endif
 
     LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "CTfLiteClass::MakeAllocate");
-    this->interpreter = new tflite::MicroInterpreter(this->model, resolver, this->tensor_arena, this->kTensorArenaSize);
+    // The interpreter object only lives as long as this class (one round) -> per-round arena
+    void *interpreterMemory = psram_round_arena_malloc(std::string(TAG) + "->MicroInterpreter", sizeof(tflite::MicroInterpreter));
+    if (interpreterMemory) {
+        this->interpreter = new (interpreterMemory) tflite::MicroInterpreter(this->model, resolver, this->tensor_arena, this->kTensorArenaSize);
+    }
     LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Trying to load the model. If it crashes here, it ist most likely due to a corrupted model!");
 
     if (this->interpreter) 
@@ -214,9 +229,18 @@ bool CTfLiteClass::MakeAllocate()
         if (allocate_status != kTfLiteOk) {
             LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "AllocateTensors() failed");
 
+            if (this->kTensorArenaSize < TENSOR_ARENA_SIZE) {
+                // Shared region was sized from an outdated measurement -> measure again with the default size after a reboot
+                tflite_remove_arena_info(modelFileName);
+                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Tensor Arena (" + std::to_string(this->kTensorArenaSize) + 
+                        " bytes) too small for " + modelFileName + ", reboot to measure it again");
+            }
+
             this->GetInputDimension();   
             return false;
         }
+
+        StoreArenaUsedBytes();
     }
     else 
     {
@@ -272,8 +296,9 @@ bool CTfLiteClass::ReadFileToModel(std::string _fn)
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Model file doesn't exist: " + _fn + "!");
         return false;
     }
-    else if(size > MAX_MODEL_SIZE) {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Unable to load model '" + _fn + "'! It does not fit in the reserved shared memory in PSRAM!");
+    else if((size_t)size > psram_get_shared_model_memory_size()) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Unable to load model '" + _fn + "'! It does not fit in the reserved shared memory in PSRAM (" +
+                std::to_string(psram_get_shared_model_memory_size()) + " bytes), reboot to resize it!");
         return false;
     }
 
@@ -324,6 +349,8 @@ bool CTfLiteClass::LoadModel(std::string _fn)
       return false;
     }
 
+    modelFileName = _fn;
+
     model = tflite::GetModel(modelfile);
 
     if(model == nullptr)     
@@ -333,6 +360,43 @@ bool CTfLiteClass::LoadModel(std::string _fn)
 }
 
 
+size_t CTfLiteClass::GetArenaUsedBytes()
+{
+    if (this->interpreter == nullptr) {
+        return 0;
+    }
+
+    return this->interpreter->arena_used_bytes();
+}
+
+
+/**
+ * Persist the used Tensor Arena next to the model, once per model and boot.
+ * On the next boot the shared PSRAM region gets sized from it (see ClassMemoryPlanner).
+ */
+void CTfLiteClass::StoreArenaUsedBytes()
+{
+    if (modelFileName.empty() || (arenaMeasuredModels.count(modelFileName) > 0)) {
+        return;
+    }
+
+    size_t arenaUsed = GetArenaUsedBytes();
+    arenaMeasuredModels.insert(modelFileName);
+
+    if (tflite_read_arena_info(modelFileName) == arenaUsed) {
+        return;
+    }
+
+    if (tflite_write_arena_info(modelFileName, arenaUsed)) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Tensor Arena of " + modelFileName + ": " + std::to_string(arenaUsed) + 
+                " bytes used (" + std::to_string(this->kTensorArenaSize) + " bytes reserved)");
+    }
+    else {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Failed to store Tensor Arena usage to " + tflite_arena_info_file(modelFileName));
+    }
+}
+
+
 CTfLiteClass::CTfLiteClass()
 {
     this->model = nullptr;
@@ -340,14 +404,17 @@ CTfLiteClass::CTfLiteClass()
     this->interpreter = nullptr;
     this->input = nullptr;
     this->output = nullptr;
-    this->kTensorArenaSize = TENSOR_ARENA_SIZE;
+    this->kTensorArenaSize = psram_get_shared_tensor_arena_size();
     this->tensor_arena = (uint8_t*)psram_get_shared_tensor_arena_memory();
 }
 
 
 CTfLiteClass::~CTfLiteClass()
 {
-  delete this->interpreter;
+  if (this->interpreter) {
+    this->interpreter->~MicroInterpreter();
+    psram_round_arena_free(std::string(TAG) + "->MicroInterpreter", this->interpreter);
+  }
 
   psram_free_shared_tensor_arena_and_model_memory();
 }        
@@ -25,6 +25,7 @@ class CTfLiteClass
         uint8_t *tensor_arena;
 
         unsigned char *modelfile = NULL;
+        std::string modelFileName;
 
 
         float* input;
@@ -34,6 +35,7 @@ class CTfLiteClass
         long GetFileSize(std::string filename);
         bool ReadFileToModel(std::string _fn);
         void MakeStaticResolver();
+        void StoreArenaUsedBytes();
 
     public:
         CTfLiteClass();
@@ -52,6 +54,7 @@ class CTfLiteClass
         float GetOutputValue(int nr);
         void GetInputDimension(bool silent);
         int ReadInputDimenstion(int _dim);
+        size_t GetArenaUsedBytes();
 };
 
 #endif //CTFLITECLASS_H
\ No newline at end of file
@@ -5,9 +5,10 @@
 #include <time.h>
 #include "ClassLogFile.h"
 #include "esp_http_client.h"
+#include "http_client_pool.h"
 #include "time_sntp.h"
 #include "../../include/defines.h"
-#include <cJSON.h>
+#include "CJsonWriter.h"
 #include <ClassFlowDefineTypes.h>
 
 
@@ -17,8 +18,6 @@ std::string _webhookURI;
 std::string _webhookApiKey;
 long _lastTimestamp;
 
-static esp_err_t http_event_handler(esp_http_client_event_t *evt);
-
 void WebhookInit(std::string _uri, std::string _apiKey)
 {
     _webhookURI = _uri;
@@ -26,145 +25,109 @@ void WebhookInit(std::string _uri, std::string _apiKey)
     _lastTimestamp = 0L;
 }
 
-bool WebhookPublish(std::vector<NumberPost*>* numbers)
+std::string WebhookGetPayload(std::vector<NumberPost*>* numbers, bool *numbersWithError)
 {
-    bool numbersWithError = false;
-    cJSON *jsonArray = cJSON_CreateArray();
+    char buffer[JSON_WRITER_BUFFER];
+    std::string payload;
+    CJsonWriter json(buffer, sizeof(buffer), CJsonWriter::StringSink(&payload));
+
+    *numbersWithError = false;
+    payload.reserve(256 * (*numbers).size());
+    json.BeginArray();
 
     for (int i = 0; i < (*numbers).size(); ++i)
     {
-        string timezw = "";
-        char buffer[80];
+        char timestamp[80];
         time_t &lastPreValue = (*numbers)[i]->timeStampLastPreValue;
         struct tm* timeinfo = localtime(&lastPreValue);
         _lastTimestamp = static_cast<long>(lastPreValue);
-        strftime(buffer, 80, PREVALUE_TIME_FORMAT_OUTPUT, timeinfo);
-        timezw = std::string(buffer);
-
-        cJSON *json = cJSON_CreateObject();
-        cJSON_AddStringToObject(json, "timestamp", timezw.c_str());
-        cJSON_AddStringToObject(json, "timestampLong", std::to_string(_lastTimestamp).c_str());
-        cJSON_AddStringToObject(json, "name", (*numbers)[i]->name.c_str());
-        cJSON_AddStringToObject(json, "rawValue", (*numbers)[i]->ReturnRawValue.c_str());
-        cJSON_AddStringToObject(json, "value", (*numbers)[i]->ReturnValue.c_str());
-        cJSON_AddStringToObject(json, "preValue", (*numbers)[i]->ReturnPreValue.c_str());
-        cJSON_AddStringToObject(json, "rate", (*numbers)[i]->ReturnRateValue.c_str());
-        cJSON_AddStringToObject(json, "changeAbsolute", (*numbers)[i]->ReturnChangeAbsolute.c_str());
-        cJSON_AddStringToObject(json, "error", (*numbers)[i]->ErrorMessageText.c_str());
-        
-        cJSON_AddItemToArray(jsonArray, json);
+        strftime(timestamp, 80, PREVALUE_TIME_FORMAT_OUTPUT, timeinfo);
+
+        json.BeginObject();
+        json.Field("timestamp", timestamp);
+        json.Field("timestampLong", std::to_string(_lastTimestamp));
+        json.Field("name", (*numbers)[i]->name);
+        json.Field("rawValue", (*numbers)[i]->ReturnRawValue);
+        json.Field("value", (*numbers)[i]->ReturnValue);
+        json.Field("preValue", (*numbers)[i]->ReturnPreValue);
+        json.Field("rate", (*numbers)[i]->ReturnRateValue);
+        json.Field("changeAbsolute", (*numbers)[i]->ReturnChangeAbsolute);
+        json.Field("error", (*numbers)[i]->ErrorMessageText);
+        json.EndObject();
 
         if ((*numbers)[i]->ErrorMessage) {
-            numbersWithError = true;
+            *numbersWithError = true;
         }
     }
 
-    char *jsonString = cJSON_PrintUnformatted(jsonArray);
+    json.EndArray();
+    json.Flush();
+    return payload;
+}
 
+bool WebhookSend(std::string payload)
+{
     LogFile.WriteToFile(ESP_LOG_INFO, TAG, "sending webhook");
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "sending JSON: " + std::string(jsonString));
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "sending JSON: " + payload);
 
-    char response_buffer[MAX_HTTP_OUTPUT_BUFFER] = {0};
-    esp_http_client_config_t http_config = {
-        .url = _webhookURI.c_str(),
-        .user_agent = "ESP32 Meter reader",
-        .method = HTTP_METHOD_POST,
-        .event_handler = http_event_handler,
-        .buffer_size = MAX_HTTP_OUTPUT_BUFFER,
-        .user_data = response_buffer
-    };
-
-    esp_http_client_handle_t http_client = esp_http_client_init(&http_config);
+    esp_http_client_handle_t http_client = http_client_pool_acquire(_webhookURI, HTTP_METHOD_POST);
+    if (http_client == NULL) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to initialize HTTP client");
+        return false;
+    }
 
-    esp_http_client_set_header(http_client, "Content-Type", "application/json");
-    esp_http_client_set_header(http_client, "APIKEY", _webhookApiKey.c_str());
+    http_client_pool_set_header(http_client, "Content-Type", "application/json");
+    http_client_pool_set_header(http_client, "APIKEY", _webhookApiKey.c_str());
 
-    ESP_ERROR_CHECK(esp_http_client_set_post_field(http_client, jsonString, strlen(jsonString)));
+    esp_http_client_set_post_field(http_client, payload.c_str(), payload.length());
 
-    esp_err_t err = ESP_ERROR_CHECK_WITHOUT_ABORT(esp_http_client_perform(http_client));
+    esp_err_t err = ESP_ERROR_CHECK_WITHOUT_ABORT(http_client_pool_perform(http_client));
+    bool delivered = false;
 
     if(err == ESP_OK) {
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP request was performed");
         int status_code = esp_http_client_get_status_code(http_client);
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP status code: " + std::to_string(status_code));
+        delivered = (status_code < 500);    // A rejected request would fail again
     } else {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "HTTP request failed");
     } 
 
-    esp_http_client_cleanup(http_client);
-    cJSON_Delete(jsonArray);
-    free(jsonString);
-    return numbersWithError;    
+    http_client_pool_release(http_client, delivered);   // Connects again after an error
+    return delivered;
 }
 
 void WebhookUploadPic(ImageData *Img) {
     LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Starting WebhookUploadPic");
 
     std::string fullURI = _webhookURI + "?timestamp=" + std::to_string(_lastTimestamp);
-    char response_buffer[MAX_HTTP_OUTPUT_BUFFER] = {0};
-    esp_http_client_config_t http_config = {
-        .url = fullURI.c_str(),
-        .user_agent = "ESP32 Meter reader",
-        .method = HTTP_METHOD_PUT,
-        .event_handler = http_event_handler,
-        .buffer_size = MAX_HTTP_OUTPUT_BUFFER,
-        .user_data = response_buffer
-    };
 
-    esp_http_client_handle_t http_client = esp_http_client_init(&http_config);
+    // Same host as the JSON request, so the kept connection gets used
+    esp_http_client_handle_t http_client = http_client_pool_acquire(fullURI, HTTP_METHOD_PUT);
+    if (http_client == NULL) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to initialize HTTP client");
+        return;
+    }
 
-    esp_http_client_set_header(http_client, "Content-Type", "image/jpeg");
-    esp_http_client_set_header(http_client, "APIKEY", _webhookApiKey.c_str());
+    http_client_pool_set_header(http_client, "Content-Type", "image/jpeg");
+    http_client_pool_set_header(http_client, "APIKEY", _webhookApiKey.c_str());
 
-    esp_err_t err = ESP_ERROR_CHECK_WITHOUT_ABORT(esp_http_client_set_post_field(http_client, (const char *)Img->data, Img->size));
+    esp_http_client_set_post_field(http_client, (const char *)Img->data, Img->size);
 
-    err = ESP_ERROR_CHECK_WITHOUT_ABORT(esp_http_client_perform(http_client));
+    esp_err_t err = ESP_ERROR_CHECK_WITHOUT_ABORT(http_client_pool_perform(http_client));
+    int status_code = 0;
 
     if (err == ESP_OK) {
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP PUT request was performed successfully");
-        int status_code = esp_http_client_get_status_code(http_client);
+        status_code = esp_http_client_get_status_code(http_client);
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP status code: " + std::to_string(status_code));
     } else {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "HTTP PUT request failed");
     }
 
-    esp_http_client_cleanup(http_client);
+    http_client_pool_release(http_client, (err == ESP_OK) && (status_code < 500));
 
     LogFile.WriteToFile(ESP_LOG_INFO, TAG, "WebhookUploadPic finished");
 }
 
-
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
-{
-    switch(evt->event_id)
-    {
-        case HTTP_EVENT_ERROR:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client Error encountered");
-            break;
-        case HTTP_EVENT_ON_CONNECTED:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client connected");
-            ESP_LOGI(TAG, "HTTP Client Connected");
-            break;
-        case HTTP_EVENT_HEADERS_SENT:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client sent all request headers");
-            break;
-        case HTTP_EVENT_ON_HEADER:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Header: key=" + std::string(evt->header_key) + ", value="  + std::string(evt->header_value));
-            break;
-        case HTTP_EVENT_ON_DATA:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client data recevied: len=" + std::to_string(evt->data_len));
-            break;
-        case HTTP_EVENT_ON_FINISH:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client finished");
-            break;
-         case HTTP_EVENT_DISCONNECTED:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client Disconnected");
-            break;
-        case HTTP_EVENT_REDIRECT:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Redirect");
-            break;
-    }
-    return ESP_OK;
-}
-
 #endif //ENABLE_WEBHOOK
@@ -10,7 +10,8 @@
 #include <ClassFlowDefineTypes.h>
 
 void WebhookInit(std::string _webhookURI, std::string _apiKey);
-bool WebhookPublish(std::vector<NumberPost*>* numbers);
+std::string WebhookGetPayload(std::vector<NumberPost*>* numbers, bool *numbersWithError);
+bool WebhookSend(std::string payload);  // false if the server could not be reached
 void WebhookUploadPic(ImageData *Img);
 
 #endif //INTERFACE_WEBHOOK_H
@@ -0,0 +1,215 @@
+#include "CMetricsRegistry.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+
+void metrics_printf(char *_buffer, size_t _size, size_t *_pos, const char *_format, ...)
+{
+    va_list args;
+    char *dest = NULL;
+    size_t room = 0;
+
+    if ((_buffer != NULL) && (*_pos < _size)) {
+        dest = _buffer + *_pos;
+        room = _size - *_pos;
+    }
+
+    va_start(args, _format);
+    int length = vsnprintf(dest, room, _format, args);
+    va_end(args);
+
+    if (length > 0) {
+        *_pos += length;
+    }
+}
+
+
+CMetricsRegistry::CMetricsRegistry()
+{
+    count = 0;
+}
+
+
+int CMetricsRegistry::Find(const char *_name, const char *_labelValue)
+{
+    for (int i = 0; i < count; ++i) {
+        if (strcmp(metrics[i].name, _name) != 0) {
+            continue;
+        }
+
+        if ((_labelValue == NULL) || (strncmp(metrics[i].labelValue, _labelValue, MAX_LABEL_VALUE - 1) == 0)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+int CMetricsRegistry::Register(Type _type, const char *_name, const char *_help, const char *_labelName, const char *_labelValue,
+                               const double *_bounds, int _boundCount)
+{
+    int id = Find(_name, (_labelName != NULL) ? ((_labelValue != NULL) ? _labelValue : "") : NULL);
+    if (id >= 0) {
+        return id;
+    }
+
+    if (count >= MAX_METRICS) {
+        return -1;
+    }
+
+    Metric &metric = metrics[count];
+    memset(&metric, 0, sizeof(metric));
+    metric.name = _name;
+    metric.help = _help;
+    metric.type = _type;
+    metric.labelName = _labelName;
+
+    if ((_labelName != NULL) && (_labelValue != NULL)) {
+        strncpy(metric.labelValue, _labelValue, MAX_LABEL_VALUE - 1);
+    }
+
+    if (_type == HISTOGRAM) {
+        metric.bounds = _bounds;
+        metric.boundCount = (_boundCount < MAX_BUCKETS) ? _boundCount : MAX_BUCKETS;
+    }
+
+    return count++;
+}
+
+
+void CMetricsRegistry::Inc(int _id, double _delta)
+{
+    if ((_id >= 0) && (_id < count)) {
+        metrics[_id].value += _delta;
+    }
+}
+
+
+void CMetricsRegistry::Set(int _id, double _value)
+{
+    if ((_id >= 0) && (_id < count)) {
+        metrics[_id].value = _value;
+    }
+}
+
+
+void CMetricsRegistry::Observe(int _id, double _value)
+{
+    if ((_id < 0) || (_id >= count)) {
+        return;
+    }
+
+    Metric &metric = metrics[_id];
+    metric.value += _value;
+    metric.count++;
+
+    for (int i = 0; i < metric.boundCount; ++i) {
+        if (_value <= metric.bounds[i]) {
+            metric.bucketCounts[i]++;
+            break;
+        }
+    }
+}
+
+
+double CMetricsRegistry::getValue(int _id)
+{
+    return ((_id >= 0) && (_id < count)) ? metrics[_id].value : 0;
+}
+
+
+uint32_t CMetricsRegistry::getCount(int _id)
+{
+    return ((_id >= 0) && (_id < count)) ? metrics[_id].count : 0;
+}
+
+
+/* {stage="TakeImage",le="0.5"}, nothing without labels */
+void CMetricsRegistry::renderLabels(char *_buffer, size_t _size, size_t *_pos, const Metric &_metric, const char *_le)
+{
+    if ((_metric.labelName == NULL) && (_le == NULL)) {
+        return;
+    }
+
+    metrics_printf(_buffer, _size, _pos, "{");
+
+    if (_metric.labelName != NULL) {
+        metrics_printf(_buffer, _size, _pos, "%s=\"%s\"%s", _metric.labelName, _metric.labelValue, (_le != NULL) ? "," : "");
+    }
+
+    if (_le != NULL) {
+        metrics_printf(_buffer, _size, _pos, "le=\"%s\"", _le);
+    }
+
+    metrics_printf(_buffer, _size, _pos, "}");
+}
+
+
+void CMetricsRegistry::renderFamily(char *_buffer, size_t _size, size_t *_pos, const char *_prefix, int _first)
+{
+    static const char *typeNames[] = { "counter", "gauge", "histogram" };
+    const Metric &family = metrics[_first];
+
+    metrics_printf(_buffer, _size, _pos, "# HELP %s_%s %s\n# TYPE %s_%s %s\n",
+                   _prefix, family.name, family.help, _prefix, family.name, typeNames[family.type]);
+
+    for (int i = _first; i < count; ++i) {
+        const Metric &metric = metrics[i];
+
+        if (strcmp(metric.name, family.name) != 0) {
+            continue;
+        }
+
+        if (metric.type != HISTOGRAM) {
+            metrics_printf(_buffer, _size, _pos, "%s_%s", _prefix, metric.name);
+            renderLabels(_buffer, _size, _pos, metric, NULL);
+            metrics_printf(_buffer, _size, _pos, " %.10g\n", metric.value);
+            continue;
+        }
+
+        uint32_t cumulative = 0;
+        char le[24];
+
+        for (int b = 0; b < metric.boundCount; ++b) {
+            cumulative += metric.bucketCounts[b];
+            snprintf(le, sizeof(le), "%g", metric.bounds[b]);
+
+            metrics_printf(_buffer, _size, _pos, "%s_%s_bucket", _prefix, metric.name);
+            renderLabels(_buffer, _size, _pos, metric, le);
+            metrics_printf(_buffer, _size, _pos, " %lu\n", (unsigned long)cumulative);
+        }
+
+        metrics_printf(_buffer, _size, _pos, "%s_%s_bucket", _prefix, metric.name);
+        renderLabels(_buffer, _size, _pos, metric, "+Inf");
+        metrics_printf(_buffer, _size, _pos, " %lu\n", (unsigned long)metric.count);
+
+        metrics_printf(_buffer, _size, _pos, "%s_%s_sum", _prefix, metric.name);
+        renderLabels(_buffer, _size, _pos, metric, NULL);
+        metrics_printf(_buffer, _size, _pos, " %.10g\n", metric.value);
+
+        metrics_printf(_buffer, _size, _pos, "%s_%s_count", _prefix, metric.name);
+        renderLabels(_buffer, _size, _pos, metric, NULL);
+        metrics_printf(_buffer, _size, _pos, " %lu\n", (unsigned long)metric.count);
+    }
+}
+
+
+size_t CMetricsRegistry::Render(char *_buffer, size_t _size, const char *_prefix, size_t _pos)
+{
+    for (int i = 0; i < count; ++i) {
+        bool rendered = false;
+
+        for (int j = 0; (j < i) && !rendered; ++j) {
+            rendered = (strcmp(metrics[j].name, metrics[i].name) == 0);
+        }
+
+        if (!rendered) {
+            renderFamily(_buffer, _size, &_pos, _prefix, i);
+        }
+    }
+
+    return _pos;
+}
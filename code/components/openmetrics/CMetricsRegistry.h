@@ -0,0 +1,82 @@
+#pragma once
+
+#ifndef CMETRICSREGISTRY_H
+#define CMETRICSREGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Counters, gauges and histograms for the /metrics endpoint
+ * All metrics live in a fixed table, names, help texts and bucket bounds are static strings resp. arrays,
+ * so updating a metric and rendering the text format do not allocate memory. Metrics with the same name
+ * form one family (e.g. one histogram per flow stage, distinguished by a label).
+ * The class only uses the C/C++ standard library, the caller is responsible for locking.
+ */
+class CMetricsRegistry
+{
+public:
+    static const int MAX_METRICS = 48;
+    static const int MAX_BUCKETS = 12;
+    static const int MAX_LABEL_VALUE = 24;
+
+    enum Type {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+protected:
+    struct Metric {
+        const char *name;
+        const char *help;
+        Type type;
+        const char *labelName;          // NULL: no label
+        char labelValue[MAX_LABEL_VALUE];
+        double value;                   // Histogram: sum of the observations
+        const double *bounds;           // Histogram: upper bounds of the buckets, ascending
+        int boundCount;
+        uint32_t bucketCounts[MAX_BUCKETS];
+        uint32_t count;                 // Histogram: observations
+    };
+
+    Metric metrics[MAX_METRICS];
+    int count;
+
+    void renderFamily(char *_buffer, size_t _size, size_t *_pos, const char *_prefix, int _first);
+    void renderLabels(char *_buffer, size_t _size, size_t *_pos, const Metric &_metric, const char *_le);
+
+public:
+    CMetricsRegistry();
+
+    /**
+     * Id of the metric with this name and label value, it gets added if it does not exist yet
+     * @param _labelValue gets copied (truncated to MAX_LABEL_VALUE - 1 characters)
+     * @return -1 if the table is full
+     */
+    int Register(Type _type, const char *_name, const char *_help, const char *_labelName = NULL, const char *_labelValue = NULL,
+                 const double *_bounds = NULL, int _boundCount = 0);
+
+    int Find(const char *_name, const char *_labelValue = NULL);
+
+    void Inc(int _id, double _delta = 1);
+    void Set(int _id, double _value);
+    void Observe(int _id, double _value);
+
+    double getValue(int _id);
+    uint32_t getCount(int _id);
+    int getMetricCount() { return count; };
+
+    /**
+     * Text format of all metrics, families in the order they got registered
+     * @return length of the complete output like snprintf(), the output got truncated if it is >= _size
+     */
+    size_t Render(char *_buffer, size_t _size, const char *_prefix, size_t _pos = 0);
+};
+
+
+/* Appends to _buffer at *_pos like snprintf(), *_pos counts the full length also if the output got truncated */
+void metrics_printf(char *_buffer, size_t _size, size_t *_pos, const char *_format, ...);
+
+#endif //CMETRICSREGISTRY_H
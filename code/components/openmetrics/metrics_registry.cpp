@@ -0,0 +1,162 @@
+#include "metrics_registry.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "CMetricsRegistry.h"
+#include "openmetrics.h"
+#include "../../include/defines.h"
+
+static const char *TAG = "METRICS";
+
+typedef struct metric_definition {
+    const char *name;
+    const char *help;
+    CMetricsRegistry::Type type;
+    const char *labelName;
+    const double *bounds;
+    int boundCount;
+} metric_definition_t;
+
+// Seconds
+static const double roundBuckets[] = { 5, 10, 20, 30, 45, 60, 90, 120, 180, 300 };
+static const double stageBuckets[] = { 0.01, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30 };
+static const double inferenceBuckets[] = { 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5 };
+static const double sdWriteBuckets[] = { 0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1 };
+
+#define BUCKETS(_bounds) _bounds, sizeof(_bounds) / sizeof(_bounds[0])
+
+static const metric_definition_t metricDefinitions[] = {
+    { "cpu_temperature_celsius",    "current cpu temperature in celsius",               CMetricsRegistry::GAUGE,        NULL,           NULL, 0 },
+    { "rssi_dbm",                   "current WiFi signal strength in dBm",              CMetricsRegistry::GAUGE,        NULL,           NULL, 0 },
+    { "memory_heap_free_bytes",     "available heap memory",                            CMetricsRegistry::GAUGE,        NULL,           NULL, 0 },
+    { "memory_heap_min_free_bytes", "lowest available heap memory since device startup", CMetricsRegistry::GAUGE,      "memory",       NULL, 0 },
+    { "uptime_seconds",             "device uptime in seconds",                         CMetricsRegistry::GAUGE,        NULL,           NULL, 0 },
+    { "rounds_total",               "data aquisition rounds since device startup",      CMetricsRegistry::COUNTER,      NULL,           NULL, 0 },
+    { "round_duration_seconds",     "duration of a data aquisition round",              CMetricsRegistry::HISTOGRAM,    NULL,           BUCKETS(roundBuckets) },
+    { "stage_duration_seconds",     "duration of a flow step within a round",           CMetricsRegistry::HISTOGRAM,    "stage",        BUCKETS(stageBuckets) },
+    { "inference_duration_seconds", "duration of a single model inference",             CMetricsRegistry::HISTOGRAM,    NULL,           BUCKETS(inferenceBuckets) },
+    { "publish_failures_total",     "rounds in which a destination could not be reached", CMetricsRegistry::COUNTER,    "destination",  NULL, 0 },
+    { "sd_write_duration_seconds",  "duration of a log write to the SD card",           CMetricsRegistry::HISTOGRAM,    NULL,           BUCKETS(sdWriteBuckets) },
+};
+
+static CMetricsRegistry registry;
+static SemaphoreHandle_t registryMutex = NULL;
+static char *renderBuffer = NULL;       // Kept between the scrapes
+static size_t renderBufferSize = 0;
+
+
+void metrics_init(void)
+{
+    if (registryMutex != NULL) {
+        return;
+    }
+
+    // Metrics without label in a fixed order, the others get added with their first label value
+    for (int i = 0; i < sizeof(metricDefinitions) / sizeof(metricDefinitions[0]); ++i) {
+        const metric_definition_t &definition = metricDefinitions[i];
+
+        if (definition.labelName == NULL) {
+            registry.Register(definition.type, definition.name, definition.help, NULL, NULL, definition.bounds, definition.boundCount);
+        }
+    }
+
+    registryMutex = xSemaphoreCreateMutex();
+    if (registryMutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create mutex, metrics disabled");
+    }
+}
+
+
+/* False before metrics_init(), the values get dropped then */
+static bool metrics_lock(void)
+{
+    if (registryMutex == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(registryMutex, portMAX_DELAY);
+    return true;
+}
+
+
+/* Id of the metric, -1 if the name is unknown or the registry is full. Call with the lock held */
+static int metrics_get_id(const char *_name, const char *_label)
+{
+    for (int i = 0; i < sizeof(metricDefinitions) / sizeof(metricDefinitions[0]); ++i) {
+        const metric_definition_t &definition = metricDefinitions[i];
+
+        if (strcmp(definition.name, _name) == 0) {
+            return registry.Register(definition.type, definition.name, definition.help, definition.labelName,
+                                     (definition.labelName != NULL) ? ((_label != NULL) ? _label : "") : NULL,
+                                     definition.bounds, definition.boundCount);
+        }
+    }
+
+    return -1;
+}
+
+
+void metrics_set(const char *_name, double _value, const char *_label)
+{
+    if (metrics_lock()) {
+        registry.Set(metrics_get_id(_name, _label), _value);
+        xSemaphoreGive(registryMutex);
+    }
+}
+
+
+void metrics_inc(const char *_name, const char *_label)
+{
+    if (metrics_lock()) {
+        registry.Inc(metrics_get_id(_name, _label));
+        xSemaphoreGive(registryMutex);
+    }
+}
+
+
+void metrics_observe(const char *_name, double _value, const char *_label)
+{
+    if (metrics_lock()) {
+        registry.Observe(metrics_get_id(_name, _label), _value);
+        xSemaphoreGive(registryMutex);
+    }
+}
+
+
+const char *metrics_render(const char *_prefix, const std::vector<NumberPost *> &_numbers, size_t *_length)
+{
+    if (!metrics_lock()) {
+        return NULL;
+    }
+
+    while (true) {
+        size_t length = renderSequenceMetrics(renderBuffer, renderBufferSize, 0, _prefix, _numbers);
+        length = registry.Render(renderBuffer, renderBufferSize, _prefix, length);
+
+        if (length < renderBufferSize) {
+            *_length = length;
+            break;
+        }
+
+        // Only when more numbers or labels got added than ever before. Not with the helpers of psram.h,
+        // they write to the log and the log writer observes metrics as well (the lock is held here)
+        heap_caps_free(renderBuffer);
+        renderBufferSize = std::max((size_t)METRICS_BUFFER_SIZE, length + 1024);
+        renderBuffer = (char *)heap_caps_malloc(renderBufferSize, MALLOC_CAP_SPIRAM);
+
+        if (renderBuffer == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate %d bytes", (int)renderBufferSize);
+            renderBufferSize = 0;
+            break;
+        }
+    }
+
+    xSemaphoreGive(registryMutex);
+    return renderBuffer;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#ifndef METRICS_REGISTRY_H
+#define METRICS_REGISTRY_H
+
+#include <stddef.h>
+#include <vector>
+
+struct NumberPost;      // ClassFlowDefineTypes.h, only needed by metrics_render()
+
+
+/* Creates the lock and the metrics without label, once at startup before any task updates a metric */
+void metrics_init(void);
+
+/**
+ * Metrics of the device and the flow for /metrics (see CMetricsRegistry), can be updated from any task
+ * The names are the ones of the table in metrics_registry.cpp (without prefix), unknown names get ignored.
+ * _label: value of the label of the metric (e.g. the stage), NULL for metrics without label
+ */
+void metrics_set(const char *_name, double _value, const char *_label = NULL);
+void metrics_inc(const char *_name, const char *_label = NULL);
+void metrics_observe(const char *_name, double _value, const char *_label = NULL);
+
+/**
+ * Text format of the sequences and all metrics, in a buffer which is kept for the next scrape
+ * Only to be called by the HTTP server task.
+ * @return NULL if the buffer could not be allocated
+ */
+const char *metrics_render(const char *_prefix, const std::vector<NumberPost *> &_numbers, size_t *_length);
+
+#endif //METRICS_REGISTRY_H
@@ -1,5 +1,5 @@
 #include "openmetrics.h"
-#include "functional"
+#include <string.h>
 #include "esp_log.h"
 
 /**
@@ -16,55 +16,70 @@ typedef struct sequence_metric {
     const char *name;
     const char *help;
     const char *type;
-    std::function<std::string(NumberPost *number)> valueFunc;
+    const char *(*valueFunc)(NumberPost *number);
 } sequence_metric_t;
 
 
 sequence_metric_t sequenceMetrics[4] = {
-    { "flow_value",     "current value of meter readout",     "gauge", [](NumberPost *number)-> std::string {return number->ReturnValue;} },
-    { "flow_raw_value", "current raw value of meter readout", "gauge", [](NumberPost *number)-> std::string {return number->ReturnRawValue;} },
-    { "flow_pre_value", "previous value of meter readout",    "gauge", [](NumberPost *number)-> std::string {return number->ReturnPreValue;} },
-    { "flow_error",     "Error message text != 'no error'",   "gauge", [](NumberPost *number)-> std::string {return number->ErrorMessageText.compare("no error") == 0 ? "0" : "1";} },
+    { "flow_value",     "current value of meter readout",     "gauge", [](NumberPost *number)-> const char * {return number->ReturnValue.c_str();} },
+    { "flow_raw_value", "current raw value of meter readout", "gauge", [](NumberPost *number)-> const char * {return number->ReturnRawValue.c_str();} },
+    { "flow_pre_value", "previous value of meter readout",    "gauge", [](NumberPost *number)-> const char * {return number->ReturnPreValue.c_str();} },
+    { "flow_error",     "Error message text != 'no error'",   "gauge", [](NumberPost *number)-> const char * {return number->ErrorMessageText.compare("no error") == 0 ? "0" : "1";} },
 };
 
-std::string createSequenceMetrics(std::string prefix, const std::vector<NumberPost *> &numbers)
+size_t renderSequenceMetrics(char *buffer, size_t size, size_t pos, const char *prefix, const std::vector<NumberPost *> &numbers)
 {
-    std::string result;
     for (int i = 0; i<sizeof(sequenceMetrics)/sizeof(sequence_metric_t);i++) 
     {
-        std::string res;
+        bool metadata = false;
+
         for (const auto &number : numbers)
         {
-            std::string value = sequenceMetrics[i].valueFunc(number); 
-            if (value.find("N") != std::string::npos) {
+            const char *value = sequenceMetrics[i].valueFunc(number);
+            if (strchr(value, 'N') != NULL) {
                 value = "NaN";
             }
-            ESP_LOGD("METRICS", "metric=%s, name=%s, value = %s ",sequenceMetrics[i].name,number->name.c_str(), value.c_str());
+            ESP_LOGD("METRICS", "metric=%s, name=%s, value = %s ",sequenceMetrics[i].name,number->name.c_str(), value);
 
             // only valid data is reported (https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md#missing-data)
-            if (value.length() > 0)
+            if (value[0] == '\0')
             {
-                auto label = number->name;
-                // except newline, double quote, and backslash (https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md#abnf)
-                // to keep it simple, these characters are just removed from the label
-                replaceAll(label, "\\", "");
-                replaceAll(label, "\"", "");
-                replaceAll(label, "\n", "");
-
-                res += prefix + "_" + sequenceMetrics[i].name + "{sequence=\"" + label + "\"} " + value + "\n";
+                continue;
             }
+
+            // prepend metadata if a valid metric gets created
+            if (!metadata)
+            {
+                metrics_printf(buffer, size, &pos, "# HELP %s_%s %s\n# TYPE %s_%s %s\n", prefix, sequenceMetrics[i].name, sequenceMetrics[i].help,
+                               prefix, sequenceMetrics[i].name, sequenceMetrics[i].type);
+                metadata = true;
+            }
+
+            metrics_printf(buffer, size, &pos, "%s_%s{sequence=\"", prefix, sequenceMetrics[i].name);
+
+            // except newline, double quote, and backslash (https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md#abnf)
+            // to keep it simple, these characters are just removed from the label
+            for (const char *c = number->name.c_str(); *c != '\0'; ++c)
+            {
+                if ((*c != '\\') && (*c != '"') && (*c != '\n'))
+                {
+                    metrics_printf(buffer, size, &pos, "%c", *c);
+                }
+            }
+
+            metrics_printf(buffer, size, &pos, "\"} %s\n", value);
         }
-        // prepend metadata if a valid metric was created
-        if (res.length() > 0)
-        {
-            res = "# HELP " + prefix + "_" + sequenceMetrics[i].name + " " + sequenceMetrics[i].help + "\n"
-                + "# TYPE " + prefix + "_" + sequenceMetrics[i].name + " " + sequenceMetrics[i].type + "\n"
-                + res;
-        }
-        result += res;
     }
 
-    return result;
+    return pos;
+}
+
+std::string createSequenceMetrics(std::string prefix, const std::vector<NumberPost *> &numbers)
+{
+    std::vector<char> buffer(renderSequenceMetrics(NULL, 0, 0, prefix.c_str(), numbers) + 1);     // snprintf() needs room for the 0
+
+    renderSequenceMetrics(buffer.data(), buffer.size(), 0, prefix.c_str(), numbers);
+    return std::string(buffer.data());
 }
 
 /**
@@ -8,8 +8,12 @@
 #include <vector>
 
 #include "ClassFlowDefineTypes.h"
+#include "CMetricsRegistry.h"
 
 std::string createMetric(const std::string &metricName, const std::string &help, const std::string &type, const std::string &value);
 std::string createSequenceMetrics(std::string prefix, const std::vector<NumberPost *> &numbers);
 
+/* Sequence metrics appended to buffer at pos, @return length like snprintf() (truncated if >= size) */
+size_t renderSequenceMetrics(char *buffer, size_t size, size_t pos, const char *prefix, const std::vector<NumberPost *> &numbers);
+
 #endif // OPENMETRICS_H
@@ -51,6 +51,41 @@
     // ClassLogFile
     //#define KEEP_LOGFILE_OPEN_FOR_APPENDING
 
+    /* ClassLogFile: After StartWriterTask() the log lines are collected in a ring buffer and written
+     * in batches by a low priority task. The buffer is not initialized at boot, so lines which were
+     * not written yet before a panic or software reset get written after the reboot. */
+    #define LOG_BUFFER_SIZE         8 * 1024    // Ring buffer in internal RAM
+    #define LOG_FLUSH_THRESHOLD     2 * 1024    // Pending bytes which wake up the writer task
+    #define LOG_FLUSH_INTERVAL      2000        // ms, max. delay until a log line is written
+    #define LOG_WRITE_ALIGNMENT     512         // SD sector, batches end on a sector boundary of the file
+
+    /* Retention of log files, data files and image folders: deleted step by step by a low priority task */
+    #define RETENTION_SWEEP_MAX_DELETES 20              // Files/folders deleted per tick
+    #define RETENTION_SWEEP_BUSY_DELAY  500             // ms between ticks while there is something to delete
+    #define RETENTION_SWEEP_IDLE_DELAY  (5 * 60 * 1000) // ms between passes
+    #define RETENTION_SWEEP_CURSOR_FILE "/sdcard/log/.retention"    // Folder in progress and totals, survives a reboot
+
+    /* Image logging (ClassFlowImage::LogImage): copies of the images are queued, a low priority task
+     * encodes and writes them. Images larger than the queue are written in the round as before. */
+    #define IMAGE_LOG_QUEUE_MAX_JOBS        32
+    #define IMAGE_LOG_QUEUE_MAX_BYTES       (256 * 1024)    // Pixel copies in PSRAM (a ROI is only a few kB)
+    #define IMAGE_LOG_QUEUE_POLICY          CImageLogQueue::POLICY_DROP_OLDEST  // Queue full: POLICY_DROP_OLDEST, POLICY_BLOCK or POLICY_SKIP
+    #define IMAGE_LOG_QUEUE_BLOCK_TIMEOUT   10000           // ms, POLICY_BLOCK: max. wait of the round, then the image is skipped
+    #define IMAGE_PACK_FILE                 "images.pack"   // ROIImagesFormat = container: file per hour folder, index in images.idx
+
+    /* Store-and-forward: readings which MQTT, InfluxDB or the webhook could not deliver are kept in a file
+     * per destination and sent in their original order once the destination can be reached again */
+    #define STORE_FORWARD_FOLDER            "/sdcard/queue"
+    #define STORE_FORWARD_CAPACITY          (256 * 1024)    // Bytes per destination (0: disabled), the oldest readings get dropped
+    #define STORE_FORWARD_DRAIN_MAX         50              // Max. queued messages sent per round
+    #define STORE_FORWARD_DRAIN_DELAY       20              // ms between queued messages
+
+    /* MQTT outbox (CONFIG_MQTT_CUSTOM_OUTBOX): messages waiting for the broker live in fixed slots (topic + payload)
+     * of a PSRAM pool which gets allocated at boot, larger messages use the PSRAM heap */
+    #define MQTT_OUTBOX_SLOT_SIZES          { 256, 1024, 4096 }
+    #define MQTT_OUTBOX_SLOT_COUNTS         { 32, 32, 4 }
+    #define MQTT_OUTBOX_POLICY              CMqttOutbox::POLICY_DROP_OLDEST     // No free slot: POLICY_DROP_OLDEST or POLICY_REJECT
+
   //****************************************
 
     //compiler optimization for esp-tflite-micro
@@ -92,9 +127,13 @@
     #define MAX_FILE_SIZE_STR "8MB"
          
     #define LOGFILE_LAST_PART_BYTES 80 * 1024 // 80 kBytes  // Size of partial log file to return 
+    #define DATA_EXPORT_LAST_PART_RECORDS 500  // Records of the binary data log returned as last part (about the same as LOGFILE_LAST_PART_BYTES as CSV)
+    #define DATA_EXPORT_MAX_LINE 512           // Room kept in the scratch buffer for one exported record
 
     #define SERVER_FILER_SCRATCH_BUFSIZE  4096 
     #define SERVER_HELPER_SCRATCH_BUFSIZE  4096
+    #define SERVER_FILE_SEND_BUFSIZE  (16 * 1024)  // Two buffers in PSRAM: one gets read from the SD card while the other one gets sent
+    #define STATIC_FILE_INDEX_ROOT "/sdcard/html"  // Indexed at startup for ETag/304 and the .gz lookup (see CStaticFileIndex)
     #define SERVER_OTA_SCRATCH_BUFSIZE  1024 
 
 
@@ -106,6 +145,7 @@
     //server_ota
     #define HASH_LEN 32 // SHA-256 digest length
     #define OTA_URL_SIZE 256
+    #define UPDATE_MANIFEST_FILE "/sdcard/update_manifest.txt"  // Files replaced by an update, rolled back if it got interrupted
 
 
     //ClassFlow + ClassFlowImage + server_tflite
@@ -129,6 +169,7 @@
     #define LWT_TOPIC        "connection"
     #define LWT_CONNECTED    "connected"
     #define LWT_DISCONNECTED "connection lost"
+    #define MQTT_DISCOVERY_CACHE_FILE "/sdcard/config/.discovery"  // Hashes of the published Homeassistant Discovery topics
 
 
     //ClassFlowPostProcessing
@@ -136,6 +177,10 @@
     #define PREVALUE_TIME_FORMAT_INPUT "%d-%d-%dT%d:%d:%d"
 
 
+    //CJsonWriter: Stack buffer of the JSON producers (/json, webhook, MQTT, Homeassistant Discovery)
+    #define JSON_WRITER_BUFFER 256
+
+
     //CImageBasis
     #define HTTP_BUFFER_SENT 1024
     #define MAX_JPG_SIZE 128000
@@ -149,6 +194,23 @@
 
     //interface_influxdb
     #define MAX_HTTP_OUTPUT_BUFFER 2048
+    #define INFLUXDB_BATCH_MAX      (16 * 1024)     // Max. bytes of lines per write request (round and queued readings)
+    #define INFLUXDB_GZIP_MIN       512             // Smaller requests are sent uncompressed (parameter GzipCompression)
+    #define INFLUXDB_GZIP_WORKSPACE (312 * 1024)    // Compressor (CGzip::GetWorkspaceSize()), allocated once and kept (used by the memory planner)
+
+
+    //http_client_pool (webhook, InfluxDB)
+    #define HTTP_CLIENT_POOL_SIZE           2                   // Hosts with a kept connection (about 5 kB each)
+    #define HTTP_CLIENT_POOL_IDLE_TIMEOUT   (15 * 60 * 1000)    // ms, longer than the usual round interval
+
+
+    //metrics_registry (/metrics)
+    #define METRICS_BUFFER_SIZE             4096                // Response buffer (PSRAM), grows if needed and is kept for the next scrapes
+
+
+    //server_events (/events)
+    #define SERVER_EVENTS_MAX_SUBSCRIBERS   2                   // Each one keeps one of the sockets of the webserver open
+    #define SERVER_EVENTS_RETRY             10000               // ms, reconnection delay of the browser after the connection got closed
 
 
     //server_mqtt
@@ -191,8 +253,12 @@
 ////      PSRAM Allocations              ////
 /////////////////////////////////////////////
 #define MAX_MODEL_SIZE            (unsigned int)(1.3 * 1024 * 1024) // Space for the currently largest model (1.1 MB) + some spare
-#define TENSOR_ARENA_SIZE         800 * 1024 // Space for the Tensor Arena, (819200 Bytes)
+#define TENSOR_ARENA_SIZE         800 * 1024 // Space for the Tensor Arena, (819200 Bytes), used until the models are measured
+#define TENSOR_ARENA_SPARE        4 * 1024 // Spare on top of the measured Tensor Arena usage of the models
 #define IMAGE_SIZE                640 * 480 * 3 // Space for a extracted image (921600 Bytes)
+#define ROUND_ARENA_SIZE          128 * 1024 // Space for temporary buffers within one round (resize scratch, interpreter, ...)
+#define MAX_PSRAM_STAGES          10 // Max. number of flow steps tracked in the allocation statistics
+#define PSRAM_RESERVE_FIRMWARE    256 * 1024 // PSRAM kept free for WLAN, webserver, MQTT, ... (used by the memory planner)
 /////////////////////////////////////////////
 ////      Conditionnal definitions       ////
 /////////////////////////////////////////////
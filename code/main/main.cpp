@@ -21,14 +21,21 @@
 ///////////////////////////////
 
 #include "ClassLogFile.h"
+#include "retention_sweeper.h"
+#include "image_log_writer.h"
 
 #include "connect_wlan.h"
 #include "read_wlanini.h"
 
 #include "server_main.h"
 #include "MainFlowControl.h"
+#include "ClassMemoryPlanner.h"
 #include "server_file.h"
+#include "server_help.h"
 #include "server_ota.h"
+#include "server_events.h"
+#include "metrics_registry.h"
+#include "http_client_pool.h"
 #include "time_sntp.h"
 #include "configFile.h"
 #include "server_main.h"
@@ -37,6 +44,7 @@
 
 #ifdef ENABLE_MQTT
     #include "server_mqtt.h"
+    #include "mqtt_outbox.h"
 #endif //ENABLE_MQTT
 #include "Helper.h"
 #include "statusled.h"
@@ -246,6 +254,30 @@ extern "C" void app_main(void)
     // ********************************************
     LogFile.CreateLogDirectories(); // mandatory for logging + image saving
 
+    // Metrics: created before the log writer task, it observes the SD card write durations
+    // ********************************************
+    metrics_init();
+
+    // Buffered logging: lines get written in batches by a low priority task (also lines still pending before a panic)
+    // ********************************************
+    LogFile.StartWriterTask();
+
+    // Retention of log files and image folders: deleted step by step in the background
+    // ********************************************
+    retention_sweeper_start();
+
+    // Kept HTTP connections of webhook and InfluxDB
+    // ********************************************
+    http_client_pool_init();
+
+    // Server-Sent Events (/events): published by the flow, sent by the webserver task
+    // ********************************************
+    server_events_init();
+
+    // Image logging: images get encoded and written by a low priority task
+    // ********************************************
+    image_log_writer_start();
+
     // ********************************************
     // Highlight start of logfile logging
     // Default Log Level: INFO -> Everything which needs to be logged during boot should be have level INFO, WARN OR ERROR
@@ -315,12 +347,33 @@ extern "C" void app_main(void)
                 StatusLED(PSRAM_INIT, 3, true);
             }
             else { // HEAP size OK --> continue to reserve shared memory block and check camera init
-                /* Allocate static PSRAM memory regions */
-                if (! reserve_psram_shared_region()) {
+                /* Allocate static PSRAM memory regions
+                 * Shared region: sized from the measured Tensor Arena of the configured models (default size until they are measured) */
+                ClassMemoryPlanner planner;
+                size_t tensorArenaSize = TENSOR_ARENA_SIZE;
+                size_t sharedRegionSize = TENSOR_ARENA_SIZE + MAX_MODEL_SIZE;
+
+                if (planner.ReadConfig(CONFIG_FILE, "/sdcard")) {
+                    planner.Plan(0, 0);
+                    tensorArenaSize = planner.getTensorArenaSize();
+                    sharedRegionSize = planner.getSharedRegionSize();
+                }
+
+                LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Shared PSRAM region: " + std::to_string(sharedRegionSize) + " byte (Tensor Arena: " + 
+                                                       std::to_string(tensorArenaSize) + " byte)");
+
+                if (! reserve_psram_shared_region(tensorArenaSize, sharedRegionSize)) {
                     setSystemStatusFlag(SYSTEM_STATUS_HEAP_TOO_SMALL);
                     StatusLED(PSRAM_INIT, 3, true);
                 }
                 else { // PSRAM OK
+                    /* Optional, on failure the temporary buffers of a round use the normal PSRAM heap */
+                    reserve_psram_round_arena();
+
+                    #ifdef ENABLE_MQTT
+                        mqtt_outbox_reserve();  // Optional as well, the messages use the PSRAM heap without it
+                    #endif //ENABLE_MQTT
+
                     // Init camera
                     // ********************************************
                     PowerResetCamera();
@@ -525,9 +578,12 @@ extern "C" void app_main(void)
     // ********************************************
     ESP_LOGD(TAG, "starting servers");
 
+    static_file_index_build();  // ETags and .gz lookup of the web interface without SD card access per request
+
     server = start_webserver();   
     register_server_camera_uri(server); 
     register_server_main_flow_task_uri(server);
+    register_server_events_uri(server);
     register_server_file_uri(server, "/sdcard");
     register_server_ota_sdcard_uri(server);
     #ifdef ENABLE_MQTT
@@ -0,0 +1,118 @@
+#include <unity.h>
+#include <ClassAdaptiveInterval.h>
+
+
+/**
+ * @brief basic behaviour: shorten while moving, exponential backoff while idle
+ */
+void test_adaptiveIntervalBackoff()
+{
+    ClassAdaptiveInterval scheduler;
+
+    // disabled -> always fixed interval
+    scheduler.Setup(false, 5, 1, 30);
+    TEST_ASSERT_EQUAL_FLOAT(5, scheduler.Update(0.5, true));
+    TEST_ASSERT_EQUAL_FLOAT(5, scheduler.Update(0, true));
+
+    // invalid bounds -> disabled
+    scheduler.Setup(true, 5, 10, 10);
+    TEST_ASSERT_FALSE(scheduler.isEnabled());
+
+    scheduler.Setup(true, 5, 1, 30);
+    TEST_ASSERT_TRUE(scheduler.isEnabled());
+    TEST_ASSERT_EQUAL_FLOAT(5, scheduler.getInterval());
+
+    // idle -> 10, 20, 30 (cap), 30
+    TEST_ASSERT_EQUAL_FLOAT(10, scheduler.Update(0, true));
+    TEST_ASSERT_EQUAL_FLOAT(20, scheduler.Update(0, true));
+    TEST_ASSERT_EQUAL_FLOAT(30, scheduler.Update(0, true));
+    TEST_ASSERT_EQUAL_FLOAT(30, scheduler.Update(0, true));
+    TEST_ASSERT_EQUAL(4, scheduler.getIdleRounds());
+
+    // invalid reading keeps the interval
+    TEST_ASSERT_EQUAL_FLOAT(30, scheduler.Update(0.2, false));
+
+    // rising rate -> lower bound immediately
+    TEST_ASSERT_EQUAL_FLOAT(1, scheduler.Update(0.2, true));
+    TEST_ASSERT_EQUAL(0, scheduler.getIdleRounds());
+
+    // falling, but still moving -> stay at lower bound
+    TEST_ASSERT_EQUAL_FLOAT(1, scheduler.Update(0.1, true));
+
+    // negative rates count as moving as well
+    TEST_ASSERT_EQUAL_FLOAT(1, scheduler.Update(-0.3, true));
+
+    // idle again -> backoff starts from the lower bound
+    TEST_ASSERT_EQUAL_FLOAT(2, scheduler.Update(0, true));
+    TEST_ASSERT_EQUAL_FLOAT(4, scheduler.Update(0, true));
+
+    // moving again after a long idle phase -> back to lower bound
+    scheduler.Update(0, true);
+    scheduler.Update(0, true);
+    TEST_ASSERT_EQUAL_FLOAT(16, scheduler.getInterval());
+    TEST_ASSERT_EQUAL_FLOAT(1, scheduler.Update(0.5, true));
+}
+
+
+/**
+ * @brief replay a recorded day (one meter value per minute) through the scheduler
+ * and compare against the fixed interval
+ */
+void test_adaptiveIntervalSimulation()
+{
+    // Recorded consumption pattern: idle night, morning shower, idle, evening usage
+    const int minutesPerDay = 24 * 60;
+    static double values[minutesPerDay];
+    double value = 1234.5;
+
+    for (int m = 0; m < minutesPerDay; ++m) {
+        if ((m >= 7 * 60 && m < 7 * 60 + 20) || (m >= 19 * 60 && m < 19 * 60 + 45)) {
+            value += 0.008; // ~8 l/min
+        }
+        values[m] = value;
+    }
+
+    ClassAdaptiveInterval scheduler;
+    scheduler.Setup(true, 5, 1, 60);
+
+    int rounds = 0;
+    int roundsDuringFlow = 0;
+    double preValue = values[0];
+    float now = 0;
+    float lastRound = 0;
+
+    while (now < minutesPerDay) {
+        rounds++;
+        double act = values[(int)now];
+        double rate = (now > lastRound) ? (act - preValue) / (now - lastRound) : 0;
+
+        if (rate > 0) {
+            roundsDuringFlow++;
+        }
+
+        preValue = act;
+        lastRound = now;
+
+        float interval = scheduler.Update(rate, true);
+        TEST_ASSERT_TRUE(interval >= 1);
+        TEST_ASSERT_TRUE(interval <= 60);
+        now += interval;
+    }
+
+    printf("Adaptive interval simulation: %d rounds (fixed 5 min: %d, fixed 1 min: %d), %d rounds during flow\n",
+                rounds, minutesPerDay / 5, minutesPerDay, roundsDuringFlow);
+
+    // Far less rounds than with the fixed interval ...
+    TEST_ASSERT_TRUE(rounds < minutesPerDay / 5 / 2);
+    // ... but finer resolution while water is flowing (65 minutes with flow)
+    TEST_ASSERT_TRUE(roundsDuringFlow > 65 / 5);
+    // Total consumption is preserved
+    TEST_ASSERT_EQUAL_DOUBLE(values[minutesPerDay - 1], value);
+}
+
+
+void test_adaptiveInterval()
+{
+    test_adaptiveIntervalBackoff();
+    test_adaptiveIntervalSimulation();
+}
@@ -0,0 +1,85 @@
+#include <unity.h>
+#include <ClassMemoryPlanner.h>
+
+
+static ClassMemoryPlanner::CNN createCNN(std::string _section, size_t _modelSize, size_t _arenaUsed, int _rois)
+{
+    ClassMemoryPlanner::CNN cnn = {};
+    cnn.section = _section;
+    cnn.modelFile = "/config/model.tflite";
+    cnn.modelFileSize = _modelSize;
+    cnn.modelInputBytes = 20 * 32 * 3;
+    cnn.arenaUsedBytes = _arenaUsed;
+    cnn.roiCount = _rois;
+    cnn.roiOriginalBytes = _rois * 30 * 56 * 3;
+    return cnn;
+}
+
+
+/**
+ * @brief memory planner: a default config fits, oversized model/reference image/budget get rejected
+ */
+void test_memoryPlanner()
+{
+    ClassMemoryPlanner planner;
+
+    // Default setup: VGA image, digits + analog
+    planner.AddReferenceImage(40, 40);
+    planner.AddCNN(createCNN("Digits", 300 * 1024, 100 * 1024, 5));
+    planner.AddCNN(createCNN("Analog", 180 * 1024, 60 * 1024, 4));
+    TEST_ASSERT_TRUE(planner.Plan(4 * 1024 * 1024 - PSRAM_RESERVE_FIRMWARE, 0));
+    TEST_ASSERT_EQUAL(4, planner.GetStages()->size()); // Take Image, Aligning, Digits, Analog
+    TEST_ASSERT_EQUAL(0, planner.GetWarnings()->size());
+    TEST_ASSERT_TRUE(planner.getPsramPeak() >= planner.getPsramPersistent());
+
+    // Same config on a device with 2 MB PSRAM
+    TEST_ASSERT_FALSE(planner.Plan(2 * 1024 * 1024, 0));
+
+    // Model larger than the reserved model memory
+    planner.Clear();
+    planner.AddCNN(createCNN("Digits", MAX_MODEL_SIZE + 1, 100 * 1024, 5));
+    TEST_ASSERT_FALSE(planner.Plan(0, 0));
+    TEST_ASSERT_EQUAL(1, planner.GetErrors()->size()); // model memory (fits in the shrinked shared region)
+
+    // Reference image which would overlap the tmpImage in the shared region
+    planner.Clear();
+    planner.AddReferenceImage(200, 200);
+    TEST_ASSERT_FALSE(planner.Plan(0, 0));
+
+    // Arena not measured -> warning only
+    planner.Clear();
+    planner.AddCNN(createCNN("Analog", 180 * 1024, 0, 4));
+    TEST_ASSERT_TRUE(planner.Plan(0, 0));
+    TEST_ASSERT_EQUAL(1, planner.GetWarnings()->size());
+    TEST_ASSERT_EQUAL(TENSOR_ARENA_SIZE + MAX_MODEL_SIZE, planner.getSharedRegionSize());
+
+    // All models measured -> Tensor Arena and shared region get shrinked, Take Image (STBI) needs the most of it
+    planner.Clear();
+    planner.AddCNN(createCNN("Digits", 300 * 1024, 100 * 1024, 5));
+    planner.AddCNN(createCNN("Analog", 180 * 1024, 60 * 1024, 4));
+    TEST_ASSERT_TRUE(planner.Plan(0, 0));
+    TEST_ASSERT_EQUAL(100 * 1024 + TENSOR_ARENA_SPARE, planner.getTensorArenaSize());
+    TEST_ASSERT_TRUE(planner.getSharedRegionSize() < TENSOR_ARENA_SIZE + MAX_MODEL_SIZE);
+    TEST_ASSERT_TRUE(planner.getSharedRegionSize() >= (*planner.GetStages())[0].sharedRegionUsed);
+
+    // Original sized ROIs are only kept if they get logged
+    ClassMemoryPlanner::CNN cnn = createCNN("Digits", 300 * 1024, 100 * 1024, 5);
+    planner.Clear();
+    planner.AddCNN(cnn);
+    planner.Plan(0, 0);
+    size_t persistent = planner.getPsramPersistent();
+
+    cnn.logImages = true;
+    planner.Clear();
+    planner.AddCNN(cnn);
+    planner.Plan(0, 0);
+    TEST_ASSERT_EQUAL(persistent + cnn.roiOriginalBytes, planner.getPsramPersistent());
+
+    // The gzip compressor of InfluxDB is kept once it got allocated
+    cnn.logImages = false;
+    planner.Clear();
+    planner.AddCNN(cnn);
+    planner.SetGzipCompression(true);
+    planner.Plan(0, 0);
+    TEST_ASSERT_EQUAL(persistent + INFLUXDB_GZIP_WORKSPACE, planner.getPsramPersistent());
+}
@@ -0,0 +1,100 @@
+#include <unity.h>
+#include <ClassPublishPolicy.h>
+
+
+/* One round of a number: check, and remember it if it got published */
+static bool publishPolicyRound(ClassPublishPolicy *_policy, const char *_value, const char *_error = "no error", const char *_name = "main")
+{
+    bool publish = _policy->Check(_name, _value, _error);
+
+    if (publish) {
+        _policy->Published(_name, _value, _error);
+    }
+    return publish;
+}
+
+
+/**
+ * @brief publish policy: always, on change, deadband (drift gets published once it sums up), heartbeat, errors, numbers
+ */
+void test_publishPolicy()
+{
+    ClassPublishPolicy policy;
+    ClassPublishPolicy::Mode mode = ClassPublishPolicy::ALWAYS;
+
+    TEST_ASSERT_TRUE(ClassPublishPolicy::ParseMode("OnChange", &mode));
+    TEST_ASSERT_EQUAL(ClassPublishPolicy::ON_CHANGE, mode);
+    TEST_ASSERT_TRUE(ClassPublishPolicy::ParseMode("deadband", &mode));
+    TEST_ASSERT_EQUAL(ClassPublishPolicy::DEADBAND, mode);
+    TEST_ASSERT_FALSE(ClassPublishPolicy::ParseMode("sometimes", &mode));
+    TEST_ASSERT_EQUAL(ClassPublishPolicy::DEADBAND, mode);
+
+    // Parameters of a destination section
+    TEST_ASSERT_TRUE(policy.SetParameter("PublishDeadband", "0.5"));
+    TEST_ASSERT_TRUE(policy.SetParameter("PUBLISHHEARTBEAT", "60"));
+    TEST_ASSERT_FALSE(policy.SetParameter("PublishPolicy", "never"));
+    TEST_ASSERT_FALSE(policy.SetParameter("Uri", "mqtt://broker"));
+    TEST_ASSERT_EQUAL(ClassPublishPolicy::ALWAYS, policy.getMode());
+    TEST_ASSERT_TRUE(policy.SetParameter("PublishPolicy", "deadband"));
+    TEST_ASSERT_EQUAL(ClassPublishPolicy::DEADBAND, policy.getMode());
+    TEST_ASSERT_EQUAL_DOUBLE(0.5, policy.getDeadband());
+    TEST_ASSERT_EQUAL(60, policy.getHeartbeat());
+
+    // Default: every round
+    policy.Setup(ClassPublishPolicy::ALWAYS);
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.00"));
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.00"));
+
+    // On change: the first round, then only changes of the value or the error
+    policy.Setup(ClassPublishPolicy::ON_CHANGE);
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.00"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "100.00"));
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.01"));
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.01", "Rate too high"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "100.01", "Rate too high"));
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.01"));
+
+    // Each number on its own
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "5.5", "no error", "gas"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "100.01"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "5.5", "no error", "gas"));
+
+    // A failed publish is compared with the last published reading again
+    TEST_ASSERT_TRUE(policy.Check("main", "100.02", "no error"));
+    TEST_ASSERT_TRUE(policy.Check("main", "100.02", "no error"));
+
+    // Deadband: compared with the published value, so slow drift gets published once it exceeds the deadband
+    policy.Setup(ClassPublishPolicy::DEADBAND, 0.05);
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.00"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "100.03"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "99.96"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "100.05"));
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.06"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "100.10"));
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.12"));
+
+    // Deadband with values which are no numbers: on change
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, ""));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, ""));
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.12"));
+
+    // Heartbeat: an unchanged reading at least every 3 rounds
+    policy.Setup(ClassPublishPolicy::ON_CHANGE, 0, 3);
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.00"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "100.00"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "100.00"));
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.00"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "100.00"));
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.01"));     // A change restarts the heartbeat
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "100.01"));
+    TEST_ASSERT_FALSE(publishPolicyRound(&policy, "100.01"));
+    TEST_ASSERT_TRUE(publishPolicyRound(&policy, "100.01"));
+
+    // A minute interval with a value changing every 30 rounds: 4 instead of 120 publishes
+    policy.Setup(ClassPublishPolicy::ON_CHANGE);
+    int published = 0;
+    for (int round = 0; round < 120; ++round) {
+        published += publishPolicyRound(&policy, std::to_string(100 + round / 30).c_str()) ? 1 : 0;
+    }
+    TEST_ASSERT_EQUAL(4, published);
+}
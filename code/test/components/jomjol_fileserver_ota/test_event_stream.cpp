@@ -0,0 +1,66 @@
+#include <unity.h>
+#include <string>
+#include <CEventStream.h>
+
+
+/**
+ * @brief Server-Sent Events: frame format, shared latest frames, unchanged data, subscriber limit, no duplicate frames
+ */
+void test_eventStream()
+{
+    // One data field per line, CR LF gets removed
+    TEST_ASSERT_EQUAL_STRING("event: status\nid: 7\ndata: Take Image (12:00:01)\n\n",
+                             CEventStream::Format("status", 7, "Take Image (12:00:01)").c_str());
+    TEST_ASSERT_EQUAL_STRING("event: reading\nid: 1\ndata: {\ndata:   \"a\": 1\ndata: }\n\n",
+                             CEventStream::Format("reading", 1, "{\r\n  \"a\": 1\n}").c_str());
+    TEST_ASSERT_EQUAL_STRING("event: x\nid: 2\ndata: \n\n", CEventStream::Format("x", 2, "").c_str());
+
+    std::string head = CEventStream::FormatHead(10000);
+    TEST_ASSERT_EQUAL(0, head.find("HTTP/1.1 200 OK\r\n"));
+    TEST_ASSERT_NOT_EQUAL(std::string::npos, head.find("Content-Type: text/event-stream\r\n"));
+    std::string end = "\r\n\r\nretry: 10000\n\n";
+    TEST_ASSERT_EQUAL(head.length() - end.length(), head.find(end));
+
+    CEventStream stream(2);
+    TEST_ASSERT_EQUAL(0, stream.getLatest().size());
+
+    CEventStream::Frame status = stream.Publish("status", "Initialization");
+    TEST_ASSERT_NOT_NULL(status.get());
+    TEST_ASSERT_EQUAL_STRING("event: status\nid: 1\ndata: Initialization\n\n", status->c_str());
+
+    CEventStream::Frame reading = stream.Publish("reading", "{\"main\":{}}");
+    TEST_ASSERT_NOT_NULL(reading.get());
+    TEST_ASSERT_NULL(stream.Publish("reading", "{\"main\":{}}").get());     // Unchanged: nothing to send
+    TEST_ASSERT_EQUAL(2, stream.getLastId());
+
+    // The latest frame of each event, shared and not copied
+    status = stream.Publish("status", "Flow finished");
+    std::vector<CEventStream::Frame> latest = stream.getLatest();
+    TEST_ASSERT_EQUAL(2, latest.size());
+    TEST_ASSERT_EQUAL_PTR(status.get(), latest[0].get());
+    TEST_ASSERT_EQUAL_PTR(reading.get(), latest[1].get());
+    TEST_ASSERT_EQUAL_STRING("event: status\nid: 3\ndata: Flow finished\n\n", latest[0]->c_str());
+
+    // Subscribers
+    TEST_ASSERT_TRUE(stream.Subscribe(10));
+    TEST_ASSERT_TRUE(stream.Subscribe(10));
+    TEST_ASSERT_TRUE(stream.Subscribe(11));
+    TEST_ASSERT_FALSE(stream.Subscribe(12));
+    TEST_ASSERT_EQUAL(2, stream.getSubscribers().size());
+    TEST_ASSERT_TRUE(stream.Unsubscribe(10));
+    TEST_ASSERT_FALSE(stream.Unsubscribe(10));
+    TEST_ASSERT_TRUE(stream.Subscribe(12));
+    TEST_ASSERT_EQUAL(11, stream.getSubscribers()[0]);
+    TEST_ASSERT_EQUAL(12, stream.getSubscribers()[1]);
+
+    // A frame published before subscribing was part of getLatest() and is not sent again
+    uint32_t pendingId = stream.getLastId();
+    TEST_ASSERT_TRUE(stream.Unsubscribe(12));
+    TEST_ASSERT_TRUE(stream.Subscribe(12));
+    TEST_ASSERT_NOT_NULL(stream.Publish("status", "Take Image").get());
+    TEST_ASSERT_EQUAL(0, stream.getSubscribers(pendingId).size());
+    std::vector<int> fds = stream.getSubscribers(stream.getLastId());
+    TEST_ASSERT_EQUAL(2, fds.size());
+    TEST_ASSERT_EQUAL(11, fds[0]);
+    TEST_ASSERT_EQUAL(12, fds[1]);
+}
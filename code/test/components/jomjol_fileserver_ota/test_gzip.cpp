@@ -0,0 +1,88 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string>
+#include <CGzip.h>
+#include "miniz.h"
+#include "../../../include/defines.h"
+
+
+static int gzipTestAllocs = 0;
+
+static void *gzipTestMalloc(size_t _size)
+{
+    gzipTestAllocs++;
+    return malloc(_size);
+}
+
+static void *gzipTestNoMemory(size_t)
+{
+    return NULL;
+}
+
+
+static uint32_t gzipTestLe32(const std::string &_data, size_t _offset)
+{
+    return (uint32_t)(uint8_t)_data[_offset] | ((uint32_t)(uint8_t)_data[_offset + 1] << 8) |
+           ((uint32_t)(uint8_t)_data[_offset + 2] << 16) | ((uint32_t)(uint8_t)_data[_offset + 3] << 24);
+}
+
+
+/* Inflate the deflate data of a gzip member and check its trailer */
+static std::string gzipTestInflate(const std::string &_gzip)
+{
+    TEST_ASSERT_TRUE(_gzip.length() >= 18);
+    TEST_ASSERT_EQUAL_HEX8(0x1f, (uint8_t)_gzip[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x8b, (uint8_t)_gzip[1]);
+    TEST_ASSERT_EQUAL(8, _gzip[2]);     // Deflate
+    TEST_ASSERT_EQUAL(0, _gzip[3]);     // No name, comment or extra field
+
+    std::string inflated;
+    size_t length = 0;
+    void *data = tinfl_decompress_mem_to_heap(_gzip.data() + 10, _gzip.length() - 18, &length, 0);
+
+    if (data != NULL) {
+        inflated.assign((const char *)data, length);
+        mz_free(data);
+    }
+    else {
+        TEST_ASSERT_EQUAL_STRING("\x03", _gzip.substr(10, _gzip.length() - 18).c_str());     // Empty final block (03 00)
+    }
+
+    TEST_ASSERT_EQUAL_HEX32(mz_crc32(MZ_CRC32_INIT, (const unsigned char *)inflated.data(), inflated.length()),
+                            gzipTestLe32(_gzip, _gzip.length() - 8));
+    TEST_ASSERT_EQUAL(inflated.length(), gzipTestLe32(_gzip, _gzip.length() - 4));
+    return inflated;
+}
+
+
+/**
+ * @brief gzip member: header, inflates to the input, CRC and size, empty input, allocation failure, reused workspace
+ */
+void test_gzip()
+{
+    std::string body;
+    for (int i = 0; i < 100; ++i) {
+        body += "watermeter,number=main value=" + std::to_string(1234.5 + i * 0.01) + " 17000000" + std::to_string(10 + i) + "000000000\n";
+    }
+
+    std::string gzip;
+    TEST_ASSERT_TRUE(CGzip::Compress(body.data(), body.length(), &gzip, gzipTestMalloc, free));
+    TEST_ASSERT_EQUAL(1, gzipTestAllocs);
+    TEST_ASSERT_TRUE(gzip.length() < body.length() / 4);    // Line protocol is very repetitive
+    TEST_ASSERT_EQUAL_STRING(body.c_str(), gzipTestInflate(gzip).c_str());
+
+    TEST_ASSERT_TRUE(CGzip::Compress("", 0, &gzip));
+    TEST_ASSERT_EQUAL_STRING("", gzipTestInflate(gzip).c_str());
+
+    TEST_ASSERT_FALSE(CGzip::Compress(body.data(), body.length(), &gzip, gzipTestNoMemory, free));
+    TEST_ASSERT_EQUAL(0, gzip.length());
+
+    // A workspace of the caller gets reused, the defines of the memory planner must cover it
+    TEST_ASSERT_TRUE(CGzip::GetWorkspaceSize() <= INFLUXDB_GZIP_WORKSPACE);
+    void *workspace = malloc(CGzip::GetWorkspaceSize());
+    for (int i = 0; i < 2; ++i) {
+        TEST_ASSERT_TRUE(CGzip::Compress(body.data(), body.length(), &gzip, workspace));
+        TEST_ASSERT_EQUAL_STRING(body.c_str(), gzipTestInflate(gzip).c_str());
+    }
+    free(workspace);
+}
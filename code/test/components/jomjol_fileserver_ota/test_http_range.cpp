@@ -0,0 +1,92 @@
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include <CHttpRange.h>
+
+
+static CHttpRange::Result parseRange(const char *_range, const char *_ifRange, size_t _size, size_t *_start, size_t *_length)
+{
+    return CHttpRange::Parse(_range, _ifRange, _size, "\"3e8-5f5e100\"", "Sat, 03 Mar 1973 09:46:40 GMT", _start, _length);
+}
+
+
+/**
+ * @brief HTTP range requests: Range header as sent by curl and browsers, If-Range, 416 and the response head
+ */
+void test_httpRange()
+{
+    size_t start, length;
+
+    // No or unsupported range: whole file
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_NONE, parseRange(NULL, NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(0, start);
+    TEST_ASSERT_EQUAL(1000, length);
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_NONE, parseRange("", "", 1000, &start, &length));
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_NONE, parseRange("items=0-10", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_NONE, parseRange("bytes=0-10,20-30", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_NONE, parseRange("bytes=10-5", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_NONE, parseRange("bytes=abc", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_NONE, parseRange("bytes=-", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(1000, length);
+
+    // curl -r 0-99
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_PARTIAL, parseRange("bytes=0-99", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(0, start);
+    TEST_ASSERT_EQUAL(100, length);
+
+    // curl -C - (resume) and end beyond the file
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_PARTIAL, parseRange("bytes=400-", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(400, start);
+    TEST_ASSERT_EQUAL(600, length);
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_PARTIAL, parseRange("bytes=990-2000", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(990, start);
+    TEST_ASSERT_EQUAL(10, length);
+
+    // curl -r -100 (last bytes), suffix longer than the file
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_PARTIAL, parseRange("bytes=-100", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(900, start);
+    TEST_ASSERT_EQUAL(100, length);
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_PARTIAL, parseRange("bytes=-5000", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(0, start);
+    TEST_ASSERT_EQUAL(1000, length);
+
+    // Not satisfiable
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_NOT_SATISFIABLE, parseRange("bytes=1000-", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_NOT_SATISFIABLE, parseRange("bytes=-0", NULL, 1000, &start, &length));
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_NOT_SATISFIABLE, parseRange("bytes=0-", NULL, 0, &start, &length));
+
+    // If-Range: partial only for the same version of the file
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_PARTIAL, parseRange("bytes=100-", "\"3e8-5f5e100\"", 1000, &start, &length));
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_PARTIAL, parseRange("bytes=100-", "Sat, 03 Mar 1973 09:46:40 GMT", 1000, &start, &length));
+    TEST_ASSERT_EQUAL(CHttpRange::RANGE_NONE, parseRange("bytes=100-", "\"3e8-5f5e101\"", 1000, &start, &length));
+    TEST_ASSERT_EQUAL(0, start);
+    TEST_ASSERT_EQUAL(1000, length);
+
+    // Validators
+    TEST_ASSERT_EQUAL_STRING("\"3e8-5f5e100\"", CHttpRange::GetETag(1000, 100000000).c_str());
+    TEST_ASSERT_EQUAL_STRING("Sat, 03 Mar 1973 09:46:40 GMT", CHttpRange::FormatHttpDate(100000000).c_str());
+
+    // Response heads
+    std::string head = CHttpRange::FormatHead(CHttpRange::RANGE_PARTIAL, "text/plain", 900, 100, 1000, "\"e\"", "", "Cache-Control: no-cache\r\n");
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 206 Partial Content\r\n"
+                             "Content-Range: bytes 900-999/1000\r\n"
+                             "Content-Type: text/plain\r\n"
+                             "Content-Length: 100\r\n"
+                             "Accept-Ranges: bytes\r\n"
+                             "ETag: \"e\"\r\n"
+                             "Cache-Control: no-cache\r\n"
+                             "\r\n", head.c_str());
+
+    head = CHttpRange::FormatHead(CHttpRange::RANGE_NOT_SATISFIABLE, "text/plain", 0, 1000, 1000, "", "", "");
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 416 Range Not Satisfiable\r\n"
+                             "Content-Range: bytes */1000\r\n"
+                             "Content-Type: text/plain\r\n"
+                             "Content-Length: 0\r\n"
+                             "Accept-Ranges: bytes\r\n"
+                             "\r\n", head.c_str());
+
+    head = CHttpRange::FormatHead(CHttpRange::RANGE_NONE, "image/jpeg", 0, 1000, 1000, "", "Sat, 03 Mar 1973 09:46:40 GMT", "");
+    TEST_ASSERT_TRUE(strncmp(head.c_str(), "HTTP/1.1 200 OK\r\n", 17) == 0);
+    TEST_ASSERT_TRUE(head.find("Content-Length: 1000\r\n") != std::string::npos);
+    TEST_ASSERT_TRUE(head.find("Last-Modified: Sat, 03 Mar 1973 09:46:40 GMT\r\n") != std::string::npos);
+}
@@ -0,0 +1,171 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <COtaStreamWriter.h>
+
+
+static const std::string otaTestDir = "/sdcard/test_ota";
+
+
+/* Stand-in for the OTA partition: a file, End(true) keeps it, End(false) deletes it */
+class OtaFilePartition : public COtaStreamWriter::Partition
+{
+public:
+    std::string fileName;
+    FILE *file;
+    int begins;
+    int ends;
+    bool validated;
+
+    OtaFilePartition(std::string _fileName) { fileName = _fileName; file = NULL; begins = 0; ends = 0; validated = false; };
+
+    bool Begin()
+    {
+        begins++;
+        file = fopen(fileName.c_str(), "wb");
+        return file != NULL;
+    }
+
+    bool Write(const uint8_t *_data, size_t _length)
+    {
+        return fwrite(_data, 1, _length, file) == _length;
+    }
+
+    bool End(bool _ok)
+    {
+        ends++;
+        fclose(file);
+        file = NULL;
+        validated = _ok;
+        if (!_ok) {
+            remove(fileName.c_str());
+        }
+        return true;
+    }
+};
+
+
+/* 5000 bytes, starts with the magic byte, MD5 14db59f7bea4a8d302b7ba9a3ada26d2 */
+static std::vector<uint8_t> otaTestImage()
+{
+    std::vector<uint8_t> image(5000);
+    image[0] = COtaStreamWriter::IMAGE_MAGIC;
+    for (size_t i = 1; i < image.size(); ++i) {
+        image[i] = (uint8_t)(i * 7 + 3);
+    }
+    return image;
+}
+
+
+static bool writeOtaTestImage(COtaStreamWriter *_writer, const std::vector<uint8_t> &_image, size_t _length, size_t _piece)
+{
+    for (size_t pos = 0; pos < _length; pos += _piece) {
+        if (!_writer->Write(_image.data() + pos, std::min(_piece, _length - pos))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static long otaTestFileSize(std::string _path)
+{
+    struct stat fileStat;
+    return (stat(_path.c_str(), &fileStat) == 0) ? (long)fileStat.st_size : -1;
+}
+
+
+/**
+ * @brief OTA stream writer: image written in pieces, MD5 and size checks, no write for other files
+ */
+void test_otaStreamWriter()
+{
+    std::string partitionFile = otaTestDir + "/partition.bin";
+    std::vector<uint8_t> image = otaTestImage();
+    const char *md5 = "14db59f7bea4a8d302b7ba9a3ada26d2";
+
+    mkdir(otaTestDir.c_str(), 0775);
+
+    // Valid image with the MD5 of the web browser (upper case is fine as well)
+    {
+        OtaFilePartition partition(partitionFile);
+        COtaStreamWriter writer(&partition, 8192);
+        TEST_ASSERT_TRUE(writer.Begin(image.size(), "14DB59F7BEA4A8D302B7BA9A3ADA26D2"));
+        TEST_ASSERT_TRUE(writeOtaTestImage(&writer, image, image.size(), 1000));
+        TEST_ASSERT_TRUE(writer.Finish());
+        TEST_ASSERT_EQUAL_STRING(md5, writer.getMD5().c_str());
+        TEST_ASSERT_TRUE(partition.validated);
+        TEST_ASSERT_EQUAL(1, partition.begins);
+        TEST_ASSERT_EQUAL(1, partition.ends);
+        TEST_ASSERT_EQUAL(5000, otaTestFileSize(partitionFile));
+    }
+
+    // Without MD5 and length (e.g. chunked upload)
+    {
+        OtaFilePartition partition(partitionFile);
+        COtaStreamWriter writer(&partition, 8192);
+        TEST_ASSERT_TRUE(writer.Begin(0, ""));
+        TEST_ASSERT_TRUE(writeOtaTestImage(&writer, image, image.size(), 333));
+        TEST_ASSERT_TRUE(writer.Finish());
+        TEST_ASSERT_EQUAL_STRING(md5, writer.getMD5().c_str());
+    }
+
+    // MD5 mismatch: the image gets aborted
+    {
+        OtaFilePartition partition(partitionFile);
+        COtaStreamWriter writer(&partition, 8192);
+        TEST_ASSERT_TRUE(writer.Begin(image.size(), "00000000000000000000000000000000"));
+        TEST_ASSERT_TRUE(writeOtaTestImage(&writer, image, image.size(), 4096));
+        TEST_ASSERT_FALSE(writer.Finish());
+        TEST_ASSERT_FALSE(partition.validated);
+        TEST_ASSERT_EQUAL(1, partition.ends);
+        TEST_ASSERT_EQUAL(-1, otaTestFileSize(partitionFile));
+        TEST_ASSERT_EQUAL_STRING("MD5 mismatch (received 14db59f7bea4a8d302b7ba9a3ada26d2, expected 00000000000000000000000000000000)",
+                                 writer.getError().c_str());
+    }
+
+    // Upload broke off
+    {
+        OtaFilePartition partition(partitionFile);
+        COtaStreamWriter writer(&partition, 8192);
+        TEST_ASSERT_TRUE(writer.Begin(image.size(), md5));
+        TEST_ASSERT_TRUE(writeOtaTestImage(&writer, image, 3000, 1000));
+        TEST_ASSERT_FALSE(writer.Finish());
+        TEST_ASSERT_EQUAL_STRING("Received 3000 of 5000 bytes", writer.getError().c_str());
+        TEST_ASSERT_EQUAL(1, partition.ends);
+    }
+
+    // Larger than the partition: announced and while writing
+    {
+        OtaFilePartition partition(partitionFile);
+        COtaStreamWriter writer(&partition, 4096);
+        TEST_ASSERT_FALSE(writer.Begin(image.size(), md5));
+        TEST_ASSERT_EQUAL(0, partition.begins);
+
+        COtaStreamWriter unknownSize(&partition, 4096);
+        TEST_ASSERT_TRUE(unknownSize.Begin(0, md5));
+        TEST_ASSERT_FALSE(writeOtaTestImage(&unknownSize, image, image.size(), 1000));
+        TEST_ASSERT_FALSE(unknownSize.Write(image.data(), 10));     // Stays failed
+        TEST_ASSERT_FALSE(unknownSize.Finish());
+        TEST_ASSERT_EQUAL(1, partition.ends);
+        TEST_ASSERT_EQUAL(4000, unknownSize.getWritten());
+    }
+
+    // No firmware image (ZIP file): nothing gets written
+    {
+        OtaFilePartition partition(partitionFile);
+        COtaStreamWriter writer(&partition, 8192);
+        const uint8_t zip[] = {'P', 'K', 0x03, 0x04};
+        TEST_ASSERT_TRUE(writer.Begin(0, ""));
+        TEST_ASSERT_FALSE(writer.Write(zip, sizeof(zip)));
+        TEST_ASSERT_EQUAL_STRING("Not a firmware image", writer.getError().c_str());
+        TEST_ASSERT_EQUAL(0, partition.begins);
+        TEST_ASSERT_FALSE(writer.Begin(0, "xyz"));      // Invalid MD5
+    }
+
+    rmdir(otaTestDir.c_str());
+}
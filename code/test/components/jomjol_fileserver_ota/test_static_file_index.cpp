@@ -0,0 +1,106 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <CStaticFileIndex.h>
+
+
+static const std::string staticIndexTestDir = "/sdcard/test_static_index";
+
+
+static void writeStaticFile(std::string _path, int _size)
+{
+    FILE *file = fopen(_path.c_str(), "w");
+    for (int i = 0; i < _size; ++i) {
+        fputc('x', file);
+    }
+    fclose(file);
+}
+
+
+/**
+ * @brief static file index: .gz preferred, ETag of the sent file, updates, conditional requests
+ */
+void test_staticFileIndex()
+{
+    std::string sub = staticIndexTestDir + "/sub";
+    CStaticFileIndex index;
+    CStaticFileIndex::File file;
+
+    mkdir(staticIndexTestDir.c_str(), 0775);
+    mkdir(sub.c_str(), 0775);
+    writeStaticFile(staticIndexTestDir + "/index.html", 100);
+    writeStaticFile(staticIndexTestDir + "/index.html.gz", 40);
+    writeStaticFile(staticIndexTestDir + "/only.js.gz", 30);
+    writeStaticFile(sub + "/style.css", 20);
+
+    TEST_ASSERT_FALSE(index.Lookup(staticIndexTestDir + "/index.html", &file));    // Not built yet
+    TEST_ASSERT_EQUAL(4, index.Build(staticIndexTestDir));
+
+    TEST_ASSERT_TRUE(index.Lookup(staticIndexTestDir + "/index.html", &file));
+    TEST_ASSERT_TRUE(file.gzip);
+    TEST_ASSERT_EQUAL_STRING((staticIndexTestDir + "/index.html.gz").c_str(), file.fileName.c_str());
+    TEST_ASSERT_EQUAL(40, file.size);
+
+    TEST_ASSERT_TRUE(index.Lookup(staticIndexTestDir + "/only.js", &file));
+    TEST_ASSERT_TRUE(file.gzip);
+    TEST_ASSERT_TRUE(index.Lookup(staticIndexTestDir + "/only.js.gz", &file));     // Requested by its own name
+    TEST_ASSERT_FALSE(file.gzip);
+
+    TEST_ASSERT_TRUE(index.Lookup(sub + "/style.css", &file));
+    TEST_ASSERT_FALSE(file.gzip);
+    TEST_ASSERT_EQUAL(20, file.size);
+    std::string etag = file.etag;
+    TEST_ASSERT_EQUAL('"', etag[0]);
+
+    TEST_ASSERT_FALSE(index.Lookup(staticIndexTestDir + "/missing.html", &file));
+    TEST_ASSERT_TRUE(index.Covers(staticIndexTestDir + "/missing.html"));
+    TEST_ASSERT_FALSE(index.Covers(staticIndexTestDir + "_other/index.html"));
+    TEST_ASSERT_FALSE(index.Lookup("/sdcard/config/config.ini", &file));
+
+    // Written and deleted files
+    writeStaticFile(sub + "/style.css", 25);
+    index.Update(sub + "/style.css");
+    TEST_ASSERT_TRUE(index.Lookup(sub + "/style.css", &file));
+    TEST_ASSERT_EQUAL(25, file.size);
+    TEST_ASSERT_TRUE(file.etag != etag);
+
+    remove((staticIndexTestDir + "/index.html.gz").c_str());
+    index.Update(staticIndexTestDir + "/index.html.gz");
+    TEST_ASSERT_TRUE(index.Lookup(staticIndexTestDir + "/index.html", &file));
+    TEST_ASSERT_FALSE(file.gzip);
+    TEST_ASSERT_EQUAL(100, file.size);
+    TEST_ASSERT_FALSE(index.Lookup(staticIndexTestDir + "/index.html.gz", &file));
+
+    remove((staticIndexTestDir + "/index.html").c_str());
+    index.Update(staticIndexTestDir + "/index.html");
+    TEST_ASSERT_FALSE(index.Lookup(staticIndexTestDir + "/index.html", &file));
+
+    writeStaticFile(staticIndexTestDir + "/new.png", 10);
+    index.Update(staticIndexTestDir + "/new.png");
+    TEST_ASSERT_TRUE(index.Lookup(staticIndexTestDir + "/new.png", &file));
+
+    // Conditional requests
+    const char *date = "Sat, 03 Mar 1973 09:46:40 GMT";
+    TEST_ASSERT_TRUE(CStaticFileIndex::IsNotModified("\"a-1\"", NULL, "\"a-1\"", date));
+    TEST_ASSERT_TRUE(CStaticFileIndex::IsNotModified("W/\"a-1\"", NULL, "\"a-1\"", date));
+    TEST_ASSERT_TRUE(CStaticFileIndex::IsNotModified("\"b-2\", \"a-1\"", NULL, "\"a-1\"", date));
+    TEST_ASSERT_TRUE(CStaticFileIndex::IsNotModified("*", NULL, "\"a-1\"", date));
+    TEST_ASSERT_FALSE(CStaticFileIndex::IsNotModified("\"a-2\"", date, "\"a-1\"", date));   // If-None-Match takes precedence
+    TEST_ASSERT_TRUE(CStaticFileIndex::IsNotModified("", date, "\"a-1\"", date));
+    TEST_ASSERT_FALSE(CStaticFileIndex::IsNotModified(NULL, "Sun, 04 Mar 1973 09:46:40 GMT", "\"a-1\"", date));
+    TEST_ASSERT_FALSE(CStaticFileIndex::IsNotModified(NULL, NULL, "\"a-1\"", date));
+
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 304 Not Modified\r\n"
+                             "ETag: \"a-1\"\r\n"
+                             "Last-Modified: Sat, 03 Mar 1973 09:46:40 GMT\r\n"
+                             "Cache-Control: max-age=43200\r\n"
+                             "\r\n", CStaticFileIndex::FormatNotModified("\"a-1\"", date, "Cache-Control: max-age=43200\r\n").c_str());
+
+    remove((staticIndexTestDir + "/only.js.gz").c_str());
+    remove((staticIndexTestDir + "/new.png").c_str());
+    remove((sub + "/style.css").c_str());
+    rmdir(sub.c_str());
+    rmdir(staticIndexTestDir.c_str());
+}
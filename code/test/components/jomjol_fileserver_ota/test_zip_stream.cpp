@@ -0,0 +1,337 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <CZipStream.h>
+#include <CZipFileInstaller.h>
+
+
+// Created with Python's zipfile: readme.txt (stored), html/ (folder), html/index.html and html/big.js (70000 bytes, deflated)
+static const uint8_t zipFixture[] = {
+    0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x16, 0x35,
+    0x96, 0x31, 0x06, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x72, 0x65,
+    0x61, 0x64, 0x6d, 0x65, 0x2e, 0x74, 0x78, 0x74, 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x0a, 0x50, 0x4b,
+    0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x68, 0x74, 0x6d, 0x6c,
+    0x2f, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0xeb, 0x7e, 0x53, 0x5d, 0xe1,
+    0xe5, 0x09, 0xa0, 0x25, 0x00, 0x00, 0x00, 0x47, 0x01, 0x00, 0x00, 0x0f, 0x00, 0x00, 0x00, 0x68,
+    0x74, 0x6d, 0x6c, 0x2f, 0x69, 0x6e, 0x64, 0x65, 0x78, 0x2e, 0x68, 0x74, 0x6d, 0x6c, 0xb3, 0xc9,
+    0x28, 0xc9, 0xcd, 0xb1, 0xb3, 0x49, 0xca, 0x4f, 0xa9, 0xb4, 0x4b, 0xc9, 0x4c, 0xcf, 0x2c, 0xc9,
+    0xac, 0x4a, 0x2d, 0x52, 0x18, 0x65, 0x11, 0x62, 0xd9, 0xe8, 0x83, 0x83, 0xcc, 0x46, 0x1f, 0x1c,
+    0x7e, 0x5c, 0x00, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0xeb, 0x7e, 0x53,
+    0x5d, 0xcf, 0x6d, 0xc7, 0x9d, 0xf3, 0x00, 0x00, 0x00, 0x70, 0x11, 0x01, 0x00, 0x0b, 0x00, 0x00,
+    0x00, 0x68, 0x74, 0x6d, 0x6c, 0x2f, 0x62, 0x69, 0x67, 0x2e, 0x6a, 0x73, 0xed, 0xd8, 0xdb, 0x0d,
+    0x82, 0x00, 0x00, 0x04, 0xb0, 0x95, 0x78, 0x29, 0xb0, 0x8d, 0x8a, 0xe8, 0xfe, 0x1b, 0x38, 0xc5,
+    0xe5, 0x12, 0xec, 0x67, 0x57, 0xe8, 0x30, 0x4e, 0xf3, 0x72, 0xbb, 0xaf, 0xdb, 0xfe, 0x7c, 0x1d,
+    0xef, 0xf3, 0x33, 0x30, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xf3, 0xe5, 0x3c, 0x0e, 0xf3, 0x74,
+    0x5b, 0xd6, 0xfb, 0xbe, 0x3d, 0x8e, 0xd7, 0xf9, 0xfe, 0x32, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0xf3, 0xf5, 0xdc, 0xfe, 0x07, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xce, 0xbb, 0xfd, 0x0f,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0x9c, 0x77, 0xfb, 0x1f, 0x98, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x39, 0xef, 0xf6, 0x3f, 0x30, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x73, 0xde, 0xed,
+    0x7f, 0x60, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xe6, 0xbc, 0xdb, 0xff, 0xc0, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0x79, 0xb7, 0xff, 0x81, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0xf3,
+    0x6e, 0xff, 0x03, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xe7, 0xdd, 0xfe, 0x07, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0xce, 0xbb, 0xfd, 0x0f, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0x9c, 0x77, 0xfb, 0x1f, 0x98, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x39, 0xef, 0xf6, 0x3f, 0x30,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x73, 0xde, 0xed, 0x7f, 0x60, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0xe6, 0xbc, 0xdb, 0xff, 0xc0, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0x79, 0xb7, 0xff,
+    0x81, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0xf3, 0x6e, 0xff, 0xc3, 0xbf, 0xf9, 0x07, 0x50,
+    0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x16,
+    0x35, 0x96, 0x31, 0x06, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x72, 0x65, 0x61,
+    0x64, 0x6d, 0x65, 0x2e, 0x74, 0x78, 0x74, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80,
+    0x01, 0x2e, 0x00, 0x00, 0x00, 0x68, 0x74, 0x6d, 0x6c, 0x2f, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03,
+    0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0xeb, 0x7e, 0x53, 0x5d, 0xe1, 0xe5, 0x09, 0xa0, 0x25, 0x00,
+    0x00, 0x00, 0x47, 0x01, 0x00, 0x00, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x80, 0x01, 0x51, 0x00, 0x00, 0x00, 0x68, 0x74, 0x6d, 0x6c, 0x2f, 0x69, 0x6e, 0x64,
+    0x65, 0x78, 0x2e, 0x68, 0x74, 0x6d, 0x6c, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x00,
+    0x00, 0x08, 0x00, 0xeb, 0x7e, 0x53, 0x5d, 0xcf, 0x6d, 0xc7, 0x9d, 0xf3, 0x00, 0x00, 0x00, 0x70,
+    0x11, 0x01, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80,
+    0x01, 0xa3, 0x00, 0x00, 0x00, 0x68, 0x74, 0x6d, 0x6c, 0x2f, 0x62, 0x69, 0x67, 0x2e, 0x6a, 0x73,
+    0x50, 0x4b, 0x05, 0x06, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x04, 0x00, 0xe1, 0x00, 0x00, 0x00,
+    0xbf, 0x01, 0x00, 0x00, 0x00, 0x00,
+};
+
+// Written to a stream (data descriptors, sizes not in the local headers): FIRMWARE.BIN (5000 bytes) and html/new.css
+static const uint8_t zipFixtureStreamed[] = {
+    0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x46, 0x49,
+    0x52, 0x4d, 0x57, 0x41, 0x52, 0x45, 0x2e, 0x42, 0x49, 0x4e, 0xed, 0xc7, 0x49, 0x11, 0x00, 0x20,
+    0x0c, 0x00, 0x31, 0x4b, 0x2d, 0x77, 0xdd, 0x70, 0xe3, 0xdf, 0x01, 0x2e, 0x78, 0x30, 0x9b, 0x5f,
+    0x44, 0x9d, 0x0f, 0x31, 0xe5, 0x62, 0xad, 0x8f, 0xb9, 0xb6, 0x70, 0xce, 0x39, 0xe7, 0x9c, 0x73,
+    0xce, 0x39, 0xe7, 0xfc, 0xbb, 0xab, 0x78, 0x17, 0x43, 0x4e, 0x56, 0xea, 0xe8, 0x6b, 0x1e, 0xce,
+    0xf9, 0xfb, 0x5f, 0x50, 0x4b, 0x07, 0x08, 0x5d, 0x92, 0xd3, 0xce, 0x39, 0x00, 0x00, 0x00, 0x88,
+    0x13, 0x00, 0x00, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0x00, 0x00, 0x21,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00,
+    0x00, 0x68, 0x74, 0x6d, 0x6c, 0x2f, 0x6e, 0x65, 0x77, 0x2e, 0x63, 0x73, 0x73, 0x4b, 0xca, 0x4f,
+    0xa9, 0x54, 0xa8, 0x56, 0x48, 0xce, 0xcf, 0xc9, 0x2f, 0xb2, 0x52, 0x28, 0x4a, 0x4d, 0xb1, 0x56,
+    0xa8, 0xe5, 0x4a, 0x22, 0x5a, 0x10, 0x00, 0x50, 0x4b, 0x07, 0x08, 0x3b, 0xf0, 0xc6, 0xf5, 0x1a,
+    0x00, 0x00, 0x00, 0x3f, 0x00, 0x00, 0x00, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x08,
+    0x00, 0x08, 0x00, 0x00, 0x00, 0x21, 0x00, 0x5d, 0x92, 0xd3, 0xce, 0x39, 0x00, 0x00, 0x00, 0x88,
+    0x13, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80,
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x46, 0x49, 0x52, 0x4d, 0x57, 0x41, 0x52, 0x45, 0x2e, 0x42, 0x49,
+    0x4e, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0x00, 0x00, 0x21,
+    0x00, 0x3b, 0xf0, 0xc6, 0xf5, 0x1a, 0x00, 0x00, 0x00, 0x3f, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x73, 0x00, 0x00, 0x00, 0x68,
+    0x74, 0x6d, 0x6c, 0x2f, 0x6e, 0x65, 0x77, 0x2e, 0x63, 0x73, 0x73, 0x50, 0x4b, 0x05, 0x06, 0x00,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x02, 0x00, 0x74, 0x00, 0x00, 0x00, 0xc7, 0x00, 0x00, 0x00, 0x00,
+    0x00,
+};
+
+
+static const std::string zipTestDir = "/sdcard/test_zip";
+
+
+/* Content of big.js and FIRMWARE.BIN in the fixtures */
+static std::string zipPattern(size_t _size)
+{
+    std::string data;
+    for (size_t i = 0; i < _size; ++i) {
+        data += (char)("0123456789abcdef"[i % 16] ^ ((i / 4096) & 1));
+    }
+    return data;
+}
+
+
+class ZipMemorySink : public CZipStream::Sink
+{
+public:
+    std::map<std::string, std::string> files;
+    std::map<std::string, uint32_t> sizes;
+    std::string current;
+    int failed;
+    std::string skip;
+
+    ZipMemorySink() { failed = 0; };
+
+    bool Begin(std::string _name, uint32_t _size)
+    {
+        current = _name;
+        files[current] = "";
+        sizes[current] = _size;
+        return _name != skip;
+    }
+
+    bool Write(const uint8_t *_data, size_t _length)
+    {
+        files[current].append((const char *)_data, _length);
+        return true;
+    }
+
+    bool End(bool _ok)
+    {
+        failed += _ok ? 0 : 1;
+        return true;
+    }
+};
+
+
+static CZipStream::Status feedZip(CZipStream *_zip, const uint8_t *_data, size_t _length, size_t _piece)
+{
+    CZipStream::Status status = CZipStream::STATUS_MORE;
+
+    for (size_t pos = 0; (pos < _length) && (status == CZipStream::STATUS_MORE); pos += _piece) {
+        status = _zip->Feed(_data + pos, std::min(_piece, _length - pos));
+    }
+
+    return (status == CZipStream::STATUS_MORE) ? _zip->Finish() : status;
+}
+
+
+static std::string readZipTestFile(std::string _path)
+{
+    std::string data;
+    FILE *file = fopen(_path.c_str(), "rb");
+    if (file != NULL) {
+        int c;
+        while ((c = fgetc(file)) != EOF) {
+            data += (char)c;
+        }
+        fclose(file);
+    }
+    return data;
+}
+
+
+static void writeZipTestFile(std::string _path, std::string _data)
+{
+    FILE *file = fopen(_path.c_str(), "wb");
+    fwrite(_data.data(), 1, _data.length(), file);
+    fclose(file);
+}
+
+
+static bool zipTestFileExists(std::string _path)
+{
+    struct stat fileStat;
+    return stat(_path.c_str(), &fileStat) == 0;
+}
+
+
+/**
+ * @brief ZIP stream: entries in pieces of any size, data descriptors, CRC errors, truncated input
+ */
+void test_zipStream()
+{
+    std::string index = "<html><body>";
+    for (int i = 0; i < 30; ++i) {
+        index += "digitizer ";
+    }
+    index += "</body></html>\n";
+
+    // Whole file, in odd pieces and byte by byte
+    const size_t pieces[] = {sizeof(zipFixture), 7, 1};
+    for (int i = 0; i < 3; ++i) {
+        ZipMemorySink sink;
+        CZipStream zip(&sink);
+        TEST_ASSERT_EQUAL(CZipStream::STATUS_DONE, feedZip(&zip, zipFixture, sizeof(zipFixture), pieces[i]));
+        TEST_ASSERT_EQUAL(4, zip.getEntries());
+        TEST_ASSERT_EQUAL(3, sink.files.size());      // Not the folder
+        TEST_ASSERT_EQUAL_STRING("Hello\n", sink.files["readme.txt"].c_str());
+        TEST_ASSERT_EQUAL(70000, sink.sizes["html/big.js"]);
+        TEST_ASSERT_EQUAL_STRING(index.c_str(), sink.files["html/index.html"].c_str());
+        TEST_ASSERT_TRUE(sink.files["html/big.js"] == zipPattern(70000));
+        TEST_ASSERT_EQUAL(0, sink.failed);
+    }
+
+    // Data descriptors
+    {
+        ZipMemorySink sink;
+        CZipStream zip(&sink);
+        TEST_ASSERT_EQUAL(CZipStream::STATUS_DONE, feedZip(&zip, zipFixtureStreamed, sizeof(zipFixtureStreamed), 5));
+        TEST_ASSERT_TRUE(sink.files["FIRMWARE.BIN"] == zipPattern(5000));
+        TEST_ASSERT_EQUAL(0, sink.sizes["FIRMWARE.BIN"]);    // Not known in advance
+        TEST_ASSERT_EQUAL(63, sink.files["html/new.css"].length());
+    }
+
+    // Skipped entry
+    {
+        ZipMemorySink sink;
+        sink.skip = "html/big.js";
+        CZipStream zip(&sink);
+        TEST_ASSERT_EQUAL(CZipStream::STATUS_DONE, feedZip(&zip, zipFixture, sizeof(zipFixture), 100));
+        TEST_ASSERT_EQUAL(0, sink.files["html/big.js"].length());
+        TEST_ASSERT_EQUAL(4, zip.getEntries());
+    }
+
+    // CRC error: one byte of the stored readme.txt changed
+    {
+        std::vector<uint8_t> broken(zipFixture, zipFixture + sizeof(zipFixture));
+        broken[41] ^= 0x01;
+        ZipMemorySink sink;
+        CZipStream zip(&sink);
+        TEST_ASSERT_EQUAL(CZipStream::STATUS_ERROR, feedZip(&zip, broken.data(), broken.size(), 64));
+        TEST_ASSERT_EQUAL_STRING("CRC error in readme.txt", zip.getError().c_str());
+        TEST_ASSERT_EQUAL(1, sink.failed);
+    }
+
+    // Truncated and no ZIP at all
+    {
+        ZipMemorySink sink;
+        CZipStream zip(&sink);
+        TEST_ASSERT_EQUAL(CZipStream::STATUS_ERROR, feedZip(&zip, zipFixture, 300, 64));
+        TEST_ASSERT_EQUAL_STRING("Incomplete ZIP file", zip.getError().c_str());
+        TEST_ASSERT_EQUAL(1, sink.failed);
+
+        CZipStream text(&sink);
+        TEST_ASSERT_EQUAL(CZipStream::STATUS_ERROR, text.Feed((const uint8_t *)"Hello world", 11));
+        TEST_ASSERT_EQUAL_STRING("Not a ZIP file", text.getError().c_str());
+    }
+}
+
+
+/**
+ * @brief ZIP installer: files in place with rename, rollback from the manifest, commit, other entry sink
+ */
+void test_zipFileInstaller()
+{
+    std::string html = zipTestDir + "/html";
+    std::string manifest = zipTestDir + "/manifest.txt";
+    CZipFileInstaller::MapFunction mapName = [](std::string _name) {
+        return (_name == "readme.txt") ? std::string("") : zipTestDir + "/" + _name;
+    };
+
+    CZipFileInstaller::MakeParentDirs(html + "/");
+    writeZipTestFile(html + "/index.html", "old");
+    writeZipTestFile(html + "/stale.txt", "stale");
+    remove(manifest.c_str());
+
+    // Names which could leave the target folder
+    TEST_ASSERT_TRUE(CZipFileInstaller::IsSafeName("html/index.html"));
+    TEST_ASSERT_FALSE(CZipFileInstaller::IsSafeName("../config/wlan.ini"));
+    TEST_ASSERT_FALSE(CZipFileInstaller::IsSafeName("html/../../wlan.ini"));
+    TEST_ASSERT_FALSE(CZipFileInstaller::IsSafeName("/sdcard/wlan.ini"));
+    TEST_ASSERT_FALSE(CZipFileInstaller::IsSafeName(""));
+    {
+        CZipFileInstaller installer(manifest, mapName);
+        TEST_ASSERT_FALSE(installer.Begin("../evil.txt", 3));
+        TEST_ASSERT_FALSE(zipTestFileExists(zipTestDir + "/../evil.txt.new"));
+    }
+
+    // Extract and roll back
+    {
+        CZipFileInstaller installer(manifest, mapName);
+        CZipStream zip(&installer);
+        TEST_ASSERT_EQUAL(CZipStream::STATUS_DONE, feedZip(&zip, zipFixture, sizeof(zipFixture), 512));
+        TEST_ASSERT_EQUAL(2, installer.getInstalled()->size());
+        TEST_ASSERT_FALSE(zipTestFileExists(zipTestDir + "/readme.txt"));
+        TEST_ASSERT_TRUE(readZipTestFile(html + "/big.js") == zipPattern(70000));
+        TEST_ASSERT_EQUAL_STRING("old", readZipTestFile(html + "/index.html.old").c_str());
+        TEST_ASSERT_FALSE(zipTestFileExists(html + "/big.js.new"));
+        TEST_ASSERT_TRUE(zipTestFileExists(manifest));
+    }
+
+    TEST_ASSERT_EQUAL(2, CZipFileInstaller::Rollback(manifest));
+    TEST_ASSERT_EQUAL_STRING("old", readZipTestFile(html + "/index.html").c_str());
+    TEST_ASSERT_FALSE(zipTestFileExists(html + "/index.html.old"));
+    TEST_ASSERT_FALSE(zipTestFileExists(html + "/big.js"));
+    TEST_ASSERT_FALSE(zipTestFileExists(manifest));
+    TEST_ASSERT_EQUAL(-1, CZipFileInstaller::Rollback(manifest));
+
+    // Broken ZIP: the file of the failed entry is not left behind
+    {
+        std::vector<uint8_t> broken(zipFixture, zipFixture + sizeof(zipFixture));
+        broken[300] ^= 0x55;    // In the deflated data of big.js
+        CZipFileInstaller installer(manifest, mapName);
+        CZipStream zip(&installer);
+        TEST_ASSERT_EQUAL(CZipStream::STATUS_ERROR, feedZip(&zip, broken.data(), broken.size(), 512));
+        TEST_ASSERT_FALSE(zipTestFileExists(html + "/big.js.new"));
+        TEST_ASSERT_FALSE(zipTestFileExists(html + "/big.js"));
+        TEST_ASSERT_EQUAL(1, CZipFileInstaller::Rollback(manifest));
+        TEST_ASSERT_EQUAL_STRING("old", readZipTestFile(html + "/index.html").c_str());
+    }
+
+    // Extract, firmware to its own sink, commit and replace the folder
+    {
+        ZipMemorySink firmware;
+        CZipFileInstaller installer(manifest, mapName);
+        installer.SetEntrySink("firmware.bin", &firmware);
+        CZipStream zip(&installer);
+        TEST_ASSERT_EQUAL(CZipStream::STATUS_DONE, feedZip(&zip, zipFixture, sizeof(zipFixture), 4096));
+        CZipStream streamed(&installer);
+        TEST_ASSERT_EQUAL(CZipStream::STATUS_DONE, feedZip(&streamed, zipFixtureStreamed, sizeof(zipFixtureStreamed), 4096));
+
+        TEST_ASSERT_TRUE(firmware.files["FIRMWARE.BIN"] == zipPattern(5000));
+        TEST_ASSERT_FALSE(zipTestFileExists(zipTestDir + "/FIRMWARE.BIN"));
+        TEST_ASSERT_EQUAL(3, installer.getInstalled()->size());
+
+        installer.Commit();
+        TEST_ASSERT_FALSE(zipTestFileExists(manifest));
+        TEST_ASSERT_FALSE(zipTestFileExists(html + "/index.html.old"));
+        TEST_ASSERT_EQUAL(1, installer.RemoveOthers(html));
+        TEST_ASSERT_FALSE(zipTestFileExists(html + "/stale.txt"));
+        TEST_ASSERT_TRUE(zipTestFileExists(html + "/new.css"));
+    }
+
+    remove((html + "/index.html").c_str());
+    remove((html + "/big.js").c_str());
+    remove((html + "/new.css").c_str());
+    rmdir(html.c_str());
+    rmdir(zipTestDir.c_str());
+}
@@ -0,0 +1,98 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <CHttpClientPool.h>
+
+
+/**
+ * @brief HTTP client pool: key per host, reuse, reset of the request headers, idle timeout,
+ *        reconnect after an error, eviction of another host, transient client when all are in use
+ */
+void test_httpClientPool()
+{
+    TEST_ASSERT_EQUAL_STRING("http://influx.local:8086", CHttpClientPool::GetKey("HTTP://Influx.Local:8086/api/v2/write?org=a").c_str());
+    TEST_ASSERT_EQUAL_STRING("http://192.168.1.5:80", CHttpClientPool::GetKey("http://user:pw@192.168.1.5?timestamp=1").c_str());
+    TEST_ASSERT_EQUAL_STRING("https://hook.example.com:443", CHttpClientPool::GetKey("https://hook.example.com/api").c_str());
+    TEST_ASSERT_EQUAL_STRING("http://[fe80::1]:8080", CHttpClientPool::GetKey("http://[fe80::1]:8080/").c_str());
+    TEST_ASSERT_EQUAL_STRING("", CHttpClientPool::GetKey("influx.local/write").c_str());
+    TEST_ASSERT_EQUAL_STRING("", CHttpClientPool::GetKey("http:///write").c_str());
+
+    // The stand-in clients are numbers, the callbacks log what happens to them
+    int nextClient = 1;
+    bool failCreate = false;
+    std::string log;
+
+    CHttpClientPool pool(2, 1000,
+        [&](const std::string &) { if (failCreate) return (void *)NULL; log += "+" + std::to_string(nextClient) + ","; return (void *)(intptr_t)nextClient++; },
+        [&](void *_client, const std::vector<std::string> &_headers) { log += "r" + std::to_string((intptr_t)_client) + ":" + std::to_string(_headers.size()) + ","; },
+        [&](void *_client) { log += "-" + std::to_string((intptr_t)_client) + ","; });
+
+    TEST_ASSERT_NULL(pool.Acquire("no url", 0));
+
+    // Webhook JSON and image upload to the same host share one client
+    bool reused = true;
+    void *a = pool.Acquire("http://hook.local/api", 0, &reused);
+    TEST_ASSERT_EQUAL(1, (intptr_t)a);
+    TEST_ASSERT_FALSE(reused);
+    pool.AddHeader(a, "Content-Type");
+    pool.AddHeader(a, "APIKEY");
+    pool.Release(a, 10, true);
+
+    TEST_ASSERT_EQUAL_PTR(a, pool.Acquire("http://HOOK.local/api?timestamp=1700000000", 20, &reused));
+    TEST_ASSERT_TRUE(reused);
+    TEST_ASSERT_EQUAL(2, pool.getRequests(a));
+    pool.Release(a, 30, true);
+    TEST_ASSERT_EQUAL_STRING("+1,r1:2,r1:0,", log.c_str());
+
+    // A second host gets its own client, both are kept
+    void *b = pool.Acquire("http://influx.local:8086/write", 40);
+    TEST_ASSERT_EQUAL(2, (intptr_t)b);
+    TEST_ASSERT_EQUAL(1, pool.getInUse());
+    pool.Release(b, 50, true);
+    TEST_ASSERT_EQUAL(2, pool.getCount());
+
+    // A failed request destroys the client, the next request connects again
+    TEST_ASSERT_EQUAL_PTR(b, pool.Acquire("http://influx.local:8086/write", 60));
+    pool.Release(b, 70, false);
+    TEST_ASSERT_EQUAL(1, pool.getCount());
+    void *c = pool.Acquire("http://influx.local:8086/write", 80, &reused);
+    TEST_ASSERT_EQUAL(3, (intptr_t)c);
+    TEST_ASSERT_FALSE(reused);
+    pool.Release(c, 90, true);
+    TEST_ASSERT_EQUAL_STRING("+1,r1:2,r1:0,+2,r2:0,-2,+3,r3:0,", log.c_str());
+
+    // A third host: the least recently used idle client gets closed
+    log = "";
+    void *d = pool.Acquire("http://other.local/", 100);
+    TEST_ASSERT_EQUAL_STRING("-1,+4,", log.c_str());
+    TEST_ASSERT_EQUAL(2, pool.getCount());
+
+    // All clients in use: a transient client, destroyed on release
+    log = "";
+    void *e = pool.Acquire("http://influx.local:8086/write", 110);     // Client 3
+    void *f = pool.Acquire("http://influx.local:8086/write", 110);
+    TEST_ASSERT_EQUAL_PTR(c, e);
+    TEST_ASSERT_EQUAL(5, (intptr_t)f);
+    TEST_ASSERT_EQUAL(3, pool.getCount());
+    pool.Release(f, 120, true);
+    pool.Release(e, 120, true);
+    pool.Release(d, 120, true);
+    TEST_ASSERT_EQUAL_STRING("+5,-5,r3:0,r4:0,", log.c_str());
+    TEST_ASSERT_EQUAL(2, pool.getCount());
+
+    // Idle timeout
+    TEST_ASSERT_EQUAL(0, pool.CloseIdle(1119));
+    TEST_ASSERT_EQUAL(2, pool.CloseIdle(1120));
+    TEST_ASSERT_EQUAL(0, pool.getCount());
+    TEST_ASSERT_EQUAL(0, pool.getRequests(a));
+
+    failCreate = true;
+    TEST_ASSERT_NULL(pool.Acquire("http://hook.local/api", 2000));
+    TEST_ASSERT_EQUAL(0, pool.getCount());
+
+    CHttpClientPool::Stats stats = pool.getStats();
+    TEST_ASSERT_EQUAL(5, stats.created);
+    TEST_ASSERT_EQUAL(3, stats.reused);
+    TEST_ASSERT_EQUAL(3, stats.closedIdle);
+    TEST_ASSERT_EQUAL(1, stats.closedError);
+}
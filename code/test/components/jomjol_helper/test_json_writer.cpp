@@ -0,0 +1,169 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <CJsonWriter.h>
+
+
+/* Counts the heap allocations of the strings of the benchmark */
+static int jsonTestAllocations = 0;
+
+template <class T> struct JsonTestAllocator
+{
+    typedef T value_type;
+
+    JsonTestAllocator() {}
+    template <class U> JsonTestAllocator(const JsonTestAllocator<U> &) {}
+
+    T *allocate(size_t _count) { jsonTestAllocations++; return (T *)malloc(_count * sizeof(T)); }
+    void deallocate(T *_ptr, size_t) { free(_ptr); }
+
+    template <class U> bool operator==(const JsonTestAllocator<U> &) const { return true; }
+    template <class U> bool operator!=(const JsonTestAllocator<U> &) const { return false; }
+};
+
+typedef std::basic_string<char, std::char_traits<char>, JsonTestAllocator<char> > JsonTestString;
+
+
+/* One number of /json as built before by string concatenation (ClassFlowPostProcessing::getJsonFromNumber) */
+static JsonTestString jsonTestConcatenate(const JsonTestString &_value, const JsonTestString &_raw, const JsonTestString &_pre,
+                                          const JsonTestString &_error, const JsonTestString &_rate, const JsonTestString &_timestamp)
+{
+    JsonTestString json = "";
+    JsonTestString lineend = "\n";
+
+    json += "  {" + lineend;
+    json += "    \"value\": \"" + _value + "\"," + lineend;
+    json += "    \"raw\": \"" + _raw + "\"," + lineend;
+    json += "    \"pre\": \"" + _pre + "\"," + lineend;
+    json += "    \"error\": \"" + _error + "\"," + lineend;
+    json += "    \"rate\": \"" + _rate + "\"," + lineend;
+    json += "    \"timestamp\": \"" + _timestamp + "\"" + lineend;
+    json += "  }" + lineend;
+
+    return json;
+}
+
+
+static std::string jsonTestWrite(size_t _bufferSize, bool _pretty, uint32_t *_flushes = NULL)
+{
+    char buffer[64];
+    std::string out;
+    CJsonWriter json(buffer, _bufferSize, CJsonWriter::StringSink(&out), _pretty);
+
+    json.BeginObject();
+    json.Key("main");
+    json.BeginObject();
+    json.Field("value", "123.456");
+    json.Field("error", "Rate too high - Read: 1.2 - Pre: 1.1\n\"quoted\" \\ \x01");
+    json.EndObject();
+    json.Key("ids");
+    json.BeginArray();
+    json.Int(-42);
+    json.Bool(true);
+    json.BeginObject();
+    json.EndObject();
+    json.EndArray();
+    json.EndObject();
+
+    TEST_ASSERT_TRUE(json.Flush());
+    TEST_ASSERT_EQUAL(out.length(), json.getLength());
+
+    if (_flushes != NULL) {
+        *_flushes = json.getFlushCount();
+    }
+    return out;
+}
+
+
+/**
+ * @brief streaming JSON writer: commas, escaping, pretty output, small buffers, sink errors, nesting limit,
+ *        allocations per number compared to string concatenation
+ */
+void test_jsonWriter()
+{
+    const char *expected = "{\"main\":{\"value\":\"123.456\",\"error\":\"Rate too high - Read: 1.2 - Pre: 1.1\\n\\\"quoted\\\" \\\\ \\u0001\"},"
+                           "\"ids\":[-42,true,{}]}";
+    uint32_t flushes = 0;
+
+    TEST_ASSERT_EQUAL_STRING(expected, jsonTestWrite(64, false, &flushes).c_str());
+    TEST_ASSERT_EQUAL(2, flushes);
+
+    // Any buffer size gives the same output
+    for (size_t size = 1; size < 20; ++size) {
+        TEST_ASSERT_EQUAL_STRING(expected, jsonTestWrite(size, false).c_str());
+    }
+
+    TEST_ASSERT_EQUAL_STRING("{\n"
+                             "  \"main\": {\n"
+                             "    \"value\": \"123.456\",\n"
+                             "    \"error\": \"Rate too high - Read: 1.2 - Pre: 1.1\\n\\\"quoted\\\" \\\\ \\u0001\"\n"
+                             "  },\n"
+                             "  \"ids\": [\n"
+                             "    -42,\n"
+                             "    true,\n"
+                             "    {}\n"
+                             "  ]\n"
+                             "}", jsonTestWrite(7, true).c_str());
+
+    // Keys get escaped as well, UTF-8 passes unchanged
+    char buffer[16];
+    std::string out;
+    CJsonWriter escaped(buffer, sizeof(buffer), CJsonWriter::StringSink(&out));
+    escaped.BeginObject();
+    escaped.Field("a\"b", "\xc2\xb0" "C\t\r");
+    escaped.EndObject();
+    escaped.Flush();
+    TEST_ASSERT_EQUAL_STRING("{\"a\\\"b\":\"\xc2\xb0" "C\\t\\r\"}", out.c_str());
+
+    // A failing sink (e.g. the HTTP client disconnected) stops the output
+    int calls = 0;
+    CJsonWriter aborted(buffer, 4, [&](const char *, size_t) { return ++calls < 2; });
+    aborted.BeginObject();
+    aborted.Field("value", "123456789");
+    TEST_ASSERT_FALSE(aborted.isOk());
+    TEST_ASSERT_FALSE(aborted.Flush());
+    TEST_ASSERT_EQUAL(2, calls);
+
+    // Unbalanced and too deep nesting
+    CJsonWriter unbalanced(buffer, sizeof(buffer), CJsonWriter::StringSink(&out));
+    unbalanced.EndObject();
+    TEST_ASSERT_FALSE(unbalanced.isOk());
+
+    CJsonWriter deep(buffer, sizeof(buffer), CJsonWriter::StringSink(&out));
+    for (int i = 0; i < CJsonWriter::MAX_DEPTH; ++i) {
+        deep.BeginArray();
+    }
+    TEST_ASSERT_FALSE(deep.isOk());
+
+    // Benchmark: heap allocations for one number, string concatenation vs. writer with a stack buffer
+    JsonTestString value = "1234.5678", raw = "01234.5678", pre = "1234.5600", error = "no error", rate = "0.002200", timestamp = "2024-06-01T12:00:00+0200";
+
+    jsonTestAllocations = 0;
+    JsonTestString concatenated = jsonTestConcatenate(value, raw, pre, error, rate, timestamp);
+    int concatenationAllocations = jsonTestAllocations;
+
+    jsonTestAllocations = 0;
+    JsonTestString written;
+    written.reserve(concatenated.length());
+    char stackBuffer[64];
+    CJsonWriter json(stackBuffer, sizeof(stackBuffer), [&](const char *_data, size_t _length) { written.append(_data, _length); return true; }, true);
+    json.BeginObject();
+    json.Field("value", value.c_str());
+    json.Field("raw", raw.c_str());
+    json.Field("pre", pre.c_str());
+    json.Field("error", error.c_str());
+    json.Field("rate", rate.c_str());
+    json.Field("timestamp", timestamp.c_str());
+    json.EndObject();
+    json.Flush();
+    int writerAllocations = jsonTestAllocations;
+
+    char message[100];
+    snprintf(message, sizeof(message), "Allocations per number: concatenation %d, writer %d (%d bytes)",
+             concatenationAllocations, writerAllocations, (int)written.length());
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_EQUAL(1, writerAllocations);    // Only the reserve() of the destination
+    TEST_ASSERT_TRUE(concatenationAllocations > 5 * writerAllocations);
+}
@@ -0,0 +1,89 @@
+#include <unity.h>
+#include <CMemoryArena.h>
+
+
+/**
+ * @brief per-round arena: alignment, LIFO free, overflow, reset and high water mark
+ */
+void test_memoryArena()
+{
+    static uint8_t buffer[256];
+    CMemoryArena arena;
+
+    // not initialized -> no allocation
+    TEST_ASSERT_NULL(arena.Alloc(16));
+
+    arena.Init(buffer, sizeof(buffer));
+
+    uint8_t *a = (uint8_t *)arena.Alloc(10);
+    uint8_t *b = (uint8_t *)arena.Alloc(20);
+    TEST_ASSERT_EQUAL_PTR(buffer, a);
+    TEST_ASSERT_EQUAL_PTR(buffer + 16, b); // aligned to 8 bytes
+    TEST_ASSERT_EQUAL(36, arena.getUsed());
+
+    // most recent allocation can be given back and gets reused
+    TEST_ASSERT_TRUE(arena.Free(b));
+    TEST_ASSERT_EQUAL(16, arena.getUsed());
+    TEST_ASSERT_EQUAL_PTR(b, arena.Alloc(20));
+
+    // older allocations stay until Reset()
+    TEST_ASSERT_TRUE(arena.Free(a));
+    TEST_ASSERT_EQUAL(36, arena.getUsed());
+
+    // foreign pointer
+    static uint8_t other[8];
+    TEST_ASSERT_FALSE(arena.Free(other));
+
+    // overflow
+    TEST_ASSERT_NULL(arena.Alloc(sizeof(buffer)));
+    TEST_ASSERT_EQUAL(1, arena.getOverflowCount());
+
+    TEST_ASSERT_NOT_NULL(arena.Alloc(200));
+    TEST_ASSERT_EQUAL(240, arena.getHighWater());
+
+    arena.Reset();
+    TEST_ASSERT_EQUAL(0, arena.getUsed());
+    TEST_ASSERT_EQUAL(240, arena.getHighWater());
+    arena.ResetHighWater();
+    TEST_ASSERT_EQUAL(0, arena.getHighWater());
+    TEST_ASSERT_EQUAL_PTR(buffer, arena.Alloc(1));
+}
+
+
+/**
+ * @brief fixed-size pool: slot reuse, size check, exhaustion
+ */
+void test_memoryPool()
+{
+    const int slots = 4;
+    static uint8_t buffer[4 * 24];
+    CMemoryPool pool;
+
+    TEST_ASSERT_EQUAL(sizeof(buffer), CMemoryPool::getBufferSize(20, slots)); // 20 -> 24 (aligned)
+
+    pool.Init(buffer, 20, slots);
+    TEST_ASSERT_EQUAL(24, pool.getSlotSize());
+
+    void *p[slots];
+    for (int i = 0; i < slots; ++i) {
+        p[i] = pool.Alloc(20);
+        TEST_ASSERT_EQUAL_PTR(buffer + i * 24, p[i]);
+    }
+
+    TEST_ASSERT_NULL(pool.Alloc(1)); // exhausted
+    TEST_ASSERT_EQUAL(slots, pool.getUsedSlots());
+
+    TEST_ASSERT_TRUE(pool.Free(p[2]));
+    TEST_ASSERT_FALSE(pool.Free(buffer + 5)); // not a slot start
+    TEST_ASSERT_NULL(pool.Alloc(25));         // too large for a slot
+    TEST_ASSERT_EQUAL_PTR(p[2], pool.Alloc(8));
+
+    TEST_ASSERT_EQUAL(slots, pool.getHighWater());
+}
+
+
+void test_memoryAllocators()
+{
+    test_memoryArena();
+    test_memoryPool();
+}
@@ -0,0 +1,207 @@
+#include <unity.h>
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <CImageBasis.h>
+#include <CImageLogQueue.h>
+#include <CImagePack.h>
+
+
+static std::vector<uint8_t> readImageLogFile(std::string _fileName)
+{
+    std::vector<uint8_t> content;
+    FILE *file = fopen(_fileName.c_str(), "rb");
+
+    if (file == NULL) {
+        return content;
+    }
+
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        content.push_back((uint8_t)c);
+    }
+    fclose(file);
+
+    return content;
+}
+
+
+/**
+ * @brief image log queue: file names and content as written in the round, policies and counters
+ */
+void test_imageLogQueue()
+{
+    float value;
+    int klasse;
+
+    // Names as before (ClassFlowImage::LogImage)
+    value = 3.46;
+    TEST_ASSERT_EQUAL_STRING("/sdcard/log/digit/20240101/10/3.5_dig1_20240101-101500.jpg",
+                             CImageLogQueue::GetLogImageName("/sdcard/log/digit/20240101/10", "dig1", &value, NULL, "20240101-101500").c_str());
+    value = 9.97;
+    TEST_ASSERT_EQUAL_STRING("/x/0.0_ana1_t.jpg", CImageLogQueue::GetLogImageName("/x", "ana1", &value, NULL, "t").c_str());
+    value = -1;
+    TEST_ASSERT_EQUAL_STRING("/x/N.N_ana1_t.jpg", CImageLogQueue::GetLogImageName("/x", "ana1", &value, NULL, "t").c_str());
+    klasse = 7;
+    TEST_ASSERT_EQUAL_STRING("/x/7_main_dig2_t.jpg", CImageLogQueue::GetLogImageName("/x", "main_dig2", NULL, &klasse, "t").c_str());
+    TEST_ASSERT_EQUAL_STRING("/x/raw_t.jpg", CImageLogQueue::GetLogImageName("/x", "raw", NULL, NULL, "t").c_str());
+
+    // Content: same bytes as the synchronous CImageBasis::SaveToFile(), the queued copy is independent of the source
+    const int width = 20, height = 32, channels = 3;
+    static uint8_t pixels[width * height * channels];
+    for (int i = 0; i < (int)sizeof(pixels); ++i) {
+        pixels[i] = (uint8_t)(i * 7 + i / 60);
+    }
+
+    std::string dir = "/sdcard/test_imagelog";
+    mkdir(dir.c_str(), 0775);
+    TEST_ASSERT_TRUE(stbi_write_jpg((dir + "/sync.jpg").c_str(), width, height, channels, pixels, 0) != 0);
+
+    CImageLogQueue queue;
+    queue.Setup(CImageLogQueue::POLICY_DROP_OLDEST, 3, 3 * sizeof(pixels));
+    TEST_ASSERT_EQUAL(CImageLogQueue::PUSH_QUEUED, queue.Push(dir + "/async.jpg", pixels, width, height, channels));
+    memset(pixels, 0, sizeof(pixels));
+
+    CImageLogQueue::Job job;
+    TEST_ASSERT_TRUE(queue.Pop(&job));
+    TEST_ASSERT_EQUAL_STRING((dir + "/async.jpg").c_str(), job.fileName.c_str());
+    TEST_ASSERT_TRUE(CImageLogQueue::WriteJPG(&job));
+    queue.Done(&job, true);
+
+    std::vector<uint8_t> sync = readImageLogFile(dir + "/sync.jpg");
+    std::vector<uint8_t> async = readImageLogFile(dir + "/async.jpg");
+    TEST_ASSERT_TRUE(sync.size() > 0);
+    TEST_ASSERT_EQUAL(sync.size(), async.size());
+    TEST_ASSERT_TRUE(sync == async);
+    TEST_ASSERT_EQUAL(0, queue.getBytes());
+    remove((dir + "/sync.jpg").c_str());
+    remove((dir + "/async.jpg").c_str());
+    rmdir(dir.c_str());
+
+    // Drop oldest: limited by jobs, the newest ones stay in order
+    for (int i = 0; i < 5; ++i) {
+        TEST_ASSERT_EQUAL(CImageLogQueue::PUSH_QUEUED, queue.Push("job" + std::to_string(i), pixels, width, height, channels));
+    }
+    TEST_ASSERT_EQUAL(3, queue.getDepth());
+    TEST_ASSERT_EQUAL(2, queue.getStats().droppedOldest);
+    TEST_ASSERT_EQUAL(3, queue.getStats().maxDepth);
+
+    // The job being written keeps its memory: only 2 more fit by bytes
+    TEST_ASSERT_TRUE(queue.Pop(&job));
+    TEST_ASSERT_EQUAL_STRING("job2", job.fileName.c_str());
+    TEST_ASSERT_EQUAL(CImageLogQueue::PUSH_QUEUED, queue.Push("job5", pixels, width, height, channels));
+    TEST_ASSERT_EQUAL(3, queue.getStats().droppedOldest);
+    queue.Done(&job, false);
+    TEST_ASSERT_EQUAL(1, queue.getStats().failed);
+
+    TEST_ASSERT_TRUE(queue.Pop(&job));
+    TEST_ASSERT_EQUAL_STRING("job4", job.fileName.c_str());
+    queue.Done(&job, true);
+    TEST_ASSERT_TRUE(queue.Pop(&job));
+    TEST_ASSERT_EQUAL_STRING("job5", job.fileName.c_str());
+    queue.Done(&job, true);
+    TEST_ASSERT_FALSE(queue.Pop(&job));
+    TEST_ASSERT_EQUAL(0, queue.getBytes());
+
+    // Too large for the queue: written by the caller
+    TEST_ASSERT_EQUAL(CImageLogQueue::PUSH_TOO_LARGE, queue.Push("large", pixels, width, height * 4, channels));
+
+    // Block: nothing changes until the writer made room
+    queue.Setup(CImageLogQueue::POLICY_BLOCK, 1, sizeof(pixels));
+    TEST_ASSERT_EQUAL(CImageLogQueue::PUSH_QUEUED, queue.Push("a", pixels, width, height, channels));
+    TEST_ASSERT_EQUAL(CImageLogQueue::PUSH_FULL, queue.Push("b", pixels, width, height, channels));
+    TEST_ASSERT_EQUAL(1, queue.getDepth());
+    TEST_ASSERT_TRUE(queue.Pop(&job));
+    TEST_ASSERT_EQUAL(CImageLogQueue::PUSH_FULL, queue.Push("b", pixels, width, height, channels));  // still being written
+    queue.Done(&job, true);
+    TEST_ASSERT_EQUAL(CImageLogQueue::PUSH_QUEUED, queue.Push("b", pixels, width, height, channels));
+
+    // Skip when busy
+    queue.Setup(CImageLogQueue::POLICY_SKIP, 1, sizeof(pixels));
+    TEST_ASSERT_EQUAL(CImageLogQueue::PUSH_SKIPPED, queue.Push("c", pixels, width, height, channels));
+    TEST_ASSERT_EQUAL(1, queue.getStats().skipped);
+    TEST_ASSERT_TRUE(queue.Pop(&job));
+    TEST_ASSERT_EQUAL_STRING("b", job.fileName.c_str());
+    queue.Done(&job, true);
+
+    CImageLogQueue::Stats stats = queue.getStats();
+    TEST_ASSERT_EQUAL(9, stats.queued);
+    TEST_ASSERT_EQUAL(5, stats.written);
+}
+
+
+/**
+ * @brief image log container: appended images are found by name and legacy file name, index lines
+ */
+void test_imagePack()
+{
+    std::string dir = "/sdcard/test_imagepack";
+    std::string pack = dir + "/images.pack";
+    CImagePack::Entry entry;
+
+    mkdir(dir.c_str(), 0775);
+    remove(pack.c_str());
+    remove(CImagePack::GetIndexFileName(pack).c_str());
+
+    TEST_ASSERT_EQUAL_STRING("/sdcard/test_imagepack/images.idx", CImagePack::GetIndexFileName(pack).c_str());
+    TEST_ASSERT_FALSE(CImagePack::Find(pack, "dig1_t.jpg", &entry));
+
+    const uint8_t data1[] = "first image";
+    const uint8_t data2[] = "second";
+    TEST_ASSERT_TRUE(CImagePack::AppendData(pack, "3.5", "dig1_t.jpg", data1, sizeof(data1)));
+    TEST_ASSERT_TRUE(CImagePack::AppendData(pack, "", "raw_t.jpg", data2, sizeof(data2)));
+
+    TEST_ASSERT_TRUE(CImagePack::Find(pack, "3.5_dig1_t.jpg", &entry));
+    TEST_ASSERT_EQUAL(0, entry.offset);
+    TEST_ASSERT_EQUAL(sizeof(data1), entry.length);
+    TEST_ASSERT_EQUAL_STRING("3.5", entry.result.c_str());
+    TEST_ASSERT_TRUE(CImagePack::Find(pack, "dig1_t.jpg", &entry));
+    TEST_ASSERT_TRUE(CImagePack::Find(pack, "raw_t.jpg", &entry));
+    TEST_ASSERT_EQUAL(sizeof(data1), entry.offset);
+    TEST_ASSERT_EQUAL(sizeof(data2), entry.length);
+    TEST_ASSERT_FALSE(CImagePack::Find(pack, "_raw_t.jpg", &entry));
+    TEST_ASSERT_FALSE(CImagePack::Find(pack, "dig2_t.jpg", &entry));
+
+    // Incomplete lines (e.g. power loss) are ignored
+    TEST_ASSERT_TRUE(CImagePack::ParseIndexLine("10,20,N.N,ana1_t.jpg\n", &entry));
+    TEST_ASSERT_EQUAL(10, entry.offset);
+    TEST_ASSERT_EQUAL(20, entry.length);
+    TEST_ASSERT_EQUAL_STRING("N.N", entry.result.c_str());
+    TEST_ASSERT_EQUAL_STRING("ana1_t.jpg", entry.name.c_str());
+    TEST_ASSERT_FALSE(CImagePack::ParseIndexLine("10,20,N.N,ana1_t.j", &entry));
+    TEST_ASSERT_FALSE(CImagePack::ParseIndexLine("10,20,N.N\n", &entry));
+    TEST_ASSERT_FALSE(CImagePack::ParseIndexLine("10,0,,a\n", &entry));
+
+    // Queued image: same JPG as a single file
+    const int width = 8, height = 8, channels = 3;
+    static uint8_t pixels[width * height * channels];
+    for (int i = 0; i < (int)sizeof(pixels); ++i) {
+        pixels[i] = (uint8_t)(i * 13);
+    }
+    TEST_ASSERT_TRUE(stbi_write_jpg((dir + "/single.jpg").c_str(), width, height, channels, pixels, 0) != 0);
+
+    CImageLogQueue queue;
+    CImageLogQueue::Job job;
+    queue.Setup(CImageLogQueue::POLICY_DROP_OLDEST, 2, sizeof(pixels));
+    TEST_ASSERT_EQUAL(CImageLogQueue::PUSH_QUEUED, queue.Push("ana2_t.jpg", pixels, width, height, channels, pack, "0.0"));
+    TEST_ASSERT_TRUE(queue.Pop(&job));
+    TEST_ASSERT_TRUE(CImageLogQueue::WriteJPG(&job));
+    queue.Done(&job, true);
+
+    std::vector<uint8_t> single = readImageLogFile(dir + "/single.jpg");
+    std::vector<uint8_t> packed = readImageLogFile(pack);
+    TEST_ASSERT_TRUE(CImagePack::Find(pack, "0.0_ana2_t.jpg", &entry));
+    TEST_ASSERT_EQUAL(sizeof(data1) + sizeof(data2), entry.offset);
+    TEST_ASSERT_EQUAL(single.size(), entry.length);
+    TEST_ASSERT_EQUAL(entry.offset + entry.length, packed.size());
+    TEST_ASSERT_TRUE(std::equal(single.begin(), single.end(), packed.begin() + entry.offset));
+
+    remove((dir + "/single.jpg").c_str());
+    remove(pack.c_str());
+    remove(CImagePack::GetIndexFileName(pack).c_str());
+    rmdir(dir.c_str());
+}
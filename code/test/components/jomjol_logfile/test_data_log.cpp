@@ -0,0 +1,236 @@
+#include <unity.h>
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <CDataLog.h>
+#include <CDataLogQuery.h>
+
+
+static const char *testDataLog = "/sdcard/test_datalog.bin";
+
+
+static CDataLog::Record makeRecord(uint32_t _timestamp, double _value)
+{
+    CDataLog::Record record;
+
+    CDataLog::ClearRecord(&record);
+    record.timestamp = _timestamp;
+    record.decimals = 3;
+    record.flags = CDataLog::FLAG_VALUE | CDataLog::FLAG_PREVALUE | CDataLog::FLAG_NO_ERROR;
+    record.value = _value;
+    record.preValue = _value;
+    strcpy(record.raw, "00123.456");
+
+    return record;
+}
+
+
+/**
+ * @brief binary data log: append, names, CSV/JSON format of a record
+ */
+void test_dataLogFormat()
+{
+    remove(testDataLog);
+    remove(CDataLog::getIndexFileName(testDataLog).c_str());
+    TEST_ASSERT_EQUAL_STRING("/sdcard/test_datalog.idx", CDataLog::getIndexFileName(testDataLog).c_str());
+
+    CDataLog::Record record = makeRecord(1700000000, 123.456);
+    record.flags |= CDataLog::FLAG_RATE | CDataLog::FLAG_CHANGE;
+    record.rate = 0.5;
+    record.changeAbsolute = 0.012;
+    CDataLog::SetROIs(&record, ",1,2,N", ",4.5,6.0");
+    TEST_ASSERT_EQUAL(3, record.digitCount);
+    TEST_ASSERT_EQUAL(2, record.analogCount);
+    TEST_ASSERT_EQUAL(CDataLog::ROI_NAN, record.roi[2]);
+    TEST_ASSERT_EQUAL(45, record.roi[3]);
+
+    TEST_ASSERT_TRUE(CDataLog::Append(testDataLog, "main", &record));
+    CDataLog::Record second = makeRecord(1700000060, 123.5);
+    TEST_ASSERT_TRUE(CDataLog::Append(testDataLog, "second", &second));
+
+    CDataLog log;
+    TEST_ASSERT_TRUE(log.Open(testDataLog));
+    TEST_ASSERT_EQUAL(2, log.getRecordCount());
+    TEST_ASSERT_EQUAL_STRING("second", log.getName(1).c_str());
+    TEST_ASSERT_EQUAL(-1, log.getNumber("unknown"));
+
+    CDataLog::Record read;
+    TEST_ASSERT_TRUE(log.Read(0, &read));
+    TEST_ASSERT_EQUAL(0, memcmp(&record, &read, sizeof(read)));
+
+    // Same fields as the CSV data log
+    char line[256];
+    CDataLog::FormatCSV(&read, log.getName(read.number), "%Y-%m-%dT%H:%M:%S", line, sizeof(line));
+    time_t timestamp = read.timestamp;
+    char expectedTime[30];
+    strftime(expectedTime, sizeof(expectedTime), "%Y-%m-%dT%H:%M:%S", localtime(&timestamp));
+    std::string expected = std::string(expectedTime) + ",main,00123.456,123.456,123.456,0.500000,0.012,no error,1,2,N,4.5,6.0";
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), line);
+
+    CDataLog::FormatJSON(&read, log.getName(read.number), "%Y", line, sizeof(line));
+    TEST_ASSERT_NOT_NULL(strstr(line, "\"name\":\"main\",\"raw\":\"00123.456\",\"value\":123.456"));
+    TEST_ASSERT_NOT_NULL(strstr(line, "\"rois\":[1.0,2.0,null,4.5,6.0]}"));
+
+    // Output is cut, not overflowing
+    TEST_ASSERT_EQUAL(15, CDataLog::FormatCSV(&read, "main", "%Y", line, 16));
+    TEST_ASSERT_EQUAL(15, strlen(line));
+
+    TEST_ASSERT_EQUAL_STRING("a\\\"b\\\\c", CDataLog::EscapeJSON("a\"b\\c\n").c_str());
+
+    // JSON: the whole object or nothing
+    int jsonLength = CDataLog::FormatJSON(&read, "main", "%Y", line, sizeof(line));
+    TEST_ASSERT_EQUAL(jsonLength, strlen(line));
+    TEST_ASSERT_EQUAL(0, CDataLog::FormatJSON(&read, "main", "%Y", line, jsonLength));
+    TEST_ASSERT_EQUAL_STRING("", line);
+    TEST_ASSERT_EQUAL(jsonLength, CDataLog::FormatJSON(&read, "main", "%Y", line, jsonLength + 1));
+    TEST_ASSERT_EQUAL('}', line[jsonLength - 1]);
+
+    TEST_ASSERT_TRUE(log.Read(1, &read));
+    TEST_ASSERT_EQUAL(1, read.number);
+    TEST_ASSERT_FALSE(log.Read(2, &read));
+    log.Close();
+
+    remove(testDataLog);
+    remove(CDataLog::getIndexFileName(testDataLog).c_str());
+}
+
+
+/**
+ * @brief binary data log: time index, lost index and damaged records
+ */
+void test_dataLogIndex()
+{
+    const uint32_t start = 1700000000;
+    const int count = 5 * CDataLog::INDEX_STEP + 10;
+
+    remove(testDataLog);
+    remove(CDataLog::getIndexFileName(testDataLog).c_str());
+
+    for (int i = 0; i < count; ++i) {
+        CDataLog::Record record = makeRecord(start + i * 60, i);
+        TEST_ASSERT_TRUE(CDataLog::Append(testDataLog, "main", &record));
+    }
+
+    CDataLog log;
+    TEST_ASSERT_TRUE(log.Open(testDataLog));
+    TEST_ASSERT_EQUAL(count, log.getRecordCount());
+    TEST_ASSERT_EQUAL(0, log.FindFirst(0));
+    TEST_ASSERT_EQUAL(0, log.FindFirst(start));
+    TEST_ASSERT_EQUAL(1, log.FindFirst(start + 1));
+    TEST_ASSERT_EQUAL(CDataLog::INDEX_STEP, log.FindFirst(start + CDataLog::INDEX_STEP * 60));
+    TEST_ASSERT_EQUAL(200, log.FindFirst(start + 200 * 60 - 30));
+    TEST_ASSERT_EQUAL(count - 1, log.FindFirst(start + (count - 1) * 60));
+    TEST_ASSERT_EQUAL(count, log.FindFirst(start + count * 60));
+    log.Close();
+
+    // Without index the search runs on the records
+    remove(CDataLog::getIndexFileName(testDataLog).c_str());
+    TEST_ASSERT_TRUE(log.Open(testDataLog));
+    TEST_ASSERT_EQUAL(200, log.FindFirst(start + 200 * 60 - 30));
+    log.Close();
+
+    // The next record of a new step writes the missing index entries again
+    for (int i = count; i < 6 * (int)CDataLog::INDEX_STEP + 1; ++i) {
+        CDataLog::Record record = makeRecord(start + i * 60, i);
+        TEST_ASSERT_TRUE(CDataLog::Append(testDataLog, "main", &record));
+    }
+    FILE *index = fopen(CDataLog::getIndexFileName(testDataLog).c_str(), "rb");
+    TEST_ASSERT_NOT_NULL(index);
+    fseek(index, 0, SEEK_END);
+    TEST_ASSERT_EQUAL(7 * sizeof(CDataLog::IndexEntry), ftell(index));
+    fclose(index);
+
+    // A damaged record gets skipped, a partly written one at the end is not counted
+    FILE *file = fopen(testDataLog, "r+b");
+    fseek(file, sizeof(CDataLog::Header) + 3 * sizeof(CDataLog::Record) + 10, SEEK_SET);
+    fputc(0xFF, file);
+    fseek(file, 0, SEEK_END);
+    fwrite("partial", 1, 7, file);
+    fclose(file);
+
+    CDataLog::Record read;
+    TEST_ASSERT_TRUE(log.Open(testDataLog));
+    TEST_ASSERT_EQUAL(6 * CDataLog::INDEX_STEP + 1, log.getRecordCount());
+    TEST_ASSERT_TRUE(log.Read(2, &read));
+    TEST_ASSERT_FALSE(log.Read(3, &read));
+    TEST_ASSERT_TRUE(log.Read(4, &read));
+    TEST_ASSERT_EQUAL(4, (int)read.value);
+    log.Close();
+
+    CDataLog::Record record = makeRecord(start + 10000 * 60, 10000);
+    TEST_ASSERT_TRUE(CDataLog::Append(testDataLog, "main", &record));
+    TEST_ASSERT_TRUE(log.Open(testDataLog));
+    TEST_ASSERT_EQUAL(6 * CDataLog::INDEX_STEP + 2, log.getRecordCount());
+    TEST_ASSERT_TRUE(log.Read(6 * CDataLog::INDEX_STEP + 1, &read));
+    TEST_ASSERT_EQUAL(10000, (int)read.value);
+    log.Close();
+
+    remove(testDataLog);
+    remove(CDataLog::getIndexFileName(testDataLog).c_str());
+}
+
+
+/**
+ * @brief data log query: buckets, CSV lines
+ */
+void test_dataLogQuery()
+{
+    CDataLogQuery query;
+    CDataLogQuery::Bucket bucket;
+    const uint32_t start = 1700000000;
+
+    // 10 minute buckets, values every 4 minutes
+    query.Init(start, start + 3600, 600);
+    TEST_ASSERT_FALSE(query.Add(start - 1, 1, &bucket));     // before the range
+    TEST_ASSERT_FALSE(query.Add(start, 10, &bucket));
+    TEST_ASSERT_FALSE(query.Add(start + 240, 14, &bucket));
+    TEST_ASSERT_FALSE(query.Add(start + 480, 12, &bucket));
+    TEST_ASSERT_TRUE(query.Add(start + 1800, 20, &bucket));  // completes the first bucket, skips two empty ones
+    TEST_ASSERT_EQUAL(start, bucket.start);
+    TEST_ASSERT_EQUAL(3, bucket.count);
+    TEST_ASSERT_EQUAL_DOUBLE(10, bucket.min);
+    TEST_ASSERT_EQUAL_DOUBLE(14, bucket.max);
+    TEST_ASSERT_EQUAL_DOUBLE(36, bucket.sum);
+    TEST_ASSERT_EQUAL_DOUBLE(12, bucket.last);
+    TEST_ASSERT_FALSE(query.Add(start + 3601, 30, &bucket)); // after the range
+    TEST_ASSERT_TRUE(query.Finish(&bucket));
+    TEST_ASSERT_EQUAL(start + 1800, bucket.start);
+    TEST_ASSERT_EQUAL(1, bucket.count);
+    TEST_ASSERT_FALSE(query.Finish(&bucket));
+    TEST_ASSERT_EQUAL(2, query.getBucketCount());
+    TEST_ASSERT_EQUAL(4, query.getValueCount());
+
+    char line[200];
+    CDataLogQuery::Bucket out = { start, 4, 1.5, 3, 8, 2 };
+    CDataLogQuery::FormatBucket(&out, false, "T", line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("T,4,1.5,3,2,2", line);
+    CDataLogQuery::FormatBucket(&out, true, "T", line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("{\"time\":\"T\",\"timestamp\":1700000000,\"count\":4,\"min\":1.5,\"max\":3,\"avg\":2,\"last\":2}", line);
+
+    // Without downsampling every value is a bucket
+    query.Init(start, start + 3600, 0);
+    TEST_ASSERT_FALSE(query.Add(start + 5, 1, &bucket));
+    TEST_ASSERT_TRUE(query.Add(start + 6, 2, &bucket));
+    TEST_ASSERT_EQUAL(start + 5, bucket.start);
+
+    // CSV data log lines
+    uint32_t timestamp;
+    double value;
+    TEST_ASSERT_TRUE(CDataLogQuery::ParseCSVLine("2023-11-14T22:13:20+0000,main,00123.456,123.456,123.400,0.1,0.056,no error,1,2,3\n", "main", &timestamp, &value));
+    TEST_ASSERT_EQUAL_DOUBLE(123.456, value);
+    struct tm tm = {};
+    tm.tm_year = 123; tm.tm_mon = 10; tm.tm_mday = 14; tm.tm_hour = 22; tm.tm_min = 13; tm.tm_sec = 20; tm.tm_isdst = -1;
+    TEST_ASSERT_EQUAL((uint32_t)mktime(&tm), timestamp);
+    TEST_ASSERT_TRUE(CDataLogQuery::ParseCSVLine("2023-11-14T22:13:20+0000,main,00123.456,123.456", "", &timestamp, &value));
+    TEST_ASSERT_FALSE(CDataLogQuery::ParseCSVLine("2023-11-14T22:13:20+0000,mainx,00123.456,123.456,", "main", &timestamp, &value));
+    TEST_ASSERT_FALSE(CDataLogQuery::ParseCSVLine("2023-11-14T22:13:20+0000,main,0012N.456,,123.400,,0,,1,2,N", "main", &timestamp, &value));
+    TEST_ASSERT_FALSE(CDataLogQuery::ParseCSVLine("garbage", "main", &timestamp, &value));
+}
+
+
+void test_dataLog()
+{
+    test_dataLogFormat();
+    test_dataLogIndex();
+    test_dataLogQuery();
+}
@@ -0,0 +1,103 @@
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include <CLogRingBuffer.h>
+
+
+static std::string readAll(CLogRingBuffer *_buffer)
+{
+    std::string out;
+    const char *chunk;
+    size_t len;
+
+    while ((len = _buffer->Peek(&chunk)) > 0) {
+        out.append(chunk, len);
+        _buffer->Consume(len);
+    }
+
+    return out;
+}
+
+
+/**
+ * @brief log ring buffer: complete lines only, wrap around, drop counter
+ */
+void test_logRingBuffer()
+{
+    static uint8_t memory[sizeof(CLogRingBuffer::Header) + 33];
+    CLogRingBuffer buffer;
+
+    memset(memory, 0, sizeof(memory));
+    TEST_ASSERT_FALSE(buffer.Attach(memory, sizeof(memory))); // nothing to recover
+    TEST_ASSERT_EQUAL(32, buffer.getSize());
+
+    TEST_ASSERT_TRUE(buffer.Push("line 1\n", 7));
+    TEST_ASSERT_TRUE(buffer.Push("line 2\n", 7));
+    TEST_ASSERT_EQUAL(14, buffer.getUsed());
+    TEST_ASSERT_EQUAL_STRING("line 1\nline 2\n", readAll(&buffer).c_str());
+    TEST_ASSERT_EQUAL(0, buffer.getUsed());
+
+    // wrap around: the reader gets two chunks
+    TEST_ASSERT_TRUE(buffer.Push("0123456789abcdefghij\n", 21));
+    const char *chunk;
+    TEST_ASSERT_EQUAL(33 - 14, buffer.Peek(&chunk));
+    TEST_ASSERT_EQUAL_STRING("0123456789abcdefghij\n", readAll(&buffer).c_str());
+
+    // line which does not fit gets dropped completely
+    TEST_ASSERT_TRUE(buffer.Push("0123456789abcdefghij\n", 21));
+    TEST_ASSERT_FALSE(buffer.Push("0123456789abcdefghij\n", 21));
+    TEST_ASSERT_EQUAL(1, buffer.getDropped());
+    TEST_ASSERT_EQUAL(21, buffer.getUsed());
+    buffer.ResetDropped();
+    TEST_ASSERT_EQUAL(0, buffer.getDropped());
+    TEST_ASSERT_EQUAL_STRING("0123456789abcdefghij\n", readAll(&buffer).c_str());
+}
+
+
+/**
+ * @brief log ring buffer: pending lines survive a reset (memory not initialized at boot),
+ * an interrupted write is not visible, an inconsistent header discards the content
+ */
+void test_logRingBufferCrashConsistency()
+{
+    static uint8_t memory[sizeof(CLogRingBuffer::Header) + 64];
+    static uint8_t afterReset[sizeof(memory)];
+    CLogRingBuffer buffer;
+
+    memset(memory, 0xA5, sizeof(memory)); // random content after power on
+    TEST_ASSERT_FALSE(buffer.Attach(memory, sizeof(memory)));
+
+    TEST_ASSERT_TRUE(buffer.Push("written\n", 8));
+    const char *chunk;
+    buffer.Consume(buffer.Peek(&chunk));
+    TEST_ASSERT_TRUE(buffer.Push("pending 1\n", 10));
+    TEST_ASSERT_TRUE(buffer.Push("pending 2\n", 10));
+
+    // Crash while copying the next line: data copied, but the write position not updated yet
+    CLogRingBuffer::Header *header = (CLogRingBuffer::Header *)memory;
+    memcpy(memory + sizeof(CLogRingBuffer::Header) + header->head, "partial", 7);
+
+    // Reboot: the same memory gets attached again
+    memcpy(afterReset, memory, sizeof(memory));
+    CLogRingBuffer recovered;
+    TEST_ASSERT_TRUE(recovered.Attach(afterReset, sizeof(afterReset)));
+    TEST_ASSERT_EQUAL_STRING("pending 1\npending 2\n", readAll(&recovered).c_str());
+
+    // Different buffer size (firmware update) -> not recovered
+    memcpy(afterReset, memory, sizeof(memory));
+    TEST_ASSERT_FALSE(recovered.Attach(afterReset, sizeof(afterReset) - 8));
+    TEST_ASSERT_EQUAL(0, recovered.getUsed());
+
+    // Header changed without matching check (torn update) -> not recovered
+    memcpy(afterReset, memory, sizeof(memory));
+    ((CLogRingBuffer::Header *)afterReset)->head += 3;
+    TEST_ASSERT_FALSE(recovered.Attach(afterReset, sizeof(afterReset)));
+    TEST_ASSERT_EQUAL(0, recovered.getUsed());
+}
+
+
+void test_logBuffer()
+{
+    test_logRingBuffer();
+    test_logRingBufferCrashConsistency();
+}
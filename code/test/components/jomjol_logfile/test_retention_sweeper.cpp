@@ -0,0 +1,170 @@
+#include <unity.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <sys/stat.h>
+#include <CRetentionSweeper.h>
+
+
+static const std::string retentionTestDir = "/sdcard/test_retention";
+
+
+static std::string dayName(const char *_format, time_t _now, int _daysBack)
+{
+    struct tm timeinfo = *localtime(&_now);
+    char name[64];
+
+    timeinfo.tm_mday -= _daysBack;
+    timeinfo.tm_isdst = -1;
+    mktime(&timeinfo);
+    strftime(name, sizeof(name), _format, &timeinfo);
+
+    return std::string(name);
+}
+
+
+static void createFile(std::string _path, int _size)
+{
+    FILE *file = fopen(_path.c_str(), "w");
+    for (int i = 0; i < _size; ++i) {
+        fputc('x', file);
+    }
+    fclose(file);
+}
+
+
+static bool exists(std::string _path)
+{
+    struct stat fileStat;
+    return stat(_path.c_str(), &fileStat) == 0;
+}
+
+
+/**
+ * @brief retention sweeper: bounded deletes per tick, kept entries, folders, cursor after a reboot
+ */
+void test_retentionSweeper()
+{
+    time_t now = time(NULL);
+    std::string logs = retentionTestDir + "/logs";
+    std::string images = retentionTestDir + "/images";
+    std::string cursor = retentionTestDir + "/cursor";
+
+    mkdir(retentionTestDir.c_str(), 0775);
+    mkdir(logs.c_str(), 0775);
+    mkdir(images.c_str(), 0775);
+    remove(cursor.c_str());
+
+    // Log files: 3 days retention keeps today and the 2 days before
+    for (int day = 0; day < 8; ++day) {
+        createFile(logs + "/" + dayName("log_%Y-%m-%d.txt", now, day), 100);
+    }
+    createFile(logs + "/log_1970-01-01.txt", 100);  // kept
+    createFile(logs + "/other.txt", 100);           // other name length
+
+    // Images: 1 day retention, old folders with hour sub folders
+    for (int day = 1; day < 3; ++day) {
+        std::string folder = images + "/" + dayName("%Y%m%d", now, day);
+        mkdir(folder.c_str(), 0775);
+        for (int hour = 10; hour < 12; ++hour) {
+            std::string sub = folder + "/" + std::to_string(hour);
+            mkdir(sub.c_str(), 0775);
+            for (int i = 0; i < 5; ++i) {
+                createFile(sub + "/image" + std::to_string(i) + ".jpg", 1000);
+            }
+        }
+    }
+    std::string todayImages = images + "/" + dayName("%Y%m%d", now, 0);
+    mkdir(todayImages.c_str(), 0775);
+
+    CRetentionSweeper sweeper;
+    sweeper.SetCursorFile(cursor);
+    sweeper.SetJob(logs, "log_%Y-%m-%d.txt", 3, false, "log_1970-01-01.txt");
+    sweeper.SetJob(images, "%Y%m%d", 1, true);
+    sweeper.SetJob(logs, "log_%Y-%m-%d.txt", 3, false, "log_1970-01-01.txt");   // update, no second job
+    TEST_ASSERT_EQUAL(2, sweeper.GetJobs()->size());
+
+    // Bounded: 3 of the 5 old log files
+    TEST_ASSERT_TRUE(sweeper.Tick(3, now));
+    TEST_ASSERT_EQUAL(3, sweeper.getStats().deletedFiles);
+    TEST_ASSERT_EQUAL(300, sweeper.getStats().bytesReclaimed);
+
+    // Remaining 2 log files, then the first image folder gets started with the rest of the budget
+    TEST_ASSERT_TRUE(sweeper.Tick(4, now));
+    TEST_ASSERT_EQUAL(7, sweeper.getStats().deletedFiles);
+    TEST_ASSERT_FALSE(sweeper.getStats().current.empty());
+    std::string current = sweeper.getStats().current;
+
+    // "Reboot": a new sweeper continues with the folder from the cursor file (saved when it got started)
+    CRetentionSweeper restarted;
+    restarted.SetCursorFile(cursor);
+    TEST_ASSERT_EQUAL_STRING(current.c_str(), restarted.getStats().current.c_str());
+    TEST_ASSERT_EQUAL(5, restarted.getStats().deletedFiles);
+    restarted.SetJob(logs, "log_%Y-%m-%d.txt", 3, false, "log_1970-01-01.txt");
+    restarted.SetJob(images, "%Y%m%d", 1, true);
+
+    int ticks = 0;
+    while (restarted.Tick(4, now)) {
+        ticks++;
+        TEST_ASSERT_TRUE(ticks < 20);
+    }
+    TEST_ASSERT_EQUAL(4, ticks);   // 18 remaining images in steps of 4, the last tick completes the pass
+    TEST_ASSERT_EQUAL(5 + 18, restarted.getStats().deletedFiles);
+    TEST_ASSERT_EQUAL(6, restarted.getStats().deletedFolders);    // 2 day + 4 hour folders
+    TEST_ASSERT_EQUAL(500 + 18 * 1000, restarted.getStats().bytesReclaimed);
+    TEST_ASSERT_EQUAL(1, restarted.getStats().passes);
+    TEST_ASSERT_TRUE(restarted.getStats().current.empty());
+
+    for (int day = 0; day < 3; ++day) {
+        TEST_ASSERT_TRUE(exists(logs + "/" + dayName("log_%Y-%m-%d.txt", now, day)));
+    }
+    TEST_ASSERT_FALSE(exists(logs + "/" + dayName("log_%Y-%m-%d.txt", now, 3)));
+    TEST_ASSERT_TRUE(exists(logs + "/log_1970-01-01.txt"));
+    TEST_ASSERT_TRUE(exists(logs + "/other.txt"));
+    TEST_ASSERT_TRUE(exists(todayImages));
+    TEST_ASSERT_FALSE(exists(images + "/" + dayName("%Y%m%d", now, 1)));
+
+    // Nothing left: the next pass completes right away, retention 0 keeps everything
+    restarted.SetJob(logs, "log_%Y-%m-%d.txt", 0, false);
+    TEST_ASSERT_FALSE(restarted.Tick(4, now));
+    TEST_ASSERT_EQUAL(2, restarted.getStats().passes);
+    TEST_ASSERT_TRUE(exists(logs + "/log_1970-01-01.txt"));
+
+    // Data log: .bin and .idx sort before .csv, but all files of a day are kept resp. deleted together
+    std::string data = retentionTestDir + "/data";
+    const char *extensions[] = { ".csv", ".bin", ".idx" };
+    mkdir(data.c_str(), 0775);
+
+    for (int day = 0; day < 5; ++day) {
+        for (int e = 0; e < 3; ++e) {
+            createFile(data + "/" + dayName("data_%Y-%m-%d", now, day) + extensions[e], 10);
+        }
+    }
+
+    CRetentionSweeper dataSweeper;
+    dataSweeper.SetJob(data, "data_%Y-%m-%d.csv", 3, false);
+    while (dataSweeper.Tick(10, now)) {
+    }
+    TEST_ASSERT_EQUAL(6, dataSweeper.getStats().deletedFiles);
+
+    for (int day = 0; day < 5; ++day) {
+        for (int e = 0; e < 3; ++e) {
+            std::string path = data + "/" + dayName("data_%Y-%m-%d", now, day) + extensions[e];
+            TEST_ASSERT_EQUAL(day < 3, exists(path));
+            remove(path.c_str());
+        }
+    }
+    rmdir(data.c_str());
+
+    remove((logs + "/log_1970-01-01.txt").c_str());
+    remove((logs + "/other.txt").c_str());
+    for (int day = 0; day < 3; ++day) {
+        remove((logs + "/" + dayName("log_%Y-%m-%d.txt", now, day)).c_str());
+    }
+    rmdir(logs.c_str());
+    rmdir(todayImages.c_str());
+    rmdir(images.c_str());
+    remove(cursor.c_str());
+    rmdir(retentionTestDir.c_str());
+}
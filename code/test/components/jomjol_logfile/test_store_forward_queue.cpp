@@ -0,0 +1,122 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <CStoreForwardQueue.h>
+
+
+static const char *testQueueFile = "/sdcard/test_queue.bin";
+
+
+/**
+ * @brief store-and-forward queue: order, wrap-around, drop oldest, partial drain, reopen, damaged header slot, joined drain
+ */
+void test_storeForwardQueue()
+{
+    std::vector<CStoreForwardQueue::Entry> entries;
+    remove(testQueueFile);
+
+    // 20 bytes header + 3 bytes key + 6 bytes payload = 29 bytes per message, room for 5
+    CStoreForwardQueue queue;
+    TEST_ASSERT_TRUE(queue.Open(testQueueFile, 160));
+    TEST_ASSERT_EQUAL(0, queue.getCount());
+    TEST_ASSERT_FALSE(queue.Push(1, "key", std::string(200, 'x')));  // Larger than the queue
+
+    for (int i = 0; i < 4; ++i) {
+        TEST_ASSERT_TRUE(queue.Push(1700000000 + i, "a/" + std::to_string(i), "value" + std::to_string(i), i));
+    }
+    TEST_ASSERT_EQUAL(4, queue.getCount());
+    TEST_ASSERT_EQUAL(116, queue.getUsed());
+
+    TEST_ASSERT_EQUAL(2, queue.Peek(&entries, 2));
+    TEST_ASSERT_EQUAL(1, entries[0].seq);
+    TEST_ASSERT_EQUAL(1700000000, entries[0].time);
+    TEST_ASSERT_EQUAL_STRING("a/0", entries[0].key.c_str());
+    TEST_ASSERT_EQUAL_STRING("value1", entries[1].payload.c_str());
+    TEST_ASSERT_EQUAL(1, entries[1].options);
+
+    // Delivery fails at the second message: only the first one gets removed
+    int calls = 0;
+    TEST_ASSERT_EQUAL(1, queue.Drain(10, [&](const CStoreForwardQueue::Entry &) { return ++calls == 1; }));
+    TEST_ASSERT_EQUAL(3, queue.getCount());
+
+    // Wraps around the end of the data area, then the oldest gets dropped
+    TEST_ASSERT_TRUE(queue.Push(1700000004, "a/4", "value4"));
+    TEST_ASSERT_TRUE(queue.Push(1700000005, "a/5", "value5"));
+    TEST_ASSERT_TRUE(queue.Push(1700000006, "a/6", "value6"));
+    TEST_ASSERT_EQUAL(5, queue.getCount());
+    TEST_ASSERT_EQUAL(1, queue.getDropped());
+
+    // Survives a restart
+    CStoreForwardQueue reopened;
+    TEST_ASSERT_TRUE(reopened.Open(testQueueFile, 160));
+    TEST_ASSERT_EQUAL(5, reopened.getCount());
+    TEST_ASSERT_EQUAL(8, reopened.getNextSeq());
+    TEST_ASSERT_EQUAL(5, reopened.Peek(&entries, 10));
+    for (int i = 0; i < 5; ++i) {
+        TEST_ASSERT_EQUAL(i + 3, entries[i].seq);
+        TEST_ASSERT_EQUAL_STRING(("value" + std::to_string(i + 2)).c_str(), entries[i].payload.c_str());
+    }
+
+    // Rate limited drain
+    std::string sent;
+    TEST_ASSERT_EQUAL(2, reopened.Drain(2, [&](const CStoreForwardQueue::Entry &_entry) { sent += _entry.key + ","; return true; }));
+    TEST_ASSERT_EQUAL_STRING("a/2,a/3,", sent.c_str());
+    TEST_ASSERT_EQUAL(3, reopened.getCount());
+
+    // A damaged current header slot: the previous state gets used (before the drain, delivered twice at worst)
+    CStoreForwardQueue::Header slots[2];
+    FILE *file = fopen(testQueueFile, "r+b");
+    fread(slots, sizeof(slots[0]), 2, file);
+    int current = (slots[0].generation > slots[1].generation) ? 0 : 1;
+    slots[current].check ^= 1;
+    fseek(file, current * sizeof(slots[0]), SEEK_SET);
+    fwrite(&slots[current], sizeof(slots[0]), 1, file);
+    fclose(file);
+
+    CStoreForwardQueue recovered;
+    TEST_ASSERT_TRUE(recovered.Open(testQueueFile, 160));
+    TEST_ASSERT_EQUAL(5, recovered.getCount());
+
+    // Another capacity creates a new queue
+    CStoreForwardQueue resized;
+    TEST_ASSERT_TRUE(resized.Open(testQueueFile, 320));
+    TEST_ASSERT_EQUAL(0, resized.getCount());
+    TEST_ASSERT_EQUAL(1, resized.getNextSeq());
+
+    resized.Push(1, "", "x");
+    resized.Clear();
+    TEST_ASSERT_EQUAL(0, resized.getCount());
+    TEST_ASSERT_EQUAL(0, resized.Peek(&entries, 10));
+
+    // Joined drain, the stand-in for the server counts requests and bytes
+    int requests = 0;
+    size_t bytes = 0;
+    std::string body;
+    auto server = [&](const std::string &_body) { requests++; bytes += _body.length(); body = _body; return true; };
+
+    for (int i = 0; i < 5; ++i) {
+        TEST_ASSERT_TRUE(resized.Push(1700000000 + i, "", "water value=" + std::to_string(i) + " 1700000000"));   // 24 bytes
+    }
+
+    TEST_ASSERT_EQUAL(3, resized.DrainJoined(10, 3 * 24 + 2, "\n", server));     // Room for 3 lines and 2 separators
+    TEST_ASSERT_EQUAL(1, requests);
+    TEST_ASSERT_EQUAL(3 * 24 + 2, bytes);
+    TEST_ASSERT_EQUAL_STRING("water value=0 1700000000\nwater value=1 1700000000\nwater value=2 1700000000", body.c_str());
+    TEST_ASSERT_EQUAL(2, resized.getCount());
+
+    // A failed request keeps all of them
+    TEST_ASSERT_EQUAL(0, resized.DrainJoined(10, 1000, "\n", [](const std::string &) { return false; }));
+    TEST_ASSERT_EQUAL(2, resized.getCount());
+
+    // A single message larger than _maxBytes still gets sent
+    TEST_ASSERT_EQUAL(1, resized.DrainJoined(10, 10, "\n", server));
+    TEST_ASSERT_EQUAL(2, requests);
+    TEST_ASSERT_EQUAL(1, resized.DrainJoined(10, 1000, "\n", server));
+    TEST_ASSERT_EQUAL(3, requests);
+    TEST_ASSERT_EQUAL(0, resized.getCount());
+    TEST_ASSERT_EQUAL(0, resized.DrainJoined(10, 1000, "\n", server));
+    TEST_ASSERT_EQUAL(3, requests);
+
+    remove(testQueueFile);
+}
@@ -0,0 +1,96 @@
+#include <unity.h>
+#include <CDiscoveryCache.h>
+
+
+/**
+ * @brief Homeassistant Discovery cache: only new or changed topics, survives a reboot (serialized), clear,
+ *        only acknowledged messages count
+ */
+void test_discoveryCache()
+{
+    CDiscoveryCache cache;
+    std::string topicValue = "homeassistant/sensor/watermeter/main_value/config";
+    std::string topicError = "homeassistant/sensor/watermeter/main_error/config";
+    std::string payloadValue = "{\"~\":\"watermeter\",\"name\":\"main Value\",\"sw_version\":\"v16.0.0\"}";
+    std::string payloadError = "{\"~\":\"watermeter\",\"name\":\"main Error\",\"sw_version\":\"v16.0.0\"}";
+
+    // FNV-1a test vectors
+    TEST_ASSERT_EQUAL_HEX32(0x811c9dc5, CDiscoveryCache::Hash(""));
+    TEST_ASSERT_EQUAL_HEX32(0xe40c292c, CDiscoveryCache::Hash("a"));
+    TEST_ASSERT_EQUAL_HEX32(0xbf9cf968, CDiscoveryCache::Hash("foobar"));
+
+    // Everything is new, nothing gets remembered until it got published
+    TEST_ASSERT_TRUE(cache.isChanged(topicValue, payloadValue));
+    TEST_ASSERT_TRUE(cache.isChanged(topicValue, payloadValue));
+    TEST_ASSERT_FALSE(cache.isModified());
+
+    cache.Published(topicValue, payloadValue);
+    cache.Published(topicError, payloadError);
+    TEST_ASSERT_TRUE(cache.isModified());
+    TEST_ASSERT_EQUAL(2, cache.getCount());
+
+    // A reconnect: nothing to publish
+    TEST_ASSERT_FALSE(cache.isChanged(topicValue, payloadValue));
+    TEST_ASSERT_FALSE(cache.isChanged(topicError, payloadError));
+
+    // A firmware update changes the payload of the topic
+    std::string updated = payloadValue;
+    updated.replace(updated.find("v16.0.0"), 7, "v16.1.0");
+    TEST_ASSERT_TRUE(cache.isChanged(topicValue, updated));
+    TEST_ASSERT_FALSE(cache.isChanged(topicError, payloadError));
+
+    // Saved and loaded after a reboot
+    std::string text = cache.Serialize();
+    TEST_ASSERT_FALSE(cache.isModified());
+
+    CDiscoveryCache loaded;
+    TEST_ASSERT_EQUAL(2, loaded.Deserialize(text));
+    TEST_ASSERT_FALSE(loaded.isChanged(topicValue, payloadValue));
+    TEST_ASSERT_FALSE(loaded.isChanged(topicError, payloadError));
+    TEST_ASSERT_TRUE(loaded.isChanged(topicValue, updated));
+    TEST_ASSERT_FALSE(loaded.isModified());
+
+    // Publishing the same payload again does not need a save
+    loaded.Published(topicValue, payloadValue);
+    TEST_ASSERT_FALSE(loaded.isModified());
+
+    // Damaged lines get skipped
+    TEST_ASSERT_EQUAL(1, loaded.Deserialize("xyz\n0000zzzz homeassistant/a\n0000002a homeassistant/b\n\n12345678\n"));
+    TEST_ASSERT_EQUAL_STRING("0000002a homeassistant/b\n", loaded.Serialize().c_str());
+    TEST_ASSERT_EQUAL(0, loaded.Deserialize(""));
+
+    // Resend requested: all topics get published again
+    cache.Clear();
+    TEST_ASSERT_TRUE(cache.isModified());
+    TEST_ASSERT_EQUAL(0, cache.getCount());
+    TEST_ASSERT_TRUE(cache.isChanged(topicError, payloadError));
+
+    // Queued is not published: only the acknowledged message gets remembered
+    cache.Serialize();
+    cache.BeginRun();
+    cache.Sent(5, topicValue, payloadValue);
+    cache.Sent(6, topicError, payloadError);
+    TEST_ASSERT_EQUAL(2, cache.getPendingCount());
+    TEST_ASSERT_FALSE(cache.isModified());
+    TEST_ASSERT_TRUE(cache.Acknowledged(6));
+    TEST_ASSERT_FALSE(cache.Acknowledged(6));
+    TEST_ASSERT_TRUE(cache.isModified());
+    TEST_ASSERT_FALSE(cache.isChanged(topicError, payloadError));
+    TEST_ASSERT_TRUE(cache.isChanged(topicValue, payloadValue));
+
+    // The acknowledge can arrive before Sent() got called
+    TEST_ASSERT_FALSE(cache.Acknowledged(7));
+    cache.Sent(7, topicValue, payloadValue);
+    TEST_ASSERT_FALSE(cache.isChanged(topicValue, payloadValue));
+    cache.EndRun();
+
+    // Message 5 got dropped from the outbox, the next run forgets it
+    TEST_ASSERT_EQUAL(1, cache.getPendingCount());
+    cache.BeginRun();
+    TEST_ASSERT_EQUAL(0, cache.getPendingCount());
+    TEST_ASSERT_FALSE(cache.Acknowledged(5));
+    cache.EndRun();
+    TEST_ASSERT_FALSE(cache.Acknowledged(8));       // Outside of a run (e.g. a reading)
+    cache.Sent(8, topicError, "changed");
+    TEST_ASSERT_TRUE(cache.isChanged(topicError, "changed"));
+}
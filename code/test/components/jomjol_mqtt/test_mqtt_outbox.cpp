@@ -0,0 +1,117 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CMqttOutbox.h>
+
+
+static int mqttOutboxFallbackCount = 0;
+
+static void *mqttOutboxTestMalloc(size_t _size)
+{
+    mqttOutboxFallbackCount++;
+    return malloc(_size);
+}
+
+static void mqttOutboxTestFree(void *_ptr)
+{
+    mqttOutboxFallbackCount--;
+    free(_ptr);
+}
+
+
+/**
+ * @brief MQTT outbox: size classes, enqueue/dequeue by state, delete, expiry, overflow policy, fallback
+ */
+void test_mqttOutbox()
+{
+    const size_t slotSizes[] = { 32, 128 };
+    const int slotCounts[] = { 2, 1 };
+    size_t bufferSize = CMqttOutbox::getBufferSize(slotSizes, slotCounts, 2);
+    uint8_t *buffer = (uint8_t *)malloc(bufferSize);
+    uint8_t message[200];
+
+    for (int i = 0; i < (int)sizeof(message); ++i) {
+        message[i] = (uint8_t)i;
+    }
+
+    {
+        CMqttOutbox outbox;
+        outbox.Setup(buffer, slotSizes, slotCounts, 2, CMqttOutbox::POLICY_REJECT, mqttOutboxTestMalloc, mqttOutboxTestFree);
+
+        // Header and remaining data get joined, small messages take the small slots
+        CMqttOutbox::Item *first = outbox.Enqueue(message, 10, message + 10, 10, 1, 3, 1, 1000);
+        TEST_ASSERT_NOT_NULL(first);
+        TEST_ASSERT_EQUAL(20, first->length);
+        TEST_ASSERT_EQUAL(0, memcmp(first->data, message, 20));
+        TEST_ASSERT_NOT_NULL(outbox.Enqueue(message, 30, NULL, 0, 2, 3, 1, 1100));
+        TEST_ASSERT_EQUAL(2, outbox.getUsedSlots(0));
+
+        // Small slots used up: the next larger class
+        TEST_ASSERT_NOT_NULL(outbox.Enqueue(message, 5, NULL, 0, 3, 3, 1, 1200));
+        TEST_ASSERT_EQUAL(1, outbox.getUsedSlots(1));
+
+        // Full: rejected, larger than all classes: fallback allocator
+        TEST_ASSERT_NULL(outbox.Enqueue(message, 5, NULL, 0, 4, 3, 1, 1300));
+        TEST_ASSERT_NOT_NULL(outbox.Enqueue(message, 200, NULL, 0, 5, 3, 1, 1400));
+        TEST_ASSERT_EQUAL(1, mqttOutboxFallbackCount);
+        TEST_ASSERT_EQUAL(4, outbox.getCount());
+        TEST_ASSERT_EQUAL(20 + 30 + 5 + 200, outbox.getBytes());
+        TEST_ASSERT_EQUAL(1, outbox.getStats().rejected);
+        TEST_ASSERT_EQUAL(1, outbox.getStats().fallback);
+
+        // Dequeue: oldest message in the state
+        long long tick = 0;
+        TEST_ASSERT_EQUAL_PTR(first, outbox.Dequeue(0, &tick));
+        TEST_ASSERT_EQUAL(1000, (int)tick);
+        TEST_ASSERT_TRUE(outbox.SetPending(1, 1));      // TRANSMITTED
+        TEST_ASSERT_EQUAL(2, outbox.Dequeue(0, NULL)->msgId);
+        TEST_ASSERT_EQUAL(1, outbox.Dequeue(1, NULL)->msgId);
+        TEST_ASSERT_FALSE(outbox.SetPending(99, 1));
+
+        // Delete by id and type, the slot gets free again
+        TEST_ASSERT_FALSE(outbox.Delete(2, 4));
+        TEST_ASSERT_TRUE(outbox.Delete(2, 3));
+        TEST_ASSERT_NULL(outbox.Get(2));
+        TEST_ASSERT_EQUAL(1, outbox.getUsedSlots(0));
+
+        // Expiry: older than 250 ticks at 1500
+        TEST_ASSERT_TRUE(outbox.SetTick(5, 1450));
+        TEST_ASSERT_EQUAL(1, outbox.DeleteSingleExpired(1500, 250));
+        TEST_ASSERT_EQUAL(1, outbox.DeleteExpired(1500, 250));      // msgId 3 (1200)
+        TEST_ASSERT_EQUAL(-1, outbox.DeleteSingleExpired(1500, 250));
+        TEST_ASSERT_EQUAL(1, outbox.getCount());
+        TEST_ASSERT_EQUAL(2, outbox.getStats().expired);
+        TEST_ASSERT_EQUAL(0, outbox.getUsedSlots(0));
+        TEST_ASSERT_EQUAL(0, outbox.getUsedSlots(1));
+    }
+    TEST_ASSERT_EQUAL(0, mqttOutboxFallbackCount);     // Destructor gives back the fallback message
+
+    {
+        CMqttOutbox outbox;
+        outbox.Setup(buffer, slotSizes, slotCounts, 2, CMqttOutbox::POLICY_DROP_OLDEST);
+
+        for (int id = 1; id <= 3; ++id) {
+            TEST_ASSERT_NOT_NULL(outbox.Enqueue(message, 8, NULL, 0, id, 3, 1, id));
+        }
+
+        // The oldest message with a large enough slot makes room
+        TEST_ASSERT_NOT_NULL(outbox.Enqueue(message, 8, NULL, 0, 4, 3, 1, 4));
+        TEST_ASSERT_NULL(outbox.Get(1));
+        TEST_ASSERT_EQUAL(3, outbox.getCount());
+        TEST_ASSERT_EQUAL(1, outbox.getStats().droppedOldest);
+
+        // Only a large slot fits: a message in a small slot does not help
+        TEST_ASSERT_NOT_NULL(outbox.Enqueue(message, 100, NULL, 0, 5, 3, 1, 5));
+        TEST_ASSERT_NULL(outbox.Get(3));        // Was in the large slot
+        TEST_ASSERT_NOT_NULL(outbox.Get(2));
+
+        // Without fallback a message larger than all slots gets rejected
+        TEST_ASSERT_NULL(outbox.Enqueue(message, 200, NULL, 0, 6, 3, 1, 6));
+
+        outbox.DeleteMsgType(3);
+        TEST_ASSERT_EQUAL(0, outbox.getCount());
+        TEST_ASSERT_EQUAL(0, (int)outbox.getBytes());
+    }
+
+    free(buffer);
+}
@@ -0,0 +1,77 @@
+#include <unity.h>
+#include <mqtt_reading.h>
+
+
+static MqttReading mqttTestReading(std::string _name, std::string _value)
+{
+    MqttReading reading;
+
+    reading.name = _name;
+    reading.value = _value;
+    reading.raw = "0" + _value;
+    reading.pre = _value;
+    reading.error = "no error";
+    reading.rate = "0.5";
+    reading.ratePerTimeUnit = "30";
+    reading.changeAbsolute = "0.5";
+    reading.timestamp = "2024-05-01T10:00:00+0200";
+
+    return reading;
+}
+
+
+void test_readingJson()
+{
+    MqttReading reading = mqttTestReading("main", "123.5");
+
+    TEST_ASSERT_EQUAL_STRING("{\"value\":\"123.5\",\"raw\":\"0123.5\",\"pre\":\"123.5\",\"error\":\"no error\","
+                             "\"rate\":\"0.5\",\"rate_per_time_unit\":\"30\",\"rate_per_digitization_round\":\"0.5\","
+                             "\"timestamp\":\"2024-05-01T10:00:00+0200\"}",
+                             mqtt_reading_json(reading).c_str());
+
+    // Empty fields stay in the message
+    reading = MqttReading();
+    TEST_ASSERT_EQUAL_STRING("{\"value\":\"\",\"raw\":\"\",\"pre\":\"\",\"error\":\"\",\"rate\":\"\","
+                             "\"rate_per_time_unit\":\"\",\"rate_per_digitization_round\":\"\",\"timestamp\":\"\"}",
+                             mqtt_reading_json(reading).c_str());
+
+    // Error messages may contain quotes and line breaks
+    reading.error = "Rate too high - Read: \"12\"\n";
+    std::string json = mqtt_reading_json(reading);
+    TEST_ASSERT_TRUE(json.find("\"error\":\"Rate too high - Read: \\\"12\\\"\\n\"") != std::string::npos);
+}
+
+
+void test_readingsJson()
+{
+    std::vector<MqttReading> readings;
+
+    TEST_ASSERT_EQUAL_STRING("{}", mqtt_readings_json(readings).c_str());
+
+    readings.push_back(mqttTestReading("main", "123.5"));
+    readings.push_back(mqttTestReading("gas", "42.0"));
+
+    std::string json = mqtt_readings_json(readings);
+    TEST_ASSERT_EQUAL_STRING(("{\"main\":" + mqtt_reading_json(readings[0]) + ",\"gas\":" + mqtt_reading_json(readings[1]) + "}").c_str(),
+                             json.c_str());
+}
+
+
+void test_readingTopics()
+{
+    TEST_ASSERT_EQUAL_STRING("json", mqtt_reading_subtopic(MQTT_PUBLISH_COMPACT, "default").c_str());
+    TEST_ASSERT_EQUAL_STRING("main/json", mqtt_reading_subtopic(MQTT_PUBLISH_COMPACT, "main").c_str());
+    TEST_ASSERT_EQUAL_STRING("readings", mqtt_reading_subtopic(MQTT_PUBLISH_DEVICE, "main").c_str());
+
+    TEST_ASSERT_EQUAL_STRING("value_json", mqtt_reading_template_path(MQTT_PUBLISH_COMPACT, "main").c_str());
+    TEST_ASSERT_EQUAL_STRING("value_json['main']", mqtt_reading_template_path(MQTT_PUBLISH_DEVICE, "main").c_str());
+    TEST_ASSERT_EQUAL_STRING("value_json['default']", mqtt_reading_template_path(MQTT_PUBLISH_DEVICE, "default").c_str());
+}
+
+
+void test_mqttReading()
+{
+    test_readingJson();
+    test_readingsJson();
+    test_readingTopics();
+}
@@ -0,0 +1,89 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <CMetricsRegistry.h>
+
+
+/**
+ * @brief metrics registry: counters, gauges, labelled histograms, families, truncated output
+ */
+void test_metricsRegistry()
+{
+    static const double bounds[] = { 0.1, 1 };
+    CMetricsRegistry registry;
+
+    int rounds = registry.Register(CMetricsRegistry::COUNTER, "rounds_total", "rounds since startup");
+    int rssi = registry.Register(CMetricsRegistry::GAUGE, "rssi_dbm", "WiFi signal strength");
+    int takeImage = registry.Register(CMetricsRegistry::HISTOGRAM, "stage_duration_seconds", "duration of a flow step", "stage", "TakeImage", bounds, 2);
+    int failures = registry.Register(CMetricsRegistry::COUNTER, "publish_failures_total", "failed rounds", "destination", "mqtt");
+    int digit = registry.Register(CMetricsRegistry::HISTOGRAM, "stage_duration_seconds", "duration of a flow step", "stage", "Digit", bounds, 2);
+
+    // Same name and label: same metric
+    TEST_ASSERT_EQUAL(takeImage, registry.Register(CMetricsRegistry::HISTOGRAM, "stage_duration_seconds", "", "stage", "TakeImage", bounds, 2));
+    TEST_ASSERT_EQUAL(rssi, registry.Find("rssi_dbm"));
+    TEST_ASSERT_EQUAL(digit, registry.Find("stage_duration_seconds", "Digit"));
+    TEST_ASSERT_EQUAL(-1, registry.Find("stage_duration_seconds", "Analog"));
+    TEST_ASSERT_EQUAL(5, registry.getMetricCount());
+
+    registry.Inc(rounds);
+    registry.Inc(rounds);
+    registry.Set(rssi, -67);
+    registry.Inc(failures);
+    registry.Observe(takeImage, 0.05);
+    registry.Observe(takeImage, 0.5);
+    registry.Observe(takeImage, 2.5);
+    registry.Observe(digit, 1);
+    registry.Inc(-1);       // Unknown metrics get ignored
+
+    TEST_ASSERT_EQUAL_DOUBLE(2, registry.getValue(rounds));
+    TEST_ASSERT_EQUAL(3, registry.getCount(takeImage));
+    TEST_ASSERT_EQUAL_DOUBLE(3.05, registry.getValue(takeImage));
+
+    const char *expected =
+        "# HELP p_rounds_total rounds since startup\n"
+        "# TYPE p_rounds_total counter\n"
+        "p_rounds_total 2\n"
+        "# HELP p_rssi_dbm WiFi signal strength\n"
+        "# TYPE p_rssi_dbm gauge\n"
+        "p_rssi_dbm -67\n"
+        "# HELP p_stage_duration_seconds duration of a flow step\n"
+        "# TYPE p_stage_duration_seconds histogram\n"
+        "p_stage_duration_seconds_bucket{stage=\"TakeImage\",le=\"0.1\"} 1\n"
+        "p_stage_duration_seconds_bucket{stage=\"TakeImage\",le=\"1\"} 2\n"
+        "p_stage_duration_seconds_bucket{stage=\"TakeImage\",le=\"+Inf\"} 3\n"
+        "p_stage_duration_seconds_sum{stage=\"TakeImage\"} 3.05\n"
+        "p_stage_duration_seconds_count{stage=\"TakeImage\"} 3\n"
+        "p_stage_duration_seconds_bucket{stage=\"Digit\",le=\"0.1\"} 0\n"
+        "p_stage_duration_seconds_bucket{stage=\"Digit\",le=\"1\"} 1\n"
+        "p_stage_duration_seconds_bucket{stage=\"Digit\",le=\"+Inf\"} 1\n"
+        "p_stage_duration_seconds_sum{stage=\"Digit\"} 1\n"
+        "p_stage_duration_seconds_count{stage=\"Digit\"} 1\n"
+        "# HELP p_publish_failures_total failed rounds\n"
+        "# TYPE p_publish_failures_total counter\n"
+        "p_publish_failures_total{destination=\"mqtt\"} 1\n";
+
+    char buffer[1500];
+    size_t length = registry.Render(buffer, sizeof(buffer), "p");
+    TEST_ASSERT_EQUAL_STRING(expected, buffer);
+    TEST_ASSERT_EQUAL(strlen(expected), length);
+
+    // Too small: truncated, but the full length is known to grow the buffer
+    char small[40];
+    TEST_ASSERT_EQUAL(strlen(expected), registry.Render(small, sizeof(small), "p"));
+    TEST_ASSERT_EQUAL(sizeof(small) - 1, strlen(small));
+    TEST_ASSERT_EQUAL(strlen(expected), registry.Render(NULL, 0, "p"));
+
+    // Appended behind other output
+    strcpy(buffer, "x\n");
+    TEST_ASSERT_EQUAL(strlen(expected) + 2, registry.Render(buffer, sizeof(buffer), "p", 2));
+    TEST_ASSERT_EQUAL(0, strncmp(buffer + 2, expected, strlen(expected)));
+
+    // Full table
+    CMetricsRegistry full;
+    char label[8];
+    for (int i = 0; i < CMetricsRegistry::MAX_METRICS; ++i) {
+        snprintf(label, sizeof(label), "%d", i);
+        TEST_ASSERT_EQUAL(i, full.Register(CMetricsRegistry::GAUGE, "gauge", "help", "id", label));
+    }
+    TEST_ASSERT_EQUAL(-1, full.Register(CMetricsRegistry::GAUGE, "gauge", "help", "id", "new"));
+}
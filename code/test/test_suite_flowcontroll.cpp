@@ -20,8 +20,29 @@
 #include "components/jomjol-flowcontroll/test_PointerEvalAnalogToDigitNew.cpp"
 #include "components/jomjol-flowcontroll/test_getReadoutRawString.cpp"
 #include "components/jomjol-flowcontroll/test_cnnflowcontroll.cpp"
+#include "components/jomjol-flowcontroll/test_adaptive_interval.cpp"
+#include "components/jomjol-flowcontroll/test_memory_planner.cpp"
+#include "components/jomjol-flowcontroll/test_publish_policy.cpp"
+#include "components/jomjol_helper/test_memory_arena.cpp"
+#include "components/jomjol_helper/test_http_client_pool.cpp"
+#include "components/jomjol_helper/test_json_writer.cpp"
+#include "components/jomjol_logfile/test_log_ring_buffer.cpp"
+#include "components/jomjol_logfile/test_data_log.cpp"
+#include "components/jomjol_logfile/test_retention_sweeper.cpp"
+#include "components/jomjol_logfile/test_store_forward_queue.cpp"
+#include "components/jomjol_image_proc/test_image_log_queue.cpp"
+#include "components/jomjol_fileserver_ota/test_http_range.cpp"
+#include "components/jomjol_fileserver_ota/test_static_file_index.cpp"
+#include "components/jomjol_fileserver_ota/test_zip_stream.cpp"
+#include "components/jomjol_fileserver_ota/test_ota_stream_writer.cpp"
+#include "components/jomjol_fileserver_ota/test_gzip.cpp"
+#include "components/jomjol_fileserver_ota/test_event_stream.cpp"
 #include "components/openmetrics/test_openmetrics.cpp"
+#include "components/openmetrics/test_metrics_registry.cpp"
 #include "components/jomjol_mqtt/test_server_mqtt.cpp"
+#include "components/jomjol_mqtt/test_mqtt_outbox.cpp"
+#include "components/jomjol_mqtt/test_mqtt_reading.cpp"
+#include "components/jomjol_mqtt/test_discovery_cache.cpp"
 
 bool Init_NVS_SDCard()
 {
@@ -169,7 +190,30 @@ extern "C" void app_main()
     // getReadoutRawString test
     RUN_TEST(test_getReadoutRawString);
     RUN_TEST(test_openmetrics);
+    RUN_TEST(test_metricsRegistry);
     RUN_TEST(test_mqtt);
+    RUN_TEST(test_mqttOutbox);
+    RUN_TEST(test_mqttReading);
+    RUN_TEST(test_discoveryCache);
+    RUN_TEST(test_adaptiveInterval);
+    RUN_TEST(test_memoryAllocators);
+    RUN_TEST(test_memoryPlanner);
+    RUN_TEST(test_logBuffer);
+    RUN_TEST(test_dataLog);
+    RUN_TEST(test_retentionSweeper);
+    RUN_TEST(test_storeForwardQueue);
+    RUN_TEST(test_imageLogQueue);
+    RUN_TEST(test_imagePack);
+    RUN_TEST(test_httpRange);
+    RUN_TEST(test_staticFileIndex);
+    RUN_TEST(test_zipStream);
+    RUN_TEST(test_zipFileInstaller);
+    RUN_TEST(test_otaStreamWriter);
+    RUN_TEST(test_gzip);
+    RUN_TEST(test_eventStream);
+    RUN_TEST(test_httpClientPool);
+    RUN_TEST(test_jsonWriter);
+    RUN_TEST(test_publishPolicy);
   
   UNITY_END();
 }
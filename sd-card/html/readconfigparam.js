@@ -153,6 +153,7 @@ function ParseConfig() {
     ParamAddValue(param, catname, "CNNGoodThreshold", 1);
     ParamAddValue(param, catname, "ROIImagesLocation");
     ParamAddValue(param, catname, "ROIImagesRetention");
+    ParamAddValue(param, catname, "ROIImagesFormat");
 
     var catname = "Analog";
     category[catname] = new Object();
@@ -162,6 +163,7 @@ function ParseConfig() {
     ParamAddValue(param, catname, "Model");
     ParamAddValue(param, catname, "ROIImagesLocation");
     ParamAddValue(param, catname, "ROIImagesRetention");
+    ParamAddValue(param, catname, "ROIImagesFormat");
 
     var catname = "PostProcessing";
     category[catname] = new Object();
@@ -194,6 +196,10 @@ function ParseConfig() {
     ParamAddValue(param, catname, "user");
     ParamAddValue(param, catname, "password");
     ParamAddValue(param, catname, "RetainMessages");
+    ParamAddValue(param, catname, "PublishMode");
+    ParamAddValue(param, catname, "PublishPolicy");
+    ParamAddValue(param, catname, "PublishDeadband");
+    ParamAddValue(param, catname, "PublishHeartbeat");
     ParamAddValue(param, catname, "DomoticzTopicIn");
     ParamAddValue(param, catname, "DomoticzIDX", 1, true);
     ParamAddValue(param, catname, "HomeassistantDiscovery");
@@ -213,6 +219,10 @@ function ParseConfig() {
 //     ParamAddValue(param, catname, "Measurement");
     ParamAddValue(param, catname, "user");
     ParamAddValue(param, catname, "password");
+    ParamAddValue(param, catname, "GzipCompression");
+    ParamAddValue(param, catname, "PublishPolicy");
+    ParamAddValue(param, catname, "PublishDeadband");
+    ParamAddValue(param, catname, "PublishHeartbeat");
     ParamAddValue(param, catname, "Measurement", 1, true);
     ParamAddValue(param, catname, "Field", 1, true);
 
@@ -226,6 +236,10 @@ function ParseConfig() {
 //     ParamAddValue(param, catname, "Measurement");
     ParamAddValue(param, catname, "Org");
     ParamAddValue(param, catname, "Token");
+    ParamAddValue(param, catname, "GzipCompression");
+    ParamAddValue(param, catname, "PublishPolicy");
+    ParamAddValue(param, catname, "PublishDeadband");
+    ParamAddValue(param, catname, "PublishHeartbeat");
     ParamAddValue(param, catname, "Measurement", 1, true);
     ParamAddValue(param, catname, "Field", 1, true);
 
@@ -237,6 +251,9 @@ function ParseConfig() {
     ParamAddValue(param, catname, "Uri");
     ParamAddValue(param, catname, "ApiKey");
     ParamAddValue(param, catname, "UploadImg");
+    ParamAddValue(param, catname, "PublishPolicy");
+    ParamAddValue(param, catname, "PublishDeadband");
+    ParamAddValue(param, catname, "PublishHeartbeat");
 
     var catname = "GPIO";
     category[catname] = new Object();
@@ -266,6 +283,9 @@ function ParseConfig() {
     param[catname] = new Object();
     //ParamAddValue(param, catname, "AutoStart");
     ParamAddValue(param, catname, "Interval");     
+    ParamAddValue(param, catname, "IntervalAdaptive");
+    ParamAddValue(param, catname, "IntervalMin");
+    ParamAddValue(param, catname, "IntervalMax");
 
     var catname = "DataLogging";
     category[catname] = new Object();
@@ -274,6 +294,7 @@ function ParseConfig() {
     param[catname] = new Object();
     ParamAddValue(param, catname, "DataLogActive");
     ParamAddValue(param, catname, "DataFilesRetention");     
+    ParamAddValue(param, catname, "DataLogFormat");
 
     var catname = "Debug";
     category[catname] = new Object();
@@ -347,6 +368,87 @@ function ParseConfig() {
         param["DataLogging"]["DataFilesRetention"]["value1"] = "3";
     }
 
+    if (param["Digits"]["ROIImagesFormat"]["found"] == false) {
+        param["Digits"]["ROIImagesFormat"]["found"] = true;
+        param["Digits"]["ROIImagesFormat"]["enabled"] = true;
+        param["Digits"]["ROIImagesFormat"]["value1"] = "jpg";
+    }
+
+    if (param["Analog"]["ROIImagesFormat"]["found"] == false) {
+        param["Analog"]["ROIImagesFormat"]["found"] = true;
+        param["Analog"]["ROIImagesFormat"]["enabled"] = true;
+        param["Analog"]["ROIImagesFormat"]["value1"] = "jpg";
+    }
+
+    if (param["DataLogging"]["DataLogFormat"]["found"] == false) {
+        param["DataLogging"]["DataLogFormat"]["found"] = true;
+        param["DataLogging"]["DataLogFormat"]["enabled"] = true;
+        param["DataLogging"]["DataLogFormat"]["value1"] = "csv";
+    }
+
+    // Downward compatibility: Create adaptive interval parameters if not available
+    if (param["AutoTimer"]["IntervalAdaptive"]["found"] == false) {
+        param["AutoTimer"]["IntervalAdaptive"]["found"] = true;
+        param["AutoTimer"]["IntervalAdaptive"]["enabled"] = true;
+        param["AutoTimer"]["IntervalAdaptive"]["value1"] = "false";
+    }
+
+    if (param["AutoTimer"]["IntervalMin"]["found"] == false) {
+        param["AutoTimer"]["IntervalMin"]["found"] = true;
+        param["AutoTimer"]["IntervalMin"]["enabled"] = false;
+        param["AutoTimer"]["IntervalMin"]["value1"] = "1";
+    }
+
+    if (param["AutoTimer"]["IntervalMax"]["found"] == false) {
+        param["AutoTimer"]["IntervalMax"]["found"] = true;
+        param["AutoTimer"]["IntervalMax"]["enabled"] = false;
+        param["AutoTimer"]["IntervalMax"]["value1"] = "60";
+    }
+
+    // Downward compatibility: Create PublishMode if not available (the firmware default)
+    if (param["MQTT"]["PublishMode"]["found"] == false) {
+        param["MQTT"]["PublishMode"]["found"] = true;
+        param["MQTT"]["PublishMode"]["enabled"] = true;
+        param["MQTT"]["PublishMode"]["value1"] = "compact";
+    }
+
+    // Downward compatibility: Create GzipCompression if not available
+    if (param["InfluxDB"]["GzipCompression"]["found"] == false) {
+        param["InfluxDB"]["GzipCompression"]["found"] = true;
+        param["InfluxDB"]["GzipCompression"]["enabled"] = true;
+        param["InfluxDB"]["GzipCompression"]["value1"] = "false";
+    }
+
+    if (param["InfluxDBv2"]["GzipCompression"]["found"] == false) {
+        param["InfluxDBv2"]["GzipCompression"]["found"] = true;
+        param["InfluxDBv2"]["GzipCompression"]["enabled"] = true;
+        param["InfluxDBv2"]["GzipCompression"]["value1"] = "false";
+    }
+
+    // Downward compatibility: Create PublishPolicy, PublishDeadband and PublishHeartbeat if not available
+    var publishCategories = ["MQTT", "InfluxDB", "InfluxDBv2", "Webhook"];
+    for (var i = 0; i < publishCategories.length; ++i) {
+        var cat = publishCategories[i];
+
+        if (param[cat]["PublishPolicy"]["found"] == false) {
+            param[cat]["PublishPolicy"]["found"] = true;
+            param[cat]["PublishPolicy"]["enabled"] = true;
+            param[cat]["PublishPolicy"]["value1"] = "always";
+        }
+
+        if (param[cat]["PublishDeadband"]["found"] == false) {
+            param[cat]["PublishDeadband"]["found"] = true;
+            param[cat]["PublishDeadband"]["enabled"] = true;
+            param[cat]["PublishDeadband"]["value1"] = "0";
+        }
+
+        if (param[cat]["PublishHeartbeat"]["found"] == false) {
+            param[cat]["PublishHeartbeat"]["found"] = true;
+            param[cat]["PublishHeartbeat"]["enabled"] = true;
+            param[cat]["PublishHeartbeat"]["value1"] = "0";
+        }
+    }
+
     // Downward compatibility: Create RSSIThreshold if not available
     if (param["System"]["RSSIThreshold"]["found"] == false) {
         param["System"]["RSSIThreshold"]["found"] = true;
@@ -0,0 +1,126 @@
+/**
+ * Host benchmark: log lines per second written line by line (like ClassLogFile without writer task)
+ * and batched through the log ring buffer (like the writer task), see readme.md
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+#include "CLogRingBuffer.h"
+
+
+#define LOG_BUFFER_SIZE         8 * 1024    // Same values as in code/include/defines.h
+#define LOG_FLUSH_THRESHOLD     2 * 1024
+#define LOG_WRITE_ALIGNMENT     512
+
+
+static std::string logLine(int _i)
+{
+    char buf[128];
+    snprintf(buf, sizeof(buf), "[0d00h01m%02ds] 2024-01-01T12:00:00\t<INF>\t[BENCH] Log line number %d\n", _i % 60, _i);
+    return std::string(buf);
+}
+
+
+static double perLine(std::string _file, int _lines)
+{
+    remove(_file.c_str());
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < _lines; ++i) {
+        std::string line = logLine(i);
+        FILE *pFile = fopen(_file.c_str(), "a+");
+        fputs(line.c_str(), pFile);
+        fclose(pFile);
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+static void writePending(CLogRingBuffer *_buffer, std::string _file, bool _all)
+{
+    FILE *pFile = fopen(_file.c_str(), "a");
+    setvbuf(pFile, NULL, _IONBF, 0);
+    size_t pending = _buffer->getUsed();
+
+    if (!_all) {
+        fseek(pFile, 0, SEEK_END);
+        size_t end = ftell(pFile) + pending;
+        pending -= std::min(pending, end % LOG_WRITE_ALIGNMENT);
+    }
+
+    while (pending > 0) {
+        const char *chunk;
+        size_t len = std::min(_buffer->Peek(&chunk), pending);
+        fwrite(chunk, 1, len, pFile);
+        _buffer->Consume(len);
+        pending -= len;
+    }
+
+    fclose(pFile);
+}
+
+
+static double batched(std::string _file, int _lines, int *_writes)
+{
+    static uint8_t memory[LOG_BUFFER_SIZE];
+    CLogRingBuffer buffer;
+    buffer.Attach(memory, sizeof(memory));
+
+    remove(_file.c_str());
+    *_writes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < _lines; ++i) {
+        std::string line = logLine(i);
+
+        if (!buffer.Push(line.c_str(), line.size())) {
+            writePending(&buffer, _file, true);
+            (*_writes)++;
+            buffer.Push(line.c_str(), line.size());
+        }
+
+        if (buffer.getUsed() >= LOG_FLUSH_THRESHOLD) {
+            writePending(&buffer, _file, false);
+            (*_writes)++;
+        }
+    }
+
+    writePending(&buffer, _file, true);
+    (*_writes)++;
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::string dir = (argc > 1) ? argv[1] : ".";
+    int lines = (argc > 2) ? atoi(argv[2]) : 20000;
+    int writes;
+
+    double tLine = perLine(dir + "/log_per_line.txt", lines);
+    double tBatch = batched(dir + "/log_batched.txt", lines, &writes);
+
+    printf("Lines:               %d\n", lines);
+    printf("Line by line:        %10.0f lines/s (%d file writes)\n", lines / tLine, lines);
+    printf("Batched ring buffer: %10.0f lines/s (%d file writes)\n", lines / tBatch, writes);
+
+    // Both ways must produce the same file
+    FILE *a = fopen((dir + "/log_per_line.txt").c_str(), "rb");
+    FILE *b = fopen((dir + "/log_batched.txt").c_str(), "rb");
+    int ca, cb;
+    do {
+        ca = fgetc(a);
+        cb = fgetc(b);
+    } while ((ca == cb) && (ca != EOF));
+    fclose(a);
+    fclose(b);
+
+    printf("Content identical:   %s\n", (ca == cb) ? "yes" : "NO");
+    return (ca == cb) ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+/**
+ * Host tool: check a config.ini against the memory budget of the device
+ * Uses the same planner as the firmware (ClassMemoryPlanner), see readme.md
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "ClassMemoryPlanner.h"
+#include "../../code/include/defines.h"
+
+
+static void usage(void)
+{
+    printf("Usage: memory-planner <sdcard-dir> [--config <file>] [--psram <bytes>] [--internal <bytes>]\n"
+           "                      [--digits-input <bytes>] [--analog-input <bytes>] [--json]\n"
+           "  <sdcard-dir>  copy of the SD card content (config.ini, models and reference images)\n"
+           "  --config      config.ini relative to <sdcard-dir> (default: /config/config.ini)\n"
+           "  --psram       PSRAM size of the device (default: 4194304)\n"
+           "  --internal    free internal RAM (default: no check)\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+
+    std::string root = argv[1];
+    std::string config = "/config/config.ini";
+    size_t psram = 4 * 1024 * 1024;
+    size_t internal = 0;
+    size_t digitsInput = 0, analogInput = 0;
+    bool json = false;
+
+    for (int i = 2; i < argc; ++i) {
+        if ((strcmp(argv[i], "--config") == 0) && (i + 1 < argc)) {
+            config = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--psram") == 0) && (i + 1 < argc)) {
+            psram = strtoul(argv[++i], NULL, 0);
+        }
+        else if ((strcmp(argv[i], "--internal") == 0) && (i + 1 < argc)) {
+            internal = strtoul(argv[++i], NULL, 0);
+        }
+        else if ((strcmp(argv[i], "--digits-input") == 0) && (i + 1 < argc)) {
+            digitsInput = strtoul(argv[++i], NULL, 0);
+        }
+        else if ((strcmp(argv[i], "--analog-input") == 0) && (i + 1 < argc)) {
+            analogInput = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        }
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    ClassMemoryPlanner planner;
+    planner.ReadConfig(root + config, root);
+
+    std::vector<ClassMemoryPlanner::CNN> *cnns = planner.GetCNNs();
+    for (int i = 0; i < cnns->size(); ++i) {
+        if (((*cnns)[i].section == "Digits") && digitsInput) {
+            (*cnns)[i].modelInputBytes = digitsInput;
+        }
+        else if (((*cnns)[i].section == "Analog") && analogInput) {
+            (*cnns)[i].modelInputBytes = analogInput;
+        }
+    }
+
+    bool ok = planner.Plan((psram > PSRAM_RESERVE_FIRMWARE) ? psram - PSRAM_RESERVE_FIRMWARE : 0, internal);
+
+    printf("%s\n", json ? planner.getJSON().c_str() : planner.getReport().c_str());
+
+    return ok ? 0 : 1;
+}
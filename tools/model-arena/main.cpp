@@ -0,0 +1,329 @@
+/**
+ * Host tool: Tensor Arena requirement of all models in a directory (default: sd-card/config)
+ * Shows the usage measured on the device (<model>.arena, see CTfLiteArenaInfo.h) and an
+ * estimate from the model file itself, see readme.md
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "CTfLiteArenaInfo.h"
+#include "../../code/include/defines.h"
+
+
+#define ARENA_ALIGNMENT         16      // Alignment of the buffers in the Tensor Arena (TFLM)
+#define PERSISTENT_BASE         2048    // Interpreter, allocator and subgraph bookkeeping
+#define PERSISTENT_PER_TENSOR   16      // TfLiteEvalTensor + dims
+#define PERSISTENT_PER_OP       64      // Node, registration and op data
+#define PERSISTENT_PER_SCALE    8       // Per channel quantization (multiplier + shift)
+
+
+/*******************************************************************
+ * Minimal read-only access to the TFLite flatbuffer (schema.fbs)
+ *******************************************************************/
+class FlatBuffer
+{
+    protected:
+        std::vector<uint8_t> data;
+
+    public:
+        bool Load(std::string _file)
+        {
+            FILE *pFile = fopen(_file.c_str(), "rb");
+
+            if (pFile == NULL) {
+                return false;
+            }
+
+            fseek(pFile, 0, SEEK_END);
+            data.resize(ftell(pFile));
+            fseek(pFile, 0, SEEK_SET);
+            bool ok = fread(data.data(), 1, data.size(), pFile) == data.size();
+            fclose(pFile);
+
+            return ok && (data.size() >= 8) && (memcmp(&data[4], "TFL3", 4) == 0);
+        }
+
+        bool valid(size_t _pos, size_t _size) { return _pos + _size <= data.size(); }
+        uint32_t u32(size_t _pos) { return valid(_pos, 4) ? data[_pos] | (data[_pos + 1] << 8) | (data[_pos + 2] << 16) | ((uint32_t)data[_pos + 3] << 24) : 0; }
+        uint16_t u16(size_t _pos) { return valid(_pos, 2) ? data[_pos] | (data[_pos + 1] << 8) : 0; }
+        uint8_t u8(size_t _pos) { return valid(_pos, 1) ? data[_pos] : 0; }
+
+        size_t root() { return u32(0); }
+
+        /* Position of a table field, 0 if not set */
+        size_t field(size_t _table, int _id)
+        {
+            size_t vtable = _table - (int32_t)u32(_table);
+            uint16_t vtableSize = u16(vtable);
+
+            if (4 + 2 * _id >= vtableSize) {
+                return 0;
+            }
+
+            uint16_t offset = u16(vtable + 4 + 2 * _id);
+            return offset ? _table + offset : 0;
+        }
+
+        /* Vector referenced by a field: position of the first element, 0 if not set */
+        size_t vector(size_t _table, int _id, uint32_t *_length)
+        {
+            size_t pos = field(_table, _id);
+            *_length = 0;
+
+            if (pos == 0) {
+                return 0;
+            }
+
+            size_t vec = pos + u32(pos);
+            *_length = u32(vec);
+            return vec + 4;
+        }
+
+        size_t table(size_t _element) { return _element + u32(_element); } // Element of a vector of tables
+};
+
+
+static int tensorTypeSize(int _type)
+{
+    switch (_type) {
+        case 0:  return 4;  // FLOAT32
+        case 1:  return 2;  // FLOAT16
+        case 2:  return 4;  // INT32
+        case 3:  return 1;  // UINT8
+        case 4:  return 8;  // INT64
+        case 6:  return 1;  // BOOL
+        case 7:  return 2;  // INT16
+        case 8:  return 8;  // COMPLEX64
+        case 9:  return 1;  // INT8
+        case 10: return 8;  // FLOAT64
+        default: return 4;
+    }
+}
+
+
+struct ArenaBuffer {
+    size_t size;
+    int firstUse, lastUse;
+    size_t offset;
+};
+
+
+/* Greedy placement like the TFLM memory planner: largest buffers first, lowest offset without lifetime overlap */
+static size_t planBuffers(std::vector<ArenaBuffer> &_buffers)
+{
+    std::vector<ArenaBuffer *> order;
+    std::vector<ArenaBuffer *> placed;
+    size_t total = 0;
+
+    for (size_t i = 0; i < _buffers.size(); ++i) {
+        order.push_back(&_buffers[i]);
+    }
+
+    std::stable_sort(order.begin(), order.end(), [](ArenaBuffer *a, ArenaBuffer *b) { return a->size > b->size; });
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        ArenaBuffer *buffer = order[i];
+        size_t offset = 0;
+        bool moved = true;
+
+        while (moved) {
+            moved = false;
+
+            for (size_t j = 0; j < placed.size(); ++j) {
+                ArenaBuffer *other = placed[j];
+                bool lifetimeOverlap = (buffer->firstUse <= other->lastUse) && (other->firstUse <= buffer->lastUse);
+                bool memoryOverlap = (offset < other->offset + other->size) && (other->offset < offset + buffer->size);
+
+                if (lifetimeOverlap && memoryOverlap) {
+                    offset = other->offset + other->size;
+                    offset = (offset + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1);
+                    moved = true;
+                }
+            }
+        }
+
+        buffer->offset = offset;
+        placed.push_back(buffer);
+        total = std::max(total, offset + buffer->size);
+    }
+
+    return total;
+}
+
+
+/**
+ * Estimate the Tensor Arena of the first subgraph: planned activation tensors + persistent data.
+ * Kernel scratch buffers (e.g. ESP-NN) are not part of the model file and not included.
+ */
+static size_t estimateArena(FlatBuffer &_fb)
+{
+    size_t model = _fb.root();
+    uint32_t subgraphCount, bufferCount, tensorCount, opCount, graphInputCount, graphOutputCount;
+    size_t subgraphs = _fb.vector(model, 2, &subgraphCount);
+    size_t buffers = _fb.vector(model, 4, &bufferCount);
+
+    if (subgraphCount == 0) {
+        return 0;
+    }
+
+    size_t subgraph = _fb.table(subgraphs);
+    size_t tensors = _fb.vector(subgraph, 0, &tensorCount);
+    size_t graphInputs = _fb.vector(subgraph, 1, &graphInputCount);
+    size_t graphOutputs = _fb.vector(subgraph, 2, &graphOutputCount);
+    size_t ops = _fb.vector(subgraph, 3, &opCount);
+
+    std::vector<ArenaBuffer> tensorBuffers(tensorCount);
+    std::vector<bool> constant(tensorCount, false);
+    size_t persistent = PERSISTENT_BASE + tensorCount * PERSISTENT_PER_TENSOR + opCount * PERSISTENT_PER_OP;
+
+    for (uint32_t i = 0; i < tensorCount; ++i) {
+        size_t tensor = _fb.table(tensors + 4 * i);
+        uint32_t dimCount, dataLength = 0, scaleCount = 0;
+        size_t dims = _fb.vector(tensor, 0, &dimCount);
+        size_t typeField = _fb.field(tensor, 1);
+        size_t bufferField = _fb.field(tensor, 2);
+        size_t quantField = _fb.field(tensor, 4);
+        size_t bytes = tensorTypeSize(typeField ? _fb.u8(typeField) : 0);
+
+        for (uint32_t d = 0; d < dimCount; ++d) {
+            bytes *= std::max((int32_t)_fb.u32(dims + 4 * d), 1);
+        }
+
+        uint32_t bufferIndex = bufferField ? _fb.u32(bufferField) : 0;
+        if ((bufferIndex > 0) && (bufferIndex < bufferCount)) {
+            _fb.vector(_fb.table(buffers + 4 * bufferIndex), 0, &dataLength);
+        }
+
+        if (quantField) {
+            _fb.vector(quantField + _fb.u32(quantField), 2, &scaleCount);
+            persistent += scaleCount * PERSISTENT_PER_SCALE;
+        }
+
+        constant[i] = dataLength > 0;
+        tensorBuffers[i].size = (bytes + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1);
+        tensorBuffers[i].firstUse = -1;
+        tensorBuffers[i].lastUse = -1;
+    }
+
+    /* Lifetimes: graph inputs from the start, graph outputs until the end */
+    for (uint32_t i = 0; i < graphInputCount; ++i) {
+        uint32_t t = _fb.u32(graphInputs + 4 * i);
+        if (t < tensorCount) {
+            tensorBuffers[t].firstUse = 0;
+        }
+    }
+
+    for (uint32_t op = 0; op < opCount; ++op) {
+        size_t opTable = _fb.table(ops + 4 * op);
+        uint32_t inputCount, outputCount;
+        size_t inputs = _fb.vector(opTable, 1, &inputCount);
+        size_t outputs = _fb.vector(opTable, 2, &outputCount);
+
+        for (uint32_t i = 0; i < inputCount; ++i) {
+            int32_t t = _fb.u32(inputs + 4 * i);
+            if ((t >= 0) && (t < (int32_t)tensorCount)) {
+                if (tensorBuffers[t].firstUse < 0) {
+                    tensorBuffers[t].firstUse = op;
+                }
+                tensorBuffers[t].lastUse = op;
+            }
+        }
+
+        for (uint32_t i = 0; i < outputCount; ++i) {
+            int32_t t = _fb.u32(outputs + 4 * i);
+            if ((t >= 0) && (t < (int32_t)tensorCount)) {
+                if (tensorBuffers[t].firstUse < 0) {
+                    tensorBuffers[t].firstUse = op;
+                }
+                tensorBuffers[t].lastUse = std::max(tensorBuffers[t].lastUse, (int)op);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < graphOutputCount; ++i) {
+        uint32_t t = _fb.u32(graphOutputs + 4 * i);
+        if (t < tensorCount) {
+            tensorBuffers[t].lastUse = opCount;
+        }
+    }
+
+    std::vector<ArenaBuffer> activations;
+    for (uint32_t i = 0; i < tensorCount; ++i) {
+        if (!constant[i] && (tensorBuffers[i].firstUse >= 0)) {
+            activations.push_back(tensorBuffers[i]);
+        }
+    }
+
+    return planBuffers(activations) + persistent;
+}
+
+
+static std::string kb(size_t _bytes)
+{
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%.1f KB", _bytes / 1024.0);
+    return std::string(buf);
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::string dir = (argc > 1) ? argv[1] : "../../sd-card/config";
+    std::vector<std::string> models;
+
+    DIR *pDir = opendir(dir.c_str());
+    if (pDir == NULL) {
+        printf("Usage: model-arena [<model-dir>]  (default: ../../sd-card/config)\n");
+        return 2;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(pDir)) != NULL) {
+        std::string name = entry->d_name;
+        if ((name.size() > 7) && (name.compare(name.size() - 7, 7, ".tflite") == 0)) {
+            models.push_back(name);
+        }
+    }
+    closedir(pDir);
+    std::sort(models.begin(), models.end());
+
+    printf("%-32s %12s %14s %14s %14s\n", "Model", "File", "Arena measured", "Arena estimate", "Shared need");
+
+    size_t maxArena = 0;
+    for (size_t i = 0; i < models.size(); ++i) {
+        std::string file = dir + "/" + models[i];
+        FlatBuffer fb;
+
+        if (!fb.Load(file)) {
+            printf("%-32s not a TFLite model\n", models[i].c_str());
+            continue;
+        }
+
+        FILE *pFile = fopen(file.c_str(), "rb");
+        fseek(pFile, 0, SEEK_END);
+        size_t modelSize = ftell(pFile);
+        fclose(pFile);
+
+        size_t measured = tflite_read_arena_info(file);
+        size_t estimate = estimateArena(fb);
+        size_t arena = (measured > 0) ? measured : estimate;
+        size_t arenaReserved = (arena + TENSOR_ARENA_SPARE + 15) & ~((size_t)15);
+        maxArena = std::max(maxArena, arenaReserved);
+
+        printf("%-32s %12s %14s %14s %14s\n", models[i].c_str(), kb(modelSize).c_str(),
+                (measured > 0) ? kb(measured).c_str() : "-", kb(estimate).c_str(), kb(arenaReserved + modelSize).c_str());
+    }
+
+    printf("\nShared need: Tensor Arena (measured, else estimated, + %s spare) + model.\n"
+           "Largest Tensor Arena: %s (default reservation: %s).\n"
+           "Take Image and Aligning use the shared region too, see tools/memory-planner for the size of the whole region.\n",
+           kb(TENSOR_ARENA_SPARE).c_str(), kb(maxArena).c_str(), kb(TENSOR_ARENA_SIZE).c_str());
+
+    return 0;
+}